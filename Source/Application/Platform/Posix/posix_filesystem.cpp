@@ -0,0 +1,116 @@
+#ifndef _WIN32
+#include "posix_filesystem.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// size of regular file behind descriptor, 0 if it can't be loaded or mapped
+static u64 GetLoadableSize(int File) {
+	struct stat Stat{};
+	if (fstat(File, &Stat) != 0 || !S_ISREG(Stat.st_mode) || Stat.st_size <= 0 || Stat.st_size >= InvalidIndex) {
+		return 0;
+	}
+	return (u64) Stat.st_size;
+}
+
+static bool ReadAll(int File, char* Destination, u64 Size) {
+	while (Size > 0) {
+		const ssize_t Read = read(File, Destination, Size);
+		if (Read <= 0) {
+			return false;
+		}
+		Destination += Read;
+		Size -= (u64) Read;
+	}
+	return true;
+}
+
+static bool WriteAll(str_view Filepath, const char* Source, u64 Size) {
+	const int File = open(str{Filepath}.GetData(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (File < 0) {
+		return false;
+	}
+	bool Written = true;
+	while (Size > 0) {
+		const ssize_t Count = write(File, Source, Size);
+		if (Count <= 0) {
+			Written = false;
+			break;
+		}
+		Source += Count;
+		Size -= (u64) Count;
+	}
+	return close(File) == 0 && Written;
+}
+
+dyn_array<u8> posix_filesystem::LoadRawFile(str_view Filepath) {
+	dyn_array<u8> Result{};
+	const int File = open(str{Filepath}.GetData(), O_RDONLY);
+	if (File < 0) {
+		return Result;
+	}
+	const u64 Size = GetLoadableSize(File);
+	if (Size > 0 && !ReadAll(File, (char*) Result.AppendUninitialized((index) Size).GetData(), Size)) {
+		Result.Clear();
+	}
+	close(File);
+	return Result;
+}
+
+str posix_filesystem::LoadTextFile(str_view Filepath) {
+	str Result{};
+	const int File = open(str{Filepath}.GetData(), O_RDONLY);
+	if (File < 0) {
+		return Result;
+	}
+	const u64 Size = GetLoadableSize(File);
+	if (Size > 0 && !ReadAll(File, Result.AppendUninitialized((index) Size).GetData(), Size)) {
+		Result = str{};
+	}
+	close(File);
+	return Result;
+}
+
+bool posix_filesystem::SaveRawFile(str_view Filepath, span<u8> Data) {
+	if (Data.IsEmpty()) {
+		return false;
+	}
+	return WriteAll(Filepath, (const char*) Data.GetData(), Data.GetSize());
+}
+
+bool posix_filesystem::SaveTextFile(str_view Filepath, str_view Data) {
+	if (Data.IsEmpty()) {
+		return false;
+	}
+	// views of str include null terminator, it doesn't go into file
+	const bool Terminated = Data[Data.GetSize() - 1] == 0;
+	return WriteAll(Filepath, Data.GetData(), Data.GetSize() - Terminated);
+}
+
+mapped_file posix_filesystem::MapFile(str_view Filepath) {
+	mapped_file Result{};
+	const int File = open(str{Filepath}.GetData(), O_RDONLY);
+	if (File < 0) {
+		return Result;
+	}
+	const u64 Size = GetLoadableSize(File);
+	// mapping keeps file referenced, so descriptor can be closed right away
+	void* View = Size > 0 ? mmap(nullptr, Size, PROT_READ, MAP_PRIVATE, File, 0) : MAP_FAILED;
+	close(File);
+	if (View == MAP_FAILED) {
+		return Result;
+	}
+	Result.Data = static_cast<const u8*>(View);
+	Result.Size = Size;
+	return Result;
+}
+
+void posix_filesystem::UnmapFile(mapped_file& File) {
+	if (File.Data) {
+		munmap((void*) File.Data, File.Size);
+	}
+	File = {};
+}
+#endif
\ No newline at end of file
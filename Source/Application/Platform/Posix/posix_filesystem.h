@@ -0,0 +1,15 @@
+#pragma once
+
+#include "Core/String/str.h"
+#include "Application/Platform/filesystem_types.h"
+
+namespace posix_filesystem {
+	// NOTE: paths from str_view are copied to str because str_view is not guaranteed to be null terminated
+	dyn_array<u8> LoadRawFile(str_view Filepath);
+	str LoadTextFile(str_view Filepath);
+	bool SaveRawFile(str_view Filepath, span<u8> Data);
+	bool SaveTextFile(str_view Filepath, str_view Data);
+	// returns invalid mapped_file if file can't be opened, is empty or doesn't fit into index
+	mapped_file MapFile(str_view Filepath);
+	void UnmapFile(mapped_file& File);
+};
\ No newline at end of file
@@ -1,6 +1,10 @@
 #include "windows_filesystem.h"
 #include <fstream>
 
+#ifdef WIN32
+#include <windows.h>
+#endif
+
 dyn_array<u8> windows_filesystem::LoadRawFile(str_view Filepath) {
 	dyn_array<u8> Result{};
 	std::ifstream File{str{Filepath}.GetData(), std::ios::binary};
@@ -61,3 +65,40 @@ bool windows_filesystem::SaveTextFile(str_view Filepath, str_view Data) {
 	}
 	return true;
 }
+
+#ifdef WIN32
+mapped_file windows_filesystem::MapFile(str_view Filepath) {
+	mapped_file Result{};
+	HANDLE File = CreateFileA(
+		str{Filepath}.GetData(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (File == INVALID_HANDLE_VALUE) {
+		return Result;
+	}
+	LARGE_INTEGER FileSize{};
+	if (!GetFileSizeEx(File, &FileSize) || FileSize.QuadPart == 0 || FileSize.QuadPart >= InvalidIndex) {
+		CloseHandle(File);
+		return Result;
+	}
+	// mapping keeps file open and view keeps mapping alive, so both handles can be closed right away
+	HANDLE Mapping = CreateFileMappingA(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(File);
+	if (!Mapping) {
+		return Result;
+	}
+	const void* View = MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(Mapping);
+	if (!View) {
+		return Result;
+	}
+	Result.Data = static_cast<const u8*>(View);
+	Result.Size = static_cast<u64>(FileSize.QuadPart);
+	return Result;
+}
+
+void windows_filesystem::UnmapFile(mapped_file& File) {
+	if (File.Data) {
+		UnmapViewOfFile(File.Data);
+	}
+	File = {};
+}
+#endif
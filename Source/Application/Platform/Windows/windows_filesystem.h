@@ -11,4 +11,7 @@ namespace windows_filesystem {
 	str LoadTextFile(str_view Filepath);
 	bool SaveRawFile(str_view Filepath, span<u8> Data);
 	bool SaveTextFile(str_view Filepath, str_view Data);
+	// returns invalid mapped_file if file can't be opened, is empty or doesn't fit into index
+	mapped_file MapFile(str_view Filepath);
+	void UnmapFile(mapped_file& File);
 };
\ No newline at end of file
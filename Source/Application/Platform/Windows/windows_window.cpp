@@ -6,6 +6,7 @@
 #include "Containers/algo.h"
 #include "glfw_keykodes_table.h"
 #include "Logs/logs.h"
+#include "Profiler/profiler.h"
 #include <GLFW/glfw3.h>
 
 struct proc_data {
@@ -91,6 +92,7 @@ windows_window::~windows_window() {
 }
 
 window_process_result windows_window::ProcessExternalEvents() {
+	PROFILE_SCOPE("ProcessExternalEvents");
 	window_process_result Result;
 	Result.Input.LastFrame = FrameInput;
 	proc_data Data{Result, FrameInput, *this};
@@ -131,6 +133,7 @@ bool windows_window::ShouldClose() const {
 }
 
 void windows_window::SwapBuffers() {
+	PROFILE_SCOPE("SwapBuffers");
 	glfwSwapBuffers(Window);
 }
 
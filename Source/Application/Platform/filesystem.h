@@ -3,4 +3,7 @@
 #ifdef _WIN32
 #include "Windows/windows_filesystem.h"
 namespace filesystem = windows_filesystem;
+#else
+#include "Posix/posix_filesystem.h"
+namespace filesystem = posix_filesystem;
 #endif
\ No newline at end of file
@@ -1,4 +1,20 @@
 #pragma once
 
 #include "basic.h"
-#include "Containers/dyn_array.h"
\ No newline at end of file
+#include "Containers/dyn_array.h"
+
+// read-only view of a whole file mapped into address space, pages are loaded lazily on first access
+struct mapped_file {
+	const u8* Data{nullptr};
+	u64 Size{0};
+
+	[[nodiscard]] FORCEINLINE bool IsValid() const {
+		return Data != nullptr;
+	}
+
+	// MapFile() refuses files that don't fit into index
+	[[nodiscard]] FORCEINLINE span<u8> GetView() const {
+		CHECK(Size < InvalidIndex)
+		return span<u8>{Data, (index) Size};
+	}
+};
\ No newline at end of file
@@ -1,16 +1,23 @@
 #include "application.h"
-#include "Application/Platform/platform.h"
 #include "Logs/logs.h"
+#include "Profiler/profiler.h"
+#include "Time/cycle_clock.h"
+
+static const char* FrameStageNames[] = {
+	"ProcessExternalEvents", "HandleMessages", "GameStep", "RenderViews", "RenderUI", "SwapBuffers"};
+static_assert(sizeof(FrameStageNames) / sizeof(FrameStageNames[0]) == (index) frame_stage::count);
 
 struct time_update_result {
 	float DeltaTime{0.f};
 	float NewTime{0.f};
 };
 
-static time_update_result UpdateTime(float LastFrameTime) {
-	const float NewTime = platform::GetTime();
-	const float DeltaTime = NewTime - LastFrameTime;
-	return {DeltaTime, NewTime};
+// delta is taken from integer nanoseconds, so it doesn't lose precision as time since start grows
+static time_update_result UpdateTime(s64 StartNs, s64& LastFrameNs) {
+	const s64 NowNs = cycle_clock::GetNs();
+	const float DeltaTime = (float) ((double) (NowNs - LastFrameNs) * 1e-9);
+	LastFrameNs = NowNs;
+	return {DeltaTime, (float) ((double) (NowNs - StartNs) * 1e-9)};
 }
 
 application::application(const application_settings& InSettings)
@@ -18,19 +25,38 @@ application::application(const application_settings& InSettings)
 	, Window{InSettings.WindowWidth, InSettings.WindowHeight}
 	, Renderer{InSettings.WindowWidth, InSettings.WindowHeight}
 	, Game{}
-	, Time{0.f} {
+	, Time{0.f}
+	, StartNs{cycle_clock::GetNs()}
+	, LastFrameNs{StartNs}
+	, FrameStats{span<const char*>{FrameStageNames, (index) frame_stage::count}} {
+	profiler::SetThreadName("Main");
 }
 
 bool application::RunOneFrame() {
-	const auto [DeltaTime, NewTime] = UpdateTime(Time);
+	profiler::MarkFrame();
+	PROFILE_SCOPE("Frame");
+	const s64 FrameBeginNs = LastFrameNs;
+	const auto [DeltaTime, NewTime] = UpdateTime(StartNs, LastFrameNs);
+	// the first frame measures startup
+	if (FrameBeginNs != StartNs) {
+		FrameStats.EndFrame(LastFrameNs - FrameBeginNs);
+	}
+	s64 StageBeginNs = LastFrameNs;
 	const auto [Input, WindowMessages, WindowState] = Window.ProcessExternalEvents();
+	StageBeginNs = FrameStats.EndStage((index) frame_stage::process_external_events, StageBeginNs);
 	const auto RenderState = Renderer.HandleMessages(WindowMessages);
+	StageBeginNs = FrameStats.EndStage((index) frame_stage::handle_messages, StageBeginNs);
 	const auto [Views, UIData, GameMessages] = Game.Step(NewTime, DeltaTime, Input, WindowState, RenderState);
+	StageBeginNs = FrameStats.EndStage((index) frame_stage::game_step, StageBeginNs);
 	const auto MessagesLeft = Window.HandleMessages(GameMessages);
 	Renderer.HandleMessages(MessagesLeft);
+	StageBeginNs = FrameStats.EndStage((index) frame_stage::handle_messages, StageBeginNs);
 	Renderer.RenderViews(Views);
+	StageBeginNs = FrameStats.EndStage((index) frame_stage::render_views, StageBeginNs);
 	Renderer.RenderUI(UIData);
+	StageBeginNs = FrameStats.EndStage((index) frame_stage::render_ui, StageBeginNs);
 	Window.SwapBuffers();
+	FrameStats.EndStage((index) frame_stage::swap_buffers, StageBeginNs);
 	Time = NewTime;
 	return !Window.ShouldClose();
 }
@@ -3,6 +3,18 @@
 #include "Platform/window.h"
 #include "Rendering/renderer.h"
 #include "Game/game.h"
+#include "Profiler/frame_stats.h"
+
+// stages of one frame in frame statistics
+enum class frame_stage : index {
+	process_external_events,
+	handle_messages,
+	game_step,
+	render_views,
+	render_ui,
+	swap_buffers,
+	count
+};
 
 struct application_settings {
 public:
@@ -17,7 +29,11 @@ public:
 	window Window;
 	renderer Renderer;
 	game Game;
+	// seconds since start
 	float Time;
+	s64 StartNs;
+	s64 LastFrameNs;
+	frame_stats FrameStats;
 
 	explicit application(const application_settings& InSettings);
 	bool RunOneFrame();
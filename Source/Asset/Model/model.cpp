@@ -8,12 +8,17 @@
 #include "ThirdParty/assimp/include/assimp/scene.h"
 #include "ThirdParty/assimp/include/assimp/Importer.hpp"
 #include "Logs/logs.h"
+#include "Logs/log_throttle.h"
+#include "Profiler/profiler.h"
+
+static logs::category ModelCategory{atom{"Model"}};
 
 static void ProcessNode(model& Model, aiNode* Node, const aiScene* Scene);
 static mesh ProcessMesh(model& Model, aiMesh* MeshData, const aiScene* Scene);
 static dyn_array<texture> LoadTextures(model& Model, aiMaterial* Material, aiTextureType Type);
 
 void model::Load(const str& Path) {
+	PROFILE_SCOPE("LoadModel");
 	mMeshes.Clear();
 
 	Assimp::Importer Importer;
@@ -23,12 +28,12 @@ void model::Load(const str& Path) {
 			aiProcess_GenNormals);
 
 	if (!Scene || Scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !Scene->mRootNode) {
-		logs::Log<logs::verbosity::error>("Can't load model using path {}", Path);
+		logs::Log<logs::verbosity::error>(ModelCategory, "Can't load model using path {}", Path);
 		CHECK(false);
 		return;
 	}
 	
-	logs::Log<logs::verbosity::debug>("Loaded model using path {}", Path);
+	LOG_RATE_LIMITED(debug, ModelCategory, 20, "Loaded model using path {}", Path);
 
 	index LastBackspace = strings::FindLastOf(Path, '/');
 	mDirectory = LastBackspace != InvalidIndex ? strings::GetSubstring(Path, 0, LastBackspace) : Path;
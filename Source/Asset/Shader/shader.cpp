@@ -5,9 +5,12 @@
 #include "glm/gtc/type_ptr.hpp"
 #include "Containers/span.h"
 #include "Logs/logs.h"
+#include "Profiler/profiler.h"
 
 #include <fstream>
 
+static logs::category ShaderCategory{atom{"Shader"}};
+
 
 shader::shader(shader&& Shader) noexcept {
 	RendererId = Shader.RendererId;
@@ -137,6 +140,7 @@ static std::ifstream& GetLine(std::ifstream& Stream, str& String) {
 }
 
 shader::parsed_shaders shader::ParseShader(const str_view Path) {
+	PROFILE_SCOPE("ParseShader");
 	// NOTE: need to convert to string to allocate space for null terminator because garbage std functions
 	// TODO: would be nice to have some way to easily allocate arbitrary length string on the stack
 	std::ifstream InputFile(str{Path}.GetRaw(), std::ios::in);
@@ -188,12 +192,12 @@ shader::parsed_shaders shader::ParseShader(const str_view Path) {
 	}
 	
 	if (Result.VertexShader.IsEmpty()) {
-		logs::Log<logs::verbosity::error>("Can't load shader using path {}", Path);
+		logs::Log<logs::verbosity::error>(ShaderCategory, "Can't load shader using path {}", Path);
 		CHECK(false);
 		return Result;
 	}
 	
-	logs::Log<logs::verbosity::debug>("Loaded shader using path {}", Path);
+	logs::Log<logs::verbosity::debug>(ShaderCategory, "Loaded shader using path {}", Path);
 	
 	return Result;
 }
@@ -211,7 +215,7 @@ u32 shader::CompileShader(u32 Type, const str& Source) {
 		glGetShaderiv(Index, GL_INFO_LOG_LENGTH, &Length);
 		char* Message = static_cast<char*>(alloca(static_cast<u64>(Length) * sizeof(char)));
 		glGetShaderInfoLog(Index, Length, &Length, Message);
-		logs::Log<logs::verbosity::error>("Error loading shader: {}", Message);
+		logs::Log<logs::verbosity::error>(ShaderCategory, "Error loading shader: {}", Message);
 		glDeleteShader(Index);
 		CHECK(false)
 		return 0;
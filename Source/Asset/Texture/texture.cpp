@@ -3,6 +3,10 @@
 #include "glad/glad.h"
 #include "stb_image.h"
 #include "Logs/logs.h"
+#include "Logs/log_throttle.h"
+#include "Profiler/profiler.h"
+
+static logs::category TextureCategory{atom{"Texture"}};
 
 static void ClearTextureHandle(texture& Texture) {
 	if (Texture.mRendererId != 0) {
@@ -35,6 +39,7 @@ texture& texture::operator=(texture&& Texture) noexcept {
 }
 
 void texture::Load(const str_view Path, bool SRGB) {
+	PROFILE_SCOPE("LoadTexture");
 	ClearTextureHandle(*this);
 	mPath = Path;
 	auto& Cache = GetTextureCache();
@@ -75,12 +80,12 @@ void texture::Load(const str_view Path, bool SRGB) {
 			glBindTexture(GL_TEXTURE_2D, 0);
 			stbi_image_free(mLocalBuffer);
 		} else {
-			logs::Log<logs::verbosity::error>("Can't open texture file using path {}", Path);
+			logs::Log<logs::verbosity::error>(TextureCategory, "Can't open texture file using path {}", Path);
 			CHECK(false);
 			return;
 		}
 	}
-	logs::Log<logs::verbosity::debug>("Loaded texture using path {}", Path);
+	LOG_RATE_LIMITED(debug, TextureCategory, 20, "Loaded texture using path {}", Path);
 }
 
 texture::~texture() {
@@ -1,30 +1,24 @@
 #pragma once
 
+#include "basic.h"
+#include "Concurrency/epoch.h"
+#include "Concurrency/mutex.h"
+#include "Concurrency/spinlock.h"
+#include "Math/math.h"
+#include "Memory/allocator_base.h"
+
 #include <limits>
 #include <type_traits>
 #include <cstdlib>
-#include <mutex>
+#include <cstring>
 #include <vector>
 #include <atomic>
 #include <thread>
 
 namespace DaniilPavlenko {
-struct spinlock {
-private:
-	std::atomic<bool> Flag{0};
-
-public:
-	void Lock() {
-		while (Flag.exchange(1, std::memory_order_acquire)) {
-			_mm_pause();
-		}
-	}
-
-	void Unlock() {
-		Flag.store(0, std::memory_order_release);
-	}
-};
-
+// Element locks serialize access to single slots, growth locks every slot of the table and publishes a new one.
+// Readers find the table through one atomic pointer while pinned by an epoch guard,
+// old tables are retired to epoch reclamation, so threads still probing them never touch freed memory.
 template <typename key_type, typename value_type>
 struct ConcurrentMap {
 private:
@@ -38,50 +32,56 @@ private:
 	constexpr static index MinCapacity = 32;
 	constexpr static float MaxLoadFactor = 0.7f;
 
-	__declspec(align(64)) struct map_element {
+	struct alignas(CacheLineSize) map_element {
 		hash_type Hash;
 		spinlock AccessLock;
 		key_type Key;
 		value_type Value;
 	};
 
-	map_element* Data = nullptr;
-	map_element* OldData = nullptr;
-	index Capacity = MinCapacity;
+	// header and elements are one allocation, so a table is retired and freed as a whole
+	struct alignas(CacheLineSize) map_table {
+		index Capacity;
+		index MaxSize;
+
+		FORCEINLINE map_element* GetElements() {
+			return reinterpret_cast<map_element*>(this + 1);
+		}
+	};
+
+	std::atomic<map_table*> Table = nullptr;
 	std::atomic<index> Size = 0;
 	std::atomic<index> Deleted = 0;
-	index MaxSize = static_cast<index>(MinCapacity * MaxLoadFactor);
-	std::mutex RelocateMutex;
+	mutex RelocateMutex;
 
 public:
-	__forceinline ConcurrentMap() {
-		Data = (map_element*) _aligned_malloc(MinCapacity * sizeof(map_element), 64);
-		for (map_element* MapElem = Data; MapElem != Data + MinCapacity; ++MapElem) {
-			MapElem->Hash = EmptyHash;
-			MapElem->AccessLock.Unlock();
-		}
+	FORCEINLINE ConcurrentMap() {
+		Table.store(AllocateTable(MinCapacity), std::memory_order_relaxed);
 	}
 
-	__forceinline ~ConcurrentMap() {
-		for (map_element* Elem = Data; Elem != Data + Capacity; ++Elem) {
+	FORCEINLINE ~ConcurrentMap() {
+		map_table* Current = Table.load(std::memory_order_relaxed);
+		map_element* Data = Current->GetElements();
+		for (map_element* Elem = Data; Elem != Data + Current->Capacity; ++Elem) {
 			if (Elem->Hash <= LastValidHash) {
 				Elem->Value.~value_type();
 				Elem->Key.~key_type();
 			}
 		}
-		_aligned_free(Data);
-		Data = nullptr;
-		Capacity = 0;
-		MaxSize = 0;
-		Size.store(0, std::memory_order::memory_order_relaxed);
-		Deleted.store(0, std::memory_order::memory_order_relaxed);
+		FreeTable(Current);
+		Table.store(nullptr, std::memory_order_relaxed);
+		Size.store(0, std::memory_order_relaxed);
+		Deleted.store(0, std::memory_order_relaxed);
 	}
 
 	value_type operator[](const key_type& Key) {
 		value_type Result;
 		hash_type Hash = GetHash(Key);
+		epoch::guard Guard;
 		while (true) {
-			index HashMask = (1 << LogOfTwoCeil(Capacity)) - 1;
+			map_table* Current = Table.load(std::memory_order_acquire);
+			map_element* Data = Current->GetElements();
+			index HashMask = Current->Capacity - 1;
 			index Iteration = 0;
 			map_element* CurrentElem;
 			bool Relocated = false;
@@ -108,25 +108,13 @@ public:
 			}
 			index PreLockSize = Size.load(std::memory_order_relaxed);
 			index PreLockDeleted = Deleted.load(std::memory_order_relaxed);
-			const bool RelocationNeeded = (PreLockSize + PreLockDeleted + 1) > MaxSize;
+			const bool RelocationNeeded = (PreLockSize + PreLockDeleted + 1) > Current->MaxSize;
 			if (RelocationNeeded) [[unlikely]] {
 				CurrentElem->AccessLock.Unlock();
-				RelocateMutex.lock();
-				index PostLockSize = Size.load(std::memory_order_relaxed);
-				index PostLockDeleted = Deleted.load(std::memory_order_relaxed);
-				const bool RelocationStillNeeded = (PostLockSize + PostLockDeleted + 1) > MaxSize;
-				if (RelocationStillNeeded) {
-					map_element* OldData = Data;
-					index OldCapacity = Capacity;
-					LockAll();
-					constexpr index MAGIC_NUMBER = 100;
-					Relocate(PostLockSize + MAGIC_NUMBER);
-					OldDataUnlockAll(OldData, OldCapacity);
-				}
-				RelocateMutex.unlock();
+				Grow();
 				continue;
 			} else {
-				Size.fetch_add(1, std::memory_order::memory_order_relaxed);
+				Size.fetch_add(1, std::memory_order_relaxed);
 				CurrentElem->Hash = Hash;
 				new (&(CurrentElem->Key)) key_type(Key);
 				new (&(CurrentElem->Value)) value_type();
@@ -137,10 +125,14 @@ public:
 		}
 	}
 
+	// element stays locked until Unlock, which also keeps its table from being relocated and retired
 	value_type& AtLock(const key_type& Key) {
 		hash_type Hash = GetHash(Key);
+		epoch::guard Guard;
 		while (true) {
-			index HashMask = (1 << LogOfTwoCeil(Capacity)) - 1;
+			map_table* Current = Table.load(std::memory_order_acquire);
+			map_element* Data = Current->GetElements();
+			index HashMask = Current->Capacity - 1;
 			index Iteration = 0;
 			map_element* CurrentElem;
 			bool Relocated = false;
@@ -165,25 +157,13 @@ public:
 			}
 			index PreLockSize = Size.load(std::memory_order_relaxed);
 			index PreLockDeleted = Deleted.load(std::memory_order_relaxed);
-			const bool RelocationNeeded = (PreLockSize + PreLockDeleted + 1) > MaxSize;
+			const bool RelocationNeeded = (PreLockSize + PreLockDeleted + 1) > Current->MaxSize;
 			if (RelocationNeeded) [[unlikely]] {
 				CurrentElem->AccessLock.Unlock();
-				RelocateMutex.lock();
-				index PostLockSize = Size.load(std::memory_order_relaxed);
-				index PostLockDeleted = Deleted.load(std::memory_order_relaxed);
-				const bool RelocationStillNeeded = (PostLockSize + PostLockDeleted + 1) > MaxSize;
-				if (RelocationStillNeeded) {
-					map_element* OldData = Data;
-					index OldCapacity = Capacity;
-					LockAll();
-					constexpr index MAGIC_NUMBER = 100;
-					Relocate(PostLockSize + MAGIC_NUMBER);
-					OldDataUnlockAll(OldData, OldCapacity);
-				}
-				RelocateMutex.unlock();
+				Grow();
 				continue;
 			} else {
-				Size.fetch_add(1, std::memory_order::memory_order_relaxed);
+				Size.fetch_add(1, std::memory_order_relaxed);
 				CurrentElem->Hash = Hash;
 				new (&(CurrentElem->Key)) key_type(Key);
 				new (&(CurrentElem->Value)) value_type();
@@ -192,9 +172,12 @@ public:
 		}
 	}
 
-	__forceinline void Unlock(const key_type& Key) {
+	FORCEINLINE void Unlock(const key_type& Key) {
 		const hash_type Hash = GetHash(Key);
-		const index HashMask = (1 << LogOfTwoCeil(Capacity)) - 1;
+		epoch::guard Guard;
+		map_table* Current = Table.load(std::memory_order_acquire);
+		map_element* Data = Current->GetElements();
+		const index HashMask = Current->Capacity - 1;
 		index Iteration = 0;
 		map_element* CurrentElem;
 		for (CurrentElem = Data + (Hash & HashMask); CurrentElem->Hash != EmptyHash;
@@ -206,11 +189,45 @@ public:
 		}
 	}
 
-	__forceinline void Remove(const key_type& Key) {
+	// copies value of the key out, unlike operator[] never inserts
+	bool Find(const key_type& Key, value_type& OutValue) {
 		const hash_type Hash = GetHash(Key);
+		epoch::guard Guard;
+		while (true) {
+			map_table* Current = Table.load(std::memory_order_acquire);
+			map_element* Data = Current->GetElements();
+			const index HashMask = Current->Capacity - 1;
+			index Iteration = 0;
+			map_element* CurrentElem;
+			for (CurrentElem = Data + (Hash & HashMask);;
+				 CurrentElem = Data + ((Hash + TriangleNumber(++Iteration)) & HashMask)) {
+				CurrentElem->AccessLock.Lock();
+				if (CurrentElem->Hash == RelocatedHash) [[unlikely]] {
+					CurrentElem->AccessLock.Unlock();
+					break;
+				}
+				if (CurrentElem->Hash == EmptyHash) {
+					CurrentElem->AccessLock.Unlock();
+					return false;
+				}
+				if (CurrentElem->Hash == Hash && (Key == CurrentElem->Key)) {
+					OutValue = CurrentElem->Value;
+					CurrentElem->AccessLock.Unlock();
+					return true;
+				}
+				CurrentElem->AccessLock.Unlock();
+			}
+		}
+	}
+
+	FORCEINLINE void Remove(const key_type& Key) {
+		const hash_type Hash = GetHash(Key);
+		epoch::guard Guard;
 		while (true) {
 			bool Relocated = false;
-			const index HashMask = (1 << LogOfTwoCeil(Capacity)) - 1;
+			map_table* Current = Table.load(std::memory_order_acquire);
+			map_element* Data = Current->GetElements();
+			const index HashMask = Current->Capacity - 1;
 			index Iteration = 0;
 			map_element* CurrentElem;
 			for (CurrentElem = Data + (Hash & HashMask);;
@@ -243,21 +260,61 @@ public:
 		}
 	}
 
-	[[nodiscard]] __forceinline index GetSize() const {
+	[[nodiscard]] FORCEINLINE index GetSize() const {
 		return Size.load(std::memory_order_relaxed);
 	}
 
+	[[nodiscard]] FORCEINLINE index GetAllocatedSize() const {
+		return Table.load(std::memory_order_relaxed)->Capacity * sizeof(map_element);
+	}
+
 private:
-	void Relocate(index DesiredSize) {
-		const index NewCapacity = 1 << (LogOfTwoCeil(DesiredSize) + 1);
-		auto* const NewData = (map_element*) _aligned_malloc(NewCapacity * sizeof(map_element), alignof(map_element));
-		for (map_element* MapElem = NewData; MapElem != NewData + NewCapacity; ++MapElem) {
+	static map_table* AllocateTable(index Capacity) {
+		auto* const NewTable = (map_table*) MemoryAlignedMalloc(
+			sizeof(map_table) + Capacity * sizeof(map_element), alignof(map_element));
+		NewTable->Capacity = Capacity;
+		NewTable->MaxSize = (index) (MaxLoadFactor * Capacity);
+		map_element* NewData = NewTable->GetElements();
+		for (map_element* MapElem = NewData; MapElem != NewData + Capacity; ++MapElem) {
 			MapElem->Hash = EmptyHash;
 			MapElem->AccessLock.Unlock();
 		}
+		return NewTable;
+	}
+
+	// elements of retired tables are all relocated, nothing to destroy
+	static void FreeTable(void* InTable) {
+		MemoryAlignedFree(InTable);
+	}
+
+	// called by a pinned thread that saw the table full, only one thread relocates, the rest retry after it
+	void Grow() {
+		RelocateMutex.Lock();
+		// table is only replaced under RelocateMutex
+		map_table* OldTable = Table.load(std::memory_order_relaxed);
+		index PostLockSize = Size.load(std::memory_order_relaxed);
+		index PostLockDeleted = Deleted.load(std::memory_order_relaxed);
+		const bool RelocationStillNeeded = (PostLockSize + PostLockDeleted + 1) > OldTable->MaxSize;
+		if (RelocationStillNeeded) {
+			LockAll(OldTable);
+			constexpr index MAGIC_NUMBER = 100;
+			Relocate(OldTable, PostLockSize + MAGIC_NUMBER);
+			// threads waiting on old locks see RelocatedHash and retry with the new table
+			UnlockAll(OldTable);
+			epoch::Retire(OldTable, &FreeTable);
+		}
+		RelocateMutex.Unlock();
+	}
+
+	void Relocate(map_table* OldTable, index DesiredSize) {
+		const index NewCapacity = 1 << (math::LogOfTwoCeil(DesiredSize) + 1);
+		map_table* const NewTable = AllocateTable(NewCapacity);
+		map_element* const NewData = NewTable->GetElements();
+		map_element* const Data = OldTable->GetElements();
+		const index Capacity = OldTable->Capacity;
 		for (map_element* MapElem = Data; MapElem != Data + Capacity; ++MapElem) {
 			if (MapElem->Hash <= LastValidHash) {
-				const index HashMask = (1 << LogOfTwoCeil(NewCapacity)) - 1;
+				const index HashMask = NewCapacity - 1;
 				index Iteration = 0;
 				map_element* CurrentElem;
 				const hash_type Hash = MapElem->Hash;
@@ -274,48 +331,322 @@ private:
 		for (map_element* MapElem = Data; MapElem != Data + Capacity; ++MapElem) {
 			MapElem->Hash = RelocatedHash;
 		}
-		if (OldData) {
-			_aligned_free(OldData);
-		}
-		OldData = Data;
-		Data = NewData;
 		Deleted.store(0, std::memory_order_relaxed);
-		Capacity = NewCapacity;
-		MaxSize = (index) (MaxLoadFactor * Capacity);
+		Table.store(NewTable, std::memory_order_release);
 	}
 
-	__forceinline static size_t GetHash(const key_type& Key) {
+	FORCEINLINE static size_t GetHash(const key_type& Key) {
 		size_t Hash = std::hash<key_type>{}(Key);
 		return Hash - (Hash > LastValidHash) * 3;
 	}
 
-	__forceinline static index TriangleNumber(const index InIteration) {
+	FORCEINLINE static index TriangleNumber(const index InIteration) {
 		return (InIteration * (InIteration + 1)) >> 1;
 	}
 
-	__forceinline void LockAll() {
-		for (map_element* Iter = Data; Iter != Data + Capacity; ++Iter) {
+	FORCEINLINE static void LockAll(map_table* InTable) {
+		map_element* Data = InTable->GetElements();
+		for (map_element* Iter = Data; Iter != Data + InTable->Capacity; ++Iter) {
 			Iter->AccessLock.Lock();
 		}
 	}
 
-	__forceinline void OldDataUnlockAll(map_element* InData, index InCapacity) {
-		for (map_element* Iter = InData; Iter != InData + InCapacity; ++Iter) {
+	FORCEINLINE static void UnlockAll(map_table* InTable) {
+		map_element* Data = InTable->GetElements();
+		for (map_element* Iter = Data; Iter != Data + InTable->Capacity; ++Iter) {
 			Iter->AccessLock.Unlock();
 		}
 	}
+};
+
+// Same interface as ConcurrentMap, but slots don't carry their own locks. Control bytes, keys and values are
+// packed densely, and slots are guarded by StripeCount cache line sized locks. Neighbouring slots share a stripe,
+// so short probe sequences mostly stay under one lock. AtLock holds the stripe of the slot until Unlock,
+// other keys of the same stripe are blocked meanwhile, so AtLock calls must not nest.
+template <typename key_type, typename value_type, size_t StripeCount = 256>
+struct CompactConcurrentMap {
+	static_assert((StripeCount & (StripeCount - 1)) == 0, "stripe count has to be a power of 2");
 
-	__forceinline static index LogOfTwoCeil(index Value) {
-		unsigned long Index;
-		if (_BitScanReverse64(&Index, Value)) {
-			index result = Index;
-			if ((Value & ~((index) 1 << Index)) > 0) {
-				++result;
+private:
+	using hash_type = size_t;
+	using index = size_t;
+	using control_type = unsigned char;
+
+	// full slots store top 7 bits of hash, so most mismatching keys are rejected without touching entries
+	constexpr static control_type EmptyControl = 0x80;
+	constexpr static control_type DeletedControl = 0xfe;
+	constexpr static index MinCapacity = 32;
+	constexpr static float MaxLoadFactor = 0.7f;
+	constexpr static index SlotsPerStripeGroup = 8;
+
+	struct map_entry {
+		key_type Key;
+		value_type Value;
+	};
+
+	struct alignas(CacheLineSize) lock_stripe {
+		spinlock Lock;
+	};
+
+	lock_stripe Stripes[StripeCount];
+	control_type* Control = nullptr;
+	map_entry* Entries = nullptr;
+	index Capacity = MinCapacity;
+	std::atomic<index> Size = 0;
+	std::atomic<index> Deleted = 0;
+	index MaxSize = static_cast<index>(MinCapacity * MaxLoadFactor);
+	// changed with all stripes locked, so after locking any stripe it tells if arrays read before are still current
+	std::atomic<index> Generation = 0;
+	mutex RelocateMutex;
+
+public:
+	FORCEINLINE CompactConcurrentMap() {
+		Control = (control_type*) MemoryAlignedMalloc(MinCapacity * sizeof(control_type), CacheLineSize);
+		Entries = (map_entry*) MemoryAlignedMalloc(MinCapacity * sizeof(map_entry), CacheLineSize);
+		memset(Control, EmptyControl, MinCapacity * sizeof(control_type));
+	}
+
+	FORCEINLINE ~CompactConcurrentMap() {
+		for (index Slot = 0; Slot != Capacity; ++Slot) {
+			if (IsFull(Control[Slot])) {
+				Entries[Slot].~map_entry();
 			}
-			return result;
-		} else {
-			return 0ull;
 		}
+		MemoryAlignedFree(Control);
+		MemoryAlignedFree(Entries);
+		Control = nullptr;
+		Entries = nullptr;
+		Capacity = 0;
+		MaxSize = 0;
+		Size.store(0, std::memory_order_relaxed);
+		Deleted.store(0, std::memory_order_relaxed);
+	}
+
+	value_type operator[](const key_type& Key) {
+		index Slot;
+		spinlock& Lock = FindOrAddLocked(Key, Slot);
+		value_type Result = Entries[Slot].Value;
+		Lock.Unlock();
+		return Result;
 	}
+
+	value_type& AtLock(const key_type& Key) {
+		index Slot;
+		FindOrAddLocked(Key, Slot);
+		return Entries[Slot].Value;
+	}
+
+	// stripe of the key is held since AtLock, so table can't be relocated and slots before key can't become empty
+	FORCEINLINE void Unlock(const key_type& Key) {
+		const hash_type Hash = GetHash(Key);
+		const control_type KeyControl = GetControl(Hash);
+		const index HashMask = Capacity - 1;
+		index Iteration = 0;
+		for (index Slot = Hash & HashMask; Control[Slot] != EmptyControl;
+			 Slot = (Hash + TriangleNumber(++Iteration)) & HashMask) {
+			if (Control[Slot] == KeyControl && (Key == Entries[Slot].Key)) {
+				GetStripe(Slot).Unlock();
+				return;
+			}
+		}
+	}
+
+	// copies value of the key out, unlike operator[] never inserts
+	bool Find(const key_type& Key, value_type& OutValue) {
+		const hash_type Hash = GetHash(Key);
+		const control_type KeyControl = GetControl(Hash);
+		while (true) {
+			const index StartGeneration = Generation.load(std::memory_order_acquire);
+			const index HashMask = Capacity - 1;
+			index Iteration = 0;
+			index Slot = Hash & HashMask;
+			spinlock* Lock = nullptr;
+			for (;; Slot = (Hash + TriangleNumber(++Iteration)) & HashMask) {
+				if (!SwitchStripe(Lock, Slot, StartGeneration)) [[unlikely]] {
+					break;
+				}
+				if (Control[Slot] == EmptyControl) {
+					Lock->Unlock();
+					return false;
+				}
+				if (Control[Slot] == KeyControl && (Key == Entries[Slot].Key)) {
+					OutValue = Entries[Slot].Value;
+					Lock->Unlock();
+					return true;
+				}
+			}
+		}
+	}
+
+	FORCEINLINE void Remove(const key_type& Key) {
+		const hash_type Hash = GetHash(Key);
+		const control_type KeyControl = GetControl(Hash);
+		while (true) {
+			const index StartGeneration = Generation.load(std::memory_order_acquire);
+			const index HashMask = Capacity - 1;
+			index Iteration = 0;
+			index Slot = Hash & HashMask;
+			spinlock* Lock = nullptr;
+			for (;; Slot = (Hash + TriangleNumber(++Iteration)) & HashMask) {
+				if (!SwitchStripe(Lock, Slot, StartGeneration)) [[unlikely]] {
+					break;
+				}
+				if (Control[Slot] == EmptyControl) {
+					Lock->Unlock();
+					return;
+				}
+				if (Control[Slot] == KeyControl && (Key == Entries[Slot].Key)) {
+					Entries[Slot].~map_entry();
+					Control[Slot] = DeletedControl;
+					Deleted.fetch_add(1, std::memory_order_relaxed);
+					Size.fetch_sub(1, std::memory_order_relaxed);
+					Lock->Unlock();
+					return;
+				}
+			}
+		}
+	}
+
+	[[nodiscard]] FORCEINLINE index GetSize() const {
+		return Size.load(std::memory_order_relaxed);
+	}
+
+	[[nodiscard]] FORCEINLINE index GetAllocatedSize() const {
+		return sizeof(Stripes) + Capacity * (sizeof(control_type) + sizeof(map_entry));
+	}
+
+private:
+	// returns stripe of the slot locked, slot holds the key
+	spinlock& FindOrAddLocked(const key_type& Key, index& OutSlot) {
+		const hash_type Hash = GetHash(Key);
+		const control_type KeyControl = GetControl(Hash);
+		while (true) {
+			const index StartGeneration = Generation.load(std::memory_order_acquire);
+			const index HashMask = Capacity - 1;
+			index Iteration = 0;
+			index Slot = Hash & HashMask;
+			spinlock* Lock = nullptr;
+			bool Relocated = false;
+			for (;; Slot = (Hash + TriangleNumber(++Iteration)) & HashMask) {
+				if (!SwitchStripe(Lock, Slot, StartGeneration)) [[unlikely]] {
+					Relocated = true;
+					break;
+				}
+				if (Control[Slot] == EmptyControl) {
+					break;
+				}
+				if (Control[Slot] == KeyControl && (Key == Entries[Slot].Key)) {
+					OutSlot = Slot;
+					return *Lock;
+				}
+			}
+			if (Relocated) [[unlikely]] {
+				continue;
+			}
+			const index PreLockSize = Size.load(std::memory_order_relaxed);
+			const index PreLockDeleted = Deleted.load(std::memory_order_relaxed);
+			const bool RelocationNeeded = (PreLockSize + PreLockDeleted + 1) > MaxSize;
+			if (RelocationNeeded) [[unlikely]] {
+				Lock->Unlock();
+				RelocateMutex.Lock();
+				LockAll();
+				index PostLockSize = Size.load(std::memory_order_relaxed);
+				index PostLockDeleted = Deleted.load(std::memory_order_relaxed);
+				const bool RelocationStillNeeded = (PostLockSize + PostLockDeleted + 1) > MaxSize;
+				if (RelocationStillNeeded) {
+					constexpr index MAGIC_NUMBER = 100;
+					Relocate(PostLockSize + MAGIC_NUMBER);
+				}
+				UnlockAll();
+				RelocateMutex.Unlock();
+				continue;
+			}
+			Size.fetch_add(1, std::memory_order_relaxed);
+			new (&Entries[Slot]) map_entry{Key, value_type()};
+			Control[Slot] = KeyControl;
+			OutSlot = Slot;
+			return *Lock;
+		}
+	}
+
+	// Keeps stripe locked while probe stays inside it, returns false with nothing locked if table was relocated
+	FORCEINLINE bool SwitchStripe(spinlock*& Lock, index Slot, index StartGeneration) {
+		spinlock* SlotLock = &GetStripe(Slot);
+		if (SlotLock == Lock) {
+			return true;
+		}
+		if (Lock) {
+			Lock->Unlock();
+		}
+		Lock = SlotLock;
+		Lock->Lock();
+		if (Generation.load(std::memory_order_relaxed) != StartGeneration) [[unlikely]] {
+			Lock->Unlock();
+			return false;
+		}
+		return true;
+	}
+
+	FORCEINLINE spinlock& GetStripe(index Slot) {
+		return Stripes[(Slot / SlotsPerStripeGroup) & (StripeCount - 1)].Lock;
+	}
+
+	void Relocate(index DesiredSize) {
+		const index NewCapacity = (index) 1 << (math::LogOfTwoCeil(DesiredSize) + 1);
+		auto* const NewControl = (control_type*) MemoryAlignedMalloc(NewCapacity * sizeof(control_type), CacheLineSize);
+		auto* const NewEntries = (map_entry*) MemoryAlignedMalloc(NewCapacity * sizeof(map_entry), CacheLineSize);
+		memset(NewControl, EmptyControl, NewCapacity * sizeof(control_type));
+		const index HashMask = NewCapacity - 1;
+		for (index Slot = 0; Slot != Capacity; ++Slot) {
+			if (IsFull(Control[Slot])) {
+				const hash_type Hash = GetHash(Entries[Slot].Key);
+				index Iteration = 0;
+				index NewSlot;
+				for (NewSlot = Hash & HashMask; NewControl[NewSlot] != EmptyControl;
+					 NewSlot = (Hash + TriangleNumber(++Iteration)) & HashMask) {
+				}
+				new (&NewEntries[NewSlot]) map_entry(std::move(Entries[Slot]));
+				NewControl[NewSlot] = Control[Slot];
+				Entries[Slot].~map_entry();
+			}
+		}
+		MemoryAlignedFree(Control);
+		MemoryAlignedFree(Entries);
+		Control = NewControl;
+		Entries = NewEntries;
+		Deleted.store(0, std::memory_order_relaxed);
+		Capacity = NewCapacity;
+		MaxSize = (index) (MaxLoadFactor * Capacity);
+		Generation.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	FORCEINLINE void LockAll() {
+		for (lock_stripe& Stripe : Stripes) {
+			Stripe.Lock.Lock();
+		}
+	}
+
+	FORCEINLINE void UnlockAll() {
+		for (lock_stripe& Stripe : Stripes) {
+			Stripe.Lock.Unlock();
+		}
+	}
+
+	FORCEINLINE static bool IsFull(control_type SlotControl) {
+		return (SlotControl & EmptyControl) == 0;
+	}
+
+	FORCEINLINE static size_t GetHash(const key_type& Key) {
+		return std::hash<key_type>{}(Key);
+	}
+
+	FORCEINLINE static control_type GetControl(hash_type Hash) {
+		return static_cast<control_type>(Hash >> (sizeof(hash_type) * 8 - 7));
+	}
+
+	FORCEINLINE static index TriangleNumber(const index InIteration) {
+		return (InIteration * (InIteration + 1)) >> 1;
+	}
+
 };
 }	 // namespace DaniilPavlenko
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "basic.h"
+
+#include <thread>
+
+// Exponential backoff for spin-wait loops, every Pause() spins twice as long as the previous one.
+// After SpinRounds spinning is considered pointless, owner of the loop then yields or parks the thread
+// instead of burning the time slice that the thread it waits for may need.
+struct backoff {
+	constexpr static u32 SpinRounds = 8;
+
+	u32 Round{0};
+
+	[[nodiscard]] FORCEINLINE bool IsSpinning() const {
+		return Round < SpinRounds;
+	}
+
+	FORCEINLINE void Pause() {
+		for (u32 Iteration = 0; Iteration < (1u << Round); ++Iteration) {
+			CPU_PAUSE();
+		}
+		if (Round < SpinRounds) {
+			++Round;
+		}
+	}
+
+	FORCEINLINE void PauseOrYield() {
+		if (IsSpinning()) {
+			Pause();
+		} else {
+			std::this_thread::yield();
+		}
+	}
+};
@@ -1,11 +1,20 @@
 #pragma once
 
+#include "basic.h"
+#include "Concurrency/mutex.h"
+#include "Concurrency/seqlock.h"
+#include "Math/math.h"
+#include "Memory/allocator_base.h"
+
 #include <limits>
 #include <type_traits>
 #include <cstdlib>
-#include <mutex>
 #include <vector>
-#include "spinlock.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <cstring>
+#include <cstdint>
 
 enum class iterator_constness_test : unsigned char { constant, non_constant };
 
@@ -23,14 +32,14 @@ private:
 	pointer End = nullptr;
 
 public:
-	__forceinline concurrent_hash_table_iter() = default;
-	__forceinline concurrent_hash_table_iter(const concurrent_hash_table_iter&) = default;
-	__forceinline concurrent_hash_table_iter(concurrent_hash_table_iter&&) noexcept = default;
-	__forceinline ~concurrent_hash_table_iter() = default;
+	FORCEINLINE concurrent_hash_table_iter() = default;
+	FORCEINLINE concurrent_hash_table_iter(const concurrent_hash_table_iter&) = default;
+	FORCEINLINE concurrent_hash_table_iter(concurrent_hash_table_iter&&) noexcept = default;
+	FORCEINLINE ~concurrent_hash_table_iter() = default;
 	
-	__forceinline concurrent_hash_table_iter(pointer InBegin, pointer InEnd) : Element{InBegin}, End{InEnd} {}
+	FORCEINLINE concurrent_hash_table_iter(pointer InBegin, pointer InEnd) : Element{InBegin}, End{InEnd} {}
 
-	__forceinline concurrent_hash_table_iter& operator++() {
+	FORCEINLINE concurrent_hash_table_iter& operator++() {
 		for (;;) {
 			++Element;
 			if (Element == End || Element->Hash <= map_type::LastValidHash) {
@@ -40,15 +49,15 @@ public:
 		return *this;
 	}
 
-	__forceinline pointer operator->() {
+	FORCEINLINE pointer operator->() {
 		return Element;
 	}
 
-	__forceinline reference operator*() {
+	FORCEINLINE reference operator*() {
 		return *Element;
 	}
 
-	__forceinline bool operator==(const concurrent_hash_table_iter& Other) const {
+	FORCEINLINE bool operator==(const concurrent_hash_table_iter& Other) const {
 		return Element == Other.Element;
 	}
 };
@@ -60,243 +69,433 @@ struct concurrent_hash_table {
 
 	using iter = concurrent_hash_table_iter<concurrent_hash_table, iterator_constness_test::non_constant>;
 
-	__forceinline iter begin() {
-		for (map_element* FirstSetElem = Data; FirstSetElem != Data + Capacity; ++FirstSetElem) {
+	// not thread safe, pending migration is finished first so every element is in the current generation
+	FORCEINLINE iter begin() {
+		generation* Gen = FinishMigration();
+		for (map_element* FirstSetElem = Gen->Elements; FirstSetElem != Gen->Elements + Gen->Capacity; ++FirstSetElem) {
 			if (FirstSetElem->Hash <= LastValidHash) {
-				return iter(FirstSetElem, Data + Capacity);
+				return iter(FirstSetElem, Gen->Elements + Gen->Capacity);
 			}
 		}
-		return iter(Data + Capacity, Data + Capacity);
+		return iter(Gen->Elements + Gen->Capacity, Gen->Elements + Gen->Capacity);
+	}
+
+	FORCEINLINE iter end() {
+		generation* Gen = Current.load(std::memory_order_acquire);
+		return iter(Gen->Elements + Gen->Capacity, Gen->Elements + Gen->Capacity);
 	}
 
-	__forceinline iter end() {
-		return iter(Data + Capacity, Data + Capacity);
+	FORCEINLINE bool ContainsKey(const key_type& Key) {
+		const hash_type Hash = GetHash(Key);
+		while (true) {
+			map_element* CurrentElem;
+			const probe_result Result = OptimisticFind(Current.load(std::memory_order_acquire), Key, Hash, CurrentElem);
+			if (Result != probe_result::relocated) [[likely]] {
+				return Result == probe_result::found;
+			}
+		}
 	}
 
-	__forceinline bool ContainsKey(const key_type& Key) {
-		const index HashMask = (1 << LogOfTwoCeil(Capacity)) - 1;
-		index Iteration = 0;
-		map_element* CurrentElem;
+	// Lock-free, copies value out and retries if its slot was modified while copying.
+	// Values assigned through references returned by operator[] are not versioned and may be read torn, Update() is.
+	FORCEINLINE bool Find(const key_type& Key, value_type& OutValue) {
 		const hash_type Hash = GetHash(Key);
-		for (CurrentElem = Data + (Hash & HashMask); CurrentElem->Hash != EmptyHash;
-			 CurrentElem = Data + ((Hash + TriangleNumber(++Iteration)) & HashMask)) {
-			if (CurrentElem->Hash == Hash && (Key == CurrentElem->Key)) {
+		while (true) {
+			map_element* CurrentElem;
+			const probe_result Result = OptimisticFind(Current.load(std::memory_order_acquire), Key, Hash, CurrentElem);
+			if (Result == probe_result::relocated) [[unlikely]] {
+				continue;
+			}
+			if (Result != probe_result::found) {
+				return false;
+			}
+			if (ReadValue(CurrentElem, Key, Hash, OutValue)) [[likely]] {
 				return true;
 			}
 		}
-		return false;
 	}
 
-	__forceinline static index TriangleNumber(const index InIteration) {
+	FORCEINLINE static index TriangleNumber(const index InIteration) {
 		return (InIteration * (InIteration + 1)) >> 1;
 	}
 
-	__forceinline concurrent_hash_table() {
-		Data = (map_element*) _aligned_malloc(MinCapacity * sizeof(map_element), 64);
-		for (map_element* MapElem = Data; MapElem != Data + MinCapacity; ++MapElem) {
-			MapElem->Hash = EmptyHash;
-			MapElem->AccessLock.Unlock();
-		}
+	FORCEINLINE concurrent_hash_table() {
+		Current.store(CreateGeneration(MinCapacity), std::memory_order_relaxed);
 	}
 
-	__forceinline ~concurrent_hash_table() {
-		for (map_element* Elem = Data; Elem != Data + Capacity; ++Elem) {
+	FORCEINLINE ~concurrent_hash_table() {
+		generation* Gen = FinishMigration();
+		for (map_element* Elem = Gen->Elements; Elem != Gen->Elements + Gen->Capacity; ++Elem) {
 			if (Elem->Hash <= LastValidHash) {
 				Elem->Value.~value_type();
 				Elem->Key.~key_type();
 			}
 		}
-		_aligned_free(Data);
-		Data = nullptr;
-		Capacity = 0;
-		MaxSize = 0;
-		Size.store(0, std::memory_order::memory_order_relaxed);
-		Deleted.store(0, std::memory_order::memory_order_relaxed);
+		while (Gen) {
+			generation* Previous = Gen->Previous;
+			MemoryAlignedFree(Gen->Elements);
+			delete Gen;
+			Gen = Previous;
+		}
+		Current.store(nullptr, std::memory_order_relaxed);
+		Size.store(0, std::memory_order_relaxed);
 	}
 
-	__forceinline value_type& operator[](const key_type& Key) {
-		hash_type Hash = GetHash(Key);
-		while (true) {
-			index HashMask = (1 << LogOfTwoCeil(Capacity)) - 1;
-			index Iteration = 0;
-			map_element* CurrentElem;
-			bool Relocated = false;
-			for (CurrentElem = Data + (Hash & HashMask);;
-				 CurrentElem = Data + ((Hash + TriangleNumber(++Iteration)) & HashMask)) {
-				CurrentElem->AccessLock.Lock();
-				if (CurrentElem->Hash == RelocatedHash) [[unlikely]] {
-					CurrentElem->AccessLock.Unlock();
-					Relocated = true;
-					break;
-				}
-				if (CurrentElem->Hash == EmptyHash) {
-					break;
-				}
-				if (CurrentElem->Hash == Hash && (Key == CurrentElem->Key)) {
-					CurrentElem->AccessLock.Unlock();	 // makes value undefined
-					return CurrentElem->Value;
-				}
-				CurrentElem->AccessLock.Unlock();
-			}
-			if (Relocated) [[unlikely]] {
-				continue;
-			}
-			index PreLockSize = Size.load(std::memory_order_relaxed);
-			index PreLockDeleted = Deleted.load(std::memory_order_relaxed);
-			const bool RelocationNeeded = (PreLockSize + PreLockDeleted + 1) > MaxSize;
-			if (RelocationNeeded) [[unlikely]] {
-				CurrentElem->AccessLock.Unlock();
-				RelocateMutex.lock();
-				index PostLockSize = Size.load(std::memory_order_relaxed);
-				index PostLockDeleted = Deleted.load(std::memory_order_relaxed);
-				const bool RelocationStillNeeded = (PostLockSize + PostLockDeleted + 1) > MaxSize;
-				if (RelocationStillNeeded) {
-					map_element* OldData = Data;
-					index OldCapacity = Capacity;
-					LockAll();
-					constexpr index MAGIC_NUMBER = 100;
-					Relocate(PostLockSize + MAGIC_NUMBER);
-					OldDataUnlockAll(OldData, OldCapacity);
-				}
-				RelocateMutex.unlock();
-				continue;
-			} else {
-				Size.fetch_add(1, std::memory_order::memory_order_relaxed);
-				CurrentElem->Hash = Hash;
-				new (&(CurrentElem->Key)) key_type(Key);
-				new (&(CurrentElem->Value)) value_type();
-				CurrentElem->AccessLock.Unlock();
-				return CurrentElem->Value;
-			}
-		}
+	// reference is not guarded by slot lock, concurrent writes of the same key through it race, see Update()
+	FORCEINLINE value_type& operator[](const key_type& Key) {
+		return FindOrAdd<false>(Key, GetHash(Key))->Value;
 	}
 
-	__forceinline void Remove(const key_type& Key) {
+	// Updater(Value) runs under slot lock, so concurrent updates of the same key are not lost
+	// and Find() doesn't observe them half written. Value is default constructed first if key is missing.
+	template <typename updater_type>
+	FORCEINLINE void Update(const key_type& Key, updater_type&& Updater) {
+		map_element* Elem = FindOrAdd<true>(Key, GetHash(Key));
+		Updater(Elem->Value);
+		Elem->AccessLock.Unlock();
+	}
+
+	FORCEINLINE void Remove(const key_type& Key) {
 		const hash_type Hash = GetHash(Key);
 		while (true) {
-			bool Relocated = false;
-			const index HashMask = (1 << LogOfTwoCeil(Capacity)) - 1;
-			index Iteration = 0;
+			generation* Gen = Current.load(std::memory_order_acquire);
+			if (generation* Source = Gen->Source.load(std::memory_order_acquire)) [[unlikely]] {
+				MigrateChunk(Gen, Source);
+				MoveFromSource(Gen, Source, Key, Hash);
+			}
 			map_element* CurrentElem;
-			for (CurrentElem = Data + (Hash & HashMask);;
-				 CurrentElem = Data + ((Hash + TriangleNumber(++Iteration)) & HashMask)) {
-				CurrentElem->AccessLock.Lock();
-				if (CurrentElem->Hash == RelocatedHash) [[unlikely]] {
-					CurrentElem->AccessLock.Unlock();
-					Relocated = true;
-					break;
-				}
-				if (CurrentElem->Hash == EmptyHash) {
-					CurrentElem->AccessLock.Unlock();
-					break;
-				}
-				if (CurrentElem->Hash == Hash && (Key == CurrentElem->Key)) {
-					CurrentElem->Value.~value_type();
-					CurrentElem->Key.~key_type();
-					CurrentElem->Hash = DeletedHash;
-					Deleted.fetch_add(1, std::memory_order_relaxed);
-					Size.fetch_sub(1, std::memory_order_relaxed);
-					CurrentElem->AccessLock.Unlock();
-					return;
-				}
-				CurrentElem->AccessLock.Unlock();
+			const probe_result Result = OptimisticProbe(Gen, Key, Hash, false, CurrentElem);
+			if (Result == probe_result::empty) {
+				return;
+			}
+			if (Result != probe_result::found) [[unlikely]] {
+				continue;
 			}
-			if (Relocated) {
+			CurrentElem->AccessLock.Lock();
+			// removed or relocated between probe and lock
+			if (CurrentElem->Hash != Hash || !(Key == CurrentElem->Key)) [[unlikely]] {
+				CurrentElem->AccessLock.Unlock();
 				continue;
 			}
+			CurrentElem->Value.~value_type();
+			CurrentElem->Key.~key_type();
+			CurrentElem->Hash = DeletedHash;
+			Gen->Deleted.fetch_add(1, std::memory_order_relaxed);
+			Size.fetch_sub(1, std::memory_order_relaxed);
+			CurrentElem->AccessLock.Unlock();
 			return;
 		}
 	}
 
-	[[nodiscard]] __forceinline index GetSize() const {
+	[[nodiscard]] FORCEINLINE index GetSize() const {
 		return Size.load(std::memory_order_relaxed);
 	}
 
-	__declspec(align(64)) struct map_element {
+	// includes previous generations, they are kept alive until destruction
+	[[nodiscard]] FORCEINLINE index GetAllocatedSize() const {
+		index Bytes = 0;
+		for (generation* Gen = Current.load(std::memory_order_acquire); Gen; Gen = Gen->Previous) {
+			Bytes += Gen->Capacity * sizeof(map_element) + sizeof(generation);
+		}
+		return Bytes;
+	}
+
+	struct alignas(CacheLineSize) map_element {
 		hash_type Hash;
-		spinlock AccessLock;
+		seqlock AccessLock;
 		key_type Key;
 		value_type Value;
 	};
 
+	// Slot array of the table. When load factor is exceeded new generation is published with the old one as
+	// its Source, and elements are moved incrementally: every writer that sees a pending migration claims
+	// MigrationChunkSize source buckets and moves them, so growth cost is spread over writers instead of one
+	// thread relocating everything while others spin. New growth can't start until Source is drained.
+	struct generation {
+		map_element* Elements = nullptr;
+		index Capacity = 0;
+		index MaxSize = 0;
+		std::atomic<index> Deleted = 0;
+		std::atomic<generation*> Source = nullptr;
+		std::atomic<index> MigrationCursor = 0;
+		std::atomic<index> MigratedBuckets = 0;
+		// kept alive until destruction for threads that are still probing it,
+		// capacity at least doubles every growth so all previous generations take less memory than current one
+		generation* Previous = nullptr;
+	};
+
+	enum class probe_result : unsigned char { found, empty, relocated, exhausted };
+
 	constexpr static hash_type EmptyHash = std::numeric_limits<hash_type>::max();
 	constexpr static hash_type DeletedHash = std::numeric_limits<hash_type>::max() - 1;
 	constexpr static hash_type RelocatedHash = std::numeric_limits<hash_type>::max() - 2;
 	constexpr static hash_type LastValidHash = std::numeric_limits<hash_type>::max() - 3;
 	constexpr static index MinCapacity = 32;
 	constexpr static float MaxLoadFactor = 0.7f;
+	constexpr static index MigrationChunkSize = 64;
+	// Optimistic readers compare keys that writers may be destroying at the same time,
+	// that is only harmless for trivially copyable keys, other keys are always probed under lock.
+	constexpr static bool OptimisticReads = std::is_trivially_copyable_v<key_type>;
 
-	__forceinline void LockAll() {
-		for (map_element* Iter = Data; Iter != Data + Capacity; ++Iter) {
-			Iter->AccessLock.Lock();
+	FORCEINLINE static generation* CreateGeneration(index InCapacity) {
+		generation* Gen = new generation{};
+		Gen->Elements = (map_element*) MemoryAlignedMalloc(InCapacity * sizeof(map_element), alignof(map_element));
+		for (map_element* MapElem = Gen->Elements; MapElem != Gen->Elements + InCapacity; ++MapElem) {
+			MapElem->Hash = EmptyHash;
+			new (&(MapElem->AccessLock)) seqlock();
 		}
+		Gen->Capacity = InCapacity;
+		Gen->MaxSize = (index) (MaxLoadFactor * InCapacity);
+		return Gen;
 	}
 
-	__forceinline void OldDataUnlockAll(map_element* InData, index InCapacity) {
-		for (map_element* Iter = InData; Iter != InData + InCapacity; ++Iter) {
-			Iter->AccessLock.Unlock();
+	// Walks probe sequence locking one slot at a time, found and empty slots are returned locked.
+	// Relocated slots are skipped in migration source. In current generation they mean that table
+	// has grown since generation was loaded and operation has to restart.
+	FORCEINLINE static probe_result LockedProbe(
+		generation* Gen, const key_type& Key, hash_type Hash, bool IsSource, map_element*& OutElem) {
+		const index HashMask = Gen->Capacity - 1;
+		for (index Iteration = 0; Iteration < Gen->Capacity; ++Iteration) {
+			OutElem = Gen->Elements + ((Hash + TriangleNumber(Iteration)) & HashMask);
+			OutElem->AccessLock.Lock();
+			if (OutElem->Hash == RelocatedHash) [[unlikely]] {
+				if (!IsSource) {
+					OutElem->AccessLock.Unlock();
+					return probe_result::relocated;
+				}
+			} else if (OutElem->Hash == EmptyHash) {
+				return probe_result::empty;
+			} else if (OutElem->Hash == Hash && (Key == OutElem->Key)) {
+				return probe_result::found;
+			}
+			OutElem->AccessLock.Unlock();
 		}
+		return probe_result::exhausted;
 	}
 
-	__forceinline void Relocate(index DesiredSize) {
-		const index NewCapacity = 1 << (LogOfTwoCeil(DesiredSize) + 1);
-		auto* const NewData = (map_element*) _aligned_malloc(NewCapacity * sizeof(map_element), alignof(map_element));
-		for (map_element* MapElem = NewData; MapElem != NewData + NewCapacity; ++MapElem) {
-			MapElem->Hash = EmptyHash;
-			MapElem->AccessLock.Unlock();
+	// Same as LockedProbe but nothing is locked or returned locked. Slot is inspected again if a writer
+	// modified it meanwhile, so every slot is seen consistent, though result may be outdated once returned.
+	FORCEINLINE static probe_result OptimisticProbe(
+		generation* Gen, const key_type& Key, hash_type Hash, bool IsSource, map_element*& OutElem) {
+		if constexpr (!OptimisticReads) {
+			const probe_result Result = LockedProbe(Gen, Key, Hash, IsSource, OutElem);
+			if (Result == probe_result::found || Result == probe_result::empty) {
+				OutElem->AccessLock.Unlock();
+			}
+			return Result;
+		} else {
+			const index HashMask = Gen->Capacity - 1;
+			for (index Iteration = 0; Iteration < Gen->Capacity;) {
+				OutElem = Gen->Elements + ((Hash + TriangleNumber(Iteration)) & HashMask);
+				const uint32_t Version = OutElem->AccessLock.ReadBegin();
+				const hash_type ElemHash = OutElem->Hash;
+				const bool KeyMatch = ElemHash == Hash && (Key == OutElem->Key);
+				if (OutElem->AccessLock.ReadRetry(Version)) [[unlikely]] {
+					continue;
+				}
+				if (ElemHash == RelocatedHash) [[unlikely]] {
+					if (!IsSource) {
+						return probe_result::relocated;
+					}
+				} else if (ElemHash == EmptyHash) {
+					return probe_result::empty;
+				} else if (KeyMatch) {
+					return probe_result::found;
+				}
+				++Iteration;
+			}
+			return probe_result::exhausted;
 		}
-		for (map_element* MapElem = Data; MapElem != Data + Capacity; ++MapElem) {
-			if (MapElem->Hash <= LastValidHash) {
-				const index HashMask = (1 << LogOfTwoCeil(NewCapacity)) - 1;
-				index Iteration = 0;
-				map_element* CurrentElem;
-				const hash_type Hash = MapElem->Hash;
-				for (CurrentElem = NewData + (Hash & HashMask); CurrentElem->Hash != EmptyHash;
-					 CurrentElem = NewData + ((Hash + TriangleNumber(++Iteration)) & HashMask)) {
+	}
+
+	// source first, element can only move from source to current generation, never back
+	FORCEINLINE static probe_result OptimisticFind(
+		generation* Gen, const key_type& Key, hash_type Hash, map_element*& OutElem) {
+		if (generation* Source = Gen->Source.load(std::memory_order_acquire)) {
+			if (OptimisticProbe(Source, Key, Hash, true, OutElem) == probe_result::found) {
+				return probe_result::found;
+			}
+		}
+		return OptimisticProbe(Gen, Key, Hash, false, OutElem);
+	}
+
+	// false if slot no longer holds the key
+	FORCEINLINE static bool ReadValue(map_element* Elem, const key_type& Key, hash_type Hash, value_type& OutValue) {
+		if constexpr (OptimisticReads && std::is_trivially_copyable_v<value_type>) {
+			alignas(value_type) unsigned char Buffer[sizeof(value_type)];
+			const uint32_t Version = Elem->AccessLock.ReadBegin();
+			const bool KeyMatch = Elem->Hash == Hash && (Key == Elem->Key);
+			std::memcpy(Buffer, &Elem->Value, sizeof(value_type));
+			if (Elem->AccessLock.ReadRetry(Version) || !KeyMatch) {
+				return false;
+			}
+			std::memcpy(&OutValue, Buffer, sizeof(value_type));
+			return true;
+		} else {
+			Elem->AccessLock.Lock();
+			const bool KeyMatch = Elem->Hash == Hash && (Key == Elem->Key);
+			if (KeyMatch) {
+				OutValue = Elem->Value;
+			}
+			Elem->AccessLock.Unlock();
+			return KeyMatch;
+		}
+	}
+
+	// Slot holding Key, default constructed value is inserted if key is missing. Returned slot is locked if LockSlot,
+	// otherwise found slots are never locked, only inserting takes slot lock.
+	template <bool LockSlot>
+	FORCEINLINE map_element* FindOrAdd(const key_type& Key, hash_type Hash) {
+		while (true) {
+			generation* Gen = Current.load(std::memory_order_acquire);
+			if (generation* Source = Gen->Source.load(std::memory_order_acquire)) [[unlikely]] {
+				MigrateChunk(Gen, Source);
+				MoveFromSource(Gen, Source, Key, Hash);
+			}
+			map_element* CurrentElem;
+			const probe_result Result = OptimisticProbe(Gen, Key, Hash, false, CurrentElem);
+			if (Result == probe_result::found) {
+				if constexpr (!LockSlot) {
+					return CurrentElem;
+				}
+				CurrentElem->AccessLock.Lock();
+				// removed or relocated between probe and lock
+				if (CurrentElem->Hash != Hash || !(Key == CurrentElem->Key)) [[unlikely]] {
+					CurrentElem->AccessLock.Unlock();
+					continue;
 				}
-				new (&(CurrentElem->Value)) value_type(std::move(MapElem->Value));
-				new (&(CurrentElem->Key)) key_type(std::move(MapElem->Key));
-				CurrentElem->Hash = MapElem->Hash;
-				MapElem->Value.~value_type();
-				MapElem->Key.~key_type();
+				return CurrentElem;
+			}
+			if (Result != probe_result::empty) [[unlikely]] {
+				continue;
+			}
+			CurrentElem->AccessLock.Lock();
+			// taken between probe and lock, possibly by the same key
+			if (CurrentElem->Hash != EmptyHash) [[unlikely]] {
+				CurrentElem->AccessLock.Unlock();
+				continue;
+			}
+			// Table could grow after this thread loaded generation, then migration may have already passed
+			// this slot and inserted element would be lost. Checked under slot lock, migration takes it too.
+			if (Current.load(std::memory_order_acquire) != Gen) [[unlikely]] {
+				CurrentElem->AccessLock.Unlock();
+				continue;
+			}
+			const index PreLockSize = Size.load(std::memory_order_relaxed);
+			const index PreLockDeleted = Gen->Deleted.load(std::memory_order_relaxed);
+			const bool RelocationNeeded = (PreLockSize + PreLockDeleted + 1) > Gen->MaxSize;
+			if (RelocationNeeded) [[unlikely]] {
+				CurrentElem->AccessLock.Unlock();
+				Grow(Gen);
+				continue;
+			}
+			Size.fetch_add(1, std::memory_order_relaxed);
+			CurrentElem->Hash = Hash;
+			new (&(CurrentElem->Key)) key_type(Key);
+			new (&(CurrentElem->Value)) value_type();
+			if constexpr (!LockSlot) {
+				CurrentElem->AccessLock.Unlock();
+			}
+			return CurrentElem;
+		}
+	}
+
+	// SourceElem must be locked and valid, lock order is always source slot before target slot
+	FORCEINLINE static void MoveElement(generation* Gen, map_element* SourceElem) {
+		const hash_type Hash = SourceElem->Hash;
+		const index HashMask = Gen->Capacity - 1;
+		for (index Iteration = 0;; ++Iteration) {
+			map_element* CurrentElem = Gen->Elements + ((Hash + TriangleNumber(Iteration)) & HashMask);
+			CurrentElem->AccessLock.Lock();
+			if (CurrentElem->Hash == EmptyHash) {
+				new (&(CurrentElem->Value)) value_type(std::move(SourceElem->Value));
+				new (&(CurrentElem->Key)) key_type(std::move(SourceElem->Key));
+				CurrentElem->Hash = Hash;
+				CurrentElem->AccessLock.Unlock();
+				break;
 			}
+			CurrentElem->AccessLock.Unlock();
 		}
-		for (map_element* MapElem = Data; MapElem != Data + Capacity; ++MapElem) {
-			MapElem->Hash = RelocatedHash;
+		SourceElem->Value.~value_type();
+		SourceElem->Key.~key_type();
+		SourceElem->Hash = RelocatedHash;
+	}
+
+	// Key is moved ahead of its chunk, so operation continues in current generation only.
+	// Probed under lock, writer with stale generation can fill an empty source slot only before this thread locks it.
+	FORCEINLINE static void MoveFromSource(generation* Gen, generation* Source, const key_type& Key, hash_type Hash) {
+		map_element* SourceElem;
+		const probe_result Result = LockedProbe(Source, Key, Hash, true, SourceElem);
+		if (Result == probe_result::found) {
+			MoveElement(Gen, SourceElem);
 		}
-		if (OldData) {
-			_aligned_free(OldData);
+		if (Result == probe_result::found || Result == probe_result::empty) {
+			SourceElem->AccessLock.Unlock();
 		}
-		OldData = Data;
-		Data = NewData;
-		Deleted.store(0, std::memory_order_relaxed);
-		Capacity = NewCapacity;
-		MaxSize = (index) (MaxLoadFactor * Capacity);
 	}
 
-	__forceinline static size_t GetHash(const key_type& Key) {
-		size_t Hash = std::hash<key_type>{}(Key);
-		return Hash - (Hash > LastValidHash) * 3;
+	// Only moved slots are marked relocated, empty ones still terminate probing of source for keys that are not
+	// there. Nothing is inserted into them after new generation is published, insertion rechecks generation.
+	// Returns false if whole source is already claimed by other threads.
+	FORCEINLINE static bool MigrateChunk(generation* Gen, generation* Source) {
+		const index Begin = Gen->MigrationCursor.fetch_add(MigrationChunkSize, std::memory_order_relaxed);
+		if (Begin >= Source->Capacity) {
+			return false;
+		}
+		const index End = std::min(Begin + MigrationChunkSize, Source->Capacity);
+		for (map_element* MapElem = Source->Elements + Begin; MapElem != Source->Elements + End; ++MapElem) {
+			MapElem->AccessLock.Lock();
+			if (MapElem->Hash <= LastValidHash) {
+				MoveElement(Gen, MapElem);
+			}
+			MapElem->AccessLock.Unlock();
+		}
+		const index Migrated = Gen->MigratedBuckets.fetch_add(End - Begin, std::memory_order_acq_rel) + End - Begin;
+		if (Migrated == Source->Capacity) {
+			Gen->Source.store(nullptr, std::memory_order_release);
+		}
+		return true;
 	}
 
-	__forceinline static index LogOfTwoCeil(index Value) {
-		unsigned long Index;
-		if (_BitScanReverse64(&Index, Value)) {
-			index result = Index;
-			if ((Value & ~((index) 1 << Index)) > 0) {
-				++result;
+	FORCEINLINE void Grow(generation* Gen) {
+		if (generation* Source = Gen->Source.load(std::memory_order_acquire)) {
+			// previous growth is still in progress, help it instead of waiting
+			if (!MigrateChunk(Gen, Source)) {
+				std::this_thread::yield();
+			}
+			return;
+		}
+		RelocateMutex.Lock();
+		const index PostLockSize = Size.load(std::memory_order_relaxed);
+		const index PostLockDeleted = Gen->Deleted.load(std::memory_order_relaxed);
+		const bool RelocationStillNeeded = (PostLockSize + PostLockDeleted + 1) > Gen->MaxSize;
+		if (RelocationStillNeeded && Current.load(std::memory_order_relaxed) == Gen) {
+			constexpr index MAGIC_NUMBER = 100;
+			generation* NewGen = CreateGeneration((index) 1 << (math::LogOfTwoCeil(PostLockSize + MAGIC_NUMBER) + 1));
+			NewGen->Source.store(Gen, std::memory_order_relaxed);
+			NewGen->Previous = Gen;
+			Current.store(NewGen, std::memory_order_release);
+		}
+		RelocateMutex.Unlock();
+	}
+
+	FORCEINLINE generation* FinishMigration() {
+		generation* Gen = Current.load(std::memory_order_acquire);
+		while (generation* Source = Gen->Source.load(std::memory_order_acquire)) {
+			if (!MigrateChunk(Gen, Source)) {
+				std::this_thread::yield();
 			}
-			return result;
-		} else {
-			return 0ull;
 		}
+		return Gen;
+	}
+
+	FORCEINLINE static size_t GetHash(const key_type& Key) {
+		size_t Hash = std::hash<key_type>{}(Key);
+		return Hash - (Hash > LastValidHash) * 3;
 	}
 
-	map_element* Data = nullptr;
-	map_element* OldData = nullptr;
-	index Capacity = MinCapacity;
+
+	std::atomic<generation*> Current = nullptr;
 	std::atomic<index> Size = 0;
-	std::atomic<index> Deleted = 0;
-	index MaxSize = static_cast<index>(MinCapacity * MaxLoadFactor);
-	std::mutex RelocateMutex;
+	mutex RelocateMutex;
 };
\ No newline at end of file
@@ -0,0 +1,145 @@
+#include "epoch.h"
+
+#include "Concurrency/mutex.h"
+
+#include <thread>
+
+namespace epoch {
+constexpr index CollectThreshold = 64;
+
+static std::atomic<thread_record*> Records{nullptr};
+
+// retired objects of threads that exited before they could free them
+static mutex OrphansLock;
+static dyn_array<retired, malloc_allocator> Orphans;
+
+// Gives record back when thread exits, leftovers can't wait for the thread to call Collect() again
+struct thread_exit_hook {
+	~thread_exit_hook() {
+		thread_record* Record = internal::CurrentRecord;
+		if (!Record) {
+			return;
+		}
+		Collect();
+		if (Record->Retired.GetSize() > 0) {
+			OrphansLock.Lock();
+			for (const retired& Retired : Record->Retired) {
+				Orphans.Add(Retired);
+			}
+			OrphansLock.Unlock();
+			Record->Retired.Clear(container_clear_type::dont_deallocate);
+		}
+		internal::CurrentRecord = nullptr;
+		Record->InUse.store(false, std::memory_order_release);
+	}
+};
+
+static thread_local thread_exit_hook ExitHook;
+
+thread_record* internal::RegisterThread() {
+	// odr-use so that hook is constructed for this thread and runs its destructor on exit
+	(void) &ExitHook;
+	thread_record* Record = nullptr;
+	for (thread_record* Existing = Records.load(std::memory_order_acquire); Existing; Existing = Existing->Next) {
+		bool Expected = false;
+		if (!Existing->InUse.load(std::memory_order_relaxed) &&
+			Existing->InUse.compare_exchange_strong(Expected, true, std::memory_order_acquire)) {
+			Record = Existing;
+			break;
+		}
+	}
+	if (!Record) {
+		Record = new thread_record{};
+		Record->InUse.store(true, std::memory_order_relaxed);
+		thread_record* Head = Records.load(std::memory_order_relaxed);
+		do {
+			Record->Next = Head;
+		} while (!Records.compare_exchange_weak(Head, Record, std::memory_order_release, std::memory_order_relaxed));
+	}
+	CurrentRecord = Record;
+	return Record;
+}
+
+static thread_record& GetRecord() {
+	thread_record* Record = internal::CurrentRecord;
+	return Record ? *Record : *internal::RegisterThread();
+}
+
+static bool TryAdvance() {
+	u64 Epoch = internal::GlobalEpoch.load(std::memory_order_relaxed);
+	// pairs with fence in guard, either we see the announcement or the pinned thread sees what was unlinked
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	for (thread_record* Record = Records.load(std::memory_order_acquire); Record; Record = Record->Next) {
+		const u64 Announced = Record->Epoch.load(std::memory_order_relaxed);
+		if ((Announced & 1) && (Announced >> 1) != Epoch) {
+			return false;
+		}
+	}
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return internal::GlobalEpoch.compare_exchange_strong(
+		Epoch, Epoch + 1, std::memory_order_acq_rel, std::memory_order_relaxed);
+}
+
+// Frees expired objects and keeps the rest in order. Orphans are appended list by list as threads exit and aren't
+// ordered by epoch, so the scan doesn't stop at the first object that isn't expired yet
+static index FreeExpired(dyn_array<retired, malloc_allocator>& List, u64 Epoch) {
+	const index Size = List.GetSize();
+	index Left = 0;
+	for (index Retired = 0; Retired < Size; ++Retired) {
+		if (Epoch - List[Retired].Epoch >= 2) {
+			List[Retired].Deleter(List[Retired].Object);
+		} else {
+			List[Left++] = List[Retired];
+		}
+	}
+	if (Left < Size) {
+		List.Clear(container_clear_type::dont_deallocate);
+		List.AppendUninitialized(Left);
+	}
+	return Size - Left;
+}
+
+void Retire(void* Object, deleter_type Deleter) {
+	thread_record& Record = GetRecord();
+	// object was unlinked before this point, so tag has to be read after it
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	Record.Retired.Add(retired{Object, Deleter, internal::GlobalEpoch.load(std::memory_order_relaxed)});
+	if (Record.Retired.GetSize() >= CollectThreshold) {
+		Collect();
+	}
+}
+
+index Collect() {
+	thread_record& Record = GetRecord();
+	TryAdvance();
+	const u64 Epoch = internal::GlobalEpoch.load(std::memory_order_acquire);
+	index Freed = FreeExpired(Record.Retired, Epoch);
+	if (OrphansLock.TryLock()) {
+		Freed += FreeExpired(Orphans, Epoch);
+		OrphansLock.Unlock();
+	}
+	return Freed;
+}
+
+void Synchronize() {
+	thread_record& Record = GetRecord();
+	CHECK(Record.Nesting == 0)
+	const u64 Target = internal::GlobalEpoch.load(std::memory_order_acquire) + 2;
+	while (internal::GlobalEpoch.load(std::memory_order_acquire) < Target) {
+		if (!TryAdvance()) {
+			std::this_thread::yield();
+		}
+	}
+	FreeExpired(Record.Retired, Target);
+	OrphansLock.Lock();
+	FreeExpired(Orphans, Target);
+	OrphansLock.Unlock();
+}
+
+index GetPendingCount() {
+	OrphansLock.Lock();
+	const index Pending = GetRecord().Retired.GetSize() + Orphans.GetSize();
+	OrphansLock.Unlock();
+	return Pending;
+}
+}	 // namespace epoch
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "basic.h"
+#include "Containers/dyn_array.h"
+#include "Memory/allocator_base.h"
+
+#include <atomic>
+
+// Epoch based memory reclamation (Fraser). Readers pin the current global epoch with a guard while they hold
+// pointers into shared structures. Writers unlink memory and retire it instead of freeing, retired memory is tagged
+// with global epoch and freed once global epoch moved 2 steps further. Epoch only advances when every pinned thread
+// has announced the current one, so nobody pinned at the time of Retire() can still be looking at it.
+// Pinning is a store and a fence into thread's own cache line, nested guards only bump a counter,
+// so hot loops should hold one outer guard and let structures pin again inside it for free.
+// Retired lists are per thread, thread that exits hands its leftovers to a shared orphan list.
+namespace epoch {
+using deleter_type = void (*)(void* Object);
+
+struct retired {
+	void* Object;
+	deleter_type Deleter;
+	u64 Epoch;
+};
+
+struct alignas(CacheLineSize) thread_record {
+	// announced epoch shifted left with active bit in the lowest bit, 0 when thread is not pinned
+	std::atomic<u64> Epoch{0};
+	u32 Nesting{0};
+	std::atomic<bool> InUse{false};
+	// records are never freed, threads that start later reuse records of exited ones
+	thread_record* Next{nullptr};
+	dyn_array<retired, malloc_allocator> Retired{};
+};
+
+namespace internal {
+inline std::atomic<u64> GlobalEpoch{0};
+inline thread_local thread_record* CurrentRecord{nullptr};
+
+thread_record* RegisterThread();
+}	 // namespace internal
+
+// Pins calling thread for its lifetime, pointers loaded from epoch protected structures are valid until it ends
+struct guard {
+	thread_record* Record;
+
+	FORCEINLINE guard() : Record{internal::CurrentRecord} {
+		if (!Record) [[unlikely]] {
+			Record = internal::RegisterThread();
+		}
+		if (Record->Nesting++ == 0) {
+			// stale global epoch is fine, it can only delay reclamation
+			const u64 Epoch = internal::GlobalEpoch.load(std::memory_order_relaxed);
+			Record->Epoch.store((Epoch << 1) | 1, std::memory_order_relaxed);
+			// announcement has to be visible before any protected pointer is loaded
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+		}
+	}
+
+	FORCEINLINE ~guard() {
+		if (--Record->Nesting == 0) {
+			Record->Epoch.store(0, std::memory_order_release);
+		}
+	}
+
+	guard(const guard&) = delete;
+	guard& operator=(const guard&) = delete;
+};
+
+// Object has to be unreachable for new readers already, Deleter is called once all current readers are done
+void Retire(void* Object, deleter_type Deleter);
+
+template <typename object_type>
+FORCEINLINE void Retire(object_type* Object) {
+	Retire(Object, [](void* Object) { delete static_cast<object_type*>(Object); });
+}
+
+// Tries to advance global epoch and frees retired objects of calling thread (and of exited threads) that became safe.
+// Called by Retire() every CollectThreshold objects, returns number of freed objects
+index Collect();
+
+// Frees everything retired by calling thread and exited threads before the call, waits for pinned threads to
+// move on. Must not be called while pinned
+void Synchronize();
+
+// objects retired by calling thread and exited threads that are not freed yet
+[[nodiscard]] index GetPendingCount();
+
+[[nodiscard]] FORCEINLINE u64 GetEpoch() {
+	return internal::GlobalEpoch.load(std::memory_order_relaxed);
+}
+}	 // namespace epoch
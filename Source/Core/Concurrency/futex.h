@@ -0,0 +1,43 @@
+#pragma once
+
+#include "basic.h"
+
+#include <atomic>
+
+#if defined(__linux__)
+#include <climits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Parking of threads on a 32 bit word. Linux uses futex directly, elsewhere std::atomic wait/notify
+// which is implemented with WaitOnAddress on Windows. Wakeups may be spurious, callers recheck their condition.
+namespace futex {
+static_assert(sizeof(std::atomic<u32>) == sizeof(u32));
+
+// blocks while Word == Expected
+FORCEINLINE void Wait(std::atomic<u32>& Word, u32 Expected) {
+#if defined(__linux__)
+	syscall(SYS_futex, reinterpret_cast<u32*>(&Word), FUTEX_WAIT_PRIVATE, Expected, nullptr, nullptr, 0);
+#else
+	Word.wait(Expected, std::memory_order_relaxed);
+#endif
+}
+
+FORCEINLINE void WakeOne(std::atomic<u32>& Word) {
+#if defined(__linux__)
+	syscall(SYS_futex, reinterpret_cast<u32*>(&Word), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#else
+	Word.notify_one();
+#endif
+}
+
+FORCEINLINE void WakeAll(std::atomic<u32>& Word) {
+#if defined(__linux__)
+	syscall(SYS_futex, reinterpret_cast<u32*>(&Word), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+#else
+	Word.notify_all();
+#endif
+}
+}	 // namespace futex
@@ -0,0 +1,183 @@
+#include "job_system.h"
+
+#include "Concurrency/backoff.h"
+#include "Concurrency/futex.h"
+#include "Memory/allocator_base.h"
+#include "Profiler/profiler.h"
+#include "String/str_conversions.h"
+
+static thread_local job_worker* CurrentWorker = nullptr;
+
+job_system::job_system(u32 NumThreads) : NumWorkers{NumThreads + 1} {
+	Workers = new job_worker[NumWorkers];
+	for (u32 WorkerIndex = 0; WorkerIndex < NumWorkers; ++WorkerIndex) {
+		Workers[WorkerIndex].System = this;
+		Workers[WorkerIndex].Index = WorkerIndex;
+		Workers[WorkerIndex].RandomState = WorkerIndex * 0x9e3779b9u + 1;
+	}
+	PreviousWorker = CurrentWorker;
+	CurrentWorker = &Workers[0];
+	Threads.Reserve(NumThreads);
+	for (u32 WorkerIndex = 1; WorkerIndex < NumWorkers; ++WorkerIndex) {
+		Threads.Emplace([this, WorkerIndex]() { WorkerLoop(WorkerIndex); });
+	}
+}
+
+job_system::~job_system() {
+	CHECK(CurrentWorker == &Workers[0])
+	CHECK(!HasQueuedJobs())
+	Stopping.store(true, std::memory_order_seq_cst);
+	WakeSequence.fetch_add(1, std::memory_order_seq_cst);
+	futex::WakeAll(WakeSequence);
+	for (std::thread& Thread : Threads) {
+		Thread.join();
+	}
+	CurrentWorker = PreviousWorker;
+	for (u32 WorkerIndex = 0; WorkerIndex < NumWorkers; ++WorkerIndex) {
+		for (job* Block : Workers[WorkerIndex].JobBlocks) {
+			MemoryAlignedFree(Block);
+		}
+	}
+	delete[] Workers;
+}
+
+u32 job_system::GetCurrentWorkerIndex() {
+	return CurrentWorker ? CurrentWorker->Index : InvalidIndex;
+}
+
+job* job_system::AllocateJob() {
+	job_worker* Worker = CurrentWorker;
+	CHECK(Worker && Worker->System == this)
+	if (!Worker->FreeJobs) [[unlikely]] {
+		Worker->FreeJobs = Worker->ReturnedJobs.exchange(nullptr, std::memory_order_acquire);
+		if (!Worker->FreeJobs) {
+			job* Block = (job*) MemoryAlignedMalloc(JobsPerBlock * sizeof(job), CacheLineSize);
+			Worker->JobBlocks.Add(Block);
+			for (index Slot = 0; Slot < JobsPerBlock; ++Slot) {
+				job* Job = new (&Block[Slot]) job{};
+				Job->Owner = Worker->Index;
+				Job->NextFree = Slot + 1 < JobsPerBlock ? &Block[Slot + 1] : nullptr;
+			}
+			Worker->FreeJobs = Block;
+		}
+	}
+	job* Job = Worker->FreeJobs;
+	Worker->FreeJobs = Job->NextFree;
+	return Job;
+}
+
+void job_system::FreeJob(job* Job) {
+	job_worker& Owner = Workers[Job->Owner];
+	if (&Owner == CurrentWorker) {
+		Job->NextFree = Owner.FreeJobs;
+		Owner.FreeJobs = Job;
+		return;
+	}
+	// owner only ever takes the whole stack, so there is no ABA problem
+	job* Head = Owner.ReturnedJobs.load(std::memory_order_relaxed);
+	do {
+		Job->NextFree = Head;
+	} while (!Owner.ReturnedJobs.compare_exchange_weak(
+		Head, Job, std::memory_order_release, std::memory_order_relaxed));
+}
+
+void job_system::Submit(job* Job) {
+	CurrentWorker->Deque.Push(Job);
+	// pairs with fence in Park(), either sleeper sees the job or we see the sleeper
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (Sleepers.load(std::memory_order_relaxed) > 0) {
+		WakeSequence.fetch_add(1, std::memory_order_release);
+		futex::WakeOne(WakeSequence);
+	}
+}
+
+void job_system::Execute(job* Job) {
+	job_counter* Counter = Job->Counter;
+	Job->Function(*Job);
+	FreeJob(Job);
+	// counter may be destroyed by the waiting thread right after this
+	Counter->Value.fetch_sub(1, std::memory_order_release);
+}
+
+job* job_system::FindJob(job_worker& Worker) {
+	job* Job = nullptr;
+	if (Worker.Deque.TryPop(Job)) {
+		return Job;
+	}
+	if (NumWorkers == 1) {
+		return nullptr;
+	}
+	// xorshift, start from random victim so thieves don't all hammer the same deque
+	Worker.RandomState ^= Worker.RandomState << 13;
+	Worker.RandomState ^= Worker.RandomState >> 17;
+	Worker.RandomState ^= Worker.RandomState << 5;
+	const u32 FirstVictim = Worker.RandomState % NumWorkers;
+	for (u32 Attempt = 0; Attempt < NumWorkers; ++Attempt) {
+		job_worker& Victim = Workers[(FirstVictim + Attempt) % NumWorkers];
+		if (&Victim != &Worker && Victim.Deque.TrySteal(Job)) {
+			return Job;
+		}
+	}
+	return nullptr;
+}
+
+bool job_system::HasQueuedJobs() const {
+	for (u32 WorkerIndex = 0; WorkerIndex < NumWorkers; ++WorkerIndex) {
+		if (Workers[WorkerIndex].Deque.GetSize() > 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void job_system::Wait(job_counter& Counter) {
+	job_worker* Worker = CurrentWorker;
+	CHECK(Worker && Worker->System == this)
+	backoff Backoff;
+	while (!Counter.IsDone()) {
+		if (job* Job = FindJob(*Worker)) {
+			Execute(Job);
+			Backoff = {};
+		} else {
+			// remaining jobs of the counter are being executed by other workers
+			Backoff.PauseOrYield();
+		}
+	}
+}
+
+// profiler track name
+static void SetWorkerThreadName(u32 WorkerIndex) {
+	using number_format = strings::default_int_format<u32>;
+	char Name[32] = "Worker ";
+	const index Length = number_format::GetCharSize(WorkerIndex);
+	number_format::Write(mutable_str_view{Name + 7, Length}, WorkerIndex);
+	profiler::SetThreadName(str_view{Name, 7 + Length});
+}
+
+void job_system::WorkerLoop(u32 WorkerIndex) {
+	CurrentWorker = &Workers[WorkerIndex];
+	SetWorkerThreadName(WorkerIndex);
+	backoff Backoff;
+	while (!Stopping.load(std::memory_order_relaxed)) {
+		if (job* Job = FindJob(*CurrentWorker)) {
+			Execute(Job);
+			Backoff = {};
+		} else if (Backoff.IsSpinning()) {
+			Backoff.Pause();
+		} else {
+			Park();
+			Backoff = {};
+		}
+	}
+	CurrentWorker = nullptr;
+}
+
+void job_system::Park() {
+	Sleepers.fetch_add(1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	const u32 Sequence = WakeSequence.load(std::memory_order_acquire);
+	if (!HasQueuedJobs() && !Stopping.load(std::memory_order_relaxed)) {
+		futex::Wait(WakeSequence, Sequence);
+	}
+	Sleepers.fetch_sub(1, std::memory_order_relaxed);
+}
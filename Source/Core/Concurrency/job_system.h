@@ -0,0 +1,123 @@
+#pragma once
+
+#include "basic.h"
+#include "Concurrency/work_stealing_deque.h"
+#include "Containers/dyn_array.h"
+#include "Math/math.h"
+
+#include <atomic>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+struct job_system;
+
+// Number of unfinished jobs started with it. Counter must outlive all of its jobs,
+// fork/join is done by running several jobs with the same counter and waiting for it.
+struct job_counter {
+	std::atomic<u32> Value{0};
+
+	[[nodiscard]] FORCEINLINE bool IsDone() const {
+		return Value.load(std::memory_order_acquire) == 0;
+	}
+};
+
+// One cache line: entry point, counter and inline storage for functor with its captures
+struct alignas(CacheLineSize) job {
+	constexpr static index DataSize = 40;
+
+	void (*Function)(job& Job){nullptr};
+	job_counter* Counter{nullptr};
+
+	union {
+		job* NextFree;
+		alignas(8) u8 Data[DataSize];
+	};
+
+	// worker that allocated this job and gets it back after execution
+	u32 Owner{0};
+};
+
+static_assert(sizeof(job) == CacheLineSize);
+
+struct alignas(CacheLineSize) job_worker {
+	work_stealing_deque<job*> Deque{};
+	job_system* System{nullptr};
+	u32 Index{0};
+	u32 RandomState{0};
+
+	// jobs of this worker are freed without synchronization by the worker itself,
+	// other threads push them to the returned stack, which the worker takes as a whole when free list is empty.
+	// Blocks are tracked with malloc_allocator, default allocator is not thread safe
+	job* FreeJobs{nullptr};
+	dyn_array<job*, malloc_allocator> JobBlocks{};
+	alignas(CacheLineSize) std::atomic<job*> ReturnedJobs{nullptr};
+};
+
+// Work-stealing job system. Every worker owns a Chase-Lev deque, jobs started from a job go to the deque of
+// the current worker and are executed in LIFO order by it (depth first, cache-warm), idle workers steal the
+// oldest jobs from random victims (breadth first, biggest chunks of work).
+// Thread that created the system is worker 0, it executes jobs only while it waits on counters.
+// Workers that found nothing to steal spin with backoff, then park on a futex until new jobs are pushed.
+// Run() and Wait() can only be called from the creating thread or from jobs.
+struct job_system {
+private:
+	constexpr static index JobsPerBlock = 64;
+
+	job_worker* Workers{nullptr};
+	u32 NumWorkers{0};
+	dyn_array<std::thread, malloc_allocator> Threads{};
+	job_worker* PreviousWorker{nullptr};
+
+	alignas(CacheLineSize) std::atomic<u32> WakeSequence{0};
+	std::atomic<u32> Sleepers{0};
+	std::atomic<bool> Stopping{false};
+
+public:
+	// NumThreads background threads are started in addition to the creating thread
+	explicit job_system(u32 NumThreads = math::Max(1u, std::thread::hardware_concurrency()) - 1);
+	~job_system();
+
+	job_system(const job_system&) = delete;
+	job_system& operator=(const job_system&) = delete;
+
+	// total number of workers including creating thread
+	[[nodiscard]] FORCEINLINE u32 GetNumWorkers() const {
+		return NumWorkers;
+	}
+
+	// Functor is moved into the job and must fit into job::DataSize, bigger state has to be captured by reference
+	template <typename functor_type>
+	FORCEINLINE void Run(functor_type&& Functor, job_counter& Counter) {
+		using stored_type = std::decay_t<functor_type>;
+		static_assert(sizeof(stored_type) <= job::DataSize, "job functor is too big, capture by reference");
+		static_assert(alignof(stored_type) <= 8);
+		job* Job = AllocateJob();
+		new (Job->Data) stored_type(std::forward<functor_type>(Functor));
+		Job->Function = [](job& Job) {
+			stored_type& Stored = *std::launder(reinterpret_cast<stored_type*>(Job.Data));
+			Stored();
+			Stored.~stored_type();
+		};
+		Job->Counter = &Counter;
+		Counter.Value.fetch_add(1, std::memory_order_relaxed);
+		Submit(Job);
+	}
+
+	// executes other jobs until counter drops to zero
+	void Wait(job_counter& Counter);
+
+	// index of the calling worker, InvalidIndex for threads that don't belong to any job system
+	[[nodiscard]] static u32 GetCurrentWorkerIndex();
+
+private:
+	job* AllocateJob();
+	void FreeJob(job* Job);
+	void Submit(job* Job);
+	void Execute(job* Job);
+	job* FindJob(job_worker& Worker);
+	[[nodiscard]] bool HasQueuedJobs() const;
+	void WorkerLoop(u32 WorkerIndex);
+	void Park();
+};
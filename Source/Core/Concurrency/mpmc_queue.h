@@ -0,0 +1,194 @@
+#pragma once
+
+#include "basic.h"
+#include "Concurrency/backoff.h"
+#include "Containers/span.h"
+#include "Math/math.h"
+#include "Memory/allocator_base.h"
+#include "Templates/concepts.h"
+
+#include <atomic>
+#include <new>
+#include <utility>
+
+// Bounded lock-free queue for any number of producers and consumers (Dmitry Vyukov's design).
+// Every cell carries sequence number that tells whether it is ready to be written (Sequence == Position)
+// or read (Sequence == Position + 1) for the current lap, so producers and consumers only contend on
+// their own position counter.
+template <typename element_type>
+struct mpmc_queue {
+private:
+	struct cell {
+		std::atomic<u64> Sequence;
+		alignas(element_type) u8 Storage[sizeof(element_type)];
+
+		FORCEINLINE element_type* GetElement() {
+			return reinterpret_cast<element_type*>(Storage);
+		}
+	};
+
+	// read-only after construction
+	alignas(CacheLineSize) cell* Cells{nullptr};
+	u64 Mask{0};
+
+	alignas(CacheLineSize) std::atomic<u64> EnqueuePosition{0};
+	alignas(CacheLineSize) std::atomic<u64> DequeuePosition{0};
+
+public:
+	using value_type = element_type;
+
+	constexpr static bool FastDestruct = trivially_destructible<element_type>;
+
+	FORCEINLINE explicit mpmc_queue(index InCapacity) {
+		const index Capacity = 1 << math::LogOfTwoCeil(math::Max(InCapacity, (index) 2));
+		Cells = (cell*) MemoryAlignedMalloc(Capacity * sizeof(cell), CacheLineSize);
+		for (index Index = 0; Index < Capacity; ++Index) {
+			new (&Cells[Index].Sequence) std::atomic<u64>(Index);
+		}
+		Mask = Capacity - 1;
+	}
+
+	mpmc_queue(const mpmc_queue&) = delete;
+	mpmc_queue& operator=(const mpmc_queue&) = delete;
+
+	FORCEINLINE ~mpmc_queue() {
+		if constexpr (!FastDestruct) {
+			const u64 End = EnqueuePosition.load(std::memory_order_relaxed);
+			for (u64 Position = DequeuePosition.load(std::memory_order_relaxed); Position != End; ++Position) {
+				Cells[Position & Mask].GetElement()->~element_type();
+			}
+		}
+		MemoryAlignedFree(Cells);
+	}
+
+	[[nodiscard]] FORCEINLINE index GetCapacity() const {
+		return (index) (Mask + 1);
+	}
+
+	// approximate when called concurrently
+	[[nodiscard]] FORCEINLINE index GetSize() const {
+		const u64 Dequeued = DequeuePosition.load(std::memory_order_acquire);
+		const u64 Enqueued = EnqueuePosition.load(std::memory_order_acquire);
+		return Enqueued > Dequeued ? (index) (Enqueued - Dequeued) : 0;
+	}
+
+	template <typename... arg_types>
+	FORCEINLINE bool TryEmplace(arg_types&&... Args) {
+		u64 Position = EnqueuePosition.load(std::memory_order_relaxed);
+		cell* Cell;
+		for (;;) {
+			Cell = &Cells[Position & Mask];
+			const u64 Sequence = Cell->Sequence.load(std::memory_order_acquire);
+			const s64 Difference = (s64) Sequence - (s64) Position;
+			if (Difference == 0) {
+				if (EnqueuePosition.compare_exchange_weak(Position, Position + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			} else if (Difference < 0) {
+				return false;
+			} else {
+				Position = EnqueuePosition.load(std::memory_order_relaxed);
+			}
+		}
+		new (Cell->GetElement()) element_type(std::forward<arg_types>(Args)...);
+		Cell->Sequence.store(Position + 1, std::memory_order_release);
+		return true;
+	}
+
+	FORCEINLINE bool TryPush(const element_type& Element) {
+		return TryEmplace(Element);
+	}
+
+	FORCEINLINE bool TryPush(element_type&& Element) {
+		return TryEmplace(std::move(Element));
+	}
+
+	FORCEINLINE bool TryPop(element_type& OutElement) {
+		u64 Position = DequeuePosition.load(std::memory_order_relaxed);
+		cell* Cell;
+		for (;;) {
+			Cell = &Cells[Position & Mask];
+			const u64 Sequence = Cell->Sequence.load(std::memory_order_acquire);
+			const s64 Difference = (s64) Sequence - (s64) (Position + 1);
+			if (Difference == 0) {
+				if (DequeuePosition.compare_exchange_weak(Position, Position + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			} else if (Difference < 0) {
+				return false;
+			} else {
+				Position = DequeuePosition.load(std::memory_order_relaxed);
+			}
+		}
+		PopFromCell(Cell, Position, OutElement);
+		return true;
+	}
+
+	// Claims a contiguous range of positions with single CAS. Free space is estimated conservatively,
+	// but cells in claimed range can still be in the middle of being read by consumers from previous lap,
+	// in which case we briefly wait for them.
+	FORCEINLINE index TryPushBatch(span<element_type> Elements) {
+		u64 Position = EnqueuePosition.load(std::memory_order_relaxed);
+		index Count;
+		for (;;) {
+			const u64 Dequeued = DequeuePosition.load(std::memory_order_acquire);
+			const u64 Used = Position > Dequeued ? Position - Dequeued : 0;
+			const u64 Free = Used > Mask ? 0 : Mask + 1 - Used;
+			Count = (index) math::Min((u64) Elements.GetSize(), Free);
+			if (Count == 0) {
+				return 0;
+			}
+			if (EnqueuePosition.compare_exchange_weak(Position, Position + Count, std::memory_order_relaxed)) {
+				break;
+			}
+		}
+		for (index Index = 0; Index < Count; ++Index) {
+			cell* Cell = &Cells[(Position + Index) & Mask];
+			WaitForSequence(Cell, Position + Index);
+			new (Cell->GetElement()) element_type(Elements[Index]);
+			Cell->Sequence.store(Position + Index + 1, std::memory_order_release);
+		}
+		return Count;
+	}
+
+	// Same as TryPushBatch, claimed cells may still be written by producers that already claimed them
+	FORCEINLINE index TryPopBatch(mutable_span<element_type> OutElements) {
+		u64 Position = DequeuePosition.load(std::memory_order_relaxed);
+		index Count;
+		for (;;) {
+			const u64 Enqueued = EnqueuePosition.load(std::memory_order_acquire);
+			const u64 Available = Enqueued > Position ? Enqueued - Position : 0;
+			Count = (index) math::Min((u64) OutElements.GetSize(), Available);
+			if (Count == 0) {
+				return 0;
+			}
+			if (DequeuePosition.compare_exchange_weak(Position, Position + Count, std::memory_order_relaxed)) {
+				break;
+			}
+		}
+		for (index Index = 0; Index < Count; ++Index) {
+			cell* Cell = &Cells[(Position + Index) & Mask];
+			WaitForSequence(Cell, Position + Index + 1);
+			PopFromCell(Cell, Position + Index, OutElements[Index]);
+		}
+		return Count;
+	}
+
+private:
+	// peer that claimed the cell is expected to finish soon, unless it was preempted
+	FORCEINLINE static void WaitForSequence(cell* Cell, u64 Sequence) {
+		backoff Backoff;
+		while (Cell->Sequence.load(std::memory_order_acquire) != Sequence) {
+			Backoff.PauseOrYield();
+		}
+	}
+
+	FORCEINLINE void PopFromCell(cell* Cell, u64 Position, element_type& OutElement) {
+		element_type* Element = Cell->GetElement();
+		OutElement = std::move(*Element);
+		if constexpr (!FastDestruct) {
+			Element->~element_type();
+		}
+		Cell->Sequence.store(Position + Mask + 1, std::memory_order_release);
+	}
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "basic.h"
+#include "Concurrency/backoff.h"
+#include "Concurrency/futex.h"
+
+#include <atomic>
+
+// Spins with backoff while owner is likely to release lock soon, then parks on futex. Unlock only
+// enters the kernel when somebody may be parked, tracked by the contended state (three state futex mutex).
+struct mutex {
+private:
+	constexpr static u32 Unlocked = 0;
+	constexpr static u32 Locked = 1;
+	constexpr static u32 Contended = 2;
+
+	std::atomic<u32> State{Unlocked};
+
+public:
+	mutex() = default;
+	mutex(const mutex&) = delete;
+	mutex& operator=(const mutex&) = delete;
+
+	FORCEINLINE void Lock() {
+		if (!TryLock()) [[unlikely]] {
+			LockSlow();
+		}
+	}
+
+	FORCEINLINE bool TryLock() {
+		u32 Expected = Unlocked;
+		return State.compare_exchange_strong(Expected, Locked, std::memory_order_acquire, std::memory_order_relaxed);
+	}
+
+	FORCEINLINE void Unlock() {
+		if (State.exchange(Unlocked, std::memory_order_release) == Contended) [[unlikely]] {
+			futex::WakeOne(State);
+		}
+	}
+
+private:
+	void LockSlow() {
+		backoff Backoff;
+		while (Backoff.IsSpinning()) {
+			Backoff.Pause();
+			if (State.load(std::memory_order_relaxed) == Unlocked && TryLock()) {
+				return;
+			}
+		}
+		// Owner can't know whether this thread is parked, so from now on lock stays contended and every unlock
+		// wakes somebody. Woken thread takes the lock as contended too, other parked threads may still wait.
+		while (State.exchange(Contended, std::memory_order_acquire) != Unlocked) {
+			futex::Wait(State, Contended);
+		}
+	}
+};
@@ -0,0 +1,254 @@
+#pragma once
+
+#include "basic.h"
+#include "Concurrency/job_system.h"
+#include "Containers/algo.h"
+#include "Containers/dyn_array.h"
+#include "Containers/span.h"
+#include "Math/math.h"
+#include "Memory/allocator_base.h"
+#include "Templates/less.h"
+
+#include <concepts>
+#include <utility>
+
+// Data parallel algorithms on top of job_system, callable from the thread that owns the job system or from jobs.
+// Work is cut into chunks of Grain elements, chunk boundaries only depend on element count and grain,
+// never on number of workers or on who stole what. Reduce and Scan combine chunk results in chunk order,
+// so for a given grain their results are bit-identical between runs and machines, even for floats.
+// Grain is a tradeoff between scheduling overhead (~100ns per chunk) and load balancing.
+namespace parallel {
+constexpr index DefaultGrain = 4096;
+
+// temporary buffers are allocated concurrently from different workers, default allocator is not thread safe
+template <typename element_type>
+using buffer = dyn_array<element_type, malloc_allocator>;
+
+// written without Count + Grain - 1, which wraps for counts close to the index limit
+FORCEINLINE index GetNumChunks(index Count, index Grain) {
+	Grain = math::Max(Grain, (index) 1);
+	return Count / Grain + (Count % Grain != 0);
+}
+
+// end of chunk that starts below Count, (Chunk + 1) * Grain of the last chunk could wrap
+FORCEINLINE index GetChunkEnd(index Count, index Grain, index Chunk) {
+	const index Begin = Chunk * Grain;
+	return Begin + math::Min(Grain, Count - Begin);
+}
+
+namespace internal {
+// Halves chunk range, upper halves become jobs for thieves, so first steal takes half of all work.
+// Nested jobs are counted before their parent finishes, so shared counter can't reach zero early.
+template <typename functor_type>
+void SplitChunks(job_system& Jobs, index Begin, index End, const functor_type& Functor, job_counter& Counter) {
+	while (End - Begin > 1) {
+		const index Middle = Begin + (End - Begin) / 2;
+		Jobs.Run(
+			[&Jobs, Middle, End, &Functor, &Counter]() { SplitChunks(Jobs, Middle, End, Functor, Counter); }, Counter);
+		End = Middle;
+	}
+	if (Begin < End) {
+		Functor(Begin);
+	}
+}
+
+// Functor(ChunkIndex) for every chunk, blocks (executing jobs) until all chunks are done
+template <typename functor_type>
+FORCEINLINE void ForEachChunk(job_system& Jobs, index NumChunks, const functor_type& Functor) {
+	if (NumChunks <= 1) {
+		if (NumChunks == 1) {
+			Functor(0);
+		}
+		return;
+	}
+	job_counter Counter;
+	SplitChunks(Jobs, 0, NumChunks, Functor, Counter);
+	Jobs.Wait(Counter);
+}
+}	 // namespace internal
+
+// Functor(Begin, End) for consecutive ranges of at most Grain indices covering [0, Count)
+template <typename functor_type>
+FORCEINLINE void For(job_system& Jobs, index Count, index Grain, const functor_type& Functor) {
+	Grain = math::Max(Grain, (index) 1);
+	internal::ForEachChunk(Jobs, GetNumChunks(Count, Grain), [Count, Grain, &Functor](index Chunk) {
+		Functor(Chunk * Grain, GetChunkEnd(Count, Grain, Chunk));
+	});
+}
+
+// Functor(Element, Index) for every element
+template <typename element_type, typename functor_type>
+FORCEINLINE void ForEach(
+	job_system& Jobs, mutable_span<element_type> Elements, const functor_type& Functor, index Grain = DefaultGrain) {
+	element_type* Data = Elements.GetData();
+	For(Jobs, Elements.GetSize(), Grain, [Data, &Functor](index Begin, index End) {
+		for (index Index = Begin; Index < End; ++Index) {
+			Functor(Data[Index], Index);
+		}
+	});
+}
+
+// Accumulate(Result, Element) folds elements of a chunk starting from Identity,
+// then Combine(Left, Right) folds chunk results left to right. Combine must be associative with Identity.
+template <typename element_type, typename result_type, typename accumulate_type, typename combine_type>
+	requires(std::invocable<combine_type, result_type, result_type>)
+FORCEINLINE result_type Reduce(
+	job_system& Jobs,
+	span<element_type> Elements,
+	const result_type& Identity,
+	const accumulate_type& Accumulate,
+	const combine_type& Combine,
+	index Grain = DefaultGrain) {
+	Grain = math::Max(Grain, (index) 1);
+	const index NumChunks = GetNumChunks(Elements.GetSize(), Grain);
+	buffer<result_type> Partials;
+	Partials.Reserve(NumChunks);
+	for (index Chunk = 0; Chunk < NumChunks; ++Chunk) {
+		Partials.Add(Identity);
+	}
+	const element_type* Data = Elements.GetData();
+	const index Count = Elements.GetSize();
+	internal::ForEachChunk(Jobs, NumChunks, [&](index Chunk) {
+		result_type Result = Identity;
+		const index End = GetChunkEnd(Count, Grain, Chunk);
+		for (index Index = Chunk * Grain; Index < End; ++Index) {
+			Result = Accumulate(std::move(Result), Data[Index]);
+		}
+		Partials[Chunk] = std::move(Result);
+	});
+	result_type Result = Identity;
+	for (result_type& Partial : Partials) {
+		Result = Combine(std::move(Result), std::move(Partial));
+	}
+	return Result;
+}
+
+template <typename element_type, typename combine_type>
+FORCEINLINE element_type Reduce(
+	job_system& Jobs,
+	span<element_type> Elements,
+	const element_type& Identity,
+	const combine_type& Combine,
+	index Grain = DefaultGrain) {
+	return Reduce(Jobs, Elements, Identity, Combine, Combine, Grain);
+}
+
+// Inclusive prefix scan, OutElements[i] = Identity op Elements[0] op ... op Elements[i].
+// OutElements may be the same memory as Elements. Three passes: chunk totals in parallel,
+// serial scan over chunk totals, chunk scans seeded with preceding total in parallel.
+template <typename element_type, typename combine_type>
+FORCEINLINE void Scan(
+	job_system& Jobs,
+	span<element_type> Elements,
+	mutable_span<element_type> OutElements,
+	const element_type& Identity,
+	const combine_type& Combine,
+	index Grain = DefaultGrain) {
+	CHECK(OutElements.GetSize() == Elements.GetSize())
+	Grain = math::Max(Grain, (index) 1);
+	const index Count = Elements.GetSize();
+	const index NumChunks = GetNumChunks(Count, Grain);
+	const element_type* Data = Elements.GetData();
+	element_type* OutData = OutElements.GetData();
+	buffer<element_type> Offsets;
+	Offsets.Reserve(NumChunks);
+	for (index Chunk = 0; Chunk < NumChunks; ++Chunk) {
+		Offsets.Add(Identity);
+	}
+	// last chunk total is never used as an offset
+	internal::ForEachChunk(Jobs, NumChunks - (NumChunks > 0), [&](index Chunk) {
+		element_type Total = Identity;
+		for (index Index = Chunk * Grain; Index < (Chunk + 1) * Grain; ++Index) {
+			Total = Combine(std::move(Total), Data[Index]);
+		}
+		Offsets[Chunk] = std::move(Total);
+	});
+	element_type Running = Identity;
+	for (element_type& Offset : Offsets) {
+		element_type Total = std::move(Offset);
+		Offset = Running;
+		Running = Combine(std::move(Running), std::move(Total));
+	}
+	internal::ForEachChunk(Jobs, NumChunks, [&](index Chunk) {
+		element_type Result = Offsets[Chunk];
+		const index End = GetChunkEnd(Count, Grain, Chunk);
+		for (index Index = Chunk * Grain; Index < End; ++Index) {
+			Result = Combine(std::move(Result), Data[Index]);
+			OutData[Index] = Result;
+		}
+	});
+}
+
+namespace internal {
+template <typename element_type, typename less_type>
+FORCEINLINE element_type* MedianOfThree(element_type* A, element_type* B, element_type* C, less_type& LessOp) {
+	if (LessOp(*A, *B)) {
+		return LessOp(*B, *C) ? B : (LessOp(*A, *C) ? C : A);
+	}
+	return LessOp(*A, *C) ? A : (LessOp(*B, *C) ? C : B);
+}
+
+// Hoare partition around median of three, returns final position of the pivot.
+// Elements before it are not greater than pivot, elements after it are not less.
+template <typename element_type, typename less_type>
+element_type* Partition(element_type* Begin, element_type* End, less_type& LessOp) {
+	const index Count = (index) (End - Begin);
+	algo::SwapElements(*Begin, *MedianOfThree(Begin, Begin + Count / 2, End - 1, LessOp));
+	element_type* Left = Begin;
+	element_type* Right = End;
+	for (;;) {
+		while (++Left < End && LessOp(*Left, *Begin))
+			;
+		while (LessOp(*Begin, *--Right))
+			;
+		if (Left >= Right) {
+			break;
+		}
+		algo::SwapElements(*Left, *Right);
+	}
+	algo::SwapElements(*Begin, *Right);
+	return Right;
+}
+
+// shared by all jobs of one Sort() call, keeps job captures small
+template <typename less_type>
+struct sort_context {
+	job_system& Jobs;
+	less_type& LessOp;
+	job_counter& Counter;
+	index Grain;
+};
+
+template <typename element_type, typename less_type>
+void SortRange(sort_context<less_type>& Context, element_type* Begin, element_type* End) {
+	while ((index) (End - Begin) > Context.Grain) {
+		element_type* Pivot = Partition(Begin, End, Context.LessOp);
+		// smaller part goes to thieves, bigger one is partitioned further by this worker
+		if (Pivot - Begin < End - Pivot) {
+			Context.Jobs.Run([&Context, Begin, Pivot]() { SortRange(Context, Begin, Pivot); }, Context.Counter);
+			Begin = Pivot + 1;
+		} else {
+			Context.Jobs.Run([&Context, Pivot, End]() { SortRange(Context, Pivot + 1, End); }, Context.Counter);
+			End = Pivot;
+		}
+	}
+	if (End - Begin > 1) {
+		algo::Quicksort(Begin, End, Context.LessOp);
+	}
+}
+}	 // namespace internal
+
+// Unstable parallel quicksort, partitions are sorted by different workers once they are split off.
+// Top level partition is serial, so speedup grows with log of element count rather than with worker count.
+template <typename element_type, typename less_type = default_less_op>
+FORCEINLINE void Sort(
+	job_system& Jobs,
+	mutable_span<element_type> Elements,
+	less_type LessOp = default_less_op{},
+	index Grain = DefaultGrain) {
+	job_counter Counter;
+	internal::sort_context<less_type> Context{Jobs, LessOp, Counter, math::Max(Grain, (index) 32)};
+	internal::SortRange(Context, Elements.GetData(), Elements.GetData() + Elements.GetSize());
+	Jobs.Wait(Counter);
+}
+}	 // namespace parallel
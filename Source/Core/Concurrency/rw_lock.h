@@ -0,0 +1,102 @@
+#pragma once
+
+#include "basic.h"
+#include "Concurrency/backoff.h"
+#include "Concurrency/futex.h"
+
+#include <atomic>
+
+// Reader-writer lock, spins with backoff and then parks on futex like mutex.
+// Prefers writers: new readers hold back while a writer waits, so a steady stream of readers can't starve it.
+// Not recursive, thread holding shared lock deadlocks on another LockShared if a writer queued in between.
+struct rw_lock {
+private:
+	constexpr static u32 WriterBit = 1u << 31;
+
+	// writer bit and number of active readers
+	std::atomic<u32> State{0};
+	std::atomic<u32> WaitingWriters{0};
+	// futex word, bumped by every release that may let a parked thread in
+	std::atomic<u32> WakeSequence{0};
+	std::atomic<u32> Sleepers{0};
+
+public:
+	rw_lock() = default;
+	rw_lock(const rw_lock&) = delete;
+	rw_lock& operator=(const rw_lock&) = delete;
+
+	FORCEINLINE void Lock() {
+		if (!TryLock()) [[unlikely]] {
+			WaitingWriters.fetch_add(1, std::memory_order_relaxed);
+			LockSlow([this]() { return TryLock(); });
+			WaitingWriters.fetch_sub(1, std::memory_order_relaxed);
+		}
+	}
+
+	FORCEINLINE bool TryLock() {
+		u32 Expected = 0;
+		return State.compare_exchange_strong(Expected, WriterBit, std::memory_order_acquire, std::memory_order_relaxed);
+	}
+
+	FORCEINLINE void Unlock() {
+		State.store(0, std::memory_order_release);
+		WakeSleepers();
+	}
+
+	FORCEINLINE void LockShared() {
+		if (!TryLockShared()) [[unlikely]] {
+			LockSlow([this]() { return TryLockShared(); });
+		}
+	}
+
+	FORCEINLINE bool TryLockShared() {
+		u32 Current = State.load(std::memory_order_relaxed);
+		while (!(Current & WriterBit) && WaitingWriters.load(std::memory_order_relaxed) == 0) {
+			if (State.compare_exchange_weak(Current, Current + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	FORCEINLINE void UnlockShared() {
+		// only writers wait for readers
+		if (State.fetch_sub(1, std::memory_order_release) == 1) {
+			WakeSleepers();
+		}
+	}
+
+private:
+	template <typename try_lock_type>
+	void LockSlow(try_lock_type&& TryAcquire) {
+		backoff Backoff;
+		while (Backoff.IsSpinning()) {
+			Backoff.Pause();
+			if (TryAcquire()) {
+				return;
+			}
+		}
+		while (true) {
+			const u32 Sequence = WakeSequence.load(std::memory_order_acquire);
+			Sleepers.fetch_add(1, std::memory_order_relaxed);
+			// pairs with fence in WakeSleepers, either releasing thread sees this sleeper or this thread sees release
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			const bool Acquired = TryAcquire();
+			if (!Acquired) {
+				futex::Wait(WakeSequence, Sequence);
+			}
+			Sleepers.fetch_sub(1, std::memory_order_relaxed);
+			if (Acquired || TryAcquire()) {
+				return;
+			}
+		}
+	}
+
+	FORCEINLINE void WakeSleepers() {
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (Sleepers.load(std::memory_order_relaxed) > 0) [[unlikely]] {
+			WakeSequence.fetch_add(1, std::memory_order_release);
+			futex::WakeAll(WakeSequence);
+		}
+	}
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "basic.h"
+#include "Concurrency/backoff.h"
+
+#include <atomic>
+#include <cstdint>
+
+// Spinlock with a version counter, version is odd while locked and every unlock publishes a new even version.
+// Readers don't take the lock, they remember version before reading protected data and check it afterwards,
+// retrying if writer was active in between. Reading never writes to the shared cache line.
+// Readers may observe torn data before validation fails, so it has to be safe to read and discard.
+struct seqlock {
+private:
+	std::atomic<uint32_t> Version{0};
+
+public:
+	void Lock() {
+		backoff Backoff;
+		uint32_t Expected = Version.load(std::memory_order_relaxed);
+		while ((Expected & 1) || !Version.compare_exchange_weak(Expected, Expected + 1, std::memory_order_acquire)) {
+			Backoff.PauseOrYield();
+			Expected = Version.load(std::memory_order_relaxed);
+		}
+		// protected writes must not become visible before odd version
+		std::atomic_thread_fence(std::memory_order_release);
+	}
+
+	void Unlock() {
+		Version.store(Version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	uint32_t ReadBegin() const {
+		backoff Backoff;
+		uint32_t Current = Version.load(std::memory_order_acquire);
+		while (Current & 1) {
+			Backoff.PauseOrYield();
+			Current = Version.load(std::memory_order_acquire);
+		}
+		return Current;
+	}
+
+	// true if data read since ReadBegin may be inconsistent
+	bool ReadRetry(uint32_t BeginVersion) const {
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return Version.load(std::memory_order_relaxed) != BeginVersion;
+	}
+};
@@ -1,20 +1,35 @@
 #pragma once
 
+#include "basic.h"
+#include "Concurrency/backoff.h"
+
 #include <atomic>
-#include <thread>
 
+// Lock for critical sections of a few instructions. Waiters spin on a plain load with exponential backoff
+// and start yielding once backoff is exhausted, so owner preempted with more threads than cores gets to run.
+// Longer or oversubscribed critical sections are better served by mutex, which parks waiters.
 struct spinlock {
 private:
 	std::atomic<bool> Flag{0};
 
 public:
 	void Lock() {
-		while (Flag.exchange(1, std::memory_order_acquire)) {
-			_mm_pause();
+		if (!Flag.exchange(1, std::memory_order_acquire)) [[likely]] {
+			return;
 		}
+		backoff Backoff;
+		do {
+			while (Flag.load(std::memory_order_relaxed)) {
+				Backoff.PauseOrYield();
+			}
+		} while (Flag.exchange(1, std::memory_order_acquire));
+	}
+
+	bool TryLock() {
+		return !Flag.load(std::memory_order_relaxed) && !Flag.exchange(1, std::memory_order_acquire);
 	}
 
 	void Unlock() {
 		Flag.store(0, std::memory_order_release);
 	}
-};
\ No newline at end of file
+};
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "basic.h"
+#include "Containers/span.h"
+#include "Math/math.h"
+#include "Memory/allocator_base.h"
+#include "Templates/concepts.h"
+
+#include <atomic>
+#include <new>
+#include <utility>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+// Capacity is rounded up to power of 2. Producer and consumer positions live on separate cache lines,
+// each side also keeps cached copy of the other side's position so it only touches shared line
+// when queue looks full/empty.
+template <typename element_type>
+struct spsc_queue {
+private:
+	// read-only after construction
+	alignas(CacheLineSize) element_type* Data{nullptr};
+	u64 Mask{0};
+
+	// written by producer
+	alignas(CacheLineSize) std::atomic<u64> Tail{0};
+	u64 CachedHead{0};
+
+	// written by consumer
+	alignas(CacheLineSize) std::atomic<u64> Head{0};
+	u64 CachedTail{0};
+
+public:
+	using value_type = element_type;
+
+	constexpr static bool FastDestruct = trivially_destructible<element_type>;
+
+	FORCEINLINE explicit spsc_queue(index InCapacity) {
+		const index Capacity = 1 << math::LogOfTwoCeil(math::Max(InCapacity, (index) 2));
+		Data = (element_type*) MemoryAlignedMalloc(Capacity * sizeof(element_type), CacheLineSize);
+		Mask = Capacity - 1;
+	}
+
+	spsc_queue(const spsc_queue&) = delete;
+	spsc_queue& operator=(const spsc_queue&) = delete;
+
+	FORCEINLINE ~spsc_queue() {
+		if constexpr (!FastDestruct) {
+			const u64 End = Tail.load(std::memory_order_relaxed);
+			for (u64 Position = Head.load(std::memory_order_relaxed); Position != End; ++Position) {
+				Data[Position & Mask].~element_type();
+			}
+		}
+		MemoryAlignedFree(Data);
+	}
+
+	[[nodiscard]] FORCEINLINE index GetCapacity() const {
+		return (index) (Mask + 1);
+	}
+
+	// approximate when called concurrently
+	[[nodiscard]] FORCEINLINE index GetSize() const {
+		// Head first, consumer can't move it past a Tail loaded afterwards
+		const u64 Dequeued = Head.load(std::memory_order_acquire);
+		const u64 Enqueued = Tail.load(std::memory_order_acquire);
+		return Enqueued > Dequeued ? (index) (Enqueued - Dequeued) : 0;
+	}
+
+	// producer only
+	template <typename... arg_types>
+	FORCEINLINE bool TryEmplace(arg_types&&... Args) {
+		const u64 Position = Tail.load(std::memory_order_relaxed);
+		if (Position - CachedHead > Mask) {
+			CachedHead = Head.load(std::memory_order_acquire);
+			if (Position - CachedHead > Mask) {
+				return false;
+			}
+		}
+		new (&Data[Position & Mask]) element_type(std::forward<arg_types>(Args)...);
+		Tail.store(Position + 1, std::memory_order_release);
+		return true;
+	}
+
+	// producer only
+	FORCEINLINE bool TryPush(const element_type& Element) {
+		return TryEmplace(Element);
+	}
+
+	// producer only
+	FORCEINLINE bool TryPush(element_type&& Element) {
+		return TryEmplace(std::move(Element));
+	}
+
+	// producer only, pushes as many elements from the front of Elements as fit, publishes them at once
+	FORCEINLINE index TryPushBatch(span<element_type> Elements) {
+		const u64 Position = Tail.load(std::memory_order_relaxed);
+		u64 Free = Mask + 1 - (Position - CachedHead);
+		if (Free < Elements.GetSize()) {
+			CachedHead = Head.load(std::memory_order_acquire);
+			Free = Mask + 1 - (Position - CachedHead);
+		}
+		const index Count = (index) math::Min((u64) Elements.GetSize(), Free);
+		for (index Index = 0; Index < Count; ++Index) {
+			new (&Data[(Position + Index) & Mask]) element_type(Elements[Index]);
+		}
+		if (Count > 0) {
+			Tail.store(Position + Count, std::memory_order_release);
+		}
+		return Count;
+	}
+
+	// consumer only
+	FORCEINLINE bool TryPop(element_type& OutElement) {
+		const u64 Position = Head.load(std::memory_order_relaxed);
+		if (Position == CachedTail) {
+			CachedTail = Tail.load(std::memory_order_acquire);
+			if (Position == CachedTail) {
+				return false;
+			}
+		}
+		element_type& Element = Data[Position & Mask];
+		OutElement = std::move(Element);
+		if constexpr (!FastDestruct) {
+			Element.~element_type();
+		}
+		Head.store(Position + 1, std::memory_order_release);
+		return true;
+	}
+
+	// consumer only, returns number of elements written to the front of OutElements
+	FORCEINLINE index TryPopBatch(mutable_span<element_type> OutElements) {
+		const u64 Position = Head.load(std::memory_order_relaxed);
+		u64 Available = CachedTail - Position;
+		if (Available < OutElements.GetSize()) {
+			CachedTail = Tail.load(std::memory_order_acquire);
+			Available = CachedTail - Position;
+		}
+		const index Count = (index) math::Min((u64) OutElements.GetSize(), Available);
+		for (index Index = 0; Index < Count; ++Index) {
+			element_type& Element = Data[(Position + Index) & Mask];
+			OutElements[Index] = std::move(Element);
+			if constexpr (!FastDestruct) {
+				Element.~element_type();
+			}
+		}
+		if (Count > 0) {
+			Head.store(Position + Count, std::memory_order_release);
+		}
+		return Count;
+	}
+};
@@ -0,0 +1,145 @@
+#pragma once
+
+#include "basic.h"
+#include "Containers/dyn_array.h"
+#include "Math/math.h"
+#include "Memory/allocator_base.h"
+#include "Templates/concepts.h"
+
+#include <atomic>
+#include <new>
+
+// Unbounded Chase-Lev deque (C11 memory model version by Le, Pop, Cohen and Zappa Nardelli).
+// Owner thread pushes and pops at the bottom without atomic RMW unless it races for the last element,
+// any other thread steals from the top with single CAS. Elements are stored in atomics, so they should be
+// small trivially copyable values, usually pointers.
+// Owner grows the ring when it is full, thieves may still read the old ring, so old rings are only released
+// in destructor. Their total size is less than the size of the current ring.
+template <trivially_copyable element_type>
+struct work_stealing_deque {
+private:
+	struct ring {
+		s64 Mask;
+		std::atomic<element_type>* Slots;
+
+		FORCEINLINE element_type Get(s64 Position) const {
+			return Slots[Position & Mask].load(std::memory_order_relaxed);
+		}
+
+		FORCEINLINE void Put(s64 Position, element_type Element) {
+			Slots[Position & Mask].store(Element, std::memory_order_relaxed);
+		}
+	};
+
+	// written by thieves
+	alignas(CacheLineSize) std::atomic<s64> Top{0};
+
+	// written by owner
+	alignas(CacheLineSize) std::atomic<s64> Bottom{0};
+	std::atomic<ring*> Ring{nullptr};
+	dyn_array<ring*, malloc_allocator> RetiredRings{};
+
+public:
+	using value_type = element_type;
+
+	FORCEINLINE explicit work_stealing_deque(index InitialCapacity = 1024) {
+		const index Capacity = 1 << math::LogOfTwoCeil(math::Max(InitialCapacity, (index) 2));
+		Ring.store(CreateRing(Capacity), std::memory_order_relaxed);
+	}
+
+	work_stealing_deque(const work_stealing_deque&) = delete;
+	work_stealing_deque& operator=(const work_stealing_deque&) = delete;
+
+	FORCEINLINE ~work_stealing_deque() {
+		MemoryAlignedFree(Ring.load(std::memory_order_relaxed));
+		for (ring* Retired : RetiredRings) {
+			MemoryAlignedFree(Retired);
+		}
+	}
+
+	// approximate when called concurrently
+	[[nodiscard]] FORCEINLINE index GetSize() const {
+		const s64 Size = Bottom.load(std::memory_order_acquire) - Top.load(std::memory_order_acquire);
+		return Size > 0 ? (index) Size : 0;
+	}
+
+	// owner only
+	FORCEINLINE void Push(element_type Element) {
+		const s64 BottomPosition = Bottom.load(std::memory_order_relaxed);
+		const s64 TopPosition = Top.load(std::memory_order_acquire);
+		ring* Current = Ring.load(std::memory_order_relaxed);
+		if (BottomPosition - TopPosition > Current->Mask) [[unlikely]] {
+			Current = Grow(Current, TopPosition, BottomPosition);
+		}
+		Current->Put(BottomPosition, Element);
+		// release store instead of release fence from the paper, same code on x86 and visible to thread sanitizer
+		Bottom.store(BottomPosition + 1, std::memory_order_release);
+	}
+
+	// owner only, takes the most recently pushed element
+	FORCEINLINE bool TryPop(element_type& OutElement) {
+		const s64 BottomPosition = Bottom.load(std::memory_order_relaxed) - 1;
+		ring* Current = Ring.load(std::memory_order_relaxed);
+		Bottom.store(BottomPosition, std::memory_order_relaxed);
+		// reservation of the bottom element has to be visible to thieves before we look at top
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		s64 TopPosition = Top.load(std::memory_order_relaxed);
+		if (TopPosition > BottomPosition) {
+			Bottom.store(BottomPosition + 1, std::memory_order_relaxed);
+			return false;
+		}
+		OutElement = Current->Get(BottomPosition);
+		if (TopPosition == BottomPosition) {
+			// last element, thieves may be taking it at the same time
+			const bool Won = Top.compare_exchange_strong(
+				TopPosition, TopPosition + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+			Bottom.store(BottomPosition + 1, std::memory_order_relaxed);
+			return Won;
+		}
+		return true;
+	}
+
+	// any thread, takes the oldest element. Fails spuriously when another thief or owner wins the race
+	FORCEINLINE bool TrySteal(element_type& OutElement) {
+		s64 TopPosition = Top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const s64 BottomPosition = Bottom.load(std::memory_order_acquire);
+		if (TopPosition >= BottomPosition) {
+			return false;
+		}
+		// consume ordering in the paper, acquire is what compilers would emit for it anyway
+		ring* Current = Ring.load(std::memory_order_acquire);
+		const element_type Element = Current->Get(TopPosition);
+		if (!Top.compare_exchange_strong(
+				TopPosition, TopPosition + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+			return false;
+		}
+		OutElement = Element;
+		return true;
+	}
+
+private:
+	FORCEINLINE static ring* CreateRing(index Capacity) {
+		// slots are placed right after ring header in the same allocation
+		const u64 HeaderSize = (sizeof(ring) + CacheLineSize - 1) & ~(CacheLineSize - 1);
+		const u64 SlotsSize = Capacity * sizeof(std::atomic<element_type>);
+		u8* Memory = (u8*) MemoryAlignedMalloc(HeaderSize + SlotsSize, CacheLineSize);
+		ring* NewRing = new (Memory) ring{};
+		NewRing->Mask = (s64) Capacity - 1;
+		NewRing->Slots = reinterpret_cast<std::atomic<element_type>*>(Memory + HeaderSize);
+		for (index Slot = 0; Slot < Capacity; ++Slot) {
+			new (&NewRing->Slots[Slot]) std::atomic<element_type>();
+		}
+		return NewRing;
+	}
+
+	ring* Grow(ring* Current, s64 TopPosition, s64 BottomPosition) {
+		ring* NewRing = CreateRing((index) (Current->Mask + 1) * 2);
+		for (s64 Position = TopPosition; Position < BottomPosition; ++Position) {
+			NewRing->Put(Position, Current->Get(Position));
+		}
+		Ring.store(NewRing, std::memory_order_release);
+		RetiredRings.Add(Current);
+		return NewRing;
+	}
+};
@@ -0,0 +1,530 @@
+#pragma once
+
+#include "basic.h"
+#include "Math/math.h"
+#include "Memory/memory.h"
+
+#include <bit>
+#include <cstring>
+#include <utility>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define BITSET_SSE2 1
+#include <immintrin.h>
+#endif
+
+// Word kernels shared between bitset and dyn_bitset.
+// Bits past the logical size in the last word are always kept zeroed, so kernels can work on whole words.
+namespace bits {
+using word = u64;
+constexpr index WordBits = 64;
+
+enum class operation : u8 { op_and, op_or, op_xor, op_and_not };
+
+FORCEINLINE constexpr index GetNumWords(index NumBits) {
+	return (NumBits + WordBits - 1) / WordBits;
+}
+
+FORCEINLINE constexpr word GetMask(index Bit) {
+	return (word) 1 << (Bit % WordBits);
+}
+
+// mask of valid bits in the last word
+FORCEINLINE constexpr word GetTailMask(index NumBits) {
+	const index TailBits = NumBits % WordBits;
+	return TailBits == 0 ? ~(word) 0 : ((word) 1 << TailBits) - 1;
+}
+
+template <operation Operation>
+FORCEINLINE constexpr word Combine(word Lhs, word Rhs) {
+	if constexpr (Operation == operation::op_and) {
+		return Lhs & Rhs;
+	} else if constexpr (Operation == operation::op_or) {
+		return Lhs | Rhs;
+	} else if constexpr (Operation == operation::op_xor) {
+		return Lhs ^ Rhs;
+	} else {
+		return Lhs & ~Rhs;
+	}
+}
+
+#if defined(__AVX2__)
+template <operation Operation>
+FORCEINLINE __m256i Combine(__m256i Lhs, __m256i Rhs) {
+	if constexpr (Operation == operation::op_and) {
+		return _mm256_and_si256(Lhs, Rhs);
+	} else if constexpr (Operation == operation::op_or) {
+		return _mm256_or_si256(Lhs, Rhs);
+	} else if constexpr (Operation == operation::op_xor) {
+		return _mm256_xor_si256(Lhs, Rhs);
+	} else {
+		return _mm256_andnot_si256(Rhs, Lhs);	 // andnot negates first operand
+	}
+}
+#endif
+
+#if defined(BITSET_SSE2)
+template <operation Operation>
+FORCEINLINE __m128i Combine(__m128i Lhs, __m128i Rhs) {
+	if constexpr (Operation == operation::op_and) {
+		return _mm_and_si128(Lhs, Rhs);
+	} else if constexpr (Operation == operation::op_or) {
+		return _mm_or_si128(Lhs, Rhs);
+	} else if constexpr (Operation == operation::op_xor) {
+		return _mm_xor_si128(Lhs, Rhs);
+	} else {
+		return _mm_andnot_si128(Rhs, Lhs);	  // andnot negates first operand
+	}
+}
+#endif
+
+// Dest = Dest (op) Source, uses widest vectors available for the target and finishes with scalar words
+template <operation Operation>
+FORCEINLINE constexpr void Apply(word* Dest, const word* Source, index NumWords) {
+	index Word = 0;
+	if (!std::is_constant_evaluated()) {
+#if defined(__AVX2__)
+		for (; Word + 4 <= NumWords; Word += 4) {
+			const __m256i Lhs = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(Dest + Word));
+			const __m256i Rhs = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(Source + Word));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(Dest + Word), Combine<Operation>(Lhs, Rhs));
+		}
+#endif
+#if defined(BITSET_SSE2)
+		for (; Word + 2 <= NumWords; Word += 2) {
+			const __m128i Lhs = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Dest + Word));
+			const __m128i Rhs = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Source + Word));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(Dest + Word), Combine<Operation>(Lhs, Rhs));
+		}
+#endif
+	}
+	for (; Word < NumWords; ++Word) {
+		Dest[Word] = Combine<Operation>(Dest[Word], Source[Word]);
+	}
+}
+
+FORCEINLINE constexpr index PopCount(const word* Words, index NumWords) {
+	// independent accumulators so popcnt latency is not on a single dependency chain
+	index Counts[4]{};
+	index Word = 0;
+	for (; Word + 4 <= NumWords; Word += 4) {
+		Counts[0] += std::popcount(Words[Word]);
+		Counts[1] += std::popcount(Words[Word + 1]);
+		Counts[2] += std::popcount(Words[Word + 2]);
+		Counts[3] += std::popcount(Words[Word + 3]);
+	}
+	for (; Word < NumWords; ++Word) {
+		Counts[0] += std::popcount(Words[Word]);
+	}
+	return Counts[0] + Counts[1] + Counts[2] + Counts[3];
+}
+
+FORCEINLINE constexpr bool Any(const word* Words, index NumWords) {
+	for (index Word = 0; Word < NumWords; ++Word) {
+		if (Words[Word] != 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// first set bit at or after From, InvalidIndex if there is none
+FORCEINLINE constexpr index FindNextSet(const word* Words, index NumWords, index From) {
+	index WordIndex = From / WordBits;
+	if (WordIndex >= NumWords) {
+		return InvalidIndex;
+	}
+	word Word = Words[WordIndex] & (~(word) 0 << (From % WordBits));
+	for (;;) {
+		unsigned long Bit = 0;
+		if (BitScanForward(&Bit, Word)) {
+			return WordIndex * WordBits + (index) Bit;
+		}
+		if (++WordIndex == NumWords) {
+			return InvalidIndex;
+		}
+		Word = Words[WordIndex];
+	}
+}
+
+// sets or clears bits in [Begin, End)
+FORCEINLINE constexpr void Fill(word* Words, index Begin, index End, bool Value) {
+	while (Begin < End) {
+		const index WordIndex = Begin / WordBits;
+		const index WordEnd = math::Min((WordIndex + 1) * WordBits, End);
+		const index Count = WordEnd - Begin;
+		const word Mask = (Count == WordBits ? ~(word) 0 : (((word) 1 << Count) - 1)) << (Begin % WordBits);
+		Words[WordIndex] = Value ? (Words[WordIndex] | Mask) : (Words[WordIndex] & ~Mask);
+		Begin = WordEnd;
+	}
+}
+
+// Iterates indices of set bits in increasing order, clears lowest bit of cached word on each step
+struct set_bit_iter {
+private:
+	const word* Words = nullptr;
+	index NumWords = 0;
+	index WordIndex = 0;
+	word Word = 0;
+
+public:
+	FORCEINLINE constexpr set_bit_iter() = default;
+
+	FORCEINLINE constexpr set_bit_iter(const word* InWords, index InNumWords, index InWordIndex)
+		: Words(InWords), NumWords(InNumWords), WordIndex(InWordIndex) {
+		if (WordIndex < NumWords) {
+			Word = Words[WordIndex];
+			SkipEmptyWords();
+		}
+	}
+
+	FORCEINLINE constexpr index operator*() const {
+		unsigned long Bit = 0;
+		BitScanForward(&Bit, Word);
+		return WordIndex * WordBits + (index) Bit;
+	}
+
+	FORCEINLINE constexpr set_bit_iter& operator++() {
+		Word &= Word - 1;
+		SkipEmptyWords();
+		return *this;
+	}
+
+	FORCEINLINE constexpr bool operator==(const set_bit_iter& Other) const {
+		return WordIndex == Other.WordIndex && Word == Other.Word;
+	}
+
+private:
+	FORCEINLINE constexpr void SkipEmptyWords() {
+		while (Word == 0 && ++WordIndex < NumWords) {
+			Word = Words[WordIndex];
+		}
+	}
+};
+
+// for (index Bit : Bitset.GetSetBits())
+struct set_bits_range {
+	const word* Words = nullptr;
+	index NumWords = 0;
+
+	FORCEINLINE constexpr set_bit_iter begin() const {
+		return set_bit_iter{Words, NumWords, 0};
+	}
+
+	FORCEINLINE constexpr set_bit_iter end() const {
+		return set_bit_iter{Words, NumWords, NumWords};
+	}
+};
+}	 // namespace bits
+
+// Fixed size bitset, usable in constexpr context
+template <index SizeParameter>
+struct bitset {
+	constexpr static index Size = SizeParameter;
+	constexpr static index NumWords = bits::GetNumWords(Size);
+
+	bits::word Words[NumWords]{};
+
+	[[nodiscard]] FORCEINLINE constexpr index GetSize() const {
+		return Size;
+	}
+
+	[[nodiscard]] FORCEINLINE constexpr bool IsSet(index Bit) const {
+		CHECK(Bit < Size)
+		return Words[Bit / bits::WordBits] & bits::GetMask(Bit);
+	}
+
+	[[nodiscard]] FORCEINLINE constexpr bool operator[](index Bit) const {
+		return IsSet(Bit);
+	}
+
+	FORCEINLINE constexpr void Set(index Bit) {
+		CHECK(Bit < Size)
+		Words[Bit / bits::WordBits] |= bits::GetMask(Bit);
+	}
+
+	FORCEINLINE constexpr void Set(index Bit, bool Value) {
+		CHECK(Bit < Size)
+		bits::word& Word = Words[Bit / bits::WordBits];
+		Word = (Word & ~bits::GetMask(Bit)) | ((bits::word) Value << (Bit % bits::WordBits));
+	}
+
+	FORCEINLINE constexpr void Unset(index Bit) {
+		CHECK(Bit < Size)
+		Words[Bit / bits::WordBits] &= ~bits::GetMask(Bit);
+	}
+
+	FORCEINLINE constexpr void Flip(index Bit) {
+		CHECK(Bit < Size)
+		Words[Bit / bits::WordBits] ^= bits::GetMask(Bit);
+	}
+
+	FORCEINLINE constexpr void SetAll() {
+		for (index Word = 0; Word < NumWords; ++Word) {
+			Words[Word] = ~(bits::word) 0;
+		}
+		Words[NumWords - 1] &= bits::GetTailMask(Size);
+	}
+
+	FORCEINLINE constexpr void UnsetAll() {
+		for (index Word = 0; Word < NumWords; ++Word) {
+			Words[Word] = 0;
+		}
+	}
+
+	[[nodiscard]] FORCEINLINE constexpr index PopCount() const {
+		return bits::PopCount(Words, NumWords);
+	}
+
+	[[nodiscard]] FORCEINLINE constexpr bool Any() const {
+		return bits::Any(Words, NumWords);
+	}
+
+	[[nodiscard]] FORCEINLINE constexpr bool None() const {
+		return !Any();
+	}
+
+	[[nodiscard]] FORCEINLINE constexpr index FindFirstSet() const {
+		return bits::FindNextSet(Words, NumWords, 0);
+	}
+
+	[[nodiscard]] FORCEINLINE constexpr index FindNextSet(index From) const {
+		return bits::FindNextSet(Words, NumWords, From);
+	}
+
+	[[nodiscard]] FORCEINLINE constexpr bits::set_bits_range GetSetBits() const {
+		return bits::set_bits_range{Words, NumWords};
+	}
+
+	FORCEINLINE constexpr bitset& operator&=(const bitset& Other) {
+		bits::Apply<bits::operation::op_and>(Words, Other.Words, NumWords);
+		return *this;
+	}
+
+	FORCEINLINE constexpr bitset& operator|=(const bitset& Other) {
+		bits::Apply<bits::operation::op_or>(Words, Other.Words, NumWords);
+		return *this;
+	}
+
+	FORCEINLINE constexpr bitset& operator^=(const bitset& Other) {
+		bits::Apply<bits::operation::op_xor>(Words, Other.Words, NumWords);
+		return *this;
+	}
+
+	// clears every bit that is set in Other
+	FORCEINLINE constexpr bitset& AndNot(const bitset& Other) {
+		bits::Apply<bits::operation::op_and_not>(Words, Other.Words, NumWords);
+		return *this;
+	}
+
+	FORCEINLINE constexpr bool operator==(const bitset& Other) const {
+		for (index Word = 0; Word < NumWords; ++Word) {
+			if (Words[Word] != Other.Words[Word]) {
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+// Resizable bitset, bits are stored in 64 bit words
+template <typename allocator_type = default_allocator>
+struct dyn_bitset : allocator_instance<allocator_type> {
+private:
+	bits::word* Words{nullptr};
+	index Size{0};
+	index CapacityWords{0};
+
+public:
+	using alloc_base = allocator_instance<allocator_type>;
+	constexpr static bool MemcopyRelocatable = true;
+
+	dyn_bitset() = default;
+
+	FORCEINLINE explicit dyn_bitset(index InSize, bool Value = false) {
+		Resize(InSize, Value);
+	}
+
+	FORCEINLINE dyn_bitset(const dyn_bitset& Other) {
+		CopyFromOther(Other);
+	}
+
+	FORCEINLINE dyn_bitset(dyn_bitset&& Other) noexcept {
+		GrabFromOther(std::move(Other));
+	}
+
+	FORCEINLINE ~dyn_bitset() {
+		Clear();
+	}
+
+	FORCEINLINE dyn_bitset& operator=(const dyn_bitset& Other) {
+		if (&Other != this) {
+			CopyFromOther(Other);
+		}
+		return *this;
+	}
+
+	FORCEINLINE dyn_bitset& operator=(dyn_bitset&& Other) noexcept {
+		if (&Other != this) {
+			Clear();
+			GrabFromOther(std::move(Other));
+		}
+		return *this;
+	}
+
+	[[nodiscard]] FORCEINLINE index GetSize() const {
+		return Size;
+	}
+
+	[[nodiscard]] FORCEINLINE index GetNumWords() const {
+		return bits::GetNumWords(Size);
+	}
+
+	[[nodiscard]] FORCEINLINE const bits::word* GetWords() const {
+		return Words;
+	}
+
+	// new bits are initialized with Value
+	FORCEINLINE void Resize(index NewSize, bool Value = false) {
+		const index NewNumWords = bits::GetNumWords(NewSize);
+		if (NewNumWords > CapacityWords) {
+			const index NewCapacity = math::Max(NewNumWords, CapacityWords * 2);
+			auto* NewWords = (bits::word*) alloc_base::Allocator.Allocate(NewCapacity * sizeof(bits::word));
+			if (Words) {
+				std::memcpy(NewWords, Words, GetNumWords() * sizeof(bits::word));
+				alloc_base::Allocator.Free(Words);
+			}
+			Words = NewWords;
+			CapacityWords = NewCapacity;
+		}
+		if (NewSize > Size) {
+			const index OldNumWords = GetNumWords();
+			std::memset(Words + OldNumWords, 0, (NewNumWords - OldNumWords) * sizeof(bits::word));
+			if (Value) {
+				bits::Fill(Words, Size, NewSize, true);
+			}
+		} else if (NewNumWords > 0) {
+			Words[NewNumWords - 1] &= bits::GetTailMask(NewSize);
+		}
+		Size = NewSize;
+	}
+
+	FORCEINLINE void Clear(container_clear_type ClearType = container_clear_type::deallocate) {
+		if (ClearType == container_clear_type::deallocate) {
+			alloc_base::Allocator.Free(Words);
+			Words = nullptr;
+			CapacityWords = 0;
+		}
+		Size = 0;
+	}
+
+	[[nodiscard]] FORCEINLINE bool IsSet(index Bit) const {
+		CHECK(Bit < Size)
+		return Words[Bit / bits::WordBits] & bits::GetMask(Bit);
+	}
+
+	[[nodiscard]] FORCEINLINE bool operator[](index Bit) const {
+		return IsSet(Bit);
+	}
+
+	FORCEINLINE void Set(index Bit) {
+		CHECK(Bit < Size)
+		Words[Bit / bits::WordBits] |= bits::GetMask(Bit);
+	}
+
+	FORCEINLINE void Set(index Bit, bool Value) {
+		CHECK(Bit < Size)
+		bits::word& Word = Words[Bit / bits::WordBits];
+		Word = (Word & ~bits::GetMask(Bit)) | ((bits::word) Value << (Bit % bits::WordBits));
+	}
+
+	FORCEINLINE void Unset(index Bit) {
+		CHECK(Bit < Size)
+		Words[Bit / bits::WordBits] &= ~bits::GetMask(Bit);
+	}
+
+	FORCEINLINE void Flip(index Bit) {
+		CHECK(Bit < Size)
+		Words[Bit / bits::WordBits] ^= bits::GetMask(Bit);
+	}
+
+	FORCEINLINE void SetAll() {
+		bits::Fill(Words, 0, Size, true);
+	}
+
+	FORCEINLINE void UnsetAll() {
+		std::memset(Words, 0, GetNumWords() * sizeof(bits::word));
+	}
+
+	[[nodiscard]] FORCEINLINE index PopCount() const {
+		return bits::PopCount(Words, GetNumWords());
+	}
+
+	[[nodiscard]] FORCEINLINE bool Any() const {
+		return bits::Any(Words, GetNumWords());
+	}
+
+	[[nodiscard]] FORCEINLINE bool None() const {
+		return !Any();
+	}
+
+	[[nodiscard]] FORCEINLINE index FindFirstSet() const {
+		return bits::FindNextSet(Words, GetNumWords(), 0);
+	}
+
+	[[nodiscard]] FORCEINLINE index FindNextSet(index From) const {
+		return bits::FindNextSet(Words, GetNumWords(), From);
+	}
+
+	[[nodiscard]] FORCEINLINE bits::set_bits_range GetSetBits() const {
+		return bits::set_bits_range{Words, GetNumWords()};
+	}
+
+	// bulk operations expect bitsets of the same size
+	FORCEINLINE dyn_bitset& operator&=(const dyn_bitset& Other) {
+		CHECK(Size == Other.Size)
+		bits::Apply<bits::operation::op_and>(Words, Other.Words, GetNumWords());
+		return *this;
+	}
+
+	FORCEINLINE dyn_bitset& operator|=(const dyn_bitset& Other) {
+		CHECK(Size == Other.Size)
+		bits::Apply<bits::operation::op_or>(Words, Other.Words, GetNumWords());
+		return *this;
+	}
+
+	FORCEINLINE dyn_bitset& operator^=(const dyn_bitset& Other) {
+		CHECK(Size == Other.Size)
+		bits::Apply<bits::operation::op_xor>(Words, Other.Words, GetNumWords());
+		return *this;
+	}
+
+	// clears every bit that is set in Other
+	FORCEINLINE dyn_bitset& AndNot(const dyn_bitset& Other) {
+		CHECK(Size == Other.Size)
+		bits::Apply<bits::operation::op_and_not>(Words, Other.Words, GetNumWords());
+		return *this;
+	}
+
+	FORCEINLINE bool operator==(const dyn_bitset& Other) const {
+		return Size == Other.Size && std::memcmp(Words, Other.Words, GetNumWords() * sizeof(bits::word)) == 0;
+	}
+
+private:
+	FORCEINLINE void CopyFromOther(const dyn_bitset& Other) {
+		Clear(container_clear_type::dont_deallocate);
+		Resize(Other.Size);
+		if (Other.Size > 0) {
+			std::memcpy(Words, Other.Words, GetNumWords() * sizeof(bits::word));
+		}
+	}
+
+	FORCEINLINE void GrabFromOther(dyn_bitset&& Other) {
+		Words = Other.Words;
+		Size = Other.Size;
+		CapacityWords = Other.CapacityWords;
+		Other.Words = nullptr;
+		Other.Size = 0;
+		Other.CapacityWords = 0;
+	}
+};
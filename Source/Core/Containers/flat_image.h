@@ -0,0 +1,208 @@
+#pragma once
+
+#include "basic.h"
+#include "Containers/dyn_array.h"
+#include "Containers/hash_table.h"
+#include "Containers/span.h"
+#include "Hash/hash.h"
+#include "Templates/concepts.h"
+
+#include <cstring>
+
+// Position independent binary images of containers, elements have to be position_independent.
+// Image is a header followed by raw element (or hash slot) storage at DataOffset, there are no pointers inside,
+// so image can be written to file, memory mapped and queried in place without rehashing or copying.
+// Images are only valid for the same endianness, element layout and hashing as the writer,
+// header carries enough information to reject mismatching images instead of reading garbage.
+namespace flat_image {
+constexpr u32 Magic = 0x4d494653;	 // "SFIM" in little endian
+// bump when header or slot layout of any container changes
+constexpr u32 LayoutVersion = 2;
+// data is aligned to cache line relative to image start, mapped files are page aligned
+constexpr u64 DataAlignment = 64;
+
+enum class container_kind : u32 { array = 0, hash_table = 1 };
+
+struct header {
+	u32 Magic{flat_image::Magic};
+	u32 LayoutVersion{flat_image::LayoutVersion};
+	container_kind Kind{container_kind::array};
+	// hash tables probe with hashes calculated at runtime, changing hashing invalidates table images,
+	// see GetHashSeed(), zero for arrays
+	hash::hash_type HashSeed{0};
+	u32 ElementSize{0};
+	u32 ElementAlignment{0};
+	index Size{0};
+	// number of elements in array or number of slots in hash table
+	index Capacity{0};
+	// relative to image start
+	u64 DataOffset{0};
+	u64 DataSize{0};
+};
+
+template <typename element_type>
+FORCEINLINE dyn_array<u8> WriteImage(
+	container_kind Kind,
+	hash::hash_type HashSeed,
+	span<element_type> Elements,
+	index Size) {
+	header Header{};
+	Header.Kind = Kind;
+	Header.HashSeed = HashSeed;
+	Header.ElementSize = sizeof(element_type);
+	Header.ElementAlignment = alignof(element_type);
+	Header.Size = Size;
+	Header.Capacity = Elements.GetSize();
+	Header.DataOffset = (sizeof(header) + DataAlignment - 1) & ~(DataAlignment - 1);
+	Header.DataSize = (u64) Elements.GetSize() * sizeof(element_type);
+
+	const u64 ImageSize = Header.DataOffset + Header.DataSize;
+	// whole image has to be addressable by index
+	CHECK(ImageSize < InvalidIndex)
+	dyn_array<u8> Image;
+	u8* Bytes = Image.AppendUninitialized((index) ImageSize).GetData();
+	std::memset(Bytes, 0, Header.DataOffset);
+	std::memcpy(Bytes, &Header, sizeof(header));
+	if (Header.DataSize > 0) {
+		std::memcpy(Bytes + Header.DataOffset, Elements.GetData(), Header.DataSize);
+	}
+	return Image;
+}
+
+// returns pointer to data of validated image, nullptr if image doesn't match expected layout
+template <typename element_type>
+FORCEINLINE const element_type* ReadImage(
+	span<u8> Image,
+	container_kind Kind,
+	hash::hash_type HashSeed,
+	header& OutHeader) {
+	if (Image.GetSize() < sizeof(header)) {
+		return nullptr;
+	}
+	// image start is not required to be aligned for header
+	std::memcpy(&OutHeader, Image.GetData(), sizeof(header));
+	const bool Valid = OutHeader.Magic == Magic && OutHeader.LayoutVersion == LayoutVersion &&
+					   OutHeader.Kind == Kind && OutHeader.HashSeed == HashSeed &&
+					   OutHeader.ElementSize == sizeof(element_type) &&
+					   OutHeader.ElementAlignment == alignof(element_type) &&
+					   OutHeader.DataSize == (u64) OutHeader.Capacity * sizeof(element_type) &&
+					   OutHeader.DataOffset >= sizeof(header) &&
+					   OutHeader.DataOffset + OutHeader.DataSize <= Image.GetSize();
+	if (!Valid) {
+		return nullptr;
+	}
+	const u8* Data = Image.GetData() + OutHeader.DataOffset;
+	if ((u64) Data % alignof(element_type) != 0) {
+		return nullptr;
+	}
+	return reinterpret_cast<const element_type*>(Data);
+}
+
+template <position_independent element_type, typename allocator_type, index StackSize>
+FORCEINLINE dyn_array<u8> Write(const dyn_array<element_type, allocator_type, StackSize>& Array) {
+	return WriteImage(
+		container_kind::array, 0, span<element_type>{Array.GetData(), Array.GetSize()}, Array.GetSize());
+}
+
+// view into image, empty on mismatch
+template <position_independent element_type>
+FORCEINLINE bool OpenArray(span<u8> Image, span<element_type>& OutElements) {
+	header Header{};
+	const element_type* Data = ReadImage<element_type>(Image, container_kind::array, 0, Header);
+	if (!Data) {
+		OutElements = {};
+		return false;
+	}
+	OutElements = span<element_type>{Data, Header.Size};
+	return true;
+}
+
+// Read-only hash table backed by slots of a table image, uses exactly the same probing as hash_table
+template <typename table_type>
+struct table_view {
+	using slot_type = typename table_type::set_element_container_type;
+	using pair_type = typename table_type::value_type;
+	using key_type = typename pair_type::key_type;
+	using mapped_type = typename pair_type::value_type;
+
+	const slot_type* Slots{nullptr};
+	index Capacity{0};
+	index Size{0};
+
+	[[nodiscard]] FORCEINLINE index GetSize() const {
+		return Size;
+	}
+
+	FORCEINLINE const mapped_type* Find(const key_type& Key) const {
+		if (Capacity == 0) {
+			return nullptr;
+		}
+		// prober takes mutable pointer but only reads through it
+		typename table_type::prober P{const_cast<slot_type*>(Slots), Capacity, table_type::GetHash(Key)};
+		for (; P.NotEmpty(); ++P) {
+			if (P.SetElem->Hash == P.Hash && table_type::Equals(Key, P.SetElem->Value)) {
+				return &(P.SetElem->Value.Value);
+			}
+		}
+		return nullptr;
+	}
+
+	FORCEINLINE bool Contains(const key_type& Key) const {
+		return Find(Key);
+	}
+};
+
+template <typename table_type>
+concept flat_table = position_independent<typename table_type::value_type::key_type> &&
+					 position_independent<typename table_type::value_type::value_type>;
+
+// Seed of table hasher combined with hash of a fixed key, so images written with another hasher are rejected
+// even if it has no seed or its seed doesn't take part in hashing of this key type
+template <flat_table table_type>
+FORCEINLINE hash::hash_type GetHashSeed() {
+	using key_type = typename table_type::value_type::key_type;
+	using hasher_type = typename table_type::hasher_type;
+	hash::hash_type Seed = 0;
+	if constexpr (requires { hasher_type::Seed; }) {
+		Seed = (hash::hash_type) hasher_type::Seed;
+	}
+	key_type ProbeKey;
+	std::memset((void*) &ProbeKey, 1, sizeof(key_type));
+	return hash::HashCombine(Seed, table_type::GetHash(ProbeKey));
+}
+
+// empty and deleted slots are zeroed so images of equal tables are byte-identical
+template <flat_table table_type>
+FORCEINLINE dyn_array<u8> Write(const table_type& Table) {
+	using slot_type = typename table_type::set_element_container_type;
+	const span<slot_type> Slots = Table.GetSlots();
+	dyn_array<u8> Image =
+		WriteImage(container_kind::hash_table, GetHashSeed<table_type>(), Slots, Table.GetSize());
+	header Header{};
+	std::memcpy(&Header, Image.GetData(), sizeof(header));
+	auto* ImageSlots = reinterpret_cast<slot_type*>(Image.GetData() + Header.DataOffset);
+	for (index Slot = 0; Slot < Slots.GetSize(); ++Slot) {
+		if (ImageSlots[Slot].Hash > table_type::LastValidHash) {
+			std::memset((void*) &ImageSlots[Slot].Value, 0, sizeof(ImageSlots[Slot].Value));
+		}
+	}
+	return Image;
+}
+
+template <flat_table table_type>
+FORCEINLINE bool OpenTable(span<u8> Image, table_view<table_type>& OutView) {
+	using slot_type = typename table_type::set_element_container_type;
+	header Header{};
+	const slot_type* Slots =
+		ReadImage<slot_type>(Image, container_kind::hash_table, GetHashSeed<table_type>(), Header);
+	// capacity is expected to be power of 2 by prober
+	if (!Slots || (Header.Capacity & (Header.Capacity - 1)) != 0) {
+		OutView = {};
+		return false;
+	}
+	OutView.Slots = Slots;
+	OutView.Capacity = Header.Capacity;
+	OutView.Size = Header.Size;
+	return true;
+}
+}	 // namespace flat_image
@@ -85,6 +85,7 @@ public:
 	using const_iter = hash_set_iter<hash_set, iterator_constness::constant>;
 	using set_element_container_type = set_elem_container;
 	using value_type = element_type;
+	using hasher_type = hasher;
 	constexpr static index MinCapacity = 4;
 	constexpr static float MaxLoadFactor = 0.7f;
 	constexpr static float MaxLoadFactorInverse = 1.f / MaxLoadFactor;
@@ -258,6 +259,23 @@ public:
 		return nullptr;
 	}
 
+	// Same as calling Find() for every element, but all hashes of a batch are calculated and their home slots
+	// prefetched before probing, so cache misses of independent lookups overlap instead of being paid one by one.
+	// OutElements[i] is set to found element or nullptr
+	FORCEINLINE void FindBatch(span<element_type> Elements, mutable_span<element_type*> OutElements) const {
+		CHECK(OutElements.GetSize() >= Elements.GetSize())
+		FindBatchImpl(Elements, [&](index ElemIndex, set_elem_container* Found) {
+			OutElements[ElemIndex] = Found ? &(Found->Value) : nullptr;
+		});
+	}
+
+	// Same as calling Add() for every element, capacity is ensured once for the whole batch
+	FORCEINLINE void AddBatch(span<element_type> Elements) {
+		AddBatchImpl(Elements, [&](index ElemIndex, void* Position) {
+			new (Position) element_type(Elements[ElemIndex]);
+		});
+	}
+
 	FORCEINLINE element_type* FindOrAdd(const element_type& Elem) {
 		hash::hash_type Hash = GetHash(Elem);
 		set_elem_container* NewElemSpot = nullptr;
@@ -372,17 +390,87 @@ public:
 		Deleted = 0;
 	}
 
+	// static so that views over serialized slots (see flat_image.h) probe exactly the same way
 	template <typename HashedType>
-	FORCEINLINE hash::hash_type GetHash(const HashedType& Elem) const {
+	FORCEINLINE static hash::hash_type GetHash(const HashedType& Elem) {
 		const hash::hash_type Hash = hasher::Hash(Elem);
 		return Hash - (Hash > LastValidHash) * 2;
 	}
 
 	template <typename LhsType, typename RhsType>
-	FORCEINLINE bool Equals(const LhsType& Lhs, const RhsType& Rhs) const {
+	FORCEINLINE static bool Equals(const LhsType& Lhs, const RhsType& Rhs) {
 		return equals_op::Equals(Lhs, Rhs);
 	}
 
+	// raw slot storage including empty and deleted slots, Capacity is always power of 2
+	[[nodiscard]] FORCEINLINE span<set_elem_container> GetSlots() const {
+		return span<set_elem_container>{Data, Capacity};
+	}
+
+	// number of keys hashed and prefetched ahead of probing, enough to cover memory latency
+	// without evicting prefetched lines before they are used
+	constexpr static index PrefetchBatchSize = 16;
+
+	template <typename key_type, typename functor_type>
+	FORCEINLINE void FindBatchImpl(span<key_type> Keys, const functor_type& OnProbed) const {
+		if (!Data) {
+			for (index KeyIndex = 0; KeyIndex < Keys.GetSize(); ++KeyIndex) {
+				OnProbed(KeyIndex, nullptr);
+			}
+			return;
+		}
+		const index HashMask = (1 << math::LogOfTwoCeil(Capacity)) - 1;
+		hash::hash_type Hashes[PrefetchBatchSize];
+		for (index BatchStart = 0; BatchStart < Keys.GetSize(); BatchStart += PrefetchBatchSize) {
+			const index BatchCount = math::Min(PrefetchBatchSize, Keys.GetSize() - BatchStart);
+			for (index BatchIndex = 0; BatchIndex < BatchCount; ++BatchIndex) {
+				Hashes[BatchIndex] = GetHash(Keys[BatchStart + BatchIndex]);
+				PREFETCH(Data + (Hashes[BatchIndex] & HashMask));
+			}
+			for (index BatchIndex = 0; BatchIndex < BatchCount; ++BatchIndex) {
+				const key_type& Key = Keys[BatchStart + BatchIndex];
+				set_elem_container* Found = nullptr;
+				for (prober P{Data, Capacity, Hashes[BatchIndex]}; P.NotEmpty(); ++P) {
+					if (P.SetElem->Hash == P.Hash && Equals(Key, P.SetElem->Value)) {
+						Found = P.SetElem;
+						break;
+					}
+				}
+				OnProbed(BatchStart + BatchIndex, Found);
+			}
+		}
+	}
+
+	// Constructor receives index of the key and uninitialized memory for the element
+	template <typename key_type, typename constructor_type>
+	FORCEINLINE void AddBatchImpl(span<key_type> Keys, const constructor_type& Construct) {
+		if (Keys.GetSize() == 0) {
+			return;
+		}
+		EnsureCapacity(Size + Keys.GetSize());
+		const index HashMask = (1 << math::LogOfTwoCeil(Capacity)) - 1;
+		hash::hash_type Hashes[PrefetchBatchSize];
+		for (index BatchStart = 0; BatchStart < Keys.GetSize(); BatchStart += PrefetchBatchSize) {
+			const index BatchCount = math::Min(PrefetchBatchSize, Keys.GetSize() - BatchStart);
+			for (index BatchIndex = 0; BatchIndex < BatchCount; ++BatchIndex) {
+				Hashes[BatchIndex] = GetHash(Keys[BatchStart + BatchIndex]);
+				PREFETCH(Data + (Hashes[BatchIndex] & HashMask));
+			}
+			for (index BatchIndex = 0; BatchIndex < BatchCount; ++BatchIndex) {
+				prober P{Data, Capacity, Hashes[BatchIndex]};
+				for (; P.NotEmpty(); ++P) {
+					if (P.SetElem->Hash == DeletedHash) {
+						--Deleted;
+						break;
+					}
+				}
+				++Size;
+				P.SetElem->Hash = P.Hash;
+				Construct(BatchStart + BatchIndex, &(P.SetElem->Value));
+			}
+		}
+	}
+
 	FORCEINLINE iter begin() {
 		for (set_elem_container* FirstSetElem = Data; FirstSetElem != Data + Capacity; ++FirstSetElem) {
 			if (FirstSetElem->Hash <= LastValidHash) {
@@ -599,6 +687,22 @@ public:
 		return Find(Key);
 	}
 
+	// see hash_set::FindBatch
+	FORCEINLINE void FindBatch(span<table_key_type> Keys, mutable_span<table_value_type*> OutValues) const {
+		CHECK(OutValues.GetSize() >= Keys.GetSize())
+		super::FindBatchImpl(Keys, [&](index KeyIndex, typename super::set_elem_container* Found) {
+			OutValues[KeyIndex] = Found ? &(Found->Value.Value) : nullptr;
+		});
+	}
+
+	// see hash_set::AddBatch, Keys and Values are matched by position
+	FORCEINLINE void AddBatch(span<table_key_type> Keys, span<table_value_type> Values) {
+		CHECK(Keys.GetSize() == Values.GetSize())
+		super::AddBatchImpl(Keys, [&](index KeyIndex, void* Position) {
+			new (Position) table_pair(Keys[KeyIndex], Values[KeyIndex]);
+		});
+	}
+
 	FORCEINLINE table_pair* FindPair(const table_key_type& Key) const {
 		if (!super::Data) {
 			return nullptr;
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "basic.h"
+#include "Containers/dyn_array.h"
+#include "Containers/span.h"
+
+#include <utility>
+
+// Maps small integer keys (entity ids) to densely packed elements.
+// Sparse array is indexed by key and stores position in dense arrays, dense arrays store elements and their keys
+// in insertion order, so iteration is linear over memory. Removal moves the last element into the hole,
+// which means element pointers and iteration order are not stable across Remove().
+template <typename element_type, typename allocator_type = default_allocator>
+struct sparse_set {
+private:
+	dyn_array<index, allocator_type> Sparse{};
+	dyn_array<index, allocator_type> DenseKeys{};
+	dyn_array<element_type, allocator_type> Dense{};
+
+public:
+	using value_type = element_type;
+	using iter = dyn_array<element_type, allocator_type>::iter;
+	using const_iter = dyn_array<element_type, allocator_type>::const_iter;
+	constexpr static bool MemcopyRelocatable = true;
+
+	sparse_set() = default;
+
+	// reserves dense storage only, sparse array grows with the largest key
+	FORCEINLINE explicit sparse_set(index InitialCapacity) {
+		Dense.Reserve(InitialCapacity);
+		DenseKeys.Reserve(InitialCapacity);
+	}
+
+	// replaces existing element for the same key
+	template <typename... arg_types>
+	FORCEINLINE element_type* Emplace(index Key, arg_types&&... Args) {
+		EnsureSparse(Key);
+		index& DenseIndex = Sparse[Key];
+		if (DenseIndex != InvalidIndex) {
+			Dense[DenseIndex] = element_type(std::forward<arg_types>(Args)...);
+			return &Dense[DenseIndex];
+		}
+		DenseIndex = Dense.Emplace(std::forward<arg_types>(Args)...);
+		DenseKeys.Add(Key);
+		return &Dense[DenseIndex];
+	}
+
+	FORCEINLINE element_type* Add(index Key, const element_type& Element) {
+		return Emplace(Key, Element);
+	}
+
+	FORCEINLINE element_type* Add(index Key, element_type&& Element) {
+		return Emplace(Key, std::move(Element));
+	}
+
+	FORCEINLINE bool Remove(index Key) {
+		if (!Contains(Key)) {
+			return false;
+		}
+		const index DenseIndex = Sparse[Key];
+		const index LastKey = DenseKeys[DenseKeys.GetSize() - 1];
+		Dense.RemoveAtSwap(DenseIndex);
+		DenseKeys.RemoveAtSwap(DenseIndex);
+		// order matters when removing the last element
+		Sparse[LastKey] = DenseIndex;
+		Sparse[Key] = InvalidIndex;
+		return true;
+	}
+
+	[[nodiscard]] FORCEINLINE bool Contains(index Key) const {
+		return Key < Sparse.GetSize() && Sparse[Key] != InvalidIndex;
+	}
+
+	FORCEINLINE element_type* Find(index Key) {
+		return Contains(Key) ? &Dense[Sparse[Key]] : nullptr;
+	}
+
+	FORCEINLINE const element_type* Find(index Key) const {
+		return Contains(Key) ? &Dense[Sparse[Key]] : nullptr;
+	}
+
+	// key must be present
+	FORCEINLINE element_type& operator[](index Key) {
+		CHECK(Contains(Key))
+		return Dense[Sparse[Key]];
+	}
+
+	FORCEINLINE const element_type& operator[](index Key) const {
+		CHECK(Contains(Key))
+		return Dense[Sparse[Key]];
+	}
+
+	[[nodiscard]] FORCEINLINE index GetSize() const {
+		return Dense.GetSize();
+	}
+
+	[[nodiscard]] FORCEINLINE bool IsEmpty() const {
+		return Dense.GetSize() == 0;
+	}
+
+	// keys in the same order as elements
+	[[nodiscard]] FORCEINLINE span<index> GetKeys() const {
+		return span<index>{DenseKeys.begin(), DenseKeys.end()};
+	}
+
+	FORCEINLINE void Clear(container_clear_type ClearType = container_clear_type::deallocate) {
+		Sparse.Clear(ClearType);
+		DenseKeys.Clear(ClearType);
+		Dense.Clear(ClearType);
+	}
+
+	FORCEINLINE iter begin() {
+		return Dense.begin();
+	}
+
+	FORCEINLINE iter end() {
+		return Dense.end();
+	}
+
+	FORCEINLINE const_iter begin() const {
+		return Dense.begin();
+	}
+
+	FORCEINLINE const_iter end() const {
+		return Dense.end();
+	}
+
+private:
+	FORCEINLINE void EnsureSparse(index Key) {
+		const index OldSize = Sparse.GetSize();
+		if (Key >= OldSize) {
+			mutable_span<index> NewSlots = Sparse.AppendUninitialized(Key + 1 - OldSize);
+			std::memset(NewSlots.GetData(), 0xff, NewSlots.GetSize() * sizeof(index));
+		}
+	}
+};
+
+// Calls Functor(Key, First[Key], Sets[Key]...) for every key present in all sets.
+// Walks keys of the smallest set and probes the others, so cost is proportional to the smallest set.
+// Sets must not be modified during the join.
+template <typename functor_type, typename first_set_type, typename... set_types>
+FORCEINLINE void ForEachJoined(functor_type&& Functor, first_set_type& First, set_types&... Sets) {
+	span<index> Keys = First.GetKeys();
+	((Sets.GetSize() < Keys.GetSize() ? (void) (Keys = Sets.GetKeys()) : (void) 0), ...);
+	for (const index Key : Keys) {
+		if (First.Contains(Key) && (Sets.Contains(Key) && ...)) {
+			Functor(Key, First[Key], Sets[Key]...);
+		}
+	}
+}
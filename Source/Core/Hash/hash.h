@@ -109,6 +109,8 @@ template <typename type>
 concept hashable = requires(const type& Value) { hash::Hash(Value); };
 
 struct default_hasher {
+	static constexpr hash::hash_type Seed = hash::DefaultSeed;
+
 	template <hashable hashable_type>
 	[[nodiscard]] FORCEINLINE static hash::hash_type Hash(const hashable_type& Key) {
 		return hash::Hash(Key);
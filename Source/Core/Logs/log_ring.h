@@ -0,0 +1,133 @@
+#pragma once
+
+#include "basic.h"
+#include "Math/math.h"
+#include "Memory/allocator_base.h"
+
+#include <atomic>
+
+// Bounded lock-free ring of variable sized byte records for exactly one producer and one consumer thread.
+// Every record starts with 8 byte frame (payload size), payloads are 8 byte aligned and never wrap around the end:
+// when record doesn't fit into the rest of the buffer producer fills it with padding frame and starts from zero.
+// Positions are laid out like in spsc_queue, sides only touch each other's cache lines when ring looks full/empty.
+struct log_ring {
+private:
+	constexpr static u64 FrameSize = 8;
+	constexpr static u64 PaddingBit = 1ull << 63;
+
+	// read-only after construction
+	alignas(CacheLineSize) u8* Data{nullptr};
+	u64 Mask{0};
+
+	// written by producer
+	alignas(CacheLineSize) std::atomic<u64> Tail{0};
+	u64 CachedHead{0};
+	u64 ReservedPosition{0};
+
+	// written by consumer
+	alignas(CacheLineSize) std::atomic<u64> Head{0};
+	u64 CachedTail{0};
+	u64 PeekedSize{0};
+
+public:
+	FORCEINLINE explicit log_ring(index InCapacity) {
+		const index Capacity = 1 << math::LogOfTwoCeil(math::Max(InCapacity, (index) 64));
+		Data = (u8*) MemoryAlignedMalloc(Capacity, CacheLineSize);
+		Mask = Capacity - 1;
+	}
+
+	log_ring(const log_ring&) = delete;
+	log_ring& operator=(const log_ring&) = delete;
+
+	FORCEINLINE ~log_ring() {
+		MemoryAlignedFree(Data);
+	}
+
+	[[nodiscard]] FORCEINLINE index GetCapacity() const {
+		return (index) (Mask + 1);
+	}
+
+	// biggest payload that can ever be reserved
+	[[nodiscard]] FORCEINLINE index GetMaxRecordSize() const {
+		return (index) (Mask + 1 - FrameSize);
+	}
+
+	// bytes in use including frames and padding, approximate when called concurrently
+	[[nodiscard]] FORCEINLINE index GetUsedSize() const {
+		return (index) (Tail.load(std::memory_order_acquire) - Head.load(std::memory_order_acquire));
+	}
+
+	[[nodiscard]] FORCEINLINE bool IsEmpty() const {
+		return Tail.load(std::memory_order_acquire) == Head.load(std::memory_order_acquire);
+	}
+
+	[[nodiscard]] FORCEINLINE static index GetAlignedSize(index Size) {
+		return (Size + 7) & ~(index) 7;
+	}
+
+	// producer only, Size has to be aligned by GetAlignedSize(). Returns nullptr when ring is full,
+	// otherwise memory for the payload that becomes visible to consumer with Commit()
+	FORCEINLINE u8* TryReserve(index Size) {
+		const u64 Position = Tail.load(std::memory_order_relaxed);
+		const u64 Offset = Position & Mask;
+		const u64 Needed = FrameSize + Size;
+		const u64 Padding = Offset + Needed > Mask + 1 ? Mask + 1 - Offset : 0;
+		if (Position + Padding + Needed - CachedHead > Mask + 1) {
+			CachedHead = Head.load(std::memory_order_acquire);
+			if (Position + Padding + Needed - CachedHead > Mask + 1) {
+				return nullptr;
+			}
+		}
+		if (Padding > 0) {
+			// consumer can't reach it before Commit() publishes position past it
+			*(u64*) (Data + Offset) = Padding | PaddingBit;
+		}
+		ReservedPosition = Position + Padding;
+		u8* Frame = Data + (ReservedPosition & Mask);
+		*(u64*) Frame = Size;
+		return Frame + FrameSize;
+	}
+
+	// producer only, publishes record returned by the last TryReserve()
+	FORCEINLINE void Commit() {
+		const u64 Size = *(u64*) (Data + (ReservedPosition & Mask));
+		Tail.store(ReservedPosition + FrameSize + Size, std::memory_order_release);
+	}
+
+	// producer only, only reads consumer position when cached one says so
+	[[nodiscard]] FORCEINLINE bool IsOverHalf() {
+		const u64 Position = Tail.load(std::memory_order_relaxed);
+		if (Position - CachedHead <= (Mask + 1) / 2) {
+			return false;
+		}
+		CachedHead = Head.load(std::memory_order_acquire);
+		return Position - CachedHead > (Mask + 1) / 2;
+	}
+
+	// consumer only, oldest record or nullptr if ring is empty. Record stays valid until Pop()
+	FORCEINLINE u8* TryPeek(index& OutSize) {
+		for (;;) {
+			const u64 Position = Head.load(std::memory_order_relaxed);
+			if (Position == CachedTail) {
+				CachedTail = Tail.load(std::memory_order_acquire);
+				if (Position == CachedTail) {
+					return nullptr;
+				}
+			}
+			u8* Frame = Data + (Position & Mask);
+			const u64 Size = *(u64*) Frame;
+			if (Size & PaddingBit) {
+				Head.store(Position + (Size & ~PaddingBit), std::memory_order_release);
+				continue;
+			}
+			PeekedSize = FrameSize + Size;
+			OutSize = (index) Size;
+			return Frame + FrameSize;
+		}
+	}
+
+	// consumer only, frees record returned by the last TryPeek()
+	FORCEINLINE void Pop() {
+		Head.store(Head.load(std::memory_order_relaxed) + PeekedSize, std::memory_order_release);
+	}
+};
@@ -0,0 +1,154 @@
+#include "log_sinks.h"
+#include "logs.h"
+#include "String/str_conversions.h"
+
+#include <iostream>
+
+namespace logs {
+void console_sink::Write(const log_line& Line) {
+	const color Color = GetVerbosityColor(Line.Verbosity);
+	switch (Color) {
+		case color::white:
+			break;
+		case color::yellow:
+			Append(Buffer, "\033[1;33m");
+			break;
+		case color::red:
+			Append(Buffer, "\033[1;31m");
+			break;
+	}
+	Append(Buffer, Line.Text);
+	if (Color != color::white) {
+		Append(Buffer, "\033[1;0m");
+	}
+}
+
+void console_sink::Flush() {
+	if (Buffer.GetSize() > 0) {
+		std::cout.write(Buffer.GetData(), Buffer.GetSize());
+		std::cout.flush();
+		Buffer.Clear(container_clear_type::dont_deallocate);
+	}
+}
+
+file_sink::file_sink(str_view InPath, const file_sink_config& InConfig) : Config{InConfig} {
+	Config.MaxFiles = math::Max(Config.MaxFiles, 1u);
+	Append(Path, InPath);
+	Buffer.Reserve(Config.BufferSize);
+	Open();
+}
+
+file_sink::~file_sink() {
+	Flush();
+	if (File) {
+		std::fclose(File);
+	}
+}
+
+void file_sink::AppendPath(line_buffer& OutPath, u32 FileIndex) const {
+	Append(OutPath, str_view{Path.GetData(), Path.GetSize()});
+	if (FileIndex > 0) {
+		using number_format = strings::default_int_format<u32>;
+		OutPath.Add('.');
+		number_format::Write(OutPath.AppendUninitialized(number_format::GetCharSize(FileIndex)), FileIndex);
+	}
+	OutPath.Add('\0');
+}
+
+void file_sink::Open() {
+	line_buffer FilePath;
+	AppendPath(FilePath, 0);
+	File = std::fopen(FilePath.GetData(), "ab");
+	if (!File) {
+		return;
+	}
+	// every flush goes to the OS as one write, no second copy in stdio buffer
+	std::setvbuf(File, nullptr, _IONBF, 0);
+	std::fseek(File, 0, SEEK_END);
+	const long Position = std::ftell(File);
+	FileSize = Position > 0 ? (u64) Position : 0;
+}
+
+void file_sink::Rotate() {
+	std::fclose(File);
+	File = nullptr;
+	line_buffer From;
+	line_buffer To;
+	for (u32 FileIndex = Config.MaxFiles - 1; FileIndex > 0; --FileIndex) {
+		From.Clear(container_clear_type::dont_deallocate);
+		To.Clear(container_clear_type::dont_deallocate);
+		AppendPath(From, FileIndex - 1);
+		AppendPath(To, FileIndex);
+		std::remove(To.GetData());
+		std::rename(From.GetData(), To.GetData());
+	}
+	if (Config.MaxFiles == 1) {
+		AppendPath(From, 0);
+		std::remove(From.GetData());
+	}
+	Open();
+}
+
+void file_sink::Write(const log_line& Line) {
+	if (Buffer.GetSize() + Line.Text.GetSize() > Config.BufferSize) {
+		Flush();
+	}
+	Append(Buffer, Line.Text);
+}
+
+void file_sink::Flush() {
+	if (Buffer.GetSize() == 0) {
+		return;
+	}
+	if (File && FileSize > 0 && FileSize + Buffer.GetSize() > Config.MaxFileSize) {
+		Rotate();
+	}
+	if (File) {
+		std::fwrite(Buffer.GetData(), 1, Buffer.GetSize(), File);
+		FileSize += Buffer.GetSize();
+		++NumWrites;
+	}
+	Buffer.Clear(container_clear_type::dont_deallocate);
+}
+
+memory_sink::memory_sink(index InCapacity) : Capacity{math::Max(InCapacity, (index) 1)} {
+	Data = (char*) MemoryMalloc(Capacity);
+}
+
+memory_sink::~memory_sink() {
+	MemoryFree(Data);
+}
+
+void memory_sink::Write(const log_line& Line) {
+	str_view Text = Line.Text;
+	// only the end of line that is longer than everything
+	if (Text.GetSize() > Capacity) {
+		Text = str_view{Text.GetData() + Text.GetSize() - Capacity, Capacity};
+	}
+	Lock.Lock();
+	// drops whole oldest lines until new one fits
+	while (Capacity - Size < Text.GetSize()) {
+		index Dropped = 0;
+		while (Dropped < Size && Data[(Start + Dropped) % Capacity] != '\n') {
+			++Dropped;
+		}
+		Dropped = math::Min(Dropped + 1, Size);
+		Start = (Start + Dropped) % Capacity;
+		Size -= Dropped;
+	}
+	const index End = (Start + Size) % Capacity;
+	const index FirstPart = math::Min(Text.GetSize(), Capacity - End);
+	std::memcpy(Data + End, Text.GetData(), FirstPart);
+	std::memcpy(Data, Text.GetData() + FirstPart, Text.GetSize() - FirstPart);
+	Size += Text.GetSize();
+	Lock.Unlock();
+}
+
+void memory_sink::GetText(line_buffer& OutText) {
+	Lock.Lock();
+	const index FirstPart = math::Min(Size, Capacity - Start);
+	Append(OutText, str_view{Data + Start, FirstPart});
+	Append(OutText, str_view{Data, Size - FirstPart});
+	Lock.Unlock();
+}
+}	 // namespace logs
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "basic.h"
+#include "Concurrency/mutex.h"
+#include "Containers/dyn_array.h"
+#include "Memory/allocator_base.h"
+#include "String/atom.h"
+#include "String/str.h"
+#include "Time/timestamp.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace logs {
+enum class verbosity : u8;
+
+// sinks are called from logging threads and from background thread, default allocator is not thread safe
+using line_buffer = dyn_array<char, malloc_allocator, 256>;
+
+FORCEINLINE void Append(line_buffer& Buffer, str_view Text) {
+	std::memcpy(Buffer.AppendUninitialized(Text.GetSize()).GetData(), Text.GetData(), Text.GetSize());
+}
+
+struct log_line {
+	// local time
+	timestamp Time;
+	verbosity Verbosity;
+	atom Category;
+	// formatted line ending with '\n', without colors
+	str_view Text;
+};
+
+// Receives formatted lines. Calls are serialized by the logger, so sinks don't need own locking for Write/Flush.
+// Sink has to be removed from the logger before it is destroyed
+struct log_sink {
+	virtual ~log_sink() = default;
+
+	// may buffer, Flush() is called after every synchronous line and after every background drain pass
+	virtual void Write(const log_line& Line) = 0;
+
+	// hands everything buffered to the OS
+	virtual void Flush() {
+	}
+};
+
+// std::cout with colors by verbosity
+struct console_sink : log_sink {
+	void Write(const log_line& Line) override;
+	void Flush() override;
+
+private:
+	line_buffer Buffer{};
+};
+
+struct file_sink_config {
+	// lines are collected into buffer of this size and written with one call
+	index BufferSize{64 * 1024};
+	// file is rotated before write that would make it bigger than this
+	u64 MaxFileSize{64ull * 1024 * 1024};
+	// Path, Path.1, ... Path.(MaxFiles-1), older files are deleted
+	u32 MaxFiles{5};
+};
+
+// Appends to file, every flush is a single unbuffered write
+struct file_sink : log_sink {
+	explicit file_sink(str_view InPath, const file_sink_config& InConfig = {});
+	~file_sink() override;
+
+	file_sink(const file_sink&) = delete;
+	file_sink& operator=(const file_sink&) = delete;
+
+	void Write(const log_line& Line) override;
+	void Flush() override;
+
+	[[nodiscard]] bool IsOpen() const {
+		return File != nullptr;
+	}
+
+	// write calls since creation, for batching statistics
+	[[nodiscard]] u64 GetNumWrites() const {
+		return NumWrites;
+	}
+
+private:
+	void Open();
+	void Rotate();
+	void AppendPath(line_buffer& OutPath, u32 FileIndex) const;
+
+	file_sink_config Config;
+	line_buffer Path{};
+	line_buffer Buffer{};
+	std::FILE* File{nullptr};
+	u64 FileSize{0};
+	u64 NumWrites{0};
+};
+
+// Keeps the most recent lines (up to Capacity bytes, whole lines only), e.g. for in-game console or crash reports.
+// Readable from any thread
+struct memory_sink : log_sink {
+	explicit memory_sink(index InCapacity = 64 * 1024);
+	~memory_sink() override;
+
+	memory_sink(const memory_sink&) = delete;
+	memory_sink& operator=(const memory_sink&) = delete;
+
+	void Write(const log_line& Line) override;
+
+	// copies kept lines, oldest first
+	void GetText(line_buffer& OutText);
+
+private:
+	mutex Lock;
+	char* Data{nullptr};
+	index Capacity{0};
+	index Start{0};
+	index Size{0};
+};
+}	 // namespace logs
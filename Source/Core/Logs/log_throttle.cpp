@@ -0,0 +1,38 @@
+#include "log_throttle.h"
+#include "log_sinks.h"
+
+void logs::LogSuppressed(
+	verbosity Verbosity,
+	atom Category,
+	str_view FormatString,
+	span<strings::format_argument> ArgumentArray,
+	u32 Suppressed) {
+	if (Suppressed == 0) {
+		Log(Verbosity, Category, FormatString, ArgumentArray);
+		return;
+	}
+	// rare path, async logging copies format string into the ring anyway
+	line_buffer Format;
+	Append(Format, FormatString);
+	Append(Format, " ({} similar messages suppressed)");
+	dyn_array<strings::format_argument, malloc_allocator, 16> Arguments;
+	for (const strings::format_argument& Argument : ArgumentArray) {
+		Arguments.Add(Argument);
+	}
+	Arguments.Add(strings::format_argument{Suppressed});
+	Log(Verbosity, Category, str_view{Format.GetData(), Format.GetSize()}, Arguments);
+}
+
+bool logs::rate_state::PassSlow(u32 PerSecond) {
+	CHECK(PerSecond > 0)
+	const u64 Now = cycle_clock::ReadCycles();
+	u64 End = WindowEnd.load(std::memory_order_relaxed);
+	// one of concurrent callers starts the window
+	if (Now >= End &&
+		WindowEnd.compare_exchange_strong(End, Now + cycle_clock::GetFrequency(), std::memory_order_relaxed)) {
+		Budget.store(PerSecond - 1, std::memory_order_relaxed);
+		return true;
+	}
+	Suppressed.store(Suppressed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	return false;
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "basic.h"
+#include "Logs/logs.h"
+#include "Time/cycle_clock.h"
+
+#include <atomic>
+
+// Logging from per-frame and per-draw code. Every macro keeps static state per call site, checks category verbosity
+// first (disabled calls don't use up anything) and then its limit inline, a load, a compare and a store. Lines that
+// get through report how many lines of the call site were skipped before them.
+// Category has to be a logs::category object, e.g. logs::categories::Global.
+//
+//	LOG_ONCE(warning, TextureCategory, "Missing texture {}", Path);
+//	LOG_EVERY_N(debug, RenderCategory, 100, "Draw call {}", DrawIndex);
+//	LOG_RATE_LIMITED(error, logs::categories::Global, 5, "OpenGL Error ({})", Error);
+//
+// Counters are not read-modify-write atomics, concurrent callers of one call site may get a few more lines through
+// than the limit allows.
+namespace logs {
+// Writes line with " ({} similar messages suppressed)" appended when Suppressed isn't 0
+void LogSuppressed(
+	verbosity Verbosity,
+	atom Category,
+	str_view FormatString,
+	span<strings::format_argument> ArgumentArray,
+	u32 Suppressed);
+
+template <verbosity Verbosity, typename... argument_types>
+void LogSuppressed(
+	const category& Category,
+	u32 Suppressed,
+	str_view FormatString,
+	const argument_types&... Arguments) {
+	array<strings::format_argument, sizeof...(Arguments)> ArgumentArray{Arguments...};
+	LogSuppressed(Verbosity, Category.Name, FormatString, ArgumentArray, Suppressed);
+}
+
+struct once_state {
+	std::atomic<bool> Done{false};
+
+	[[nodiscard]] FORCEINLINE bool Pass() {
+		return !Done.load(std::memory_order_relaxed) && !Done.exchange(true, std::memory_order_relaxed);
+	}
+};
+
+// first call and then every N-th one, N has to be positive
+struct sample_state {
+	std::atomic<u32> Count{0};
+	std::atomic<u32> Skipped{0};
+
+	[[nodiscard]] FORCEINLINE bool Pass(u32 N) {
+		CHECK(N > 0)
+		const u32 Current = Count.load(std::memory_order_relaxed);
+		Count.store(Current + 1 >= N ? 0 : Current + 1, std::memory_order_relaxed);
+		if (Current == 0) {
+			return true;
+		}
+		Skipped.store(Skipped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		return false;
+	}
+
+	// skipped calls since the previous line
+	[[nodiscard]] u32 TakeSuppressed() {
+		return Skipped.exchange(0, std::memory_order_relaxed);
+	}
+};
+
+// Up to PerSecond lines per one second window. Window starts with the first call after the previous one ended.
+// Calls with budget left don't read the clock, skipped calls compare raw counter with the cached end of the window.
+// Budget left at the end of a window carries over into the next one, a burst after a quiet window can get up to
+// twice the limit through
+struct rate_state {
+	std::atomic<u32> Budget{0};
+	std::atomic<u32> Suppressed{0};
+	// in cycle_clock::ReadCycles() units
+	std::atomic<u64> WindowEnd{0};
+
+	[[nodiscard]] FORCEINLINE bool Pass(u32 PerSecond) {
+		const u32 Current = Budget.load(std::memory_order_relaxed);
+		if (Current > 0) [[likely]] {
+			Budget.store(Current - 1, std::memory_order_relaxed);
+			return true;
+		}
+		if (cycle_clock::ReadCycles() < WindowEnd.load(std::memory_order_relaxed)) {
+			Suppressed.store(Suppressed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			return false;
+		}
+		return PassSlow(PerSecond);
+	}
+
+	// starts new window when the current one is over, counts skipped call when other caller started it first
+	bool PassSlow(u32 PerSecond);
+
+	[[nodiscard]] u32 TakeSuppressed() {
+		return Suppressed.exchange(0, std::memory_order_relaxed);
+	}
+};
+}	 // namespace logs
+
+#define LOG_ONCE(Verbosity, Category, ...)                                                               \
+	do {                                                                                                 \
+		static logs::once_state LogOnceState;                                                            \
+		if (logs::IsEnabled<logs::verbosity::Verbosity>(Category) && LogOnceState.Pass()) [[unlikely]] { \
+			logs::Log<logs::verbosity::Verbosity>(Category, __VA_ARGS__);                                \
+		}                                                                                                \
+	} while (false)
+
+#define LOG_EVERY_N(Verbosity, Category, N, ...)                                                            \
+	do {                                                                                                    \
+		static logs::sample_state LogSampleState;                                                           \
+		if (logs::IsEnabled<logs::verbosity::Verbosity>(Category) && LogSampleState.Pass(N)) [[unlikely]] { \
+			logs::LogSuppressed<logs::verbosity::Verbosity>(                                                \
+				Category, LogSampleState.TakeSuppressed(), __VA_ARGS__);                                    \
+		}                                                                                                   \
+	} while (false)
+
+#define LOG_RATE_LIMITED(Verbosity, Category, PerSecond, ...)                                       \
+	do {                                                                                            \
+		static logs::rate_state LogRateState;                                                       \
+		if (logs::IsEnabled<logs::verbosity::Verbosity>(Category) && LogRateState.Pass(PerSecond)) { \
+			logs::LogSuppressed<logs::verbosity::Verbosity>(                                        \
+				Category, LogRateState.TakeSuppressed(), __VA_ARGS__);                              \
+		}                                                                                           \
+	} while (false)
@@ -1,40 +1,598 @@
 #include "logs.h"
+#include "log_ring.h"
+#include "log_sinks.h"
 #include "Time/timestamp.h"
-#include "Application/Platform/platform.h"
+#include "Time/wall_clock.h"
+#include "Concurrency/mutex.h"
+#include "Containers/dyn_array.h"
+#include "Memory/allocator_base.h"
 
-void logs::Log(
-	logs::color Color,
-	str_view VerbosityString,
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace logs {
+// Everything logging thread copies into its ring. Followed by raw format_argument array, format string characters
+// and characters of every string argument in argument order, consumer points string views back into the record
+struct record {
+	s64 Ticks;
+	atom Category;
+	u32 FormatLength;
+	verbosity Verbosity;
+	u8 NumArguments;
+};
+
+static void AppendLine(
+	line_buffer& Output,
+	strings::cached_timestamp_format& TimeFormat,
+	timestamp LocalTime,
+	verbosity Verbosity,
 	atom Category,
 	str_view FormatString,
 	span<strings::format_argument> ArgumentArray) {
-	const index CategoryLength = Category.ToStr().GetByteLength();
+	const index TimeLength = strings::cached_timestamp_format::GetCharSize(LocalTime);
 	const index InputLength = strings::GetFormatLength(FormatString, ArgumentArray);
-	const timestamp CurrentTimeUTC = timestamp::GetCurrentUTC();
-	const timestamp CurrentTime = platform::GetTimezone().Apply(CurrentTimeUTC);
-	const index TimeLength = strings::default_timestamp_format::GetCharSize(CurrentTime);
-	const index TotalLength = TimeLength + 3 + VerbosityString.GetSize() + 3 + CategoryLength + 3 + InputLength;
-	str LogString;
-	LogString.Reserve(TotalLength);
-	strings::default_timestamp_format::Write(LogString.AppendUninitialized(TimeLength), CurrentTime);
-	LogString += " | ";
-	LogString += VerbosityString;
-	LogString += " | ";
-	LogString += Category.ToStr();
-	LogString += " | ";
-	strings::WriteFormat(LogString.AppendUninitialized(InputLength), FormatString, ArgumentArray);
-	switch (Color) {
-		case color::white:
+	TimeFormat.Write(Output.AppendUninitialized(TimeLength), LocalTime);
+	Append(Output, " | ");
+	Append(Output, GetVerbosityString(Verbosity));
+	Append(Output, " | ");
+	Append(Output, Category.ToStr());
+	Append(Output, " | ");
+	strings::WriteFormat(Output.AppendUninitialized(InputLength), FormatString, ArgumentArray);
+	Output.Add('\n');
+}
+
+namespace {
+// never destroyed, so lines logged from static destructors still reach sinks
+struct output_state {
+	// guards Sinks and every call into sinks
+	mutex Lock;
+	console_sink Console;
+	dyn_array<log_sink*, malloc_allocator> Sinks{};
+
+	output_state() {
+		Sinks.Add(&Console);
+	}
+};
+}	 // namespace
+
+static output_state& GetOutput() {
+	static output_state* Output = new output_state{};
+	return *Output;
+}
+
+// output lock has to be held
+static void WriteLine(
+	output_state& Output,
+	const line_buffer& Text,
+	timestamp LocalTime,
+	verbosity Verbosity,
+	atom Category) {
+	const log_line Line{LocalTime, Verbosity, Category, str_view{Text.GetData(), Text.GetSize()}};
+	for (log_sink* Sink : Output.Sinks) {
+		Sink->Write(Line);
+	}
+}
+
+// output lock has to be held
+static void FlushSinks(output_state& Output) {
+	for (log_sink* Sink : Output.Sinks) {
+		Sink->Flush();
+	}
+}
+
+namespace {
+struct thread_ring {
+	log_ring Ring;
+	// dropped by owner since background thread looked last time
+	std::atomic<u64> Dropped{0};
+	// owner exited, ring is freed once it is drained
+	std::atomic<bool> Abandoned{false};
+	// owner is between checking Running and committing a record, StopAsync waits for it before last drain
+	std::atomic<bool> Writing{false};
+
+	explicit thread_ring(index Capacity) : Ring{Capacity} {
+	}
+};
+
+struct ring_holder {
+	thread_ring* Ring{nullptr};
+
+	~ring_holder() {
+		if (Ring) {
+			Ring->Abandoned.store(true, std::memory_order_release);
+		}
+	}
+};
+
+struct async_logger {
+	std::atomic<bool> Running{false};
+	// written only while background thread is not running
+	async_config Config{};
+
+	// serializes StartAsync/StopAsync
+	std::mutex ControlMutex;
+	std::thread Thread;
+	// one drainer at a time: background thread, StopAsync after join or crash handler
+	mutex DrainLock;
+
+	mutex RingsLock;
+	dyn_array<thread_ring*, malloc_allocator> Rings{};
+
+	std::mutex WakeMutex;
+	std::condition_variable WakeCondition;
+	std::condition_variable FlushCondition;
+	// guarded by WakeMutex
+	bool StopRequested{false};
+	bool Exited{true};
+	u64 FlushRequested{0};
+	u64 FlushCompleted{0};
+
+	std::atomic<u64> TotalDropped{0};
+
+	// guarded by DrainLock
+	dyn_array<thread_ring*, malloc_allocator> DrainRings{};
+	dyn_array<strings::format_argument, malloc_allocator> Arguments{};
+	line_buffer Line{};
+	strings::cached_timestamp_format TimeFormat{};
+
+	~async_logger() {
+		StopAsync();
+	}
+};
+
+static async_logger Async;
+static thread_local ring_holder ThreadRing;
+}	 // namespace
+
+static thread_ring& GetThreadRing() {
+	if (!ThreadRing.Ring) [[unlikely]] {
+		thread_ring* Ring = new thread_ring(Async.Config.RingSize);
+		Async.RingsLock.Lock();
+		Async.Rings.Add(Ring);
+		Async.RingsLock.Unlock();
+		ThreadRing.Ring = Ring;
+	}
+	return *ThreadRing.Ring;
+}
+
+static void WakeBackground() {
+	Async.WakeCondition.notify_one();
+}
+
+// Hot path, no formatting and no shared writes unless ring is full. False when message has to be written synchronously
+static bool TryLogAsync(
+	thread_ring& Ring,
+	verbosity Verbosity,
+	atom Category,
+	str_view FormatString,
+	span<strings::format_argument> ArgumentArray) {
+	const s64 Ticks = wall_clock::GetUTC().Ticks;
+	const index NumArguments = ArgumentArray.GetSize();
+	index Size = sizeof(record) + NumArguments * sizeof(strings::format_argument) + FormatString.GetSize();
+	for (const strings::format_argument& Argument : ArgumentArray) {
+		if (Argument.Type == strings::format_argument::type::string_arg) {
+			Size += Argument.String.GetSize();
+		}
+	}
+	Size = log_ring::GetAlignedSize(Size);
+	if (Size > Ring.Ring.GetMaxRecordSize() || NumArguments > 255) [[unlikely]] {
+		return false;
+	}
+	u8* Memory = Ring.Ring.TryReserve(Size);
+	while (!Memory) [[unlikely]] {
+		if (Async.Config.Overflow == overflow_policy::drop && Verbosity > verbosity::warning) {
+			Ring.Dropped.fetch_add(1, std::memory_order_relaxed);
+			Async.TotalDropped.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+		WakeBackground();
+		if (!Async.Running.load(std::memory_order_acquire)) {
+			return false;
+		}
+		std::this_thread::yield();
+		Memory = Ring.Ring.TryReserve(Size);
+	}
+	new (Memory) record{Ticks, Category, (u32) FormatString.GetSize(), Verbosity, (u8) NumArguments};
+	u8* Cursor = Memory + sizeof(record);
+	std::memcpy(Cursor, ArgumentArray.GetData(), NumArguments * sizeof(strings::format_argument));
+	Cursor += NumArguments * sizeof(strings::format_argument);
+	std::memcpy(Cursor, FormatString.GetData(), FormatString.GetSize());
+	Cursor += FormatString.GetSize();
+	for (const strings::format_argument& Argument : ArgumentArray) {
+		if (Argument.Type == strings::format_argument::type::string_arg) {
+			std::memcpy(Cursor, Argument.String.GetData(), Argument.String.GetSize());
+			Cursor += Argument.String.GetSize();
+		}
+	}
+	Ring.Ring.Commit();
+	if (Ring.Ring.IsOverHalf()) [[unlikely]] {
+		WakeBackground();
+	}
+	return true;
+}
+
+static void WriteRecord(output_state& Output, timezone Timezone, const u8* Memory) {
+	const record& Record = *(const record*) Memory;
+	Async.Arguments.Clear(container_clear_type::dont_deallocate);
+	std::memcpy(
+		Async.Arguments.AppendUninitialized(Record.NumArguments).GetData(),
+		Memory + sizeof(record),
+		Record.NumArguments * sizeof(strings::format_argument));
+	const char* Characters =
+		(const char*) (Memory + sizeof(record) + Record.NumArguments * sizeof(strings::format_argument));
+	const str_view FormatString{Characters, Record.FormatLength};
+	Characters += Record.FormatLength;
+	for (strings::format_argument& Argument : Async.Arguments) {
+		if (Argument.Type == strings::format_argument::type::string_arg) {
+			Argument.String = str_view{Characters, Argument.String.GetSize()};
+			Characters += Argument.String.GetSize();
+		}
+	}
+	const timestamp LocalTime = Timezone.Apply(timestamp{Record.Ticks});
+	Async.Line.Clear(container_clear_type::dont_deallocate);
+	AppendLine(
+		Async.Line,
+		Async.TimeFormat,
+		LocalTime,
+		Record.Verbosity,
+		Record.Category,
+		FormatString,
+		Async.Arguments);
+	WriteLine(Output, Async.Line, LocalTime, Record.Verbosity, Record.Category);
+}
+
+// Formats and writes everything that is in the rings, flushes sinks and frees rings of exited threads.
+// Drain lock and output lock have to be held
+static void DrainLocked(output_state& Output) {
+	Async.RingsLock.Lock();
+	Async.DrainRings.Clear(container_clear_type::dont_deallocate);
+	for (thread_ring* Ring : Async.Rings) {
+		Async.DrainRings.Add(Ring);
+	}
+	Async.RingsLock.Unlock();
+
+	const timezone Timezone = wall_clock::GetTimezone();
+	for (thread_ring* Ring : Async.DrainRings) {
+		// read before draining, owner could log one more message right before exit otherwise
+		const bool Abandoned = Ring->Abandoned.load(std::memory_order_acquire);
+		index Size = 0;
+		while (const u8* Memory = Ring->Ring.TryPeek(Size)) {
+			WriteRecord(Output, Timezone, Memory);
+			Ring->Ring.Pop();
+		}
+		if (const u64 Dropped = Ring->Dropped.exchange(0, std::memory_order_relaxed)) {
+			array<strings::format_argument, 1> ArgumentArray{Dropped};
+			const timestamp LocalTime = Timezone.Apply(wall_clock::GetUTC());
+			Async.Line.Clear(container_clear_type::dont_deallocate);
+			AppendLine(
+				Async.Line,
+				Async.TimeFormat,
+				LocalTime,
+				verbosity::warning,
+				atoms::GlobalCategory,
+				"{} messages dropped, log ring of the thread is full",
+				ArgumentArray);
+			WriteLine(Output, Async.Line, LocalTime, verbosity::warning, atoms::GlobalCategory);
+		}
+		if (Abandoned) {
+			Async.RingsLock.Lock();
+			for (index RingIndex = 0; RingIndex < Async.Rings.GetSize(); ++RingIndex) {
+				if (Async.Rings[RingIndex] == Ring) {
+					Async.Rings.RemoveAt(RingIndex);
+					break;
+				}
+			}
+			Async.RingsLock.Unlock();
+			delete Ring;
+		}
+	}
+	FlushSinks(Output);
+}
+
+static void DrainAll() {
+	output_state& Output = GetOutput();
+	Async.DrainLock.Lock();
+	Output.Lock.Lock();
+	DrainLocked(Output);
+	Output.Lock.Unlock();
+	Async.DrainLock.Unlock();
+}
+
+static void BackgroundThread() {
+	std::unique_lock Lock(Async.WakeMutex);
+	for (;;) {
+		const u64 FlushTarget = Async.FlushRequested;
+		const bool Stop = Async.StopRequested;
+		Lock.unlock();
+		DrainAll();
+		Lock.lock();
+		Async.FlushCompleted = FlushTarget;
+		Async.FlushCondition.notify_all();
+		if (Stop) {
 			break;
-		case color::yellow:
-			std::cout << "\033[1;33m";
+		}
+		if (!Async.StopRequested && Async.FlushRequested == FlushTarget) {
+			Async.WakeCondition.wait_for(Lock, std::chrono::milliseconds(Async.Config.FlushIntervalMs));
+		}
+	}
+	Async.Exited = true;
+	Async.FlushCondition.notify_all();
+}
+
+namespace {
+struct verbosity_override {
+	atom Category;
+	verbosity Verbosity;
+};
+
+// never destroyed, categories register from static constructors and unregister from static destructors
+struct category_registry {
+	mutex Lock;
+	verbosity DefaultVerbosity{EnabledVerbosity};
+	dyn_array<category*, malloc_allocator> Categories{};
+	dyn_array<verbosity_override, malloc_allocator> Overrides{};
+};
+}	 // namespace
+
+static category_registry& GetRegistry() {
+	static category_registry* Registry = new category_registry{};
+	return *Registry;
+}
+
+// registry lock has to be held
+static verbosity_override* FindOverride(category_registry& Registry, atom Category) {
+	for (verbosity_override& Override : Registry.Overrides) {
+		if (Override.Category == Category) {
+			return &Override;
+		}
+	}
+	return nullptr;
+}
+
+// registry lock has to be held
+static verbosity FindVerbosity(category_registry& Registry, atom Category) {
+	const verbosity_override* Override = FindOverride(Registry, Category);
+	return Override ? Override->Verbosity : Registry.DefaultVerbosity;
+}
+
+// every verbosity value above the given one
+static u8 GetDisabledMask(verbosity Verbosity) {
+	return static_cast<u8>(0xFFu << (static_cast<u8>(Verbosity) + 1));
+}
+}	 // namespace logs
+
+logs::category::category(atom InName) : Name{InName} {
+	category_registry& Registry = GetRegistry();
+	Registry.Lock.Lock();
+	DisabledMask.store(GetDisabledMask(FindVerbosity(Registry, Name)), std::memory_order_relaxed);
+	Registry.Categories.Add(this);
+	Registry.Lock.Unlock();
+}
+
+logs::category::~category() {
+	category_registry& Registry = GetRegistry();
+	Registry.Lock.Lock();
+	for (index CategoryIndex = 0; CategoryIndex < Registry.Categories.GetSize(); ++CategoryIndex) {
+		if (Registry.Categories[CategoryIndex] == this) {
+			Registry.Categories.RemoveAt(CategoryIndex);
 			break;
-		case color::red:
-			std::cout << "\033[1;31m";
+		}
+	}
+	Registry.Lock.Unlock();
+}
+
+void logs::SetVerbosity(atom Category, verbosity Verbosity) {
+	category_registry& Registry = GetRegistry();
+	Registry.Lock.Lock();
+	if (verbosity_override* Override = FindOverride(Registry, Category)) {
+		Override->Verbosity = Verbosity;
+	} else {
+		Registry.Overrides.Add(verbosity_override{Category, Verbosity});
+	}
+	for (category* Registered : Registry.Categories) {
+		if (Registered->Name == Category) {
+			Registered->DisabledMask.store(GetDisabledMask(Verbosity), std::memory_order_relaxed);
+		}
+	}
+	Registry.Lock.Unlock();
+}
+
+void logs::SetDefaultVerbosity(verbosity Verbosity) {
+	category_registry& Registry = GetRegistry();
+	Registry.Lock.Lock();
+	Registry.DefaultVerbosity = Verbosity;
+	for (category* Registered : Registry.Categories) {
+		if (!FindOverride(Registry, Registered->Name)) {
+			Registered->DisabledMask.store(GetDisabledMask(Verbosity), std::memory_order_relaxed);
+		}
+	}
+	Registry.Lock.Unlock();
+}
+
+logs::verbosity logs::GetVerbosity(atom Category) {
+	category_registry& Registry = GetRegistry();
+	Registry.Lock.Lock();
+	const verbosity Verbosity = FindVerbosity(Registry, Category);
+	Registry.Lock.Unlock();
+	return Verbosity;
+}
+
+logs::category& logs::GetCategory(atom Name) {
+	category_registry& Registry = GetRegistry();
+	Registry.Lock.Lock();
+	for (category* Registered : Registry.Categories) {
+		if (Registered->Name == Name) {
+			Registry.Lock.Unlock();
+			return *Registered;
+		}
+	}
+	Registry.Lock.Unlock();
+	// racing first uses may both create one, both are registered and follow SetVerbosity
+	return *new category{Name};
+}
+
+void logs::Log(
+	verbosity Verbosity,
+	atom Category,
+	str_view FormatString,
+	span<strings::format_argument> ArgumentArray) {
+	if (Async.Running.load(std::memory_order_acquire)) {
+		thread_ring& Ring = GetThreadRing();
+		// Announced before Running is checked again, so either StopAsync sees this thread writing and waits
+		// for its record, or this thread sees logging stopped. Only owner writes the flag, no shared cache line.
+		Ring.Writing.store(true, std::memory_order_seq_cst);
+		const bool Logged = Async.Running.load(std::memory_order_seq_cst) &&
+							TryLogAsync(Ring, Verbosity, Category, FormatString, ArgumentArray);
+		Ring.Writing.store(false, std::memory_order_release);
+		if (Logged) {
+			return;
+		}
+	}
+	// every logging thread formats its own timestamps in synchronous mode
+	static thread_local strings::cached_timestamp_format TimeFormat;
+	const timestamp LocalTime = wall_clock::GetLocal();
+	line_buffer Text;
+	AppendLine(Text, TimeFormat, LocalTime, Verbosity, Category, FormatString, ArgumentArray);
+	output_state& Output = GetOutput();
+	Output.Lock.Lock();
+	WriteLine(Output, Text, LocalTime, Verbosity, Category);
+	FlushSinks(Output);
+	Output.Lock.Unlock();
+}
+
+void logs::StartAsync(const async_config& Config) {
+	std::lock_guard Guard(Async.ControlMutex);
+	if (Async.Thread.joinable()) {
+		return;
+	}
+	Async.Config = Config;
+	{
+		std::lock_guard WakeGuard(Async.WakeMutex);
+		Async.StopRequested = false;
+		Async.Exited = false;
+	}
+	Async.Thread = std::thread(&BackgroundThread);
+	Async.Running.store(true, std::memory_order_release);
+}
+
+void logs::StopAsync() {
+	std::lock_guard Guard(Async.ControlMutex);
+	if (!Async.Thread.joinable()) {
+		return;
+	}
+	Async.Running.store(false, std::memory_order_seq_cst);
+	{
+		std::lock_guard WakeGuard(Async.WakeMutex);
+		Async.StopRequested = true;
+	}
+	WakeBackground();
+	Async.Thread.join();
+	// threads that saw Running right before it was cleared may still be committing their records
+	Async.RingsLock.Lock();
+	for (thread_ring* Ring : Async.Rings) {
+		while (Ring->Writing.load(std::memory_order_acquire)) {
+			std::this_thread::yield();
+		}
+	}
+	Async.RingsLock.Unlock();
+	DrainAll();
+}
+
+void logs::Flush() {
+	if (Async.Running.load(std::memory_order_acquire)) {
+		std::unique_lock Lock(Async.WakeMutex);
+		const u64 Target = ++Async.FlushRequested;
+		WakeBackground();
+		Async.FlushCondition.wait(Lock, [Target]() { return Async.FlushCompleted >= Target || Async.Exited; });
+	}
+	output_state& Output = GetOutput();
+	Output.Lock.Lock();
+	FlushSinks(Output);
+	Output.Lock.Unlock();
+}
+
+bool logs::IsAsync() {
+	return Async.Running.load(std::memory_order_relaxed);
+}
+
+u64 logs::GetDroppedCount() {
+	return Async.TotalDropped.load(std::memory_order_relaxed);
+}
+
+void logs::AddSink(log_sink& Sink) {
+	output_state& Output = GetOutput();
+	Output.Lock.Lock();
+	Output.Sinks.Add(&Sink);
+	Output.Lock.Unlock();
+}
+
+void logs::RemoveSink(log_sink& Sink) {
+	output_state& Output = GetOutput();
+	Output.Lock.Lock();
+	for (index SinkIndex = 0; SinkIndex < Output.Sinks.GetSize(); ++SinkIndex) {
+		if (Output.Sinks[SinkIndex] == &Sink) {
+			Sink.Flush();
+			Output.Sinks.RemoveAt(SinkIndex);
 			break;
+		}
+	}
+	Output.Lock.Unlock();
+}
+
+logs::console_sink& logs::GetConsoleSink() {
+	return GetOutput().Console;
+}
+
+// crashing thread may hold the lock itself, gives up after a while instead of deadlocking
+static bool TryLockFor(mutex& Lock) {
+	for (u32 Attempt = 0; Attempt < 1000; ++Attempt) {
+		if (Lock.TryLock()) {
+			return true;
+		}
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
 	}
-	std::cout << LogString << "\n";	   // TODO real output
-	if (Color != color::white) {
-		std::cout << "\033[1;0m";
+	return false;
+}
+
+void logs::FlushOnCrash() {
+	output_state& Output = GetOutput();
+	const bool CanDrain = TryLockFor(Async.DrainLock);
+	if (TryLockFor(Output.Lock)) {
+		if (CanDrain) {
+			DrainLocked(Output);
+		} else {
+			FlushSinks(Output);
+		}
+		Output.Lock.Unlock();
+	}
+	if (CanDrain) {
+		Async.DrainLock.Unlock();
+	}
+}
+
+static std::terminate_handler PreviousTerminateHandler{nullptr};
+
+static void CrashSignalHandler(int Signal) {
+	logs::FlushOnCrash();
+	std::signal(Signal, SIG_DFL);
+	std::raise(Signal);
+}
+
+void logs::InstallCrashHandler() {
+	PreviousTerminateHandler = std::set_terminate([]() {
+		FlushOnCrash();
+		if (PreviousTerminateHandler) {
+			PreviousTerminateHandler();
+		}
+		std::abort();
+	});
+	for (const int Signal : {SIGSEGV, SIGABRT, SIGFPE, SIGILL}) {
+		std::signal(Signal, &CrashSignalHandler);
 	}
 }
@@ -1,17 +1,116 @@
 #pragma once
 
+#include "Logs/log_sinks.h"
 #include "String/atom.h"
 #include "String/str.h"
 #include "String/str_format.h"
 
+#include <atomic>
+
 namespace logs {
 namespace atoms {
 inline const atom GlobalCategory{"Global Category"};
 }
 enum class verbosity : u8 { error = 1, warning = 2, info = 3, debug = 4 };
 enum class color : u8 { white, yellow, red };
+// compile time ceiling, more verbose calls are compiled out, runtime levels can only be lower
 constexpr verbosity EnabledVerbosity = verbosity::debug;
 
+// Log category with runtime verbosity. Checking it is one load of DisabledMask, one test and one branch, done before
+// format arguments are collected, so declare categories of hot code once (global or static) and pass them to Log.
+// Calls with atom category look the category up by name first
+struct category {
+	atom Name;
+	// bit per verbosity value, set bits are skipped. Zero when statically initialized memory is used before the
+	// constructor ran, so such calls log everything instead of nothing
+	std::atomic<u8> DisabledMask{0};
+
+	// picks up verbosity set by name before the category existed
+	explicit category(atom InName);
+	~category();
+
+	category(const category&) = delete;
+	category& operator=(const category&) = delete;
+
+	[[nodiscard]] FORCEINLINE bool IsEnabled(verbosity Verbosity) const {
+		return !(DisabledMask.load(std::memory_order_relaxed) & (1u << static_cast<u8>(Verbosity)));
+	}
+};
+
+namespace categories {
+inline category Global{atoms::GlobalCategory};
+}
+
+// same check Log does, for skipping work that only prepares arguments
+template <verbosity Verbosity>
+[[nodiscard]] FORCEINLINE bool IsEnabled(const category& Category) {
+	if constexpr (static_cast<u8>(EnabledVerbosity) >= static_cast<u8>(Verbosity)) {
+		return Category.IsEnabled(Verbosity);
+	} else {
+		return false;
+	}
+}
+
+// Messages more verbose than Verbosity are skipped in every category with this name, including categories created
+// later. Thread safe, takes effect on the next call
+void SetVerbosity(atom Category, verbosity Verbosity);
+
+// for categories without own verbosity, EnabledVerbosity at start
+void SetDefaultVerbosity(verbosity Verbosity);
+
+[[nodiscard]] verbosity GetVerbosity(atom Category);
+
+// registered category with this name, created on first use and never destroyed
+[[nodiscard]] category& GetCategory(atom Name);
+
+// What logging thread does when its ring is full
+enum class overflow_policy : u8 {
+	// debug and info messages are counted and dropped, warnings and errors still wait
+	drop,
+	// every message waits for the background thread to make room
+	block
+};
+
+struct async_config {
+	// per logging thread, rounded up to power of 2, messages that don't fit into empty ring are written synchronously
+	index RingSize{64 * 1024};
+	overflow_policy Overflow{overflow_policy::drop};
+	// background thread wakes up at least this often, earlier when some ring is half full
+	u32 FlushIntervalMs{10};
+};
+
+// Deferred formatting: logging thread only copies format string, category, timestamp and raw arguments
+// (string arguments by value) into its own lock-free ring, background thread formats and writes them.
+// Lines of one thread keep their order, lines of different threads are ordered per drain pass only.
+void StartAsync(const async_config& Config = {});
+
+// Writes everything that is queued and joins background thread, logging becomes synchronous again.
+// Called automatically at exit
+void StopAsync();
+
+// Blocks until everything logged before the call is written
+void Flush();
+
+[[nodiscard]] bool IsAsync();
+
+// messages dropped by overflow_policy::drop since start of the program
+[[nodiscard]] u64 GetDroppedCount();
+
+// Every line goes to every sink, caller keeps ownership. Console sink is there by default
+void AddSink(log_sink& Sink);
+
+// flushes sink, after return logger doesn't touch it anymore
+void RemoveSink(log_sink& Sink);
+
+[[nodiscard]] console_sink& GetConsoleSink();
+
+// Best effort when process is about to die: drains rings and flushes sinks, but only takes locks that get free soon,
+// crashing thread may hold them itself
+void FlushOnCrash();
+
+// std::terminate handler and fatal signal handlers that call FlushOnCrash() before default handling
+void InstallCrashHandler();
+
 constexpr str_view GetVerbosityString(verbosity Verbosity) {
 	switch (Verbosity) {
 		case verbosity::error:
@@ -38,46 +137,49 @@ constexpr color GetVerbosityColor(verbosity Verbosity) {
 	}
 }
 
-void Log(
-	color Color,
-	str_view VerbosityString,
-	atom Category,
-	str_view FormatString,
-	span<strings::format_argument> ArgumentArray);
+// Writes line synchronously or, while async logging is running, copies arguments into calling thread's ring
+void Log(verbosity Verbosity, atom Category, str_view FormatString, span<strings::format_argument> ArgumentArray);
+
+template <verbosity Verbosity, typename... argument_types>
+FORCEINLINE void Log(const category& Category, str_view FormatString, const argument_types&... Arguments) {
+	if constexpr (static_cast<u8>(EnabledVerbosity) >= static_cast<u8>(Verbosity)) {
+		if (Category.IsEnabled(Verbosity)) {
+			array<strings::format_argument, sizeof...(Arguments)> ArgumentArray{Arguments...};
+			Log(Verbosity, Category.Name, FormatString, ArgumentArray);
+		}
+	}
+}
 
 template <verbosity Verbosity, typename... argument_types>
 inline void Log(atom Category, str_view FormatString, const argument_types&... Arguments) {
 	if constexpr (static_cast<u8>(EnabledVerbosity) >= static_cast<u8>(Verbosity)) {
-		constexpr const color Color = GetVerbosityColor(Verbosity);
-		constexpr str_view VerbosityString = GetVerbosityString(Verbosity);
-		array<strings::format_argument, sizeof...(Arguments)> ArgumentArray{Arguments...};
-		Log(Color, VerbosityString, Category, FormatString, ArgumentArray);
+		Log<Verbosity>(GetCategory(Category), FormatString, Arguments...);
 	}
 }
 
 template <verbosity Verbosity, typename... argument_types>
-inline void Log(str_view FormatString, const argument_types&... Arguments) {
-	Log<Verbosity>(atoms::GlobalCategory, FormatString, Arguments...);
+FORCEINLINE void Log(str_view FormatString, const argument_types&... Arguments) {
+	Log<Verbosity>(categories::Global, FormatString, Arguments...);
 }
 
 template <typename... argument_types>
-inline void Debug(str_view FormatString, const argument_types&... Arguments) {
-	Log<verbosity::debug>(atoms::GlobalCategory, FormatString, Arguments...);
+FORCEINLINE void Debug(str_view FormatString, const argument_types&... Arguments) {
+	Log<verbosity::debug>(categories::Global, FormatString, Arguments...);
 }
 
 template <typename... argument_types>
-inline void Info(str_view FormatString, const argument_types&... Arguments) {
-	Log<verbosity::info>(atoms::GlobalCategory, FormatString, Arguments...);
+FORCEINLINE void Info(str_view FormatString, const argument_types&... Arguments) {
+	Log<verbosity::info>(categories::Global, FormatString, Arguments...);
 }
 
 template <typename... argument_types>
-inline void Warning(str_view FormatString, const argument_types&... Arguments) {
-	Log<verbosity::warning>(atoms::GlobalCategory, FormatString, Arguments...);
+FORCEINLINE void Warning(str_view FormatString, const argument_types&... Arguments) {
+	Log<verbosity::warning>(categories::Global, FormatString, Arguments...);
 }
 
 template <typename... argument_types>
-inline void Error(str_view FormatString, const argument_types&... Arguments) {
-	Log<verbosity::error>(atoms::GlobalCategory, FormatString, Arguments...);
+FORCEINLINE void Error(str_view FormatString, const argument_types&... Arguments) {
+	Log<verbosity::error>(categories::Global, FormatString, Arguments...);
 }
 
 template <typename... argument_types>
@@ -100,4 +202,24 @@ inline void Error(atom Category, str_view FormatString, const argument_types&...
 	Log<verbosity::error>(Category, FormatString, Arguments...);
 }
 
+template <typename... argument_types>
+FORCEINLINE void Debug(const category& Category, str_view FormatString, const argument_types&... Arguments) {
+	Log<verbosity::debug>(Category, FormatString, Arguments...);
+}
+
+template <typename... argument_types>
+FORCEINLINE void Info(const category& Category, str_view FormatString, const argument_types&... Arguments) {
+	Log<verbosity::info>(Category, FormatString, Arguments...);
+}
+
+template <typename... argument_types>
+FORCEINLINE void Warning(const category& Category, str_view FormatString, const argument_types&... Arguments) {
+	Log<verbosity::warning>(Category, FormatString, Arguments...);
+}
+
+template <typename... argument_types>
+FORCEINLINE void Error(const category& Category, str_view FormatString, const argument_types&... Arguments) {
+	Log<verbosity::error>(Category, FormatString, Arguments...);
+}
+
 }	 // namespace logs
@@ -9,6 +9,10 @@
 	_BitScanReverse64((BIT_SCAN_REVERSE_Index), (BIT_SCAN_REVERSE_Value))
 #define BIT_SCAN_REVERSE_32(BIT_SCAN_REVERSE_Index, BIT_SCAN_REVERSE_Value) \
 	_BitScanReverse((BIT_SCAN_REVERSE_Index), (BIT_SCAN_REVERSE_Value))
+#define BIT_SCAN_FORWARD_64(BIT_SCAN_FORWARD_Index, BIT_SCAN_FORWARD_Value) \
+	_BitScanForward64((BIT_SCAN_FORWARD_Index), (BIT_SCAN_FORWARD_Value))
+#define BIT_SCAN_FORWARD_32(BIT_SCAN_FORWARD_Index, BIT_SCAN_FORWARD_Value) \
+	_BitScanForward((BIT_SCAN_FORWARD_Index), (BIT_SCAN_FORWARD_Value))
 #endif
 
 #if defined(__GNUC__)	 // GCC
@@ -29,7 +33,7 @@ static FORCEINLINE constexpr unsigned char BitScanReverseGNUC_32(unsigned long*
 		*Index = 0;
 		return false;
 	}
-	*Index = __builtin_clzl(Mask);
+	*Index = __builtin_clz((unsigned int) Mask);	// unsigned long is 64 bit on LP64 platforms
 	*Index = 31 - *Index;
 	return true;
 }
@@ -38,6 +42,29 @@ static FORCEINLINE constexpr unsigned char BitScanReverseGNUC_32(unsigned long*
 	BitScanReverseGNUC_64((BIT_SCAN_REVERSE_Index), (BIT_SCAN_REVERSE_Value))
 #define BIT_SCAN_REVERSE_32(BIT_SCAN_REVERSE_Index, BIT_SCAN_REVERSE_Value) \
 	BitScanReverseGNUC_32((BIT_SCAN_REVERSE_Index), (BIT_SCAN_REVERSE_Value))
+
+static FORCEINLINE constexpr unsigned char BitScanForwardGNUC_64(unsigned long* Index, unsigned long long Mask) {
+	if (Mask == 0) {
+		*Index = 0;
+		return false;
+	}
+	*Index = __builtin_ctzll(Mask);
+	return true;
+}
+
+static FORCEINLINE constexpr unsigned char BitScanForwardGNUC_32(unsigned long* Index, unsigned long Mask) {
+	if (Mask == 0) {
+		*Index = 0;
+		return false;
+	}
+	*Index = __builtin_ctz((unsigned int) Mask);
+	return true;
+}
+
+#define BIT_SCAN_FORWARD_64(BIT_SCAN_FORWARD_Index, BIT_SCAN_FORWARD_Value) \
+	BitScanForwardGNUC_64((BIT_SCAN_FORWARD_Index), (BIT_SCAN_FORWARD_Value))
+#define BIT_SCAN_FORWARD_32(BIT_SCAN_FORWARD_Index, BIT_SCAN_FORWARD_Value) \
+	BitScanForwardGNUC_32((BIT_SCAN_FORWARD_Index), (BIT_SCAN_FORWARD_Value))
 #endif
 
 template <integral integral_type>
@@ -59,6 +86,28 @@ constexpr char BitScanReverse(unsigned long* Index, integral_type Mask) {
 	}
 }
 
+// Index of lowest set bit, returns false for 0
+template <integral integral_type>
+constexpr char BitScanForward(unsigned long* Index, integral_type Mask) {
+	if (std::is_constant_evaluated()) {
+		if (Mask == 0) {
+			return false;
+		}
+		unsigned long Count = 0;
+		while ((Mask & 1) == 0) {
+			Mask = Mask >> 1;
+			++Count;
+		}
+		*Index = Count;
+		return true;
+	}
+	if constexpr (sizeof(integral_type) > 4) {
+		return BIT_SCAN_FORWARD_64(Index, Mask);
+	} else {
+		return BIT_SCAN_FORWARD_32(Index, Mask);
+	}
+}
+
 namespace math {
 constexpr float DefaultEqualityTolerance = 0.001f;
 
@@ -21,6 +21,23 @@ FORCEINLINE static void MemoryFree(void* Ptr) {
 	std::free(Ptr);
 }
 
+// Alignment must be a power of 2, memory must be released with MemoryAlignedFree
+FORCEINLINE static void* MemoryAlignedMalloc(u64 Size, u64 Alignment) {
+#if defined(_MSC_VER)
+	return _aligned_malloc(Size, Alignment);
+#else
+	return std::aligned_alloc(Alignment, (Size + Alignment - 1) & ~(Alignment - 1));
+#endif
+}
+
+FORCEINLINE static void MemoryAlignedFree(void* Ptr) {
+#if defined(_MSC_VER)
+	_aligned_free(Ptr);
+#else
+	std::free(Ptr);
+#endif
+}
+
 template <typename sub_type>
 struct allocator_base {
 	constexpr static bool Debug = false;
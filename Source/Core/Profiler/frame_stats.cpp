@@ -0,0 +1,123 @@
+#include "frame_stats.h"
+#include "Containers/algo.h"
+#include "Containers/dyn_array.h"
+#include "Logs/logs.h"
+#include "Memory/allocator_base.h"
+#include "Time/cycle_clock.h"
+
+static logs::category FrameStatsCategory{atom{"Frame Stats"}};
+
+frame_stats::frame_stats(span<const char*> InStageNames, index InWindowSize)
+	: StageCount{math::Min(InStageNames.GetSize(), MaxStages)}
+	, WindowSize{math::Max(InWindowSize, (index) 1)} {
+	CHECK(InStageNames.GetSize() <= MaxStages)
+	for (index Stage = 0; Stage < StageCount; ++Stage) {
+		StageNames[Stage] = InStageNames[Stage];
+	}
+	FrameHistogram = new histogram{};
+	StageHistograms = new histogram[StageCount > 0 ? StageCount : 1];
+	Window = new std::atomic<s64>[WindowSize];
+	for (index Frame = 0; Frame < WindowSize; ++Frame) {
+		Window[Frame].store(0, std::memory_order_relaxed);
+	}
+}
+
+frame_stats::~frame_stats() {
+	delete FrameHistogram;
+	delete[] StageHistograms;
+	delete[] Window;
+}
+
+s64 frame_stats::EndStage(index Stage, s64 BeginNs) {
+	const s64 EndNs = cycle_clock::GetNs();
+	PendingStageNs[Stage] += EndNs - BeginNs;
+	return EndNs;
+}
+
+void frame_stats::EndFrame(s64 FrameNs) {
+	FrameHistogram->Record(FrameNs);
+	for (index Stage = 0; Stage < StageCount; ++Stage) {
+		StageHistograms[Stage].Record(PendingStageNs[Stage]);
+		PendingStageNs[Stage] = 0;
+	}
+	const u64 Frame = WindowFrames.load(std::memory_order_relaxed);
+	Window[Frame % WindowSize].store(FrameNs, std::memory_order_relaxed);
+	WindowFrames.store(Frame + 1, std::memory_order_release);
+}
+
+histogram_summary frame_stats::GetFrameSummary() const {
+	return FrameHistogram->GetSummary();
+}
+
+histogram_summary frame_stats::GetStageSummary(index Stage) const {
+	return StageHistograms[Stage].GetSummary();
+}
+
+histogram_summary frame_stats::GetWindowSummary() const {
+	histogram_summary Summary;
+	const u64 Frames = WindowFrames.load(std::memory_order_acquire);
+	const index Count = (index) math::Min(Frames, (u64) WindowSize);
+	if (Count == 0) {
+		return Summary;
+	}
+	// may be called from any thread, default allocator is not thread safe
+	dyn_array<s64, malloc_allocator> Sorted(Count);
+	s64 Sum = 0;
+	for (index Frame = 0; Frame < Count; ++Frame) {
+		const s64 FrameNs = Window[Frame].load(std::memory_order_relaxed);
+		Sorted.Add(FrameNs);
+		Sum += FrameNs;
+	}
+	algo::Sort(Sorted);
+	// nearest rank
+	const auto GetPercentile = [&](index Percent) {
+		const index Rank = math::Max((Count * Percent + 99) / 100, (index) 1);
+		return Sorted[Rank - 1];
+	};
+	const index SlowCount = math::Max(Count / 100, (index) 1);
+	s64 SlowSum = 0;
+	for (index Frame = Count - SlowCount; Frame < Count; ++Frame) {
+		SlowSum += Sorted[Frame];
+	}
+	Summary.Count = Count;
+	Summary.Min = Sorted[0];
+	Summary.Max = Sorted[Count - 1];
+	Summary.Mean = Sum / (s64) Count;
+	Summary.P50 = GetPercentile(50);
+	Summary.P95 = GetPercentile(95);
+	Summary.P99 = GetPercentile(99);
+	Summary.Low1 = SlowSum / (s64) SlowCount;
+	return Summary;
+}
+
+void frame_stats::Reset() {
+	FrameHistogram->Reset();
+	for (index Stage = 0; Stage < StageCount; ++Stage) {
+		StageHistograms[Stage].Reset();
+	}
+	WindowFrames.store(0, std::memory_order_release);
+}
+
+static void LogSummary(str_view Name, const histogram_summary& Summary) {
+	// microseconds are enough for frames and keep lines short
+	logs::Info(
+		FrameStatsCategory,
+		"{}: {} samples, min {} us, mean {} us, p50 {} us, p95 {} us, p99 {} us, 1% low {} us, max {} us",
+		Name,
+		Summary.Count,
+		Summary.Min / 1000,
+		Summary.Mean / 1000,
+		Summary.P50 / 1000,
+		Summary.P95 / 1000,
+		Summary.P99 / 1000,
+		Summary.Low1 / 1000,
+		Summary.Max / 1000);
+}
+
+void frame_stats::LogReport() const {
+	LogSummary("Frame", GetFrameSummary());
+	LogSummary("Last frames", GetWindowSummary());
+	for (index Stage = 0; Stage < StageCount; ++Stage) {
+		LogSummary(StageNames[Stage], GetStageSummary(Stage));
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "basic.h"
+#include "Containers/span.h"
+#include "Profiler/histogram.h"
+
+#include <atomic>
+
+// Frame time statistics. Whole frames and each of their stages go to histograms that cover everything since the last
+// Reset(), whole frames also to a window of the last frames, which gives exact percentiles of the recent run. Frames
+// are recorded by one thread, queries can come from any thread while frames are running.
+//
+//	s64 StageBeginNs = cycle_clock::GetNs();
+//	Update();
+//	StageBeginNs = Stats.EndStage(update_stage, StageBeginNs);
+//	Render();
+//	StageBeginNs = Stats.EndStage(render_stage, StageBeginNs);
+//	Stats.EndFrame(FrameNs);
+struct frame_stats {
+	static constexpr index MaxStages = 8;
+
+	// names are kept by pointer
+	explicit frame_stats(span<const char*> InStageNames, index InWindowSize = 1024);
+	~frame_stats();
+
+	frame_stats(const frame_stats&) = delete;
+	frame_stats& operator=(const frame_stats&) = delete;
+
+	// adds time since BeginNs to the stage of the current frame, returns now, which is where the next stage begins
+	s64 EndStage(index Stage, s64 BeginNs);
+
+	// records frame time and stage times added since the previous call
+	void EndFrame(s64 FrameNs);
+
+	[[nodiscard]] index GetStageCount() const {
+		return StageCount;
+	}
+
+	[[nodiscard]] const char* GetStageName(index Stage) const {
+		return StageNames[Stage];
+	}
+
+	// since Reset()
+	[[nodiscard]] histogram_summary GetFrameSummary() const;
+	[[nodiscard]] histogram_summary GetStageSummary(index Stage) const;
+
+	// exact, over the last WindowSize frames
+	[[nodiscard]] histogram_summary GetWindowSummary() const;
+
+	// not synchronized with EndFrame(), a frame recorded meanwhile may be partially kept
+	void Reset();
+
+	// frame, window and stage summaries, one line each
+	void LogReport() const;
+
+	const char* StageNames[MaxStages]{};
+	index StageCount{0};
+	index WindowSize{0};
+	// written by recording thread only
+	s64 PendingStageNs[MaxStages]{};
+	histogram* FrameHistogram{nullptr};
+	histogram* StageHistograms{nullptr};
+	std::atomic<s64>* Window{nullptr};
+	std::atomic<u64> WindowFrames{0};
+};
@@ -0,0 +1,166 @@
+#pragma once
+
+#include "basic.h"
+#include "Math/math.h"
+
+#include <atomic>
+
+// in units of recorded samples
+struct histogram_summary {
+	u64 Count{0};
+	s64 Min{0};
+	s64 Max{0};
+	s64 Mean{0};
+	s64 P50{0};
+	s64 P95{0};
+	s64 P99{0};
+	// mean of the slowest 1% of samples
+	s64 Low1{0};
+};
+
+// Lock-free log-linear histogram of non-negative integer samples (nanoseconds), HDR histogram style. Values below
+// 2^SubBucketBits get own bucket, above that every power of two is split into 2^(SubBucketBits - 1) equal buckets,
+// so reported percentiles are within 1/128 of the sample. Record() is a few relaxed atomic adds and can be called
+// from any number of threads, queries read a snapshot that may miss samples being recorded at the same time.
+struct histogram {
+	static constexpr u32 SubBucketBits = 7;
+	static constexpr u64 SubBucketHalf = 1ull << (SubBucketBits - 1);
+	// larger samples (about 18 minutes in nanoseconds) go to the last bucket
+	static constexpr u32 MaxValueBits = 40;
+	static constexpr u64 MaxValue = (1ull << MaxValueBits) - 1;
+	static constexpr index BucketCount = (MaxValueBits - SubBucketBits + 2) * SubBucketHalf;
+
+	std::atomic<u64> Count{0};
+	std::atomic<u64> Sum{0};
+	std::atomic<u64> Min{~0ull};
+	std::atomic<u64> Max{0};
+	std::atomic<u64> Buckets[BucketCount]{};
+
+	histogram() = default;
+	histogram(const histogram&) = delete;
+	histogram& operator=(const histogram&) = delete;
+
+	[[nodiscard]] static FORCEINLINE index GetBucket(u64 Value) {
+		if (Value < (1ull << SubBucketBits)) {
+			return (index) Value;
+		}
+		Value = Value < MaxValue ? Value : MaxValue;
+		unsigned long HighestBit;
+		BIT_SCAN_REVERSE_64(&HighestBit, Value);
+		const u64 Shift = HighestBit - SubBucketBits + 1;
+		return (index) (Shift * SubBucketHalf + (Value >> Shift));
+	}
+
+	// smallest value that falls into the bucket
+	[[nodiscard]] static u64 GetBucketStart(index Bucket) {
+		if (Bucket < (1ull << SubBucketBits)) {
+			return Bucket;
+		}
+		const u64 Shift = Bucket / SubBucketHalf - 1;
+		return (Bucket - Shift * SubBucketHalf) << Shift;
+	}
+
+	[[nodiscard]] static u64 GetBucketWidth(index Bucket) {
+		return Bucket < (1ull << SubBucketBits) ? 1 : 1ull << (Bucket / SubBucketHalf - 1);
+	}
+
+	// negative samples are counted as zero
+	FORCEINLINE void Record(s64 Sample) {
+		const u64 Value = Sample > 0 ? (u64) Sample : 0;
+		Buckets[GetBucket(Value)].fetch_add(1, std::memory_order_relaxed);
+		Sum.fetch_add(Value, std::memory_order_relaxed);
+		Count.fetch_add(1, std::memory_order_relaxed);
+		u64 CurrentMin = Min.load(std::memory_order_relaxed);
+		while (Value < CurrentMin && !Min.compare_exchange_weak(CurrentMin, Value, std::memory_order_relaxed)) {
+		}
+		u64 CurrentMax = Max.load(std::memory_order_relaxed);
+		while (Value > CurrentMax && !Max.compare_exchange_weak(CurrentMax, Value, std::memory_order_relaxed)) {
+		}
+	}
+
+	[[nodiscard]] u64 GetCount() const {
+		return Count.load(std::memory_order_relaxed);
+	}
+
+	[[nodiscard]] s64 GetMin() const {
+		return GetCount() > 0 ? (s64) Min.load(std::memory_order_relaxed) : 0;
+	}
+
+	[[nodiscard]] s64 GetMax() const {
+		return (s64) Max.load(std::memory_order_relaxed);
+	}
+
+	[[nodiscard]] s64 GetMean() const {
+		const u64 Samples = GetCount();
+		return Samples > 0 ? (s64) (Sum.load(std::memory_order_relaxed) / Samples) : 0;
+	}
+
+	// Percentile in [0, 100], middle of the bucket holding the sample of that rank, clamped to recorded range
+	[[nodiscard]] s64 GetPercentile(double Percentile) const {
+		const u64 Samples = GetCount();
+		if (Samples == 0) {
+			return 0;
+		}
+		u64 Rank = (u64) (Percentile / 100.0 * (double) Samples + 0.5);
+		Rank = math::Max(Rank, (u64) 1);
+		u64 Seen = 0;
+		for (index Bucket = 0; Bucket < BucketCount; ++Bucket) {
+			Seen += Buckets[Bucket].load(std::memory_order_relaxed);
+			if (Seen >= Rank) {
+				return ClampToRange(GetBucketStart(Bucket) + GetBucketWidth(Bucket) / 2);
+			}
+		}
+		return GetMax();
+	}
+
+	// mean of the highest (100 - Percentile)% of samples, at least one
+	[[nodiscard]] s64 GetMeanAbove(double Percentile) const {
+		const u64 Samples = GetCount();
+		if (Samples == 0) {
+			return 0;
+		}
+		u64 Wanted = (u64) ((100.0 - Percentile) / 100.0 * (double) Samples);
+		Wanted = math::Max(Wanted, (u64) 1);
+		u64 Taken = 0;
+		double Total = 0.0;
+		for (index Bucket = BucketCount; Bucket > 0 && Taken < Wanted; --Bucket) {
+			const u64 InBucket = Buckets[Bucket - 1].load(std::memory_order_relaxed);
+			const u64 Take = math::Min(InBucket, Wanted - Taken);
+			const u64 Middle = GetBucketStart(Bucket - 1) + GetBucketWidth(Bucket - 1) / 2;
+			Total += (double) ClampToRange(Middle) * (double) Take;
+			Taken += Take;
+		}
+		return Taken > 0 ? (s64) (Total / (double) Taken) : 0;
+	}
+
+	[[nodiscard]] histogram_summary GetSummary() const {
+		histogram_summary Summary;
+		Summary.Count = GetCount();
+		Summary.Min = GetMin();
+		Summary.Max = GetMax();
+		Summary.Mean = GetMean();
+		Summary.P50 = GetPercentile(50.0);
+		Summary.P95 = GetPercentile(95.0);
+		Summary.P99 = GetPercentile(99.0);
+		Summary.Low1 = GetMeanAbove(99.0);
+		return Summary;
+	}
+
+	// not atomic as a whole, samples recorded during reset may be partially kept
+	void Reset() {
+		for (std::atomic<u64>& Bucket : Buckets) {
+			Bucket.store(0, std::memory_order_relaxed);
+		}
+		Sum.store(0, std::memory_order_relaxed);
+		Count.store(0, std::memory_order_relaxed);
+		Min.store(~0ull, std::memory_order_relaxed);
+		Max.store(0, std::memory_order_relaxed);
+	}
+
+private:
+	[[nodiscard]] s64 ClampToRange(u64 Value) const {
+		const u64 Low = Min.load(std::memory_order_relaxed);
+		const u64 High = Max.load(std::memory_order_relaxed);
+		return (s64) math::Min(math::Max(Value, Low), High);
+	}
+};
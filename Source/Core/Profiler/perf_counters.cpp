@@ -0,0 +1,187 @@
+#include "perf_counters.h"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+struct counter_reading {
+	u64 Value{0};
+	u64 EnabledNs{0};
+	u64 RunningNs{0};
+};
+
+// counters of one thread, closed when it exits
+struct thread_counters {
+	s32 Descriptors[PerfEventCount];
+	bool Opened{false};
+
+	thread_counters() {
+		for (s32& Descriptor : Descriptors) {
+			Descriptor = -1;
+		}
+	}
+
+	~thread_counters();
+
+	thread_counters(const thread_counters&) = delete;
+	thread_counters& operator=(const thread_counters&) = delete;
+};
+}	 // namespace
+
+static thread_local thread_counters Counters;
+
+#if defined(__linux__)
+struct event_config {
+	u32 Type;
+	u64 Config;
+};
+
+static constexpr u64 MakeCacheConfig(u64 Cache) {
+	return Cache | ((u64) PERF_COUNT_HW_CACHE_OP_READ << 8) | ((u64) PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+// in perf_event order
+static constexpr event_config EventConfigs[PerfEventCount] = {
+	{PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+	{PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+	{PERF_TYPE_HW_CACHE, MakeCacheConfig(PERF_COUNT_HW_CACHE_L1D)},
+	{PERF_TYPE_HW_CACHE, MakeCacheConfig(PERF_COUNT_HW_CACHE_LL)},
+	{PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+	{PERF_TYPE_HW_CACHE, MakeCacheConfig(PERF_COUNT_HW_CACHE_DTLB)},
+};
+
+thread_counters::~thread_counters() {
+	for (const s32 Descriptor : Descriptors) {
+		if (Descriptor >= 0) {
+			close(Descriptor);
+		}
+	}
+}
+
+static thread_counters& GetCounters() {
+	if (!Counters.Opened) [[unlikely]] {
+		Counters.Opened = true;
+		for (index Event = 0; Event < PerfEventCount; ++Event) {
+			perf_event_attr Attributes{};
+			Attributes.size = sizeof(Attributes);
+			Attributes.type = EventConfigs[Event].Type;
+			Attributes.config = EventConfigs[Event].Config;
+			Attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+			// user space of this thread on any CPU
+			Attributes.exclude_kernel = 1;
+			Attributes.exclude_hv = 1;
+			const long Descriptor = syscall(SYS_perf_event_open, &Attributes, 0, -1, -1, 0);
+			Counters.Descriptors[Event] = Descriptor >= 0 ? (s32) Descriptor : -1;
+		}
+	}
+	return Counters;
+}
+
+// false when the counter can't be read anymore
+static bool Read(s32 Descriptor, counter_reading& Reading) {
+	u64 Buffer[3];
+	if (read(Descriptor, Buffer, sizeof(Buffer)) != (ssize_t) sizeof(Buffer)) {
+		return false;
+	}
+	Reading = counter_reading{Buffer[0], Buffer[1], Buffer[2]};
+	return true;
+}
+
+static void Close(thread_counters& Thread, index Event) {
+	close(Thread.Descriptors[Event]);
+	Thread.Descriptors[Event] = -1;
+}
+#else
+thread_counters::~thread_counters() = default;
+
+static thread_counters& GetCounters() {
+	Counters.Opened = true;
+	return Counters;
+}
+
+static bool Read(s32 Descriptor, counter_reading& Reading) {
+	return false;
+}
+
+static void Close(thread_counters& Thread, index Event) {
+	Thread.Descriptors[Event] = -1;
+}
+#endif
+
+// Counter that fails to read is closed and reported unavailable from then on, a reading of zero would make the next
+// difference wrap
+void perf_counters::Start() {
+	thread_counters& Thread = GetCounters();
+	// cycles and instructions are read last here and first in Stop(), closest to the measured code
+	for (index Event = PerfEventCount; Event > 0; --Event) {
+		if (Thread.Descriptors[Event - 1] >= 0) {
+			counter_reading Reading;
+			if (!Read(Thread.Descriptors[Event - 1], Reading)) {
+				Close(Thread, Event - 1);
+				continue;
+			}
+			StartValues[Event - 1] = Reading.Value;
+			StartEnabledNs[Event - 1] = Reading.EnabledNs;
+			StartRunningNs[Event - 1] = Reading.RunningNs;
+		}
+	}
+}
+
+void perf_counters::Stop() {
+	thread_counters& Thread = GetCounters();
+	for (index Event = 0; Event < PerfEventCount; ++Event) {
+		if (Thread.Descriptors[Event] < 0) {
+			continue;
+		}
+		counter_reading Reading;
+		if (!Read(Thread.Descriptors[Event], Reading)) {
+			Close(Thread, Event);
+			continue;
+		}
+		const u64 Value = Reading.Value - StartValues[Event];
+		const u64 EnabledNs = Reading.EnabledNs - StartEnabledNs[Event];
+		const u64 RunningNs = Reading.RunningNs - StartRunningNs[Event];
+		// counter shared its hardware slot with other events part of the time
+		if (RunningNs > 0 && RunningNs < EnabledNs) {
+			Values[Event] += (u64) ((double) Value * (double) EnabledNs / (double) RunningNs);
+		} else {
+			Values[Event] += Value;
+		}
+	}
+}
+
+bool perf_counters::IsAvailable(perf_event Event) {
+	return GetCounters().Descriptors[(index) Event] >= 0;
+}
+
+bool perf_counters::IsAvailable() {
+	const thread_counters& Thread = GetCounters();
+	for (const s32 Descriptor : Thread.Descriptors) {
+		if (Descriptor >= 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+const char* perf_counters::GetName(perf_event Event) {
+	switch (Event) {
+		case perf_event::cycles:
+			return "cycles";
+		case perf_event::instructions:
+			return "instructions";
+		case perf_event::l1d_misses:
+			return "L1D misses";
+		case perf_event::llc_misses:
+			return "LLC misses";
+		case perf_event::branch_misses:
+			return "branch misses";
+		case perf_event::dtlb_misses:
+			return "dTLB misses";
+		default:
+			return "unknown";
+	}
+}
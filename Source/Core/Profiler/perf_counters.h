@@ -0,0 +1,78 @@
+#pragma once
+
+#include "basic.h"
+#include "Math/math.h"
+
+// Hardware performance counters of the calling thread, for benchmarks that need to know whether a change cut cache
+// misses or branch mispredictions rather than only time. Linux only (perf_event_open): counters of a thread are opened
+// on its first Start() and stay enabled, Start() and Stop() read them and accumulate the difference.
+// Each event is opened on its own, so the kernel can multiplex them when there are more events than hardware
+// counters, values are scaled by the share of time an event was actually counted. Where nothing can be opened (other
+// platforms, virtual machines without PMU, perf_event_paranoid above 2) every value stays zero, events the CPU
+// doesn't have are reported unavailable one by one.
+//
+//	perf_counters Counters;
+//	Counters.Start();
+//	...
+//	Counters.Stop();
+//	const double MissesPerOp = (double) Counters.Get(perf_event::llc_misses) / Operations;
+enum class perf_event : u8 { cycles, instructions, l1d_misses, llc_misses, branch_misses, dtlb_misses, count };
+
+constexpr index PerfEventCount = (index) perf_event::count;
+
+struct perf_counters {
+	// accumulated between Start() and Stop() pairs
+	u64 Values[PerfEventCount]{};
+
+	// raw readings taken by Start()
+	u64 StartValues[PerfEventCount]{};
+	u64 StartEnabledNs[PerfEventCount]{};
+	u64 StartRunningNs[PerfEventCount]{};
+
+	void Start();
+	void Stop();
+
+	[[nodiscard]] u64 Get(perf_event Event) const {
+		return Values[(index) Event];
+	}
+
+	// instructions per cycle, 0 when either is unavailable
+	[[nodiscard]] double GetIpc() const {
+		return Values[(index) perf_event::cycles] > 0
+				   ? (double) Values[(index) perf_event::instructions] / (double) Values[(index) perf_event::cycles]
+				   : 0.0;
+	}
+
+	void Offset(const perf_counters& Other) {
+		for (index Event = 0; Event < PerfEventCount; ++Event) {
+			Values[Event] -= math::Min(Values[Event], Other.Values[Event]);
+		}
+	}
+
+	void Clear() {
+		for (u64& Value : Values) {
+			Value = 0;
+		}
+	}
+
+	// opens counters of the calling thread if needed
+	[[nodiscard]] static bool IsAvailable(perf_event Event);
+	[[nodiscard]] static bool IsAvailable();
+
+	[[nodiscard]] static const char* GetName(perf_event Event);
+
+	struct scope {
+		perf_counters& Counters;
+
+		explicit scope(perf_counters& InCounters) : Counters{InCounters} {
+			Counters.Start();
+		}
+
+		~scope() {
+			Counters.Stop();
+		}
+
+		scope(const scope&) = delete;
+		scope& operator=(const scope&) = delete;
+	};
+};
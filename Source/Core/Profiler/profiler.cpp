@@ -0,0 +1,287 @@
+#include "profiler.h"
+#include "Concurrency/mutex.h"
+#include "Concurrency/spsc_queue.h"
+#include "Containers/dyn_array.h"
+#include "Memory/allocator_base.h"
+#include "String/str_conversions.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace profiler {
+// zones are written by several threads, default allocator is not thread safe
+using text_buffer = dyn_array<char, malloc_allocator, 256>;
+
+namespace {
+struct thread_buffer {
+	// owning thread pushes, whoever holds collector lock pops
+	spsc_queue<zone_event> Ring;
+	std::atomic<u64> Dropped{0};
+	// set by owning thread at exit, buffer is deleted by the next capture
+	std::atomic<bool> Abandoned{false};
+	u32 ThreadId{0};
+
+	// guarded by collector lock
+	text_buffer Name{};
+	dyn_array<zone_event, malloc_allocator> Zones{};
+
+	explicit thread_buffer(index RingSize) : Ring{RingSize} {
+	}
+};
+
+// never destroyed, threads may record zones from static destructors
+struct collector_state {
+	mutex Lock;
+	capture_config Config{};
+	s64 CaptureBeginNs{0};
+	u64 Dropped{0};
+	u32 NextThreadId{1};
+	dyn_array<thread_buffer*, malloc_allocator> Buffers{};
+	dyn_array<s64, malloc_allocator> FrameMarks{};
+};
+
+struct buffer_holder {
+	thread_buffer* Buffer{nullptr};
+	// name given before the first zone of the thread
+	text_buffer PendingName{};
+
+	~buffer_holder() {
+		if (Buffer) {
+			Buffer->Abandoned.store(true, std::memory_order_release);
+		}
+	}
+};
+}	 // namespace
+
+static collector_state& GetCollector() {
+	static collector_state* Collector = new collector_state{};
+	return *Collector;
+}
+
+static thread_local buffer_holder Holder;
+
+static void Append(text_buffer& Buffer, str_view Text) {
+	std::memcpy(Buffer.AppendUninitialized(Text.GetSize()).GetData(), Text.GetData(), Text.GetSize());
+}
+
+// collector lock has to be held
+static void CollectLocked(collector_state& Collector) {
+	zone_event Batch[256];
+	for (thread_buffer* Buffer : Collector.Buffers) {
+		index Count;
+		while ((Count = Buffer->Ring.TryPopBatch(mutable_span<zone_event>{Batch, 256})) > 0) {
+			for (index ZoneIndex = 0; ZoneIndex < Count; ++ZoneIndex) {
+				// zones that began in the previous capture
+				if (Batch[ZoneIndex].BeginNs >= Collector.CaptureBeginNs) {
+					Buffer->Zones.Add(Batch[ZoneIndex]);
+				}
+			}
+		}
+		Collector.Dropped += Buffer->Dropped.exchange(0, std::memory_order_relaxed);
+	}
+}
+
+// collector lock has to be held
+static void ClearLocked(collector_state& Collector) {
+	CollectLocked(Collector);
+	for (index BufferIndex = 0; BufferIndex < Collector.Buffers.GetSize();) {
+		thread_buffer* Buffer = Collector.Buffers[BufferIndex];
+		if (Buffer->Abandoned.load(std::memory_order_acquire)) {
+			delete Buffer;
+			Collector.Buffers.RemoveAt(BufferIndex);
+			continue;
+		}
+		Buffer->Zones.Clear(container_clear_type::dont_deallocate);
+		++BufferIndex;
+	}
+	Collector.FrameMarks.Clear(container_clear_type::dont_deallocate);
+	Collector.Dropped = 0;
+}
+
+static thread_buffer& GetThreadBuffer() {
+	if (!Holder.Buffer) [[unlikely]] {
+		collector_state& Collector = GetCollector();
+		Collector.Lock.Lock();
+		Holder.Buffer = new thread_buffer{Collector.Config.RingSize};
+		Holder.Buffer->ThreadId = Collector.NextThreadId++;
+		Append(Holder.Buffer->Name, str_view{Holder.PendingName.GetData(), Holder.PendingName.GetSize()});
+		Collector.Buffers.Add(Holder.Buffer);
+		Collector.Lock.Unlock();
+	}
+	return *Holder.Buffer;
+}
+
+void internal::Record(const zone_event& Zone) {
+	thread_buffer& Buffer = GetThreadBuffer();
+	if (Buffer.Ring.TryPush(Zone)) [[likely]] {
+		return;
+	}
+	// full ring is collected by its own thread when nobody else is collecting right now
+	collector_state& Collector = GetCollector();
+	if (Collector.Lock.TryLock()) {
+		CollectLocked(Collector);
+		Collector.Lock.Unlock();
+		if (Buffer.Ring.TryPush(Zone)) {
+			return;
+		}
+	}
+	Buffer.Dropped.fetch_add(1, std::memory_order_relaxed);
+}
+}	 // namespace profiler
+
+void profiler::StartCapture(const capture_config& Config) {
+	collector_state& Collector = GetCollector();
+	Collector.Lock.Lock();
+	ClearLocked(Collector);
+	// rings of existing threads keep their size
+	Collector.Config = Config;
+	Collector.CaptureBeginNs = internal::GetNs();
+	internal::Capturing.store(true, std::memory_order_relaxed);
+	Collector.Lock.Unlock();
+}
+
+void profiler::StopCapture() {
+	internal::Capturing.store(false, std::memory_order_relaxed);
+	collector_state& Collector = GetCollector();
+	Collector.Lock.Lock();
+	CollectLocked(Collector);
+	Collector.Lock.Unlock();
+}
+
+bool profiler::IsCapturing() {
+	return internal::Capturing.load(std::memory_order_relaxed);
+}
+
+void profiler::SetThreadName(str_view Name) {
+	if (!Holder.Buffer) {
+		Holder.PendingName.Clear(container_clear_type::dont_deallocate);
+		Append(Holder.PendingName, Name);
+		return;
+	}
+	collector_state& Collector = GetCollector();
+	Collector.Lock.Lock();
+	Holder.Buffer->Name.Clear(container_clear_type::dont_deallocate);
+	Append(Holder.Buffer->Name, Name);
+	Collector.Lock.Unlock();
+}
+
+void profiler::MarkFrame() {
+	if (!internal::Capturing.load(std::memory_order_relaxed)) {
+		return;
+	}
+	const s64 Now = internal::GetNs();
+	collector_state& Collector = GetCollector();
+	Collector.Lock.Lock();
+	Collector.FrameMarks.Add(Now);
+	CollectLocked(Collector);
+	Collector.Lock.Unlock();
+}
+
+u64 profiler::GetDroppedCount() {
+	collector_state& Collector = GetCollector();
+	Collector.Lock.Lock();
+	CollectLocked(Collector);
+	const u64 Dropped = Collector.Dropped;
+	Collector.Lock.Unlock();
+	return Dropped;
+}
+
+void profiler::GetZones(void (*Visitor)(void* Context, u32 ThreadId, const zone_event& Zone), void* Context) {
+	collector_state& Collector = GetCollector();
+	Collector.Lock.Lock();
+	CollectLocked(Collector);
+	for (thread_buffer* Buffer : Collector.Buffers) {
+		for (const zone_event& Zone : Buffer->Zones) {
+			Visitor(Context, Buffer->ThreadId, Zone);
+		}
+	}
+	Collector.Lock.Unlock();
+}
+
+static void AppendNumber(profiler::text_buffer& Output, u64 Value) {
+	using number_format = strings::default_int_format<u64>;
+	number_format::Write(Output.AppendUninitialized(number_format::GetCharSize(Value)), Value);
+}
+
+// microseconds with nanosecond fraction, trace timestamps are relative to capture start
+static void AppendMicroseconds(profiler::text_buffer& Output, s64 Ns) {
+	const u64 Value = Ns > 0 ? (u64) Ns : 0;
+	AppendNumber(Output, Value / 1000);
+	const u64 Fraction = Value % 1000;
+	char Digits[4] = {'.', char('0' + Fraction / 100), char('0' + Fraction / 10 % 10), char('0' + Fraction % 10)};
+	profiler::Append(Output, str_view{Digits, 4});
+}
+
+static void AppendEscaped(profiler::text_buffer& Output, str_view Text) {
+	for (const char Char : Text) {
+		if (Char == '"' || Char == '\\') {
+			Output.Add('\\');
+		}
+		Output.Add(Char >= ' ' ? Char : ' ');
+	}
+}
+
+static void AppendThreadName(profiler::text_buffer& Output, u32 ThreadId, str_view Name) {
+	profiler::Append(Output, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":");
+	AppendNumber(Output, ThreadId);
+	profiler::Append(Output, ",\"args\":{\"name\":\"");
+	AppendEscaped(Output, Name);
+	profiler::Append(Output, "\"}}");
+}
+
+static void AppendComplete(profiler::text_buffer& Output, u32 ThreadId, str_view Name, s64 BeginNs, s64 EndNs) {
+	profiler::Append(Output, ",\n{\"name\":\"");
+	AppendEscaped(Output, Name);
+	profiler::Append(Output, "\",\"ph\":\"X\",\"pid\":1,\"tid\":");
+	AppendNumber(Output, ThreadId);
+	profiler::Append(Output, ",\"ts\":");
+	AppendMicroseconds(Output, BeginNs);
+	profiler::Append(Output, ",\"dur\":");
+	AppendMicroseconds(Output, EndNs - BeginNs);
+	profiler::Append(Output, "}");
+}
+
+bool profiler::WriteChromeTrace(str_view Path) {
+	text_buffer FilePath;
+	Append(FilePath, Path);
+	FilePath.Add('\0');
+	std::FILE* File = std::fopen(FilePath.GetData(), "wb");
+	if (!File) {
+		return false;
+	}
+	text_buffer Output;
+	bool Written = true;
+	collector_state& Collector = GetCollector();
+	Collector.Lock.Lock();
+	CollectLocked(Collector);
+	const s64 Origin = Collector.CaptureBeginNs;
+	Append(Output, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+	// frames get own track above threads
+	Append(Output, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Scratch\"}}");
+	AppendThreadName(Output, 0, "Frames");
+	for (index FrameIndex = 1; FrameIndex < Collector.FrameMarks.GetSize(); ++FrameIndex) {
+		AppendComplete(
+			Output,
+			0,
+			"Frame",
+			Collector.FrameMarks[FrameIndex - 1] - Origin,
+			Collector.FrameMarks[FrameIndex] - Origin);
+	}
+	for (thread_buffer* Buffer : Collector.Buffers) {
+		if (Buffer->Name.GetSize() > 0) {
+			AppendThreadName(Output, Buffer->ThreadId, str_view{Buffer->Name.GetData(), Buffer->Name.GetSize()});
+		}
+		for (const zone_event& Zone : Buffer->Zones) {
+			AppendComplete(Output, Buffer->ThreadId, Zone.Name, Zone.BeginNs - Origin, Zone.EndNs - Origin);
+			// keeps memory of the text bounded for long captures
+			if (Output.GetSize() > 1024 * 1024) {
+				Written = Written && std::fwrite(Output.GetData(), 1, Output.GetSize(), File) == Output.GetSize();
+				Output.Clear(container_clear_type::dont_deallocate);
+			}
+		}
+	}
+	Collector.Lock.Unlock();
+	Append(Output, "\n]}\n");
+	Written = Written && std::fwrite(Output.GetData(), 1, Output.GetSize(), File) == Output.GetSize();
+	return std::fclose(File) == 0 && Written;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "basic.h"
+#include "String/str.h"
+#include "Time/cycle_clock.h"
+
+#include <atomic>
+
+// Instrumentation profiler. PROFILE_SCOPE("name") records begin and end time of the enclosing scope into a lock-free
+// ring of the calling thread while capture is running, otherwise it costs a load and a branch. Rings are collected
+// on every MarkFrame(), when a ring gets full and on export. Zones nest by time, depth is kept for hierarchical
+// views. Export is Chrome trace JSON, which chrome://tracing and ui.perfetto.dev open.
+//
+//	profiler::StartCapture();
+//	...
+//	profiler::StopCapture();
+//	profiler::WriteChromeTrace("trace.json");
+namespace profiler {
+struct zone_event {
+	// string literal, zones keep the pointer
+	const char* Name;
+	s64 BeginNs;
+	s64 EndNs;
+	// zones of the same thread open around this one
+	u32 Depth;
+};
+
+struct capture_config {
+	// zones per thread between two collections, rounded up to power of 2, zones that don't fit are dropped
+	index RingSize{64 * 1024};
+};
+
+// drops previously collected zones
+void StartCapture(const capture_config& Config = {});
+
+// collects what was recorded, zones that began before the call are still recorded when they end
+void StopCapture();
+
+[[nodiscard]] bool IsCapturing();
+
+// shown as track name, can be called before capture starts
+void SetThreadName(str_view Name);
+
+// end of one frame and start of the next, collects rings of all threads
+void MarkFrame();
+
+// zones of the last capture (or of the running one so far), false when file can't be written
+bool WriteChromeTrace(str_view Path);
+
+// zones that didn't fit into full rings during the last capture
+[[nodiscard]] u64 GetDroppedCount();
+
+// collected zones of every thread, ordered by thread then by end time
+void GetZones(void (*Visitor)(void* Context, u32 ThreadId, const zone_event& Zone), void* Context);
+
+namespace internal {
+inline std::atomic<bool> Capturing{false};
+
+inline thread_local u32 Depth{0};
+
+[[nodiscard]] FORCEINLINE s64 GetNs() {
+	return cycle_clock::GetNs();
+}
+
+void Record(const zone_event& Zone);
+}	 // namespace internal
+
+struct scope {
+	const char* Name{nullptr};
+	s64 BeginNs{0};
+
+	FORCEINLINE explicit scope(const char* InName) {
+		if (internal::Capturing.load(std::memory_order_relaxed)) [[unlikely]] {
+			Name = InName;
+			++internal::Depth;
+			BeginNs = internal::GetNs();
+		}
+	}
+
+	FORCEINLINE ~scope() {
+		if (Name) [[unlikely]] {
+			const s64 EndNs = internal::GetNs();
+			--internal::Depth;
+			internal::Record(zone_event{Name, BeginNs, EndNs, internal::Depth});
+		}
+	}
+
+	scope(const scope&) = delete;
+	scope& operator=(const scope&) = delete;
+};
+}	 // namespace profiler
+
+#define PROFILE_CONCAT_INNER(Left, Right) Left##Right
+#define PROFILE_CONCAT(Left, Right) PROFILE_CONCAT_INNER(Left, Right)
+#define PROFILE_SCOPE(Name) const profiler::scope PROFILE_CONCAT(ProfileScope, __LINE__){Name}
@@ -1,17 +1,172 @@
 #include "atom.h"
 
-static bool PoolInitialized;
+#include <cstring>
+#include <new>
+
+// Global pool is never destroyed, atoms can be converted to strings until the very end of the program
 alignas(atom::atom_pool) static array<u8, sizeof(atom::atom_pool)> PoolBytes;
 
 atom::atom_pool& atom::GetAtomPool() {
-	if (PoolInitialized) {
-		return *(atom_pool*) (&PoolBytes);
+	// initialization of function local static is thread safe
+	static atom_pool* Pool = new (&PoolBytes) atom_pool{};
+	return *Pool;
+}
+
+// slot is hash in high half and index + 1 in low half, so zero is an empty slot
+constexpr u64 EmptySlot = 0;
+constexpr index ShardShift = 32 - 6;
+static_assert((1 << (32 - ShardShift)) == atom::atom_pool::NumShards);
+constexpr u64 InitialShardCapacity = 64;
+
+static u64 MakeSlot(hash::hash_type Hash, index Index) {
+	return ((u64) Hash << 32) | (u64) (Index + 1);
+}
+
+static atom::atom_pool::shard_table* CreateTable(u64 Capacity) {
+	using shard_table = atom::atom_pool::shard_table;
+	// slots are placed right after table header in the same allocation
+	u8* Memory = (u8*) MemoryMalloc(sizeof(shard_table) + Capacity * sizeof(std::atomic<u64>));
+	auto* Table = new (Memory) shard_table{};
+	Table->Mask = Capacity - 1;
+	Table->Slots = reinterpret_cast<std::atomic<u64>*>(Memory + sizeof(shard_table));
+	for (u64 Slot = 0; Slot < Capacity; ++Slot) {
+		new (&Table->Slots[Slot]) std::atomic<u64>(EmptySlot);
+	}
+	return Table;
+}
+
+// lock-free, slots are published with release after their entry is written
+static index Probe(
+	const atom::atom_pool& Pool, const atom::atom_pool::shard_table* Table, hash::hash_type Hash, str_view Str) {
+	for (u64 Position = Hash & Table->Mask;; Position = (Position + 1) & Table->Mask) {
+		const u64 Slot = Table->Slots[Position].load(std::memory_order_acquire);
+		if (Slot == EmptySlot) {
+			return InvalidIndex;
+		}
+		if ((hash::hash_type) (Slot >> 32) == Hash) {
+			const index Index = (index) Slot - 1;
+			const atom::atom_pool::entry& Entry = Pool.GetEntry(Index);
+			if (Entry.Length == Str.GetSize() && std::memcmp(Entry.Data, Str.GetData(), Str.GetSize()) == 0) {
+				return Index;
+			}
+		}
+	}
+}
+
+static void InsertSlot(atom::atom_pool::shard_table* Table, u64 Slot) {
+	u64 Position = (Slot >> 32) & Table->Mask;
+	while (Table->Slots[Position].load(std::memory_order_relaxed) != EmptySlot) {
+		Position = (Position + 1) & Table->Mask;
+	}
+	Table->Slots[Position].store(Slot, std::memory_order_release);
+}
+
+// under shard lock, readers keep probing old table until they see the new one
+static atom::atom_pool::shard_table* GrowShard(atom::atom_pool::shard& Shard) {
+	atom::atom_pool::shard_table* OldTable = Shard.Table.load(std::memory_order_relaxed);
+	const u64 NewCapacity = OldTable ? (OldTable->Mask + 1) * 2 : InitialShardCapacity;
+	atom::atom_pool::shard_table* NewTable = CreateTable(NewCapacity);
+	if (OldTable) {
+		for (u64 Position = 0; Position <= OldTable->Mask; ++Position) {
+			const u64 Slot = OldTable->Slots[Position].load(std::memory_order_relaxed);
+			if (Slot != EmptySlot) {
+				InsertSlot(NewTable, Slot);
+			}
+		}
+		Shard.Allocations.Add(OldTable);
+	}
+	Shard.Table.store(NewTable, std::memory_order_release);
+	return NewTable;
+}
+
+// under shard lock, small strings are bump allocated from shard chunk, big ones get their own allocation
+static const char* CopyString(atom::atom_pool::shard& Shard, str_view Str) {
+	using atom_pool = atom::atom_pool;
+	const index Size = Str.GetSize() + 1;
+	char* Data;
+	if (Size > atom_pool::ChunkSize / 4) {
+		Data = (char*) MemoryMalloc(Size);
+		Shard.Allocations.Add(Data);
+	} else {
+		if (!Shard.Chunk || Shard.ChunkUsed + Size > atom_pool::ChunkSize) {
+			Shard.Chunk = (char*) MemoryMalloc(atom_pool::ChunkSize);
+			Shard.ChunkUsed = 0;
+			Shard.Allocations.Add(Shard.Chunk);
+		}
+		Data = Shard.Chunk + Shard.ChunkUsed;
+		Shard.ChunkUsed += Size;
+	}
+	std::memcpy(Data, Str.GetData(), Str.GetSize());
+	Data[Str.GetSize()] = '\0';
+	return Data;
+}
+
+// segments are shared by all shards, first thread that needs one installs it
+static atom::atom_pool::entry* EnsureSegment(std::atomic<atom::atom_pool::entry*>& Segment) {
+	using entry = atom::atom_pool::entry;
+	entry* Existing = Segment.load(std::memory_order_acquire);
+	if (Existing) {
+		return Existing;
+	}
+	auto* NewSegment = (entry*) MemoryMalloc(atom::atom_pool::SegmentSize * sizeof(entry));
+	for (index Entry = 0; Entry < atom::atom_pool::SegmentSize; ++Entry) {
+		new (&NewSegment[Entry]) entry{};
+	}
+	if (Segment.compare_exchange_strong(Existing, NewSegment, std::memory_order_acq_rel, std::memory_order_acquire)) {
+		return NewSegment;
+	}
+	MemoryFree(NewSegment);
+	return Existing;
+}
+
+index atom::atom_pool::Intern(str_view Str) {
+	const hash::hash_type Hash = hash::Hash(Str);
+	shard& Shard = Shards[Hash >> ShardShift];
+	if (const shard_table* Table = Shard.Table.load(std::memory_order_acquire)) {
+		const index Existing = Probe(*this, Table, Hash, Str);
+		if (Existing != InvalidIndex) {
+			return Existing;
+		}
+	}
+	Shard.Lock.Lock();
+	// another thread may have added the same string while we were waiting for the lock
+	shard_table* Table = Shard.Table.load(std::memory_order_relaxed);
+	if (Table) {
+		const index Existing = Probe(*this, Table, Hash, Str);
+		if (Existing != InvalidIndex) {
+			Shard.Lock.Unlock();
+			return Existing;
+		}
+	}
+	// load factor is kept at or below 1/2
+	if (!Table || (Shard.Count + 1) * 2 > Table->Mask + 1) {
+		Table = GrowShard(Shard);
 	}
-	atom_pool* Singleton = new (&PoolBytes) atom_pool{};
-	PoolInitialized = true;
-	return *Singleton;
+	const index Index = NextIndex.fetch_add(1, std::memory_order_relaxed);
+	CHECK(Index < MaxSegments * SegmentSize)
+	entry* Segment = EnsureSegment(Segments[Index >> SegmentSizeLog]);
+	Segment[Index & (SegmentSize - 1)] = entry{CopyString(Shard, Str), Str.GetSize()};
+	InsertSlot(Table, MakeSlot(Hash, Index));
+	++Shard.Count;
+	Shard.Lock.Unlock();
+	return Index;
 }
 
-hash::hash_type atom::atom_pool::index_hasher::Hash(index Index) {
-	return hash::Hash((*(atom_pool*) (&PoolBytes)).Strings[Index]);
+index atom::atom_pool::Find(str_view Str) const {
+	const hash::hash_type Hash = hash::Hash(Str);
+	const shard& Shard = Shards[Hash >> ShardShift];
+	const shard_table* Table = Shard.Table.load(std::memory_order_acquire);
+	return Table ? Probe(*this, Table, Hash, Str) : InvalidIndex;
+}
+
+atom::atom_pool::~atom_pool() {
+	for (shard& Shard : Shards) {
+		MemoryFree(Shard.Table.load(std::memory_order_relaxed));
+		for (void* Allocation : Shard.Allocations) {
+			MemoryFree(Allocation);
+		}
+	}
+	for (std::atomic<entry*>& Segment : Segments) {
+		MemoryFree(Segment.load(std::memory_order_relaxed));
+	}
 }
@@ -2,24 +2,76 @@
 
 #include "basic.h"
 #include "String/str.h"
+#include "Concurrency/mutex.h"
 #include "Containers/array.h"
+#include "Containers/dyn_array.h"
 #include "Containers/hash_table.h"
 #include "Hash/hash.h"
+#include "Memory/allocator_base.h"
+
+#include <atomic>
 
 // Number that corresponds to a string (str). Can be created from any str and converted back to str.
-// Optimal for copying and comparison, creation from string is a big table lookup
+// Optimal for copying and comparison, creation from string is a big table lookup.
+// Atoms can be created and converted from any thread, lookups of existing atoms don't take locks.
 struct atom {
+	// Strings are copied into chunked arena and never move or get freed, so views returned by ToStr() stay valid.
+	// Index -> string entries live in fixed size segments that are allocated on demand and never move either.
+	// Lookup table is split into shards by hash, every shard is an open addressing table of atomic slots
+	// (hash and index packed together) that is read without locks and written under shard mutex.
+	// Growing shard publishes new table and keeps the old one alive for readers that may still probe it.
 	struct atom_pool {
-		struct index_hasher {
-			static hash::hash_type Hash(index Index);
+		struct entry {
+			const char* Data{nullptr};
+			index Length{0};
+		};
+
+		struct shard_table {
+			u64 Mask{0};
+			std::atomic<u64>* Slots{nullptr};
 		};
 
-		// NOTE: This is redundant but Clang wants it really bad
-		atom_pool() : Strings{}, IndexLookupSet{} {
+		struct alignas(CacheLineSize) shard {
+			std::atomic<shard_table*> Table{nullptr};
+			index Count{0};
+			mutex Lock{};
+			// current arena chunk of this shard, strings of different shards never share chunks
+			char* Chunk{nullptr};
+			index ChunkUsed{0};
+			// arena chunks and tables replaced by growth, released with the pool
+			dyn_array<void*, malloc_allocator> Allocations{};
+		};
+
+		constexpr static index NumShards = 64;
+		constexpr static index SegmentSizeLog = 12;
+		constexpr static index SegmentSize = 1 << SegmentSizeLog;
+		constexpr static index MaxSegments = 1 << 12;
+		constexpr static index ChunkSize = 16 * 1024;
+
+		std::atomic<entry*> Segments[MaxSegments]{};
+		alignas(CacheLineSize) std::atomic<index> NextIndex{0};
+		shard Shards[NumShards]{};
+
+		atom_pool() = default;
+		~atom_pool();
+		atom_pool(const atom_pool&) = delete;
+		atom_pool& operator=(const atom_pool&) = delete;
+
+		// returns index of existing or new atom
+		index Intern(str_view Str);
+
+		// returns InvalidIndex if atom for the string was never created
+		[[nodiscard]] index Find(str_view Str) const;
+
+		// number of atoms created so far
+		[[nodiscard]] FORCEINLINE index GetSize() const {
+			return NextIndex.load(std::memory_order_acquire);
 		}
 
-		dyn_array<str> Strings{};
-		hash_set<index, index_hasher> IndexLookupSet{};
+		// index has to come from Intern(), directly or through another thread that synchronized with it
+		[[nodiscard]] FORCEINLINE const entry& GetEntry(index Index) const {
+			return Segments[Index >> SegmentSizeLog].load(std::memory_order_acquire)[Index & (SegmentSize - 1)];
+		}
 	};
 
 	static constexpr bool MemcopyRelocatable = true;
@@ -32,21 +84,15 @@ struct atom {
 	FORCEINLINE atom(const atom& OtherId) = default;
 	FORCEINLINE atom& operator=(const atom& OtherId) = default;
 
-	FORCEINLINE explicit atom(str_view Str) {
-		auto& Pool = GetAtomPool();
-		if (auto* ExistingIndex = Pool.IndexLookupSet.FindByPredicate(
-				hash::Hash(Str), [&Pool, Str](auto& Index) { return Pool.Strings[Index] == Str; })) {
-			Index = *ExistingIndex;
-		} else {
-			Index = Pool.Strings.Emplace(Str);
-			Pool.IndexLookupSet.Add(Index);
-		}
+	FORCEINLINE explicit atom(str_view Str) : Index{GetAtomPool().Intern(Str)} {
 	}
 
-	[[nodiscard]] FORCEINLINE const str& ToStr() const {
-		auto& Strings = GetAtomPool().Strings;
-		CHECK(Strings.GetSize() > Index)
-		return Strings[Index];
+	// view is null terminated and valid until program exit
+	[[nodiscard]] FORCEINLINE str_view ToStr() const {
+		auto& Pool = GetAtomPool();
+		CHECK(Pool.GetSize() > Index)
+		const atom_pool::entry& Entry = Pool.GetEntry(Index);
+		return str_view{Entry.Data, Entry.Length};
 	}
 
 	[[nodiscard]] FORCEINLINE bool IsEmpty() const {
@@ -177,6 +177,35 @@ struct default_timestamp_format {
 	}
 };
 
+// Same output as default_timestamp_format, but calendar math and formatting of "DD-MM-YYYY hh:mm:ss." only run
+// when second changes, otherwise it is a copy and three digits. Keeps state, every formatting thread needs its own
+struct cached_timestamp_format {
+	constexpr static index PrefixSize = 20;
+
+	s64 CachedSecond{-1};
+	char Prefix[PrefixSize]{};
+
+	static constexpr index GetCharSize(timestamp Value) {
+		return default_timestamp_format::GetCharSize(Value);
+	}
+
+	FORCEINLINE void Write(mutable_str_view Destination, timestamp Value) {
+		CHECK(Destination.GetSize() >= 23)
+		const s64 Second = Value.Ticks / timestamp::TicksPerSecond;
+		if (Second != CachedSecond) [[unlikely]] {
+			char Full[23];
+			default_timestamp_format::Write(mutable_str_view{Full, 23}, Value);
+			CopyChars(Prefix, Full, PrefixSize);
+			CachedSecond = Second;
+		}
+		CopyChars(Destination.GetData(), Prefix, PrefixSize);
+		const s64 Millisecond = Value.GetMillisecond();
+		Destination[20] = (char) ('0' + Millisecond / 100);
+		Destination[21] = (char) ('0' + Millisecond / 10 % 10);
+		Destination[22] = (char) ('0' + Millisecond % 10);
+	}
+};
+
 FORCEINLINE constexpr static index GetByteLength(str_view String);
 
 FORCEINLINE constexpr bool IsSpace(char Character);
@@ -87,4 +87,213 @@ FORCEINLINE constexpr index WriteFormat(
 	return WriteFormat(Destination, String, ArgumentArray);
 }
 
+
+namespace internal {
+// literal text between placeholders, offset into format string
+struct format_segment {
+	index Begin{0};
+	index Size{0};
+};
+
+// not constexpr, calling it from consteval format_string constructor makes the error show up at compile time
+inline void FormatStringPlaceholderCountDoesNotMatchArguments() {
+}
+
+// arguments are converted once, length and writing of floats would otherwise both run float to decimal conversion
+template <format_supported argument_type>
+FORCEINLINE constexpr auto PrepareArgument(const argument_type& Argument) {
+	if constexpr (std::convertible_to<const argument_type&, str_view>) {
+		return str_view{Argument};
+	} else if constexpr (fractional<argument_type>) {
+		return math::CalcFloatParts(Argument);
+	} else if constexpr (pointer<argument_type>) {
+		return (void*) Argument;
+	} else if constexpr (std::same_as<argument_type, bool>) {
+		return Argument;
+	} else if constexpr (std::is_signed_v<argument_type>) {
+		// widened like in format_argument, Abs() of smallest narrow value would overflow
+		return (s64) Argument;
+	} else {
+		return (u64) Argument;
+	}
+}
+
+FORCEINLINE constexpr index GetArgumentSize(str_view Argument) {
+	return Argument.GetSize();
+}
+
+FORCEINLINE constexpr index GetArgumentSize(bool Argument) {
+	return default_bool_format::GetCharSize(Argument);
+}
+
+template <integral integral_type>
+FORCEINLINE constexpr index GetArgumentSize(integral_type Argument) {
+	return default_int_format<integral_type>::GetCharSize(Argument);
+}
+
+FORCEINLINE constexpr index GetArgumentSize(const math::decimal_parts& Argument) {
+	return default_float_format::GetCharSize(Argument);
+}
+
+FORCEINLINE constexpr index GetArgumentSize(void* Argument) {
+	return default_pointer_format::GetCharSize(Argument);
+}
+
+FORCEINLINE constexpr void WriteArgument(char* Destination, index Size, str_view Argument) {
+	CopyChars(Destination, Argument.GetData(), Size);
+}
+
+FORCEINLINE constexpr void WriteArgument(char* Destination, index Size, bool Argument) {
+	default_bool_format::Write(mutable_str_view{Destination, Size}, Argument);
+}
+
+template <integral integral_type>
+FORCEINLINE constexpr void WriteArgument(char* Destination, index Size, integral_type Argument) {
+	default_int_format<integral_type>::Write(mutable_str_view{Destination, Size}, Argument);
+}
+
+FORCEINLINE constexpr void WriteArgument(char* Destination, index Size, const math::decimal_parts& Argument) {
+	default_float_format::Write(mutable_str_view{Destination, Size}, Argument);
+}
+
+FORCEINLINE constexpr void WriteArgument(char* Destination, index Size, void* Argument) {
+	default_pointer_format::Write(mutable_str_view{Destination, Size}, Argument);
+}
+}	 // namespace internal
+
+// Format string split into literal segments at compile time. Placeholders are found the same way as by WriteFormat(),
+// but their count has to match arguments exactly, otherwise it doesn't compile. Constructed implicitly from string
+// literals by FormatCompiled() and friends, which then write segments and arguments without scanning for braces and
+// without format_argument, every argument type gets its own writer.
+template <format_supported... argument_types>
+struct format_string {
+	static constexpr index ArgumentCount = sizeof...(argument_types);
+
+	str_view String{};
+	// Segments[Argument] precedes that argument, the last segment follows all of them
+	internal::format_segment Segments[ArgumentCount + 1]{};
+	index LiteralSize{0};
+
+	template <typename string_type>
+		requires std::convertible_to<const string_type&, str_view>
+	consteval format_string(const string_type& InString)	// NOLINT(*-explicit-constructor)
+		: String{InString} {
+		index PlacedArguments{0};
+		index SegmentBegin{0};
+		index OpeningIndex = FindFirstOf(String, '{');
+		while (OpeningIndex != InvalidIndex) {
+			const str_view RestOfString = GetSubstring(String, OpeningIndex + 1, String.GetSize());
+			const index ClosingIndex = FindFirstOf(RestOfString, '}');
+			if (ClosingIndex == InvalidIndex) {
+				break;
+			}
+			if (PlacedArguments == ArgumentCount) {
+				internal::FormatStringPlaceholderCountDoesNotMatchArguments();
+			}
+			Segments[PlacedArguments] = {SegmentBegin, OpeningIndex - SegmentBegin};
+			LiteralSize += OpeningIndex - SegmentBegin;
+			++PlacedArguments;
+			SegmentBegin = OpeningIndex + 1 + ClosingIndex + 1;
+			const index NextOpening = FindFirstOf(GetSubstring(String, SegmentBegin, String.GetSize()), '{');
+			OpeningIndex = NextOpening == InvalidIndex ? InvalidIndex : SegmentBegin + NextOpening;
+		}
+		if (PlacedArguments != ArgumentCount) {
+			internal::FormatStringPlaceholderCountDoesNotMatchArguments();
+		}
+		Segments[ArgumentCount] = {SegmentBegin, String.GetSize() - SegmentBegin};
+		LiteralSize += String.GetSize() - SegmentBegin;
+	}
+};
+
+// arguments are deduced from the rest of the call, not from format string
+template <format_supported... argument_types>
+using checked_format_string = format_string<std::type_identity_t<argument_types>...>;
+
+namespace internal {
+template <typename format_type, typename... prepared_types, index... ArgumentIndices>
+FORCEINLINE constexpr void WriteSegmentsAndArguments(
+	char* Destination,
+	const format_type& FormatString,
+	const index (&Sizes)[sizeof...(prepared_types) + 1],
+	std::integer_sequence<index, ArgumentIndices...>,
+	const prepared_types&... Arguments) {
+	const char* Source = FormatString.String.GetData();
+	(
+		(CopyChars(
+			 Destination, Source + FormatString.Segments[ArgumentIndices].Begin,
+			 FormatString.Segments[ArgumentIndices].Size),
+		 Destination += FormatString.Segments[ArgumentIndices].Size,
+		 WriteArgument(Destination, Sizes[ArgumentIndices], Arguments),
+		 Destination += Sizes[ArgumentIndices]),
+		...);
+	const format_segment& Last = FormatString.Segments[sizeof...(prepared_types)];
+	CopyChars(Destination, Source + Last.Begin, Last.Size);
+}
+
+template <typename format_type, typename... prepared_types>
+FORCEINLINE constexpr index WriteFormatPrepared(
+	mutable_str_view Destination,
+	const format_type& FormatString,
+	const prepared_types&... Arguments) {
+	// last one is a placeholder, arrays can't be empty
+	const index Sizes[sizeof...(prepared_types) + 1]{GetArgumentSize(Arguments)..., 0};
+	index Length = FormatString.LiteralSize;
+	for (const index Size : Sizes) {
+		Length += Size;
+	}
+	CHECK(Destination.GetSize() >= Length);
+	WriteSegmentsAndArguments(
+		Destination.GetData(),
+		FormatString,
+		Sizes,
+		std::make_integer_sequence<index, sizeof...(prepared_types)>{},
+		Arguments...);
+	return Length;
+}
+}	 // namespace internal
+
+template <format_supported... argument_types>
+FORCEINLINE constexpr index GetFormatLengthCompiled(
+	checked_format_string<argument_types...> FormatString,
+	const argument_types&... Arguments) {
+	return FormatString.LiteralSize + (internal::GetArgumentSize(internal::PrepareArgument(Arguments)) + ... + 0);
+}
+
+template <format_supported... argument_types>
+FORCEINLINE constexpr index WriteFormatCompiled(
+	mutable_str_view Destination,
+	checked_format_string<argument_types...> FormatString,
+	const argument_types&... Arguments) {
+	return internal::WriteFormatPrepared(Destination, FormatString, internal::PrepareArgument(Arguments)...);
+}
+
+namespace internal {
+template <typename format_type, typename... prepared_types>
+FORCEINLINE str FormatPrepared(const format_type& FormatString, const prepared_types&... Arguments) {
+	const index Sizes[sizeof...(prepared_types) + 1]{GetArgumentSize(Arguments)..., 0};
+	index Length = FormatString.LiteralSize;
+	for (const index Size : Sizes) {
+		Length += Size;
+	}
+	str Result{};
+	WriteSegmentsAndArguments(
+		Result.AppendUninitialized(Length).GetData(),
+		FormatString,
+		Sizes,
+		std::make_integer_sequence<index, sizeof...(prepared_types)>{},
+		Arguments...);
+	Result[Length] = 0;
+	return Result;
+}
+}	 // namespace internal
+
+// Format() with format string parsed at compile time
+//
+//	str Message = strings::FormatCompiled("{} of {} done", Done, Total);
+template <format_supported... argument_types>
+FORCEINLINE str FormatCompiled(
+	checked_format_string<argument_types...> FormatString,
+	const argument_types&... Arguments) {
+	return internal::FormatPrepared(FormatString, internal::PrepareArgument(Arguments)...);
+}
 }	 // namespace strings
@@ -33,4 +33,8 @@ concept pointer = std::is_pointer<type>::value || std::is_same_v<type, std::null
 template <typename type>
 concept enumerable = std::is_enum<type>::value;
 template <typename type>
-concept memcopy_relocatable = type::MemcopyRelocatable || trivially_copyable<type>;
\ No newline at end of file
+concept memcopy_relocatable = type::MemcopyRelocatable || trivially_copyable<type>;
+// bytes mean the same at any address and in another process, so no pointers inside, structs have to opt in
+template <typename type>
+concept position_independent =
+	numeric<type> || enumerable<type> || (trivially_copyable<type> && type::PositionIndependent);
\ No newline at end of file
@@ -0,0 +1,124 @@
+#include "cycle_clock.h"
+#include "Concurrency/mutex.h"
+
+#include <thread>
+
+#if CYCLE_CLOCK_HAS_TSC && !defined(_MSC_VER)
+#include <cpuid.h>
+#endif
+
+namespace cycle_clock {
+constexpr s64 CalibrationNs = 20'000'000;
+// rates outside of this are treated as broken counter
+constexpr double MinFrequency = 1e8;
+constexpr double MaxFrequency = 1e11;
+
+static mutex CalibrationLock;
+
+// CPUID leaf 0x80000007, EDX bit 8: counter runs at constant rate in every power state
+static bool HasInvariantCounter() {
+#if CYCLE_CLOCK_HAS_TSC
+#if defined(_MSC_VER)
+	int Registers[4];
+	__cpuid(Registers, (int) 0x80000000);
+	if ((u32) Registers[0] < 0x80000007u) {
+		return false;
+	}
+	__cpuid(Registers, (int) 0x80000007);
+	return (Registers[3] & (1 << 8)) != 0;
+#else
+	u32 Eax, Ebx, Ecx, Edx;
+	// checks highest supported extended leaf first
+	if (!__get_cpuid(0x80000007u, &Eax, &Ebx, &Ecx, &Edx)) {
+		return false;
+	}
+	return (Edx & (1u << 8)) != 0;
+#endif
+#else
+	return false;
+#endif
+}
+
+struct clock_pair {
+	u64 Cycles;
+	s64 Ns;
+};
+
+// steady_clock reading with counter value taken at the same moment, the tightest of a few attempts
+static clock_pair ReadPair() {
+	clock_pair Best{0, 0};
+	u64 BestWidth = ~0ull;
+	for (u32 Attempt = 0; Attempt < 8; ++Attempt) {
+		const u64 Before = ReadCyclesOrdered();
+		const s64 Ns = internal::GetSteadyNs();
+		const u64 After = ReadCyclesOrdered();
+		if (After - Before < BestWidth) {
+			BestWidth = After - Before;
+			Best = clock_pair{Before + (After - Before) / 2, Ns};
+		}
+	}
+	return Best;
+}
+
+static void Calibrate() {
+	using namespace internal;
+	CalibrationLock.Lock();
+	if (Calibration.Source.load(std::memory_order_relaxed) != source::uncalibrated) {
+		CalibrationLock.Unlock();
+		return;
+	}
+	source Source = source::steady_clock;
+	// without counter ReadCycles() returns steady_clock nanoseconds
+	Calibration.NsPerCycle = 1ull << 32;
+	if (CYCLE_CLOCK_HAS_TSC) {
+		// rate is measured even when counter isn't invariant, CyclesToNs() of short intervals is still useful
+		const clock_pair Begin = ReadPair();
+		while (internal::GetSteadyNs() - Begin.Ns < CalibrationNs) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		const clock_pair End = ReadPair();
+		const double Cycles = (double) (End.Cycles - Begin.Cycles);
+		const double Ns = (double) (End.Ns - Begin.Ns);
+		const double Frequency = Cycles * 1e9 / Ns;
+		if (End.Cycles > Begin.Cycles && Frequency >= MinFrequency && Frequency <= MaxFrequency) {
+			Calibration.NsPerCycle = (u64) (Ns / Cycles * 4294967296.0);
+			Calibration.BaseCycles = End.Cycles;
+			Calibration.BaseNs = End.Ns;
+			if (HasInvariantCounter()) {
+				Source = source::counter;
+			}
+		}
+	}
+	Calibration.Source.store(Source, std::memory_order_release);
+	CalibrationLock.Unlock();
+}
+}	 // namespace cycle_clock
+
+s64 cycle_clock::internal::GetNsSlow() {
+	if (Calibration.Source.load(std::memory_order_acquire) == source::uncalibrated) {
+		Calibrate();
+		if (Calibration.Source.load(std::memory_order_acquire) == source::counter) {
+			return GetNs();
+		}
+	}
+	return GetSteadyNs();
+}
+
+cycle_clock::source cycle_clock::GetSource() {
+	if (internal::Calibration.Source.load(std::memory_order_acquire) == source::uncalibrated) {
+		Calibrate();
+	}
+	return internal::Calibration.Source.load(std::memory_order_acquire);
+}
+
+u64 cycle_clock::GetFrequency() {
+	(void) GetSource();
+	return (u64) (4294967296.0 * 1e9 / (double) internal::Calibration.NsPerCycle);
+}
+
+s64 cycle_clock::CyclesToNs(s64 Cycles) {
+	(void) GetSource();
+	const u64 NsPerCycle = internal::Calibration.NsPerCycle;
+	return Cycles >= 0 ? (s64) internal::MultiplyFixed((u64) Cycles, NsPerCycle)
+					   : -(s64) internal::MultiplyFixed((u64) -Cycles, NsPerCycle);
+}
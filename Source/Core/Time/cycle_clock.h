@@ -0,0 +1,100 @@
+#pragma once
+
+#include "basic.h"
+
+#include <atomic>
+#include <chrono>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define CYCLE_CLOCK_HAS_TSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CYCLE_CLOCK_HAS_TSC 1
+#else
+#define CYCLE_CLOCK_HAS_TSC 0
+#endif
+
+// Nanosecond clock for intervals: profiler zones, timers, frame times. Reads CPU timestamp counter, calibrated once
+// against steady_clock (CLOCK_MONOTONIC on Linux, QueryPerformanceCounter on Windows) by the first call, which takes
+// about 20 ms. When the counter is not invariant (its rate follows frequency scaling or it stops in sleep states)
+// or there is none, steady_clock is read instead. Nanoseconds count from unspecified start and are comparable
+// between threads.
+namespace cycle_clock {
+enum class source : u8 { uncalibrated, counter, steady_clock };
+
+namespace internal {
+// written once before Source is published
+struct calibration {
+	std::atomic<source> Source{source::uncalibrated};
+	// nanoseconds per cycle, 32.32 fixed point
+	u64 NsPerCycle{0};
+	u64 BaseCycles{0};
+	s64 BaseNs{0};
+};
+
+inline calibration Calibration;
+
+// calibrates on first call, reads steady_clock when counter is not used
+s64 GetNsSlow();
+
+[[nodiscard]] FORCEINLINE s64 GetSteadyNs() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			   std::chrono::steady_clock::now().time_since_epoch())
+		.count();
+}
+
+// (Value * Fixed) >> 32 without overflow
+[[nodiscard]] FORCEINLINE u64 MultiplyFixed(u64 Value, u64 Fixed) {
+#if defined(_MSC_VER) && defined(_M_X64)
+	u64 High;
+	const u64 Low = _umul128(Value, Fixed, &High);
+	return (High << 32) | (Low >> 32);
+#elif defined(__SIZEOF_INT128__)
+	return (u64) (((unsigned __int128) Value * Fixed) >> 32);
+#else
+	const u64 Low = (Value & 0xFFFFFFFFull) * Fixed;
+	return (Value >> 32) * Fixed + (Low >> 32);
+#endif
+}
+}	 // namespace internal
+
+// raw counter (steady_clock nanoseconds where there is none), may be reordered with surrounding instructions
+[[nodiscard]] FORCEINLINE u64 ReadCycles() {
+#if CYCLE_CLOCK_HAS_TSC
+	return __rdtsc();
+#else
+	return (u64) internal::GetSteadyNs();
+#endif
+}
+
+// waits until previous instructions are done, for the end of a measured region
+[[nodiscard]] FORCEINLINE u64 ReadCyclesOrdered() {
+#if CYCLE_CLOCK_HAS_TSC
+	u32 Processor;
+	return __rdtscp(&Processor);
+#else
+	return (u64) internal::GetSteadyNs();
+#endif
+}
+
+[[nodiscard]] FORCEINLINE s64 GetNs() {
+	using namespace internal;
+	if (Calibration.Source.load(std::memory_order_acquire) == source::counter) [[likely]] {
+		// counter read before calibration finished on another core may be a little behind the base
+		const s64 Cycles = (s64) (ReadCycles() - Calibration.BaseCycles);
+		return Cycles >= 0 ? Calibration.BaseNs + (s64) MultiplyFixed((u64) Cycles, Calibration.NsPerCycle)
+						   : Calibration.BaseNs - (s64) MultiplyFixed((u64) -Cycles, Calibration.NsPerCycle);
+	}
+	return GetNsSlow();
+}
+
+// what the clock reads, calibrates if needed
+[[nodiscard]] source GetSource();
+
+// measured counter cycles per second, also when counter is not invariant
+[[nodiscard]] u64 GetFrequency();
+
+// converts difference of two ReadCycles() values, only meaningful for short intervals when counter is not invariant
+[[nodiscard]] s64 CyclesToNs(s64 Cycles);
+}	 // namespace cycle_clock
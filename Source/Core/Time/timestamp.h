@@ -152,7 +152,7 @@ struct timezone {
 	constexpr explicit timezone(s64 InTickDiff) : TickDiff{InTickDiff} {
 	}
 
-	timestamp Apply(timestamp Timestamp) {
+	constexpr timestamp Apply(timestamp Timestamp) const {
 		return timestamp{Timestamp.Ticks - TickDiff};
 	}
 };
@@ -0,0 +1,55 @@
+#include "wall_clock.h"
+#include "Application/Platform/platform.h"
+#include "Concurrency/mutex.h"
+#include "Math/math.h"
+
+namespace wall_clock {
+// first rate measurement waits for this much platform time, until then every call reads platform time
+constexpr s64 MinCalibrationTicks = 10 * timestamp::TicksPerMillisecond;
+// longer gaps are not measured, clock could have been adjusted in between
+constexpr s64 MaxCalibrationTicks = 10 * timestamp::TicksPerSecond;
+
+static mutex ResyncLock;
+// last platform reading and counter value taken with it, guarded by ResyncLock
+static s64 AnchorTicks{0};
+static u64 AnchorCycles{0};
+
+timestamp internal::Resync() {
+	if (!ResyncLock.TryLock()) {
+		// somebody else is resyncing right now
+		return platform::GetUTC();
+	}
+	const u64 Before = ReadCycles();
+	const timestamp Now = platform::GetUTC();
+	const u64 NowCycles = Before + (ReadCycles() - Before) / 2;
+
+	u64 TicksPerCycle = Calibration.TicksPerCycle.load(std::memory_order_relaxed);
+	const s64 ElapsedTicks = Now.Ticks - AnchorTicks;
+	if (AnchorCycles == 0 || NowCycles <= AnchorCycles || ElapsedTicks < 0 || ElapsedTicks > MaxCalibrationTicks) {
+		AnchorTicks = Now.Ticks;
+		AnchorCycles = NowCycles;
+	} else if (ElapsedTicks >= MinCalibrationTicks) {
+		const double Rate = (double) ElapsedTicks / (double) (NowCycles - AnchorCycles);
+		TicksPerCycle = (u64) (Rate * 4294967296.0);
+		AnchorTicks = Now.Ticks;
+		AnchorCycles = NowCycles;
+	}
+	// until rate is known every call comes here
+	u64 ResyncCycles = NowCycles;
+	if (TicksPerCycle > 0) {
+		ResyncCycles += ((u64) timestamp::TicksPerSecond << 32) / TicksPerCycle;
+	}
+
+	const u32 Sequence = Calibration.Sequence.load(std::memory_order_relaxed);
+	Calibration.Sequence.store(Sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	Calibration.BaseTicks.store(Now.Ticks, std::memory_order_relaxed);
+	Calibration.BaseCycles.store(NowCycles, std::memory_order_relaxed);
+	Calibration.TicksPerCycle.store(TicksPerCycle, std::memory_order_relaxed);
+	Calibration.ResyncCycles.store(math::Max(ResyncCycles, (u64) 1), std::memory_order_relaxed);
+	Calibration.TimezoneTicks.store(platform::GetTimezone().TickDiff, std::memory_order_relaxed);
+	Calibration.Sequence.store(Sequence + 2, std::memory_order_release);
+	ResyncLock.Unlock();
+	return Now;
+}
+}	 // namespace wall_clock
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "basic.h"
+#include "Time/cycle_clock.h"
+#include "Time/timestamp.h"
+
+#include <atomic>
+
+// Wall clock for timestamps taken at high frequency, e.g. one per log line. Platform UTC time and timezone are read
+// about once per second, in between UTC time is extrapolated from CPU timestamp counter (steady_clock where there is
+// none), which costs a few nanoseconds instead of a system call. Counter rate is measured against platform time at
+// every resync, so extrapolated time can step by a few microseconds when resync corrects it.
+namespace wall_clock {
+namespace internal {
+// Seqlock protected snapshot of the last resync, odd sequence means it is being written
+struct calibration {
+	std::atomic<u32> Sequence{0};
+	std::atomic<s64> BaseTicks{0};
+	std::atomic<u64> BaseCycles{0};
+	// timestamp ticks per counter cycle, 32.32 fixed point, 0 until rate is measured
+	std::atomic<u64> TicksPerCycle{0};
+	std::atomic<u64> ResyncCycles{0};
+	std::atomic<s64> TimezoneTicks{0};
+};
+
+inline calibration Calibration;
+
+FORCEINLINE u64 ReadCycles() {
+	return cycle_clock::ReadCycles();
+}
+
+// reads platform time, measures counter rate and publishes new snapshot
+timestamp Resync();
+}	 // namespace internal
+
+[[nodiscard]] FORCEINLINE timestamp GetUTC() {
+	using namespace internal;
+	const u64 Cycles = ReadCycles();
+	u32 Sequence;
+	s64 BaseTicks;
+	u64 BaseCycles;
+	u64 TicksPerCycle;
+	u64 ResyncCycles;
+	do {
+		Sequence = Calibration.Sequence.load(std::memory_order_acquire);
+		BaseTicks = Calibration.BaseTicks.load(std::memory_order_relaxed);
+		BaseCycles = Calibration.BaseCycles.load(std::memory_order_relaxed);
+		TicksPerCycle = Calibration.TicksPerCycle.load(std::memory_order_relaxed);
+		ResyncCycles = Calibration.ResyncCycles.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+	} while ((Sequence & 1) || Sequence != Calibration.Sequence.load(std::memory_order_relaxed));
+	// counter can go back after migration to another core on old hardware, platform time is the safe answer then
+	if (Cycles >= ResyncCycles || Cycles < BaseCycles) [[unlikely]] {
+		return Resync();
+	}
+	return timestamp{BaseTicks + (s64) (((Cycles - BaseCycles) * TicksPerCycle) >> 32)};
+}
+
+// refreshed together with UTC time
+[[nodiscard]] FORCEINLINE timezone GetTimezone() {
+	if (internal::Calibration.ResyncCycles.load(std::memory_order_relaxed) == 0) [[unlikely]] {
+		(void) GetUTC();
+	}
+	return timezone{internal::Calibration.TimezoneTicks.load(std::memory_order_relaxed)};
+}
+
+[[nodiscard]] FORCEINLINE timestamp GetLocal() {
+	const timestamp UTC = GetUTC();
+	return GetTimezone().Apply(UTC);
+}
+}	 // namespace wall_clock
@@ -1,5 +1,15 @@
 #pragma once
 
+// glibc declares index() and rindex() in <strings.h>, which <cstring> pulls in, they would clash with index type
+// below. Including it first with both names hidden keeps later includes of it no-ops.
+#if __has_include(<strings.h>)
+#define index glibc_index
+#define rindex glibc_rindex
+#include <strings.h>
+#undef index
+#undef rindex
+#endif
+
 #include <cstdint>
 #include <type_traits>
 #include "glm/glm.hpp"
@@ -22,9 +32,20 @@ using mat4 = glm::mat4;
 using index = u32;
 constexpr index InvalidIndex = 0xffffffff;
 
+// used to keep data written by different threads on separate cache lines
+constexpr index CacheLineSize = 64;
+
+#if defined(_MSC_VER)
 #define PLATFORM_BREAK() (__debugbreak())
+#else
+#define PLATFORM_BREAK() (__builtin_trap())
+#endif
 #ifdef NDEBUG
+#if defined(_MSC_VER)
 #define FORCEINLINE __forceinline
+#else
+#define FORCEINLINE inline __attribute__((always_inline))
+#endif
 #define CHECK(condition)
 #else
 #define FORCEINLINE inline
@@ -42,6 +63,27 @@ constexpr index InvalidIndex = 0xffffffff;
 #define NO_UNIQUE_ADDRESS [[no_unique_address]]
 #endif
 
+// hint to start loading cache line with Address, never faults
+#if defined(__GNUC__) || defined(__clang__)
+#define PREFETCH(Address) __builtin_prefetch(Address)
+#else
+#include <xmmintrin.h>
+#define PREFETCH(Address) _mm_prefetch((const char*) (Address), _MM_HINT_T0)
+#endif
+
+// hint for spin-wait loops, frees execution resources for the sibling hyper-thread and saves power
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#define CPU_PAUSE() _mm_pause()
+#elif defined(_M_ARM64)
+#include <intrin.h>
+#define CPU_PAUSE() __yield()
+#elif defined(__aarch64__)
+#define CPU_PAUSE() __asm__ __volatile__("yield")
+#else
+#define CPU_PAUSE()
+#endif
+
 enum class container_clear_type : u8 { deallocate, dont_deallocate };
 
 enum class iterator_constness : u8 { constant, non_constant };
@@ -1,6 +1,7 @@
 #include "game.h"
 
 #include "Asset/asset_storage.h"
+#include "Profiler/profiler.h"
 
 static ui_data UpdateUi() {
 	return {};
@@ -16,6 +17,7 @@ game_update_result game::Step(
 	const input& Input,
 	const window_state& WindowState,
 	const render_state& RenderState) {
+	PROFILE_SCOPE("GameStep");
 	game_update_result Result;
 	Result.UIData = UpdateUi();
 	return Result;
@@ -2,10 +2,32 @@
 
 #include "basic.h"
 #include "Asset/Model/model.h"
+#include "Containers/sparse_set.h"
 #include "Game/Entities/light.h"
 #include "Game/Entities/model_instance.h"
 
+using entity = index;
+
 struct world {
-	dyn_array<light> mLights{};
-	dyn_array<model_instance> mInstances{};
+	sparse_set<light> mLights{};
+	sparse_set<model_instance> mInstances{};
+
+	// ids of destroyed entities are reused before new ones are handed out
+	dyn_array<entity> mFreeEntities{};
+	entity mNextEntity{0};
+
+	FORCEINLINE entity CreateEntity() {
+		if (mFreeEntities.GetSize() > 0) {
+			const entity Entity = mFreeEntities[mFreeEntities.GetSize() - 1];
+			mFreeEntities.RemoveAt(mFreeEntities.GetSize() - 1);
+			return Entity;
+		}
+		return mNextEntity++;
+	}
+
+	FORCEINLINE void DestroyEntity(entity Entity) {
+		mLights.Remove(Entity);
+		mInstances.Remove(Entity);
+		mFreeEntities.Add(Entity);
+	}
 };
\ No newline at end of file
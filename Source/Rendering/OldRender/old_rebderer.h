@@ -11,16 +11,21 @@
 #include "glm/glm.hpp"
 #include "Asset/Shader/shader.h"
 #include "vertex_buffer.h"
+#include "Logs/log_throttle.h"
 
-#define GL_CALL(x)  \
-	GlClearError(); \
-	x;              \
-	GlLogCall(#x, __FILE__, __LINE__);
+// every call site has its own limit of logged errors
+#define GL_CALL(x)                                          \
+	do {                                                    \
+		static logs::rate_state GlCallErrorRate;            \
+		GlClearError();                                     \
+		x;                                                  \
+		GlLogCall(GlCallErrorRate, #x, __FILE__, __LINE__); \
+	} while (false)
 
 class shader;
 
 void GlClearError();
-bool GlLogCall(const char* FunctionName, const char* FileName, int LineNumber);
+bool GlLogCall(logs::rate_state& ErrorRate, const char* FunctionName, const char* FileName, int LineNumber);
 
 class old_rebderer {
 public:
@@ -8,16 +8,29 @@
 #include "vertex_buffer_layout.h"
 #include "vertex.h"
 #include "Logs/logs.h"
+#include "Logs/log_throttle.h"
+
+static logs::category OpenGLCategory{atom{"OpenGL"}};
 
 void GlClearError() {
 	while (glGetError() != GL_NO_ERROR)
 		;
 }
 
-bool GlLogCall(const char* FunctionName, const char* FileName, int LineNumber) {
+bool GlLogCall(logs::rate_state& ErrorRate, const char* FunctionName, const char* FileName, int LineNumber) {
 	if (GLenum Error = glGetError()) {
-		logs::Log<logs::verbosity::error>("OpenGL Error ({}): {}:{}:{}", Error, FileName, LineNumber, FunctionName);
-		CHECK(false);
+		// Debug break is limited with the line, continuing in debugger doesn't stop on every failing call.
+		if (logs::IsEnabled<logs::verbosity::error>(OpenGLCategory) && ErrorRate.Pass(5)) {
+			logs::LogSuppressed<logs::verbosity::error>(
+				OpenGLCategory,
+				ErrorRate.TakeSuppressed(),
+				"OpenGL Error ({}): {}:{}:{}",
+				Error,
+				FileName,
+				LineNumber,
+				FunctionName);
+			CHECK(false);
+		}
 		return false;
 	}
 	return true;
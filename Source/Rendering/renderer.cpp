@@ -2,6 +2,7 @@
 #include "Rendering/Backend/dynamic_rhi.h"
 #include "glm/ext/matrix_clip_space.hpp"
 #include "Logs/logs.h"
+#include "Profiler/profiler.h"
 
 static void SetupCubeTransforms(dyn_array<glm::mat4>& StaticCubes, dyn_array<glm::mat4>& DynamicCubes) {
 	// Static
@@ -140,6 +141,7 @@ render_state renderer::HandleMessages(const dyn_array<app_message>& Messages) {
 }
 
 void renderer::RenderViews(const dyn_array<view>& Views) {
+	PROFILE_SCOPE("RenderViews");
 	// TODO this is game update
 	input Input{};
 	const float Speed = /*DeltaTime * */ mOldRenderer.mCamera.mMovementSpeed / 60.f;
@@ -296,4 +298,5 @@ void renderer::RenderViews(const dyn_array<view>& Views) {
 }
 
 void renderer::RenderUI(const ui_data& UIData) {
+	PROFILE_SCOPE("RenderUI");
 }
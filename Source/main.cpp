@@ -1,10 +1,24 @@
 #include "Application/application.h"
+#include "Profiler/profiler.h"
+
+#include <cstdlib>
 
 int main() {
+	// SCRATCH_TRACE=trace.json captures the whole run for chrome://tracing or ui.perfetto.dev
+	const char* TracePath = std::getenv("SCRATCH_TRACE");
+	if (TracePath) {
+		profiler::StartCapture();
+	}
 	application_settings Settings;
 	application App{Settings};
 	while (App.RunOneFrame()) {
 	}
+	// same scene on two builds gives comparable numbers
+	App.FrameStats.LogReport();
+	if (TracePath) {
+		profiler::StopCapture();
+		profiler::WriteChromeTrace(TracePath);
+	}
 	
 	return 0;
 }
@@ -127,104 +127,10 @@ static bool SanityCheck() {
 	return true;
 }
 
-template <typename allocator_type>
-static TestResult PerformanceTests(
-	TotalResults& OutTotals,
-	const size_t MinSize = 1,
-	const size_t MaxSize = 32,
-	const size_t IterationsCount = 10,
-	const size_t AllocationsCount = 1000000) {
-	std::default_random_engine rd(128648432u);
-
-	TestResult result;
-
-	const size_t step = AllocationsCount / 5;
-	uint32_t index = 0;
-
-	for (size_t allocCount = step; allocCount <= AllocationsCount; allocCount += step) {
-		index++;
-
-		std::vector<size_t> sizesToAllocate;
-		sizesToAllocate.resize(allocCount);
-
-		size_t totalAllocatedSize = 0;
-		for (size_t i = 0; i < allocCount; ++i) {
-			sizesToAllocate[i] = rd() % MaxSize + MinSize;
-			totalAllocatedSize += sizesToAllocate[i];
-		}
-
-		timer simpleTest;
-		size_t memoryOverhead1 = 0;
-
-		timer shuffleTest;
-		size_t memoryOverhead2 = 0;
-
-		timer randomTest;
-		size_t memoryOverhead3 = 0;
-
-		float factorSimple = 1.0f;
-		float factorShuffle = 1.0f;
-		float factorRandom = 1.0f;
-
-		for (size_t i = 0; i < IterationsCount; i++) {
-			factorSimple =
-				TestPerformanceSimple<allocator_type>(sizesToAllocate, simpleTest, memoryOverhead1);
-			factorShuffle = TestPerformanceShuffle<allocator_type>(
-				sizesToAllocate, shuffleTest, memoryOverhead2);
-			factorRandom =
-				TestPerformanceRandom<allocator_type>(sizesToAllocate, randomTest, memoryOverhead3);
-		}
-
-		result["simple"][totalAllocatedSize] = {
-			(size_t)simpleTest.Result(), (float) ((double) memoryOverhead1 / 1048576.0)};
-		result["shuffle"][totalAllocatedSize] = {
-			(size_t)shuffleTest.Result(), (float) ((double) memoryOverhead2 / 1048576.0)};
-		result["random"][totalAllocatedSize] = {
-			(size_t)randomTest.Result(), (float) ((double) memoryOverhead3 / 1048576.0)};
-
-		// printf(" %.2f %.2f %.2f \n", factorSimple, factorShuffle, factorRandom);
-
-		float totalAllocatedSizeMb = (float) ((double) totalAllocatedSize / 1048576.0);
-
-		OutTotals.mMemoryOverhead += (float) ((double) memoryOverhead1 / 1048576.0);
-		OutTotals.mMemoryOverhead += (float) ((double) memoryOverhead2 / 1048576.0);
-		OutTotals.mMemoryOverhead += (float) ((double) memoryOverhead3 / 1048576.0);
-
-		OutTotals.mGlobalTime += simpleTest.Result() * 0.001f;
-		OutTotals.mGlobalTime += shuffleTest.Result() * 0.001f;
-		OutTotals.mGlobalTime += randomTest.Result() * 0.001f;
-
-		// printf("Test effectivenes: %.2f %.2f %.2f\n", factorSimple, factorShuffle, factorRandom);
-
-		std::cout << "Simple (" << MinSize << " to " << MaxSize << "), AllocCount " << allocCount << ":" << std::endl;
-		OutTotals.mScore += factorSimple * math::Min(CalculateScore(
-											   (float) result["simple"][totalAllocatedSize].first,
-											   result["simple"][totalAllocatedSize].second,
-											   (float) index,
-											   totalAllocatedSizeMb), 100.f);
-		
-		std::cout << "Shuffle (" << MinSize << " to " << MaxSize << "), AllocCount " << allocCount << ":" << std::endl;
-		OutTotals.mScore += factorShuffle * math::Min(CalculateScore(
-												(float) result["shuffle"][totalAllocatedSize].first,
-												result["shuffle"][totalAllocatedSize].second,
-												(float) index,
-												totalAllocatedSizeMb),100.f);
-		
-		std::cout << "Random (" << MinSize << " to " << MaxSize << "), AllocCount " << allocCount << ":" << std::endl;
-		OutTotals.mScore += factorRandom * math::Min(CalculateScore(
-											   (float) result["random"][totalAllocatedSize].first,
-											   result["random"][totalAllocatedSize].second,
-											   (float) index,
-											   totalAllocatedSizeMb),100.f);
-	}
-
-	return result;
-}
-
 template <typename allocator_type>
 static float TestPerformanceRandom(
 	const std::vector<size_t>& sizesToAllocate,
-	timer& timer,
+	bench::state& State,
 	size_t& memoryOverhead) {
 	size_t totalShouldAllocate = 0;
 	size_t totalAllocated = 0;
@@ -240,7 +146,7 @@ static float TestPerformanceRandom(
 		allocator_type::ClearStaticImpl();
 	}
 	size_t beforeTest = GetTotalUsedVirtualMemory();
-	timer.Start();
+	State.ResumeTiming();
 	{
 		allocator_type allocator;
 		size_t border = sizesToAllocate.size() / 4;
@@ -252,13 +158,13 @@ static float TestPerformanceRandom(
 				totalAllocated += sizesToAllocate[i];
 			}
 		}
-		timer.Stop();
+		State.PauseTiming();
 
 		std::random_device rd;
 		std::mt19937 g(rd());
 		std::shuffle(ptrs.begin(), ptrs.end() - (size_t) border * 3, g);
 
-		timer.Start();
+		State.ResumeTiming();
 
 		for (size_t i = 0; i < border; ++i) {
 			allocator.Free(ptrs[i]);
@@ -283,7 +189,7 @@ static float TestPerformanceRandom(
 			allocator.Free(ptrs[i]);
 		}
 	}
-	timer.Stop();
+	State.PauseTiming();
 
 	return (float) ((double) totalAllocated / (double) totalShouldAllocate);
 }
@@ -291,7 +197,7 @@ static float TestPerformanceRandom(
 template <typename allocator_type>
 static float TestPerformanceShuffle(
 	const std::vector<size_t>& sizesToAllocate,
-	timer& timer,
+	bench::state& State,
 	size_t& memoryOverhead) {
 	size_t totalShouldAllocate = 0;
 	size_t totalAllocated = 0;
@@ -306,7 +212,7 @@ static float TestPerformanceShuffle(
 		allocator_type::ClearStaticImpl();
 	}
 	size_t beforeTest = GetTotalUsedVirtualMemory();
-	timer.Start();
+	State.ResumeTiming();
 	{
 		allocator_type allocator;
 		for (size_t i = 0; i < sizesToAllocate.size(); ++i) {
@@ -317,7 +223,7 @@ static float TestPerformanceShuffle(
 				totalAllocated += sizesToAllocate[i];
 			}
 		}
-		timer.Stop();
+		State.PauseTiming();
 
 		memoryOverhead = 0;
 		if (GetTotalUsedVirtualMemory() > beforeTest + totalAllocated) {
@@ -328,12 +234,12 @@ static float TestPerformanceShuffle(
 		std::mt19937 g(rd());
 		std::shuffle(ptrs.begin(), ptrs.end(), g);
 
-		timer.Start();
+		State.ResumeTiming();
 		for (size_t i = 0; i < sizesToAllocate.size(); ++i) {
 			allocator.Free(ptrs[i]);
 		}
 	}
-	timer.Stop();
+	State.PauseTiming();
 
 	return (float) ((double) totalAllocated / (double) totalShouldAllocate);
 }
@@ -341,7 +247,7 @@ static float TestPerformanceShuffle(
 template <typename allocator_type>
 static float TestPerformanceSimple(
 	const std::vector<size_t>& sizesToAllocate,
-	timer& timer,
+	bench::state& State,
 	size_t& memoryOverhead) {
 	size_t totalShouldAllocate = 0;
 	size_t totalAllocated = 0;
@@ -356,7 +262,7 @@ static float TestPerformanceSimple(
 		allocator_type::ClearStaticImpl();
 	}
 	size_t beforeTest = GetTotalUsedVirtualMemory();
-	timer.Start();
+	State.ResumeTiming();
 	{
 		allocator_type allocator;
 		for (size_t i = 0; i < sizesToAllocate.size(); ++i) {
@@ -368,23 +274,137 @@ static float TestPerformanceSimple(
 
 			totalShouldAllocate += sizesToAllocate[i];
 		}
-		timer.Stop();
+		State.PauseTiming();
 
 		memoryOverhead = 0;
 		if (GetTotalUsedVirtualMemory() > beforeTest + totalAllocated) {
 			memoryOverhead = GetTotalUsedVirtualMemory() - beforeTest - totalAllocated;
 		}
 
-		timer.Start();
+		State.ResumeTiming();
 		for (size_t i = 0; i < sizesToAllocate.size(); ++i) {
 			allocator.Free(ptrs[i]);
 		}
 	}
-	timer.Stop();
+	State.PauseTiming();
 
 	return (float) ((double) totalAllocated / (double) totalShouldAllocate);
 }
 
+template <typename allocator_type>
+static TestResult PerformanceTests(
+	TotalResults& OutTotals,
+	const size_t MinSize = 1,
+	const size_t MaxSize = 32,
+	const size_t IterationsCount = 10,
+	const size_t AllocationsCount = 1000000) {
+	std::default_random_engine rd(128648432u);
+
+	TestResult result;
+
+	const size_t step = AllocationsCount / 5;
+	uint32_t index = 0;
+
+	for (size_t allocCount = step; allocCount <= AllocationsCount; allocCount += step) {
+		index++;
+
+		std::vector<size_t> sizesToAllocate;
+		sizesToAllocate.resize(allocCount);
+
+		size_t totalAllocatedSize = 0;
+		for (size_t i = 0; i < allocCount; ++i) {
+			sizesToAllocate[i] = rd() % MaxSize + MinSize;
+			totalAllocatedSize += sizesToAllocate[i];
+		}
+
+		size_t memoryOverhead1 = 0;
+		size_t memoryOverhead2 = 0;
+		size_t memoryOverhead3 = 0;
+
+		float factorSimple = 1.0f;
+		float factorShuffle = 1.0f;
+		float factorRandom = 1.0f;
+
+		// one sample per iteration, every allocation is freed once in each test
+		const bench::config Config{
+			.Samples = (u32) IterationsCount,
+			.WarmupSamples = 0,
+			.Iterations = 1,
+			.ItemsPerIteration = (u64) allocCount * 2};
+		const std::string Name = std::string(typeid(allocator_type).name()) + " (" + std::to_string(MinSize) +
+								 " to " + std::to_string(MaxSize) + ") ";
+		const std::string Suffix = "/" + std::to_string(allocCount);
+		// test functions time only allocations and frees themselves
+		const bench::result* simpleTest = bench::Run(Name + "simple" + Suffix, Config, [&](bench::state& State) {
+			State.PauseTiming();
+			factorSimple = TestPerformanceSimple<allocator_type>(sizesToAllocate, State, memoryOverhead1);
+			State.ResumeTiming();
+		});
+		const bench::result* shuffleTest = bench::Run(Name + "shuffle" + Suffix, Config, [&](bench::state& State) {
+			State.PauseTiming();
+			factorShuffle = TestPerformanceShuffle<allocator_type>(sizesToAllocate, State, memoryOverhead2);
+			State.ResumeTiming();
+		});
+		const bench::result* randomTest = bench::Run(Name + "random" + Suffix, Config, [&](bench::state& State) {
+			State.PauseTiming();
+			factorRandom = TestPerformanceRandom<allocator_type>(sizesToAllocate, State, memoryOverhead3);
+			State.ResumeTiming();
+		});
+		if (!simpleTest || !shuffleTest || !randomTest) {
+			continue;
+		}
+
+		// scores are defined for milliseconds of all iterations
+		const auto TotalMs = [&](const bench::result* Result) {
+			return (float) (Result->MedianNs * (double) Result->ItemsPerIteration * (double) IterationsCount * 1e-6);
+		};
+
+		result["simple"][totalAllocatedSize] = {
+			(size_t) TotalMs(simpleTest), (float) ((double) memoryOverhead1 / 1048576.0)};
+		result["shuffle"][totalAllocatedSize] = {
+			(size_t) TotalMs(shuffleTest), (float) ((double) memoryOverhead2 / 1048576.0)};
+		result["random"][totalAllocatedSize] = {
+			(size_t) TotalMs(randomTest), (float) ((double) memoryOverhead3 / 1048576.0)};
+
+		// printf(" %.2f %.2f %.2f \n", factorSimple, factorShuffle, factorRandom);
+
+		float totalAllocatedSizeMb = (float) ((double) totalAllocatedSize / 1048576.0);
+
+		OutTotals.mMemoryOverhead += (float) ((double) memoryOverhead1 / 1048576.0);
+		OutTotals.mMemoryOverhead += (float) ((double) memoryOverhead2 / 1048576.0);
+		OutTotals.mMemoryOverhead += (float) ((double) memoryOverhead3 / 1048576.0);
+
+		OutTotals.mGlobalTime += TotalMs(simpleTest) * 0.001f;
+		OutTotals.mGlobalTime += TotalMs(shuffleTest) * 0.001f;
+		OutTotals.mGlobalTime += TotalMs(randomTest) * 0.001f;
+
+		// printf("Test effectivenes: %.2f %.2f %.2f\n", factorSimple, factorShuffle, factorRandom);
+
+		std::cout << "Simple (" << MinSize << " to " << MaxSize << "), AllocCount " << allocCount << ":" << std::endl;
+		OutTotals.mScore += factorSimple * math::Min(CalculateScore(
+											   (float) result["simple"][totalAllocatedSize].first,
+											   result["simple"][totalAllocatedSize].second,
+											   (float) index,
+											   totalAllocatedSizeMb), 100.f);
+		
+		std::cout << "Shuffle (" << MinSize << " to " << MaxSize << "), AllocCount " << allocCount << ":" << std::endl;
+		OutTotals.mScore += factorShuffle * math::Min(CalculateScore(
+												(float) result["shuffle"][totalAllocatedSize].first,
+												result["shuffle"][totalAllocatedSize].second,
+												(float) index,
+												totalAllocatedSizeMb),100.f);
+		
+		std::cout << "Random (" << MinSize << " to " << MaxSize << "), AllocCount " << allocCount << ":" << std::endl;
+		OutTotals.mScore += factorRandom * math::Min(CalculateScore(
+											   (float) result["random"][totalAllocatedSize].first,
+											   result["random"][totalAllocatedSize].second,
+											   (float) index,
+											   totalAllocatedSizeMb),100.f);
+	}
+
+	return result;
+}
+
 std::string GetJsData(
 	std::string allocSize,
 	std::string testName,
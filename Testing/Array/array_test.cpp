@@ -86,144 +86,144 @@ static bool SanityCheck(s64 Count) {
 }
 
 template <typename test_type>
-static void PerformanceTests(s64 Count, s64 Iters) {
-	std::cout << "------------------------------------------" << std::endl;
-	const std::string InfoString = std::string("Testing with ") + typeid(test_type).name() + ", " +
-								   std::to_string(sizeof(test_type)) + " bytes";
-	std::cout << InfoString << std::endl;
+static void AddValue(dyn_array<test_type>& Array, index Index, const test_type& Value) {
+	if (Index % 2 == 0) {
+		Array.Add(Value);
+	} else {
+		Array.Emplace(Value);
+	}
+}
 
-	timer stdVector;
-	timer tVector;
-	timer stdVectorRemoveSwap;
-	timer tVectorRemoveSwap;
-	timer stdVectorRemoveAt;
-	timer tVectorRemoveAt;
-	timer stdVectorInsert;
-	timer tVectorInsert;
-	timer stdVectorSort;
-	timer tVectorSort;
-
-	for (s32 iter = 0; iter < Iters; ++iter) {
-		dyn_array<test_type> container;
-		std::vector<test_type> ideal;
-
-		ClearCache();
-		srand(0);
-		tVector.Start();
-		for (size_t i = 0; i < Count; i++) {
-			const int32_t value = rand();
-
-			if (i % 2 == 0) {
-				container.Add(value);
-			} else {
-				container.Emplace(value);
-			}
-		}
-		tVector.Stop();
+template <typename test_type>
+static void AddValue(std::vector<test_type>& Array, index Index, const test_type& Value) {
+	if (Index % 2 == 0) {
+		Array.push_back(Value);
+	} else {
+		Array.emplace_back(Value);
+	}
+}
 
-		ClearCache();
-		srand(0);
-		stdVector.Start();
-		for (size_t i = 0; i < Count; i++) {
-			const int32_t value = rand();
-
-			if (i % 2 == 0) {
-				ideal.push_back(value);
-			} else {
-				ideal.emplace_back(value);
-			}
-		}
-		stdVector.Stop();
+template <typename test_type>
+static void SortValues(dyn_array<test_type>& Array) {
+	algo::Sort(Array);
+}
 
-		ClearCache();
-		tVectorSort.Start();
-		algo::Sort(container);
-		tVectorSort.Stop();
+template <typename test_type>
+static void SortValues(std::vector<test_type>& Array) {
+	std::sort(Array.begin(), Array.end());
+}
 
-		ClearCache();
-		stdVectorSort.Start();
-		std::sort(ideal.begin(), ideal.end());
-		stdVectorSort.Stop();
+template <typename test_type>
+static void RemoveAtSwap(dyn_array<test_type>& Array, index Index) {
+	Array.RemoveAtSwap(Index);
+}
 
-		uint32_t countToRemoveSwap = Count / 2;
+template <typename test_type>
+static void RemoveAtSwap(std::vector<test_type>& Array, index Index) {
+	std::iter_swap(Array.begin() + Index, Array.end() - 1);
+	Array.pop_back();
+}
 
-		ClearCache();
-		srand(0);
-		stdVectorRemoveSwap.Start();
-		for (size_t i = 0; i < countToRemoveSwap; i++) {
-			const size_t pos = rand() % ideal.size();
-			const auto valueToRemove = ideal[pos];
+template <typename test_type>
+static void RemoveAt(dyn_array<test_type>& Array, index Index) {
+	Array.RemoveAt(Index);
+}
 
-			std::iter_swap(ideal.begin() + pos, ideal.end() - 1);
-			ideal.pop_back();
-		}
-		stdVectorRemoveSwap.Stop();
+template <typename test_type>
+static void RemoveAt(std::vector<test_type>& Array, index Index) {
+	Array.erase(Array.begin() + Index);
+}
 
-		ClearCache();
-		srand(0);
-		tVectorRemoveSwap.Start();
-		for (size_t i = 0; i < countToRemoveSwap; i++) {
-			const size_t pos = rand() % container.GetSize();
-			const auto valueToRemove = container[pos];
+template <typename test_type>
+static void InsertAt(dyn_array<test_type>& Array, index Index, const test_type& Value) {
+	Array.EmplaceAt(Index, Value);
+}
 
-			container.RemoveAtSwap(pos);
-		}
-		tVectorRemoveSwap.Stop();
+template <typename test_type>
+static void InsertAt(std::vector<test_type>& Array, index Index, const test_type& Value) {
+	Array.insert(Array.begin() + Index, 1u, Value);
+}
 
-		uint32_t countToDelete = Count / 128;
+template <typename test_type>
+static void ClearValues(dyn_array<test_type>& Array) {
+	Array.Clear();
+}
 
-		ClearCache();
-		srand(0);
-		tVectorRemoveAt.Start();
-		for (size_t i = 0; i < countToDelete; i++) {
-			const int32_t value = rand() % container.GetSize();
-			container.RemoveAt(value);
-		}
-		tVectorRemoveAt.Stop();
+template <typename test_type>
+static void ClearValues(std::vector<test_type>& Array) {
+	Array.clear();
+}
 
-		ClearCache();
+// Body(Array) runs on Count random values, setup and teardown are not timed
+template <typename test_type, typename array_type, typename body_type>
+static void RunOnFilled(bench::state& State, s64 Count, const body_type& Body) {
+	for (u64 Iteration = 0; Iteration < State.Iterations; ++Iteration) {
+		State.PauseTiming();
+		array_type Array;
 		srand(0);
-		stdVectorRemoveAt.Start();
-		for (size_t i = 0; i < countToDelete; i++) {
-			const int32_t value = rand() % ideal.size();
-			ideal.erase(ideal.begin() + value);
-		}
-		stdVectorRemoveAt.Stop();
-
-		uint32_t countToAdd = Count / 256;
-
-		ClearCache();
-		tVectorInsert.Start();
-		for (size_t i = 0; i < countToAdd; i++) {
-			const size_t num = rand() % 16;
-			const size_t pos = rand() % container.GetSize();
-			container.EmplaceAt(pos, test_type((uint32_t) i));
+		for (s64 i = 0; i < Count; i++) {
+			AddValue(Array, (index) i, test_type(rand()));
 		}
-		tVectorInsert.Stop();
-
-		ClearCache();
-		stdVectorInsert.Start();
-		for (size_t i = 0; i < countToAdd; i++) {
-			const size_t num = rand() % 16;
-			const size_t pos = rand() % ideal.size();
+		srand(0);
+		State.ResumeTiming();
+		Body(Array);
+		bench::DoNotOptimize(Array);
+		State.PauseTiming();
+		ClearValues(Array);
+		State.ResumeTiming();
+	}
+}
 
-			ideal.insert(ideal.begin() + pos, 1u, test_type((uint32_t) i));
+template <typename test_type, typename array_type>
+static void PerformanceTests(const std::string& Name, s64 Count) {
+	bench::Run(Name + " add/emplace", {.ItemsPerIteration = (u64) Count}, [&](bench::state& State) {
+		for (u64 Iteration = 0; Iteration < State.Iterations; ++Iteration) {
+			array_type Array;
+			srand(0);
+			for (s64 i = 0; i < Count; i++) {
+				AddValue(Array, (index) i, test_type(rand()));
+			}
+			bench::DoNotOptimize(Array);
+			State.PauseTiming();
+			ClearValues(Array);
+			State.ResumeTiming();
 		}
-		stdVectorInsert.Stop();
-	}
-	std::cout << std::endl;
+	});
+	// per sorted element
+	bench::Run(Name + " Sort", {.ItemsPerIteration = (u64) Count}, [&](bench::state& State) {
+		RunOnFilled<test_type, array_type>(State, Count, [](array_type& Array) { SortValues(Array); });
+	});
+	bench::Run(Name + " RemoveAtSwap", {.ItemsPerIteration = (u64) Count / 2}, [&](bench::state& State) {
+		RunOnFilled<test_type, array_type>(State, Count, [&](array_type& Array) {
+			for (s64 i = 0; i < Count / 2; i++) {
+				RemoveAtSwap(Array, (index) (rand() % (Count - i)));
+			}
+		});
+	});
+	bench::Run(Name + " RemoveAt", {.ItemsPerIteration = (u64) Count / 128}, [&](bench::state& State) {
+		RunOnFilled<test_type, array_type>(State, Count, [&](array_type& Array) {
+			for (s64 i = 0; i < Count / 128; i++) {
+				RemoveAt(Array, (index) (rand() % (Count - i)));
+			}
+		});
+	});
+	bench::Run(Name + " Insert", {.ItemsPerIteration = (u64) Count / 256}, [&](bench::state& State) {
+		RunOnFilled<test_type, array_type>(State, Count, [&](array_type& Array) {
+			for (s64 i = 0; i < Count / 256; i++) {
+				InsertAt(Array, (index) (rand() % (Count + i)), test_type((uint32_t) i));
+			}
+		});
+	});
+}
 
-	std::cout << "Performance test add/emplace:\n\tstd::vector " << stdVector.Result() << " ms"
-			  << "\n\tarray " << tVector.Result() << " ms" << std::endl;
-	std::cout << "Performance test RemoveAtSwap:\n\tstd::vector " << stdVectorRemoveSwap.Result()
-			  << " ms"
-			  << "\n\tarray " << tVectorRemoveSwap.Result() << " ms" << std::endl;
-	std::cout << "Performance test RemoveAt:\n\tstd::vector " << stdVectorRemoveAt.Result() << " ms"
-			  << "\n\tarray " << tVectorRemoveAt.Result() << " ms" << std::endl;
-	std::cout << "Performance test Insert:\n\tstd::vector " << stdVectorInsert.Result() << " ms"
-			  << "\n\tarray " << tVectorInsert.Result() << " ms" << std::endl;
-	std::cout << "Performance test Sort:\n\tstd::vector " << stdVectorSort.Result() << " ms"
-			  << "\n\tarray " << tVectorSort.Result() << " ms" << std::endl;
+template <typename test_type>
+static void PerformanceTests(s64 Count) {
+	std::cout << "------------------------------------------" << std::endl;
+	const std::string TypeName = std::string(typeid(test_type).name()) + ", " + std::to_string(sizeof(test_type)) +
+								 " bytes";
+	std::cout << "Testing with " << TypeName << std::endl;
+	PerformanceTests<test_type, std::vector<test_type>>("std::vector<" + TypeName + ">", Count);
+	PerformanceTests<test_type, dyn_array<test_type>>("dyn_array<" + TypeName + ">", Count);
 }
 
 s32 array_test::Test(const std::span<char*>& Args) {
@@ -237,9 +237,9 @@ s32 array_test::Test(const std::span<char*>& Args) {
 
 void array_test::Benchmark(const std::span<char*>& Args) {
 	TEST_PRINT_LINE();
-	PerformanceTests<bytes_struct<24>>(10000, 1000);
-	PerformanceTests<complex_type>(10000, 1000);
-	PerformanceTests<complex_type_realloc>(10000, 1000);
+	PerformanceTests<bytes_struct<24>>(10000);
+	PerformanceTests<complex_type>(10000);
+	PerformanceTests<complex_type_realloc>(10000);
 }
 
 TEST_ENTRY(array_test);
@@ -0,0 +1,206 @@
+﻿#include "../testing_shared.h"
+#include "String/atom.h"
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct atom_test {
+	s32 Test(const std::span<char*>& Args);
+	void Benchmark(const std::span<char*>& Args);
+};
+
+static str_view MakeView(const std::string& String) {
+	return str_view{String.data(), (index) String.size()};
+}
+
+static std::vector<std::string> MakeNames(const char* Prefix, index Count) {
+	std::vector<std::string> Names;
+	for (index Name = 0; Name < Count; ++Name) {
+		Names.push_back(std::string(Prefix) + std::to_string(Name));
+	}
+	return Names;
+}
+
+static bool SingleThreadCheck() {
+	std::cout << "------------------------------------------" << std::endl;
+	const atom First{"first"};
+	const atom Second{"second"};
+	TEST_CHECK(First == atom{"first"} && First != Second, "same string gives same atom");
+	TEST_CHECK(First.ToStr() == str_view{"first"} && Second.ToStr() == str_view{"second"}, "atom to string");
+	TEST_CHECK(First.ToStr().GetData()[First.ToStr().GetSize()] == '\0', "string is null terminated");
+	TEST_CHECK(atom{""}.ToStr().GetSize() == 0 && atom{""} == atom{""}, "empty string");
+	TEST_CHECK(atom::GetAtomPool().Find("first") == First.Index, "find existing");
+	TEST_CHECK(atom::GetAtomPool().Find("never created") == InvalidIndex, "find missing");
+
+	const std::string Long(100000, 'x');
+	const atom LongAtom{MakeView(Long)};
+	TEST_CHECK(LongAtom.ToStr() == MakeView(Long) && LongAtom == atom{MakeView(Long)}, "long string");
+	return true;
+}
+
+// views returned by ToStr() must survive any number of later insertions
+static bool StabilityCheck(index Count) {
+	std::cout << "------------------------------------------" << std::endl;
+	auto Pool = std::make_unique<atom::atom_pool>();
+	const std::vector<std::string> Names = MakeNames("stable_", Count);
+	std::vector<index> Indices;
+	std::vector<const char*> Pointers;
+	for (index Name = 0; Name < 100; ++Name) {
+		Indices.push_back(Pool->Intern(MakeView(Names[Name])));
+		Pointers.push_back(Pool->GetEntry(Indices.back()).Data);
+	}
+	for (const std::string& Name : Names) {
+		Pool->Intern(MakeView(Name));
+	}
+	bool Valid = Pool->GetSize() == Count;
+	for (index Name = 0; Name < 100; ++Name) {
+		const atom::atom_pool::entry& Entry = Pool->GetEntry(Indices[Name]);
+		Valid = Valid && Entry.Data == Pointers[Name] && str_view{Entry.Data, Entry.Length} == MakeView(Names[Name]);
+	}
+	TEST_CHECK(Valid, "strings don't move");
+	return true;
+}
+
+// All threads intern the same names in different orders, every name must get exactly one index
+static bool ConcurrentCheck(u32 NumThreads, index Count) {
+	std::cout << "------------------------------------------" << std::endl;
+	std::cout << "Testing " << NumThreads << " threads with " << Count << " names" << std::endl;
+	auto Pool = std::make_unique<atom::atom_pool>();
+	const std::vector<std::string> Names = MakeNames("concurrent_", Count);
+	std::vector<std::vector<index>> Results(NumThreads, std::vector<index>(Count));
+	std::vector<std::thread> Threads;
+	for (u32 Thread = 0; Thread < NumThreads; ++Thread) {
+		Threads.emplace_back([&, Thread]() {
+			std::vector<index> Order(Count);
+			for (index Name = 0; Name < Count; ++Name) {
+				Order[Name] = Name;
+			}
+			std::shuffle(Order.begin(), Order.end(), std::mt19937(Thread));
+			for (index Name : Order) {
+				Results[Thread][Name] = Pool->Intern(MakeView(Names[Name]));
+			}
+		});
+	}
+	for (std::thread& Thread : Threads) {
+		Thread.join();
+	}
+	bool Valid = Pool->GetSize() == Count;
+	for (index Name = 0; Name < Count && Valid; ++Name) {
+		const atom::atom_pool::entry& Entry = Pool->GetEntry(Results[0][Name]);
+		Valid = str_view{Entry.Data, Entry.Length} == MakeView(Names[Name]);
+		for (u32 Thread = 1; Thread < NumThreads; ++Thread) {
+			Valid = Valid && Results[Thread][Name] == Results[0][Name];
+		}
+	}
+	TEST_CHECK(Valid, "one index per string");
+	return true;
+}
+
+s32 atom_test::Test(const std::span<char*>& Args) {
+	TEST_PRINT_LINE();
+	bool Passed = true;
+	Passed = Passed && SingleThreadCheck();
+	Passed = Passed && StabilityCheck(100000);
+	Passed = Passed && ConcurrentCheck(2, 10000);
+	Passed = Passed && ConcurrentCheck(math::Max(4u, std::thread::hardware_concurrency()) * 2, 50000);
+	return Passed ? 0 : 1;
+}
+
+// previous design: single table and string storage behind one lock
+struct locked_atom_pool {
+	std::mutex Lock;
+	std::deque<std::string> Strings;
+	std::unordered_map<std::string_view, index> Lookup;
+
+	index Intern(str_view Str) {
+		std::lock_guard<std::mutex> Guard{Lock};
+		const auto Found = Lookup.find(std::string_view{Str.GetData(), Str.GetSize()});
+		if (Found != Lookup.end()) {
+			return Found->second;
+		}
+		Strings.emplace_back(Str.GetData(), Str.GetSize());
+		return Lookup.emplace(Strings.back(), (index) Strings.size() - 1).first->second;
+	}
+};
+
+// Every thread interns OpsPerThread names, ExistingPercent of them from a shared prepopulated set,
+// others are unique to the thread and are new on first use
+template <typename pool_type>
+static void InternRun(
+	const char* PoolName,
+	u32 NumThreads,
+	index OpsPerThread,
+	u32 ExistingPercent,
+	const std::vector<std::string>& Existing) {
+	std::vector<std::vector<std::string>> Ops(NumThreads);
+	for (u32 Thread = 0; Thread < NumThreads; ++Thread) {
+		std::mt19937 Generator(Thread);
+		for (index Op = 0; Op < OpsPerThread; ++Op) {
+			if (Generator() % 100 < ExistingPercent) {
+				Ops[Thread].push_back(Existing[Generator() % Existing.size()]);
+			} else {
+				Ops[Thread].push_back("new_" + std::to_string(Thread) + "_" + std::to_string(Op));
+			}
+		}
+	}
+	const std::string BenchName = std::string{PoolName} + " " + std::to_string(ExistingPercent) + "% existing " +
+								  std::to_string(NumThreads) + " threads";
+	const bench::config Config{
+		.Samples = 5, .WarmupSamples = 0, .Iterations = 1, .ItemsPerIteration = (u64) OpsPerThread * NumThreads};
+	bench::Run(BenchName, Config, [&](bench::state& State) {
+		State.PauseTiming();
+		auto Pool = std::make_unique<pool_type>();
+		for (const std::string& Name : Existing) {
+			Pool->Intern(MakeView(Name));
+		}
+		std::atomic<bool> Start{false};
+		std::atomic<u64> Checksum{0};
+		std::vector<std::thread> Threads;
+		for (u32 Thread = 0; Thread < NumThreads; ++Thread) {
+			Threads.emplace_back([&, Thread]() {
+				while (!Start.load(std::memory_order_acquire)) {
+					std::this_thread::yield();
+				}
+				u64 Sum = 0;
+				for (const std::string& Name : Ops[Thread]) {
+					Sum += Pool->Intern(MakeView(Name));
+				}
+				Checksum += Sum;
+			});
+		}
+		State.ResumeTiming();
+		Start.store(true, std::memory_order_release);
+		for (std::thread& Thread : Threads) {
+			Thread.join();
+		}
+		State.PauseTiming();
+		bench::DoNotOptimize(Checksum.load());
+		Pool.reset();
+		State.ResumeTiming();
+	});
+}
+
+static void PerformanceTests(index OpsPerThread, index NumExisting) {
+	const std::vector<std::string> Existing = MakeNames("existing_atom_name_", NumExisting);
+	const u32 NumCores = math::Max(1u, std::thread::hardware_concurrency());
+	for (u32 ExistingPercent : {100u, 90u, 50u, 0u}) {
+		for (u32 NumThreads = 1; NumThreads <= NumCores * 2; NumThreads *= 2) {
+			InternRun<locked_atom_pool>("locked unordered_map", NumThreads, OpsPerThread, ExistingPercent, Existing);
+			InternRun<atom::atom_pool>("atom_pool", NumThreads, OpsPerThread, ExistingPercent, Existing);
+		}
+	}
+}
+
+void atom_test::Benchmark(const std::span<char*>& Args) {
+	TEST_PRINT_LINE();
+	PerformanceTests(1000000, 100000);
+}
+
+TEST_ENTRY(atom_test);
@@ -0,0 +1,158 @@
+﻿#include "../testing_shared.h"
+
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <vector>
+
+struct benchmark_test {
+	s32 Test(const std::span<char*>& Args);
+	void Benchmark(const std::span<char*>& Args);
+};
+
+static bool StatisticsCheck() {
+	std::cout << "------------------------------------------" << std::endl;
+	TEST_CHECK(bench::GetMedian({5.0, 1.0, 3.0}) == 3.0, "median of odd count");
+	TEST_CHECK(bench::GetMedian({4.0, 1.0, 3.0, 2.0}) == 2.5, "median of even count");
+	TEST_CHECK(bench::GetMedianAbsoluteDeviation({1.0, 2.0, 3.0, 4.0, 100.0}, 3.0) == 1.0, "MAD ignores outliers");
+
+	std::mt19937_64 Random{7};
+	std::normal_distribution<double> Noise{100.0, 5.0};
+	const auto MakeSamples = [&](double Scale) {
+		std::vector<double> Samples;
+		for (index Sample = 0; Sample < 15; ++Sample) {
+			Samples.push_back(Noise(Random) * Scale);
+		}
+		return Samples;
+	};
+	const std::vector<double> Base = MakeSamples(1.0);
+	const std::vector<double> Same = MakeSamples(1.0);
+	const std::vector<double> Slower = MakeSamples(1.2);
+	const double SamePValue = bench::GetPValue(Base, Same);
+	const double SlowerPValue = bench::GetPValue(Base, Slower);
+	std::cout << "\tp same " << SamePValue << ", p slower " << SlowerPValue << std::endl;
+	TEST_CHECK(SamePValue > 0.01, "same distribution is not significant");
+	TEST_CHECK(SlowerPValue < 0.001, "shifted distribution is significant");
+	TEST_CHECK(bench::GetPValue({1.0, 1.0, 1.0}, {1.0, 1.0, 1.0}) == 1.0, "all ties");
+	return true;
+}
+
+// spins for about the given time, sleeping would give the scheduler a say in results
+static void Spin(s64 Ns) {
+	const s64 EndNs = cycle_clock::GetNs() + Ns;
+	while (cycle_clock::GetNs() < EndNs) {
+	}
+}
+
+static bool RunCheck() {
+	std::cout << "------------------------------------------" << std::endl;
+	u64 Calls = 0;
+	const bench::result* Fixed =
+		bench::Run("fixed", {.Samples = 5, .WarmupSamples = 2, .Iterations = 3}, [&](bench::state& State) {
+			Calls += State.Iterations;
+		});
+	TEST_CHECK(Fixed && Fixed->Iterations == 3 && Fixed->SamplesNs.size() == 5, "fixed iterations");
+	TEST_CHECK(Calls == 3 * 7, "warm-up samples run");
+
+	const bench::result* Calibrated =
+		bench::Run("calibrated", {.Samples = 3, .MinSampleNs = 2'000'000}, [&](bench::state& State) {
+			for (u64 Iteration = 0; Iteration < State.Iterations; ++Iteration) {
+				Spin(10'000);
+			}
+		});
+	TEST_CHECK(Calibrated && Calibrated->Iterations >= 150, "calibrated to minimal sample time");
+	TEST_CHECK(Calibrated->MedianNs >= 10'000.0 && Calibrated->MedianNs < 100'000.0, "time per iteration");
+
+	const bench::result* Paused =
+		bench::Run("paused", {.Samples = 3, .Iterations = 10, .ItemsPerIteration = 4}, [&](bench::state& State) {
+			for (u64 Iteration = 0; Iteration < State.Iterations; ++Iteration) {
+				State.PauseTiming();
+				Spin(1'000'000);
+				State.ResumeTiming();
+				Spin(40'000);
+			}
+			State.SetCounter("answer", 42.0);
+		});
+	std::cout << "\tpaused " << Paused->MedianNs << " ns per item" << std::endl;
+	TEST_CHECK(Paused->MedianNs >= 10'000.0 && Paused->MedianNs < 100'000.0, "paused time is excluded, per item");
+	TEST_CHECK(Paused->UserCounters.size() == 1 && Paused->UserCounters[0].second == 42.0, "user counters");
+
+	bench::GetSession().Filter = "nothing like this";
+	const bench::result* Filtered = bench::Run("filtered", {}, [&](bench::state& State) { CHECK(false) });
+	bench::GetSession().Filter.clear();
+	TEST_CHECK(Filtered == nullptr, "filtered out");
+	return true;
+}
+
+static bool JsonCheck() {
+	std::cout << "------------------------------------------" << std::endl;
+	const std::string BasePath = (std::filesystem::temp_directory_path() / "scratch_benchmark_base.json").string();
+	const std::string NewPath = (std::filesystem::temp_directory_path() / "scratch_benchmark_new.json").string();
+	std::deque<bench::result> Results(2);
+	Results[0].Name = "steady \"quoted\"";
+	Results[0].SamplesNs = {10.0, 10.5, 9.5, 10.25, 9.75, 10.0, 10.1, 9.9, 10.2, 9.8, 10.05};
+	Results[0].UserCounters.emplace_back("p99 ns", 12.0);
+	Results[1].Name = "regressing";
+	Results[1].SamplesNs = Results[0].SamplesNs;
+	{
+		std::ofstream File{BasePath, std::ios::binary};
+		bench::WriteJson(File, Results);
+	}
+	std::vector<bench::result> ReadBack;
+	TEST_CHECK(bench::ReadJson(BasePath, ReadBack), "read back");
+	TEST_CHECK(ReadBack.size() == 2 && ReadBack[0].Name == Results[0].Name, "names");
+	TEST_CHECK(ReadBack[0].SamplesNs == Results[0].SamplesNs, "samples");
+	TEST_CHECK(bench::CompareFiles(BasePath, BasePath) == 0, "no regressions against itself");
+
+	for (double& Sample : Results[1].SamplesNs) {
+		Sample *= 1.5;
+	}
+	{
+		std::ofstream File{NewPath, std::ios::binary};
+		bench::WriteJson(File, Results);
+	}
+	TEST_CHECK(bench::CompareFiles(BasePath, NewPath) == 1, "regression is flagged");
+	TEST_CHECK(bench::CompareFiles(NewPath, BasePath) == 0, "improvement is not a regression");
+	std::filesystem::remove(BasePath);
+	std::filesystem::remove(NewPath);
+	return true;
+}
+
+s32 benchmark_test::Test(const std::span<char*>& Args) {
+	TEST_PRINT_LINE();
+	bool Passed = true;
+	Passed = Passed && StatisticsCheck();
+	Passed = Passed && RunCheck();
+	Passed = Passed && JsonCheck();
+	return Passed ? 0 : 1;
+}
+
+// costs of the harness itself, they put a floor under what can be measured
+void benchmark_test::Benchmark(const std::span<char*>& Args) {
+	TEST_PRINT_LINE();
+	std::cout << "------------------------------------------" << std::endl;
+	bench::Run("empty iteration", {}, [](bench::state& State) {
+		for (u64 Iteration = 0; Iteration < State.Iterations; ++Iteration) {
+			bench::DoNotOptimize(Iteration);
+		}
+	});
+	bench::Run("PauseTiming and ResumeTiming", {}, [](bench::state& State) {
+		for (u64 Iteration = 0; Iteration < State.Iterations; ++Iteration) {
+			State.PauseTiming();
+			State.ResumeTiming();
+		}
+	});
+	bench::Run("FlushCache", {.Samples = 5}, [](bench::state& State) {
+		for (u64 Iteration = 0; Iteration < State.Iterations; ++Iteration) {
+			bench::FlushCache();
+		}
+	});
+	static u8 Line[CacheLineSize * 64]{};
+	bench::Run("FlushRange of 4 KB", {}, [](bench::state& State) {
+		for (u64 Iteration = 0; Iteration < State.Iterations; ++Iteration) {
+			bench::FlushRange(Line, sizeof(Line));
+		}
+	});
+}
+
+TEST_ENTRY(benchmark_test);
@@ -0,0 +1,276 @@
+﻿#include "../testing_shared.h"
+#include "Containers/bitset.h"
+#include "Containers/dyn_array.h"
+
+#include <vector>
+
+struct bitset_test {
+	s32 Test(const std::span<char*>& Args);
+	void Benchmark(const std::span<char*>& Args);
+};
+
+template <typename bitset_type>
+static bool Compare(const std::vector<bool>& Ideal, const bitset_type& Bitset) {
+	if (Ideal.size() != Bitset.GetSize()) {
+		return false;
+	}
+	for (index Bit = 0; Bit < Ideal.size(); ++Bit) {
+		if (Ideal[Bit] != Bitset.IsSet(Bit)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static index CountIdeal(const std::vector<bool>& Ideal) {
+	index Count = 0;
+	for (bool Bit : Ideal) {
+		Count += Bit;
+	}
+	return Count;
+}
+
+template <typename bitset_type>
+static bool QueryCheck(const std::vector<bool>& Ideal, const bitset_type& Bitset) {
+	TEST_CHECK(Bitset.PopCount() == CountIdeal(Ideal), "popcount");
+
+	bool Valid = true;
+	index Expected = 0;
+	for (index Bit = Bitset.FindFirstSet(); Bit != InvalidIndex; Bit = Bitset.FindNextSet(Bit + 1)) {
+		while (Expected < Ideal.size() && !Ideal[Expected]) {
+			++Expected;
+		}
+		Valid = Valid && Bit == Expected++;
+	}
+	while (Expected < Ideal.size() && !Ideal[Expected]) {
+		++Expected;
+	}
+	TEST_CHECK(Valid && Expected == Ideal.size(), "find next set");
+
+	Expected = 0;
+	index Iterated = 0;
+	for (index Bit : Bitset.GetSetBits()) {
+		while (Expected < Ideal.size() && !Ideal[Expected]) {
+			++Expected;
+		}
+		Valid = Valid && Bit == Expected++;
+		++Iterated;
+	}
+	TEST_CHECK(Valid && Iterated == CountIdeal(Ideal), "set bit iteration");
+	return true;
+}
+
+static bool DynamicCheck(index Size) {
+	std::cout << "------------------------------------------" << std::endl;
+	std::cout << "Testing dyn_bitset with " << Size << " bits" << std::endl;
+
+	srand(0);
+	dyn_bitset Lhs{Size};
+	dyn_bitset Rhs{Size};
+	std::vector<bool> IdealLhs(Size);
+	std::vector<bool> IdealRhs(Size);
+	for (index Iteration = 0; Iteration < Size; ++Iteration) {
+		const index Bit = rand() % Size;
+		switch (rand() % 4) {
+			case 0:
+				Lhs.Set(Bit);
+				IdealLhs[Bit] = true;
+				break;
+			case 1:
+				Lhs.Unset(Bit);
+				IdealLhs[Bit] = false;
+				break;
+			case 2:
+				Lhs.Flip(Bit);
+				IdealLhs[Bit] = !IdealLhs[Bit];
+				break;
+			default:
+				Rhs.Set(Bit, true);
+				IdealRhs[Bit] = true;
+				break;
+		}
+	}
+	TEST_CHECK(Compare(IdealLhs, Lhs) && Compare(IdealRhs, Rhs), "set/unset/flip");
+	if (!QueryCheck(IdealLhs, Lhs)) {
+		return false;
+	}
+
+	dyn_bitset And = Lhs;
+	And &= Rhs;
+	dyn_bitset Or = Lhs;
+	Or |= Rhs;
+	dyn_bitset Xor = Lhs;
+	Xor ^= Rhs;
+	dyn_bitset AndNot = Lhs;
+	AndNot.AndNot(Rhs);
+	std::vector<bool> IdealAnd(Size), IdealOr(Size), IdealXor(Size), IdealAndNot(Size);
+	for (index Bit = 0; Bit < Size; ++Bit) {
+		IdealAnd[Bit] = IdealLhs[Bit] && IdealRhs[Bit];
+		IdealOr[Bit] = IdealLhs[Bit] || IdealRhs[Bit];
+		IdealXor[Bit] = IdealLhs[Bit] != IdealRhs[Bit];
+		IdealAndNot[Bit] = IdealLhs[Bit] && !IdealRhs[Bit];
+	}
+	TEST_CHECK(Compare(IdealAnd, And), "and");
+	TEST_CHECK(Compare(IdealOr, Or), "or");
+	TEST_CHECK(Compare(IdealXor, Xor), "xor");
+	TEST_CHECK(Compare(IdealAndNot, AndNot), "and not");
+
+	const index Grown = Size + Size / 2 + 3;
+	Lhs.Resize(Grown, true);
+	IdealLhs.resize(Grown, true);
+	TEST_CHECK(Compare(IdealLhs, Lhs), "grow with set bits");
+	const index Shrunk = Size / 3;
+	Lhs.Resize(Shrunk);
+	IdealLhs.resize(Shrunk);
+	TEST_CHECK(Compare(IdealLhs, Lhs) && Lhs.PopCount() == CountIdeal(IdealLhs), "shrink");
+	Lhs.Resize(Size);
+	IdealLhs.resize(Size, false);
+	TEST_CHECK(Compare(IdealLhs, Lhs), "shrunk bits stay cleared after grow");
+
+	Lhs.SetAll();
+	TEST_CHECK(Lhs.PopCount() == Size, "set all");
+	Lhs.UnsetAll();
+	TEST_CHECK(Lhs.None() && Lhs.FindFirstSet() == InvalidIndex, "unset all");
+	return true;
+}
+
+template <index Size>
+static bool FixedCheck() {
+	std::cout << "------------------------------------------" << std::endl;
+	std::cout << "Testing bitset with " << Size << " bits" << std::endl;
+
+	srand(1);
+	bitset<Size> Lhs;
+	bitset<Size> Rhs;
+	std::vector<bool> IdealLhs(Size);
+	std::vector<bool> IdealRhs(Size);
+	for (index Iteration = 0; Iteration < Size / 2; ++Iteration) {
+		const index LhsBit = rand() % Size;
+		const index RhsBit = rand() % Size;
+		Lhs.Set(LhsBit);
+		IdealLhs[LhsBit] = true;
+		Rhs.Set(RhsBit);
+		IdealRhs[RhsBit] = true;
+	}
+	TEST_CHECK(Compare(IdealLhs, Lhs), "set");
+	if (!QueryCheck(IdealLhs, Lhs)) {
+		return false;
+	}
+	Lhs ^= Rhs;
+	for (index Bit = 0; Bit < Size; ++Bit) {
+		IdealLhs[Bit] = IdealLhs[Bit] != IdealRhs[Bit];
+	}
+	TEST_CHECK(Compare(IdealLhs, Lhs), "xor");
+	Lhs.SetAll();
+	TEST_CHECK(Lhs.PopCount() == Size, "set all keeps tail clear");
+	return true;
+}
+
+static constexpr index MakeConstexprBitset() {
+	bitset<130> Bitset;
+	Bitset.Set(3);
+	Bitset.Set(64);
+	Bitset.Set(129);
+	bitset<130> Other;
+	Other.Set(64);
+	Bitset.AndNot(Other);
+	return Bitset.PopCount() * 1000 + Bitset.FindNextSet(4);
+}
+
+static_assert(MakeConstexprBitset() == 2129);
+
+s32 bitset_test::Test(const std::span<char*>& Args) {
+	TEST_PRINT_LINE();
+	bool Passed = true;
+	Passed = Passed && DynamicCheck(1);
+	Passed = Passed && DynamicCheck(64);
+	Passed = Passed && DynamicCheck(1000);
+	Passed = Passed && DynamicCheck(100003);
+	Passed = Passed && FixedCheck<7>();
+	Passed = Passed && FixedCheck<128>();
+	Passed = Passed && FixedCheck<1000>();
+	return Passed ? 0 : 1;
+}
+
+static void PerformanceTests(index Size, index Density, index Iters) {
+	const std::string Bits = " " + std::to_string(Size) + " bits, 1/" + std::to_string(Density) + " set";
+
+	dyn_bitset Lhs{Size};
+	dyn_bitset Rhs{Size};
+	dyn_array<bool> BoolLhs;
+	dyn_array<bool> BoolRhs;
+	BoolLhs.AppendUninitialized(Size);
+	BoolRhs.AppendUninitialized(Size);
+	srand(0);
+	for (index Bit = 0; Bit < Size; ++Bit) {
+		const bool LhsValue = rand() % Density == 0;
+		const bool RhsValue = rand() % Density == 0;
+		Lhs.Set(Bit, LhsValue);
+		Rhs.Set(Bit, RhsValue);
+		BoolLhs[Bit] = LhsValue;
+		BoolRhs[Bit] = RhsValue;
+	}
+
+	// every measured pass starts with operands out of cache, flushing whole cache would dwarf small sizes
+	const auto EvictOperands = [&]() {
+		bench::FlushRange(Lhs.GetWords(), bits::GetNumWords(Size) * sizeof(bits::word));
+		bench::FlushRange(Rhs.GetWords(), bits::GetNumWords(Size) * sizeof(bits::word));
+		bench::FlushRange(BoolLhs.GetData(), Size);
+		bench::FlushRange(BoolRhs.GetData(), Size);
+	};
+	const bench::config Config{
+		.Samples = (u32) Iters, .WarmupSamples = 0, .Iterations = 1, .ItemsPerIteration = Size};
+	const auto RunCold = [&](const char* Name, const auto& Pass) {
+		bench::Run(Name + Bits, Config, [&](bench::state& State) {
+			State.PauseTiming();
+			EvictOperands();
+			State.ResumeTiming();
+			Pass();
+		});
+	};
+	u64 Checksum = 0;
+
+	RunCold("dyn_bitset and + or", [&]() {
+		Lhs &= Rhs;
+		Lhs |= Rhs;
+	});
+	RunCold("dyn_array<bool> and + or", [&]() {
+		for (index Bit = 0; Bit < Size; ++Bit) {
+			BoolLhs[Bit] = BoolLhs[Bit] && BoolRhs[Bit];
+		}
+		for (index Bit = 0; Bit < Size; ++Bit) {
+			BoolLhs[Bit] = BoolLhs[Bit] || BoolRhs[Bit];
+		}
+	});
+	RunCold("dyn_bitset popcount", [&]() { Checksum += Lhs.PopCount(); });
+	RunCold("dyn_array<bool> popcount", [&]() {
+		index Count = 0;
+		for (index Bit = 0; Bit < Size; ++Bit) {
+			Count += BoolLhs[Bit];
+		}
+		Checksum += Count;
+	});
+	RunCold("dyn_bitset iterate set bits", [&]() {
+		for (index Bit : Lhs.GetSetBits()) {
+			Checksum += Bit;
+		}
+	});
+	RunCold("dyn_array<bool> iterate set bits", [&]() {
+		for (index Bit = 0; Bit < Size; ++Bit) {
+			if (BoolLhs[Bit]) {
+				Checksum += Bit;
+			}
+		}
+	});
+	bench::DoNotOptimize(Checksum);
+}
+
+void bitset_test::Benchmark(const std::span<char*>& Args) {
+	TEST_PRINT_LINE();
+	PerformanceTests(1024, 2, 10000);
+	PerformanceTests(1024, 64, 10000);
+	PerformanceTests(1 << 20, 2, 100);
+	PerformanceTests(1 << 20, 64, 100);
+}
+
+TEST_ENTRY(bitset_test);
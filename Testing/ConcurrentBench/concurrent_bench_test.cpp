@@ -0,0 +1,656 @@
+﻿#include "../testing_shared.h"
+#include "Concurrency/ConcurrentMap.h"
+#include "Concurrency/concurrent_hash_table.h"
+#include "Time/cycle_clock.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Sailor headers are MSVC only (windows.h, __forceinline, dependent names without typename)
+#if defined(_MSC_VER)
+#include "ThirdParty/Sailor/ConcurrentMap.h"
+#undef min
+#undef max
+#define BENCH_SAILOR_MAP 1
+#else
+#define BENCH_SAILOR_MAP 0
+#endif
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+// Benchmark driver for concurrent maps: sweeps thread counts, key distributions, operation mixes and
+// prefilled/growing tables, reports throughput, sampled latency percentiles and memory.
+// Usage: concurrent_bench_test_exec --benchmark [--threads=N] [--ops=N] [--keys=N] [--map=name]
+//                                               [--csv=file] [--quick] [--json=file] [--filter=name] [--samples=N]
+// Without --csv/--json results are printed as CSV after the human readable lines. JSON is written by the benchmark
+// harness, with ns per op of every sample and latencies and memory as counters.
+struct concurrent_bench_test {
+	s32 Test(const std::span<char*>& Args);
+	void Benchmark(const std::span<char*>& Args);
+};
+
+enum class key_distribution : u8 { uniform, zipfian, sequential };
+
+static const char* GetName(key_distribution Distribution) {
+	switch (Distribution) {
+		case key_distribution::uniform:
+			return "uniform";
+		case key_distribution::zipfian:
+			return "zipfian";
+		case key_distribution::sequential:
+			return "sequential";
+	}
+	return "";
+}
+
+// percents of lookups, inserts, updates and erases, sum to 100
+struct operation_mix {
+	const char* Name;
+	u32 Lookup;
+	u32 Insert;
+	u32 Update;
+	u32 Erase;
+};
+
+constexpr operation_mix OperationMixes[] = {
+	{"read_only", 100, 0, 0, 0},
+	{"read_mostly", 90, 4, 5, 1},
+	{"balanced", 50, 20, 20, 10},
+	{"write_heavy", 10, 40, 30, 20},
+};
+
+// Prefilled tables get every second key of the key space before timing starts, so they are grown to their
+// steady state size and about half of lookups hit. Growing tables start empty and resize during the run.
+// None of the maps can reserve capacity up front, prefilling is the closest thing to a presized table.
+enum class table_sizing : u8 { prefilled, growing };
+
+static const char* GetName(table_sizing Sizing) {
+	return Sizing == table_sizing::prefilled ? "prefilled" : "growing";
+}
+
+enum class op_type : u8 { lookup, insert, update, erase };
+
+struct bench_op {
+	s64 Key;
+	op_type Type;
+};
+
+// Zipf distribution over ranks [0, NumKeys), rank 0 is the most popular (Gray et al., as used by YCSB).
+// Ranks are scrambled into keys so hot keys don't sit next to each other in hash order or in key order.
+struct zipfian_generator {
+	index NumKeys;
+	double Theta;
+	double Alpha;
+	double Zeta;
+	double Eta;
+	double HalfPowTheta;
+
+	zipfian_generator(index InNumKeys, double InTheta = 0.99) : NumKeys{InNumKeys}, Theta{InTheta} {
+		Zeta = 0;
+		for (index Rank = 1; Rank <= NumKeys; ++Rank) {
+			Zeta += 1.0 / std::pow((double) Rank, Theta);
+		}
+		const double ZetaTwo = 1.0 + 1.0 / std::pow(2.0, Theta);
+		Alpha = 1.0 / (1.0 - Theta);
+		Eta = (1.0 - std::pow(2.0 / (double) NumKeys, 1.0 - Theta)) / (1.0 - ZetaTwo / Zeta);
+		HalfPowTheta = std::pow(0.5, Theta);
+	}
+
+	index NextRank(std::mt19937_64& Generator) const {
+		const double Uniform = std::uniform_real_distribution<double>(0.0, 1.0)(Generator);
+		const double Scaled = Uniform * Zeta;
+		if (Scaled < 1.0) {
+			return 0;
+		}
+		if (Scaled < 1.0 + HalfPowTheta) {
+			return 1;
+		}
+		const index Rank = (index) ((double) NumKeys * std::pow(Eta * Uniform - Eta + 1.0, Alpha));
+		return math::Min(Rank, NumKeys - 1);
+	}
+
+	index Next(std::mt19937_64& Generator) const {
+		return ScrambleRank(NextRank(Generator), NumKeys);
+	}
+
+	static index ScrambleRank(index Rank, index NumKeys) {
+		u64 Hash = (u64) Rank * 0x9e3779b97f4a7c15ull;
+		Hash ^= Hash >> 29;
+		return (index) (Hash % NumKeys);
+	}
+};
+
+struct bench_config {
+	index OpsPerThread = 100000;
+	index NumKeys = 1 << 18;
+	u32 MaxThreads = math::Max(1u, std::thread::hardware_concurrency());
+	// every LatencySampleRate-th op is timed, timing every op would double the cost of the fastest ones
+	index LatencySampleRate = 8;
+	std::string MapFilter;
+	std::string CsvPath;
+	// whole runs, each on a new map
+	u32 Samples = 3;
+	bool Quick = false;
+};
+
+struct bench_result {
+	std::string Map;
+	key_distribution Distribution;
+	const operation_mix* Mix;
+	table_sizing Sizing;
+	u32 NumThreads;
+	index TotalOps;
+	float Ms;
+	float OpsPerSecond;
+	u64 P50Ns;
+	u64 P99Ns;
+	u64 P999Ns;
+	// reported by the map itself, 0 if it can't tell
+	s64 TableBytes;
+	// change of process memory over the run, includes allocator slack and table garbage
+	s64 ProcessBytes;
+	index FinalSize;
+};
+
+static s64 GetProcessMemory() {
+#if defined(_WIN32)
+	return (s64) GetTotalUsedVirtualMemory();
+#else
+	std::ifstream Statm("/proc/self/statm");
+	s64 TotalPages = 0;
+	s64 ResidentPages = 0;
+	Statm >> TotalPages >> ResidentPages;
+	return ResidentPages * (s64) sysconf(_SC_PAGESIZE);
+#endif
+}
+
+// Common interface over maps: lookup doesn't insert, insert assigns new value, update is read-modify-write
+// under map's own locking, erase removes key if present
+template <typename map_type>
+struct locked_map_adapter {
+	using map = map_type;
+
+	FORCEINLINE static bool Lookup(map_type& Map, s64 Key, s64& OutValue) {
+		return Map.Find(Key, OutValue);
+	}
+
+	FORCEINLINE static void Insert(map_type& Map, s64 Key, s64 Value) {
+		Map.AtLock(Key) = Value;
+		Map.Unlock(Key);
+	}
+
+	FORCEINLINE static void Update(map_type& Map, s64 Key) {
+		Map.AtLock(Key) += 1;
+		Map.Unlock(Key);
+	}
+
+	FORCEINLINE static void Erase(map_type& Map, s64 Key) {
+		Map.Remove(Key);
+	}
+
+	FORCEINLINE static index GetSize(map_type& Map) {
+		return Map.GetSize();
+	}
+};
+
+struct concurrent_map_adapter : locked_map_adapter<DaniilPavlenko::ConcurrentMap<s64, s64>> {
+	constexpr static const char* Name = "ConcurrentMap";
+};
+
+struct compact_map_adapter : locked_map_adapter<DaniilPavlenko::CompactConcurrentMap<s64, s64>> {
+	constexpr static const char* Name = "CompactConcurrentMap";
+};
+
+// Inserts assign through operator[] reference, which isn't guarded against concurrent writers of the same key,
+// same as in the rest of the table tests. Updates go through Update() and hold the slot lock like other maps.
+struct concurrent_hash_table_adapter {
+	using map = concurrent_hash_table<s64, s64>;
+	constexpr static const char* Name = "concurrent_hash_table";
+
+	FORCEINLINE static bool Lookup(map& Map, s64 Key, s64& OutValue) {
+		return Map.Find(Key, OutValue);
+	}
+
+	FORCEINLINE static void Insert(map& Map, s64 Key, s64 Value) {
+		Map[Key] = Value;
+	}
+
+	FORCEINLINE static void Update(map& Map, s64 Key) {
+		Map.Update(Key, [](s64& Value) { Value += 1; });
+	}
+
+	FORCEINLINE static void Erase(map& Map, s64 Key) {
+		Map.Remove(Key);
+	}
+
+	FORCEINLINE static index GetSize(map& Map) {
+		return Map.GetSize();
+	}
+};
+
+#if BENCH_SAILOR_MAP
+// Sailor's Find doesn't lock, lookups hold bucket lock of the key around it
+struct sailor_map : Sailor::TConcurrentMap<s64, s64, 8, Sailor::Memory::MallocAllocator> {
+	FORCEINLINE void LockKey(s64 Key) {
+		Lock(Sailor::GetHash(Key));
+	}
+};
+
+struct sailor_map_adapter {
+	using map = sailor_map;
+	constexpr static const char* Name = "Sailor::TConcurrentMap";
+
+	FORCEINLINE static bool Lookup(map& Map, s64 Key, s64& OutValue) {
+		Map.LockKey(Key);
+		s64* Value = nullptr;
+		const bool Found = Map.Find(Key, Value);
+		if (Found) {
+			OutValue = *Value;
+		}
+		Map.Unlock(Key);
+		return Found;
+	}
+
+	FORCEINLINE static void Insert(map& Map, s64 Key, s64 Value) {
+		Map.At_Lock(Key) = Value;
+		Map.Unlock(Key);
+	}
+
+	FORCEINLINE static void Update(map& Map, s64 Key) {
+		Map.At_Lock(Key) += 1;
+		Map.Unlock(Key);
+	}
+
+	FORCEINLINE static void Erase(map& Map, s64 Key) {
+		Map.Remove(Key);
+	}
+
+	FORCEINLINE static index GetSize(map& Map) {
+		return Map.Num();
+	}
+};
+#endif
+
+template <typename adapter_type>
+FORCEINLINE static void RunOp(typename adapter_type::map& Map, const bench_op& Op, s64& Checksum) {
+	switch (Op.Type) {
+		case op_type::lookup: {
+			s64 Value;
+			if (adapter_type::Lookup(Map, Op.Key, Value)) {
+				Checksum += Value;
+			}
+			break;
+		}
+		case op_type::insert:
+			adapter_type::Insert(Map, Op.Key, Op.Key);
+			break;
+		case op_type::update:
+			adapter_type::Update(Map, Op.Key);
+			break;
+		case op_type::erase:
+			adapter_type::Erase(Map, Op.Key);
+			break;
+	}
+}
+
+// Sequential keys are interleaved between threads, together they walk the key space in order
+static std::vector<std::vector<bench_op>> MakeOps(
+	u32 NumThreads, index OpsPerThread, index NumKeys, key_distribution Distribution, const operation_mix& Mix) {
+	std::vector<std::vector<bench_op>> Ops(NumThreads);
+	const zipfian_generator Zipfian{Distribution == key_distribution::zipfian ? NumKeys : 2};
+	for (u32 Thread = 0; Thread < NumThreads; ++Thread) {
+		std::mt19937_64 Generator(Thread * 7919 + 1);
+		std::uniform_int_distribution<index> UniformKey(0, NumKeys - 1);
+		std::uniform_int_distribution<u32> Percent(0, 99);
+		Ops[Thread].reserve(OpsPerThread);
+		for (index Op = 0; Op < OpsPerThread; ++Op) {
+			index Key = 0;
+			switch (Distribution) {
+				case key_distribution::uniform:
+					Key = UniformKey(Generator);
+					break;
+				case key_distribution::zipfian:
+					Key = Zipfian.Next(Generator);
+					break;
+				case key_distribution::sequential:
+					Key = (Op * NumThreads + Thread) % NumKeys;
+					break;
+			}
+			const u32 Roll = Percent(Generator);
+			op_type Type = op_type::erase;
+			if (Roll < Mix.Lookup) {
+				Type = op_type::lookup;
+			} else if (Roll < Mix.Lookup + Mix.Insert) {
+				Type = op_type::insert;
+			} else if (Roll < Mix.Lookup + Mix.Insert + Mix.Update) {
+				Type = op_type::update;
+			}
+			Ops[Thread].push_back({(s64) Key, Type});
+		}
+	}
+	return Ops;
+}
+
+static u64 GetPercentile(const std::vector<u32>& Sorted, double Percentile) {
+	if (Sorted.empty()) {
+		return 0;
+	}
+	const index Rank = (index) std::ceil(Percentile * (double) Sorted.size()) - 1;
+	return Sorted[math::Min(Rank, (index) Sorted.size() - 1)];
+}
+
+// Every sample runs the whole op stream on a new map, setup and thread startup are not timed. Latencies are pooled
+// over samples, memory is that of the last one.
+template <typename adapter_type>
+static void RunBench(
+	const bench_config& Config,
+	u32 NumThreads,
+	key_distribution Distribution,
+	const operation_mix& Mix,
+	table_sizing Sizing,
+	std::vector<bench_result>& Results) {
+	const auto Ops = MakeOps(NumThreads, Config.OpsPerThread, Config.NumKeys, Distribution, Mix);
+	bench_result Result;
+	Result.Map = adapter_type::Name;
+	Result.Distribution = Distribution;
+	Result.Mix = &Mix;
+	Result.Sizing = Sizing;
+	Result.NumThreads = NumThreads;
+	Result.TotalOps = Config.OpsPerThread * NumThreads;
+	std::vector<u32> AllLatencies;
+	s64 Checksum = 0;
+	const std::string Name = std::string{adapter_type::Name} + " " + GetName(Distribution) + " " + Mix.Name + " " +
+							 GetName(Sizing) + " " + std::to_string(NumThreads) + " threads";
+	const bench::config BenchConfig{
+		.Samples = Config.Samples, .WarmupSamples = 0, .Iterations = 1, .ItemsPerIteration = Result.TotalOps};
+	const bench::result* Sampled = bench::Run(Name, BenchConfig, [&](bench::state& State) {
+		State.PauseTiming();
+		const s64 MemoryBefore = GetProcessMemory();
+		auto Map = std::make_unique<typename adapter_type::map>();
+		if (Sizing == table_sizing::prefilled) {
+			for (index Key = 0; Key < Config.NumKeys; Key += 2) {
+				adapter_type::Insert(*Map, (s64) Key, (s64) Key);
+			}
+		}
+		std::vector<std::vector<u32>> Latencies(NumThreads);
+		std::vector<s64> Checksums(NumThreads);
+		std::atomic<bool> Start{false};
+		std::atomic<u32> Ready{0};
+		std::vector<std::thread> Threads;
+		for (u32 Thread = 0; Thread < NumThreads; ++Thread) {
+			Threads.emplace_back([&, Thread]() {
+				std::vector<u32>& ThreadLatencies = Latencies[Thread];
+				ThreadLatencies.reserve(Config.OpsPerThread / Config.LatencySampleRate + 1);
+				s64 ThreadChecksum = 0;
+				Ready.fetch_add(1);
+				while (!Start.load(std::memory_order_acquire)) {
+					std::this_thread::yield();
+				}
+				const std::vector<bench_op>& ThreadOps = Ops[Thread];
+				for (index Op = 0; Op < ThreadOps.size(); ++Op) {
+					if (Op % Config.LatencySampleRate == 0) {
+						const s64 OpStart = cycle_clock::GetNs();
+						RunOp<adapter_type>(*Map, ThreadOps[Op], ThreadChecksum);
+						ThreadLatencies.push_back((u32) math::Min(cycle_clock::GetNs() - OpStart, (s64) UINT32_MAX));
+					} else {
+						RunOp<adapter_type>(*Map, ThreadOps[Op], ThreadChecksum);
+					}
+				}
+				Checksums[Thread] = ThreadChecksum;
+			});
+		}
+		while (Ready.load() < NumThreads) {
+			std::this_thread::yield();
+		}
+		State.ResumeTiming();
+		Start.store(true, std::memory_order_release);
+		for (std::thread& Thread : Threads) {
+			Thread.join();
+		}
+		State.PauseTiming();
+
+		for (const std::vector<u32>& ThreadLatencies : Latencies) {
+			AllLatencies.insert(AllLatencies.end(), ThreadLatencies.begin(), ThreadLatencies.end());
+		}
+		for (s64 ThreadChecksum : Checksums) {
+			Checksum += ThreadChecksum;
+		}
+		Result.TableBytes = 0;
+		if constexpr (requires(typename adapter_type::map& Map) { Map.GetAllocatedSize(); }) {
+			Result.TableBytes = (s64) Map->GetAllocatedSize();
+		}
+		Result.ProcessBytes = GetProcessMemory() - MemoryBefore;
+		Result.FinalSize = adapter_type::GetSize(*Map);
+		Map.reset();
+		std::sort(AllLatencies.begin(), AllLatencies.end());
+		State.SetCounter("p50 ns", (double) GetPercentile(AllLatencies, 0.50));
+		State.SetCounter("p99 ns", (double) GetPercentile(AllLatencies, 0.99));
+		State.SetCounter("p99.9 ns", (double) GetPercentile(AllLatencies, 0.999));
+		State.SetCounter("keys", (double) Result.FinalSize);
+		State.SetCounter("table KB", (double) Result.TableBytes / 1024.0);
+		State.SetCounter("process KB", (double) Result.ProcessBytes / 1024.0);
+		State.ResumeTiming();
+	});
+	if (!Sampled) {
+		return;
+	}
+	// keeps checksums alive, lookups could be optimized out otherwise
+	CHECK(Checksum != -1)
+	Result.Ms = (float) (Sampled->MedianNs * (double) Result.TotalOps * 1e-6);
+	Result.OpsPerSecond = (float) Result.TotalOps / math::Max(Result.Ms, 0.001f) * 1000.f;
+	Result.P50Ns = GetPercentile(AllLatencies, 0.50);
+	Result.P99Ns = GetPercentile(AllLatencies, 0.99);
+	Result.P999Ns = GetPercentile(AllLatencies, 0.999);
+	Results.push_back(Result);
+}
+
+static void WriteCsv(std::ostream& Stream, const std::vector<bench_result>& Results) {
+	Stream << "map,distribution,mix,sizing,threads,ops,ms,ops_per_sec,p50_ns,p99_ns,p999_ns,table_bytes,"
+			  "process_bytes,final_size\n";
+	for (const bench_result& Result : Results) {
+		Stream << Result.Map << "," << GetName(Result.Distribution) << "," << Result.Mix->Name << ","
+			   << GetName(Result.Sizing) << "," << Result.NumThreads << "," << Result.TotalOps << "," << Result.Ms
+			   << "," << Result.OpsPerSecond << "," << Result.P50Ns << "," << Result.P99Ns << "," << Result.P999Ns
+			   << "," << Result.TableBytes << "," << Result.ProcessBytes << "," << Result.FinalSize << "\n";
+	}
+}
+
+static std::vector<u32> GetThreadCounts(u32 MaxThreads) {
+	std::vector<u32> Counts;
+	for (u32 NumThreads = 1; NumThreads < MaxThreads; NumThreads *= 2) {
+		Counts.push_back(NumThreads);
+	}
+	Counts.push_back(MaxThreads);
+	return Counts;
+}
+
+template <typename adapter_type>
+static void RunSweep(const bench_config& Config, std::vector<bench_result>& Results) {
+	if (!Config.MapFilter.empty() && std::string_view{adapter_type::Name}.find(Config.MapFilter) == std::string::npos) {
+		return;
+	}
+	std::cout << "------------------------------------------" << std::endl;
+	for (key_distribution Distribution :
+		 {key_distribution::uniform, key_distribution::zipfian, key_distribution::sequential}) {
+		for (const operation_mix& Mix : OperationMixes) {
+			for (table_sizing Sizing : {table_sizing::prefilled, table_sizing::growing}) {
+				// nothing to look up in a table that never gets keys
+				if (Sizing == table_sizing::growing && Mix.Insert + Mix.Update == 0) {
+					continue;
+				}
+				for (u32 NumThreads : GetThreadCounts(Config.MaxThreads)) {
+					RunBench<adapter_type>(Config, NumThreads, Distribution, Mix, Sizing, Results);
+				}
+			}
+		}
+	}
+}
+
+static std::vector<bench_result> RunAll(const bench_config& Config) {
+	std::vector<bench_result> Results;
+	RunSweep<concurrent_hash_table_adapter>(Config, Results);
+	RunSweep<concurrent_map_adapter>(Config, Results);
+	RunSweep<compact_map_adapter>(Config, Results);
+#if BENCH_SAILOR_MAP
+	RunSweep<sailor_map_adapter>(Config, Results);
+#endif
+	return Results;
+}
+
+static bool ZipfianCheck() {
+	std::cout << "------------------------------------------" << std::endl;
+	const index NumKeys = 1000;
+	const zipfian_generator Zipfian{NumKeys};
+	std::mt19937_64 Generator(1);
+	std::vector<index> Counts(NumKeys);
+	const index NumSamples = 1000000;
+	bool InRange = true;
+	for (index Sample = 0; Sample < NumSamples; ++Sample) {
+		const index Rank = Zipfian.NextRank(Generator);
+		InRange = InRange && Rank < NumKeys;
+		Counts[math::Min(Rank, NumKeys - 1)]++;
+	}
+	TEST_CHECK(InRange, "ranks in range");
+	// with theta 0.99 probability of rank r is about 1 / (r + 1) / Zeta
+	const double Expected = (double) NumSamples / Zipfian.Zeta;
+	TEST_CHECK(std::abs((double) Counts[0] - Expected) < Expected * 0.05, "most popular rank frequency");
+	TEST_CHECK(Counts[0] > Counts[1] && Counts[1] > Counts[10] && Counts[10] > Counts[500], "skewed");
+	std::vector<bool> Seen(NumKeys);
+	for (index Rank = 0; Rank < NumKeys; ++Rank) {
+		Seen[zipfian_generator::ScrambleRank(Rank, NumKeys)] = true;
+	}
+	TEST_CHECK(std::count(Seen.begin(), Seen.end(), true) > NumKeys / 2, "scrambled keys are spread");
+	return true;
+}
+
+// Single thread op stream against std::unordered_map, checks that adapters implement the same semantics
+template <typename adapter_type>
+static bool AdapterCheck() {
+	std::cout << "------------------------------------------" << std::endl;
+	std::cout << "Testing " << adapter_type::Name << std::endl;
+	const auto Ops = MakeOps(1, 200000, 5000, key_distribution::uniform, OperationMixes[2]);
+	typename adapter_type::map Map;
+	std::unordered_map<s64, s64> Ideal;
+	bool LookupsMatch = true;
+	for (const bench_op& Op : Ops[0]) {
+		switch (Op.Type) {
+			case op_type::lookup: {
+				s64 Value = 0;
+				const bool Found = adapter_type::Lookup(Map, Op.Key, Value);
+				const auto Iter = Ideal.find(Op.Key);
+				LookupsMatch = LookupsMatch && Found == (Iter != Ideal.end()) && (!Found || Value == Iter->second);
+				break;
+			}
+			case op_type::insert:
+				adapter_type::Insert(Map, Op.Key, Op.Key);
+				Ideal[Op.Key] = Op.Key;
+				break;
+			case op_type::update:
+				adapter_type::Update(Map, Op.Key);
+				Ideal[Op.Key] += 1;
+				break;
+			case op_type::erase:
+				adapter_type::Erase(Map, Op.Key);
+				Ideal.erase(Op.Key);
+				break;
+		}
+	}
+	TEST_CHECK(LookupsMatch, "lookups match reference");
+	TEST_CHECK(adapter_type::GetSize(Map) == Ideal.size(), "size matches reference");
+	return true;
+}
+
+static bool DriverCheck() {
+	std::cout << "------------------------------------------" << std::endl;
+	bench_config Config;
+	Config.OpsPerThread = 2000;
+	Config.NumKeys = 1024;
+	Config.MaxThreads = 2;
+	Config.MapFilter = "ConcurrentMap";
+	const std::vector<bench_result> Results = RunAll(Config);
+	bool Sane = !Results.empty();
+	for (const bench_result& Result : Results) {
+		Sane = Sane && Result.TotalOps == Config.OpsPerThread * Result.NumThreads && Result.P50Ns <= Result.P99Ns &&
+			   Result.P99Ns <= Result.P999Ns && Result.FinalSize <= Config.NumKeys;
+	}
+	TEST_CHECK(Sane, "results are consistent");
+	std::ostringstream Csv;
+	WriteCsv(Csv, Results);
+	const std::string CsvText = Csv.str();
+	TEST_CHECK((index) std::count(CsvText.begin(), CsvText.end(), '\n') == Results.size() + 1, "one csv row per run");
+	return true;
+}
+
+s32 concurrent_bench_test::Test(const std::span<char*>& Args) {
+	TEST_PRINT_LINE();
+	bool Passed = true;
+	Passed = Passed && ZipfianCheck();
+	Passed = Passed && AdapterCheck<concurrent_hash_table_adapter>();
+	Passed = Passed && AdapterCheck<concurrent_map_adapter>();
+	Passed = Passed && AdapterCheck<compact_map_adapter>();
+#if BENCH_SAILOR_MAP
+	Passed = Passed && AdapterCheck<sailor_map_adapter>();
+#endif
+	Passed = Passed && DriverCheck();
+	return Passed ? 0 : 1;
+}
+
+static bench_config ParseConfig(const std::span<char*>& Args) {
+	bench_config Config;
+	for (index Arg = 2; Arg < Args.size(); ++Arg) {
+		const std::string_view Option{Args[Arg]};
+		const size_t Separator = Option.find('=');
+		const std::string_view Name = Option.substr(0, Separator);
+		const std::string Value{Separator == std::string_view::npos ? "" : Option.substr(Separator + 1)};
+		if (Name == "--threads") {
+			Config.MaxThreads = math::Max(1u, (u32) std::stoul(Value));
+		} else if (Name == "--ops") {
+			Config.OpsPerThread = (index) std::stoull(Value);
+		} else if (Name == "--keys") {
+			Config.NumKeys = math::Max((index) 2, (index) std::stoull(Value));
+		} else if (Name == "--map") {
+			Config.MapFilter = Value;
+		} else if (Name == "--csv") {
+			Config.CsvPath = Value;
+		} else if (Name == "--quick") {
+			Config.Quick = true;
+		} else if (!bench::IsOption(Option)) {
+			std::cout << "Unknown option " << Option << std::endl;
+		}
+	}
+	if (Config.Quick) {
+		Config.OpsPerThread = math::Min(Config.OpsPerThread, (index) 20000);
+		Config.NumKeys = math::Min(Config.NumKeys, (index) 1 << 14);
+	}
+	return Config;
+}
+
+void concurrent_bench_test::Benchmark(const std::span<char*>& Args) {
+	TEST_PRINT_LINE();
+	const bench_config Config = ParseConfig(Args);
+	std::cout << "Testing up to " << Config.MaxThreads << " threads, " << Config.OpsPerThread << " ops per thread, "
+			  << Config.NumKeys << " keys" << std::endl;
+	const std::vector<bench_result> Results = RunAll(Config);
+	if (!Config.CsvPath.empty()) {
+		std::ofstream File(Config.CsvPath);
+		WriteCsv(File, Results);
+		std::cout << "Results written to " << Config.CsvPath << std::endl;
+	}
+	if (Config.CsvPath.empty() && bench::GetSession().JsonPath.empty()) {
+		std::cout << "------------------------------------------" << std::endl;
+		WriteCsv(std::cout, Results);
+	}
+}
+
+TEST_ENTRY(concurrent_bench_test);
@@ -1,41 +1,16 @@
 #include "Concurrency/ConcurrentMap.h"
+#include "Concurrency/concurrent_hash_table.h"
+#include "Time/cycle_clock.h"
+#include "../benchmark.h"
+#include <algorithm>
 #include <iostream>
 #include <unordered_map>
 #include <random>
 #include <thread>
 #include <syncstream>
 
-struct timer {
-	using time_point = std::chrono::time_point<std::chrono::high_resolution_clock>;
-	time_point mStart{};
-	float mAccumulator{0};
-	
-	void Start() {
-		mStart = std::chrono::high_resolution_clock::now();
-	}
-
-	void Stop() {
-		time_point End = std::chrono::high_resolution_clock::now();
-		long Time = std::chrono::duration_cast<std::chrono::microseconds>(End - mStart).count();
-		mAccumulator += Time / 1000.f;
-	}
-
-	[[nodiscard]] float Result() const {
-		return mAccumulator;
-	}
-
-	void Offset(const timer& OffsetTimer) {
-		mAccumulator -= OffsetTimer.mAccumulator;
-	}
-
-	void Clear() {
-		mStart = {};
-		mAccumulator = 0;
-	}
-};
-
-template <typename key_type, typename value_type>
-bool Compare(std::unordered_map<key_type, value_type>& Ideal, DaniilPavlenko::ConcurrentMap<key_type, value_type>& Test) {
+template <typename key_type, typename value_type, typename map_type>
+bool Compare(std::unordered_map<key_type, value_type>& Ideal, map_type& Test) {
 	if (Ideal.size() != Test.GetSize()) {
 		return false;
 	}
@@ -58,8 +33,8 @@ void IdealThreadInsertions(std::unordered_map<key_type, value_type>* Ideal, int
 	}
 }
 
-template <typename key_type, typename value_type>
-void TestThreadInsertions(DaniilPavlenko::ConcurrentMap<key_type, value_type>* Test, int Seed, int Count, int Min, int Max) {
+template <typename key_type, typename value_type, typename map_type>
+void TestThreadInsertions(map_type* Test, int Seed, int Count, int Min, int Max) {
 	std::default_random_engine Generator(Seed);
 	std::uniform_int_distribution<int> Distribution(Min, Max);
 	for (int i = Min; i < Min + Count; ++i) {
@@ -80,8 +55,8 @@ void IdealThreadDeletions(std::unordered_map<key_type, value_type>* Ideal, int S
 	}
 }
 
-template <typename key_type, typename value_type>
-void TestThreadDeletions(DaniilPavlenko::ConcurrentMap<key_type, value_type>* Test, int Seed, int Count, int Min, int Max) {
+template <typename key_type, typename value_type, typename map_type>
+void TestThreadDeletions(map_type* Test, int Seed, int Count, int Min, int Max) {
 	std::default_random_engine Generator(Seed);
 	std::uniform_int_distribution<int> Distribution(Min, Max);
 	for (int i = Min; i < Min + Count; ++i) {
@@ -106,8 +81,8 @@ void IdealThreadMix(std::unordered_map<key_type, value_type>* Ideal, int Seed, i
 	}
 }
 
-template <typename key_type, typename value_type>
-void TestThreadMix(DaniilPavlenko::ConcurrentMap<key_type, value_type>* Test, int Seed, int Count, int Min, int Max) {
+template <typename key_type, typename value_type, typename map_type>
+void TestThreadMix(map_type* Test, int Seed, int Count, int Min, int Max) {
 	std::default_random_engine Generator(Seed);
 	std::uniform_int_distribution<int> Distribution(Min, Max);
 	std::uniform_int_distribution<int> SwitchDistribution(0, 1);
@@ -123,13 +98,72 @@ void TestThreadMix(DaniilPavlenko::ConcurrentMap<key_type, value_type>* Test, in
 	}
 }
 
-int main() {
-	int NumThreads = 32;
-	int Count = 100000;
-	bool SameKeys = false;
+void GrowthInsert(DaniilPavlenko::ConcurrentMap<int, int>& Test, int Key, int Value) {
+	Test.AtLock(Key) = Value;
+	Test.Unlock(Key);
+}
+
+void GrowthInsert(DaniilPavlenko::CompactConcurrentMap<int, int>& Test, int Key, int Value) {
+	Test.AtLock(Key) = Value;
+	Test.Unlock(Key);
+}
+
+void GrowthInsert(concurrent_hash_table<int, int>& Test, int Key, int Value) {
+	Test[Key] = Value;
+}
+
+template <typename map_type>
+void GrowthThreadInsertions(map_type* Test, std::vector<s64>* Latencies, int Count, int Min) {
+	Latencies->reserve(Count);
+	for (int i = Min; i < Min + Count; ++i) {
+		const s64 Start = cycle_clock::GetNs();
+		GrowthInsert(*Test, i, i);
+		Latencies->push_back(cycle_clock::GetNs() - Start);
+	}
+}
+
+// Inserts into initially empty map, so most of the operations run while map is growing.
+// Total time hides threads stalled by relocation, tail latency doesn't.
+template <typename map_type>
+void GrowthLatencyTest(const char* Name, int NumThreads, int Count) {
+	map_type Test;
+	std::vector<std::vector<s64>> Latencies(NumThreads);
+	const bench::config OneShot{
+		.Samples = 1, .WarmupSamples = 0, .Iterations = 1, .ItemsPerIteration = (u64) NumThreads * Count};
+	bench::Run(std::string{Name} + " growth insert", OneShot, [&](bench::state& State) {
+		std::vector<std::thread> Threads{};
+		for (int i = 0; i < NumThreads; ++i) {
+			Threads.push_back(std::thread{GrowthThreadInsertions<map_type>, &Test, &Latencies[i], Count, i * Count});
+		}
+		for (int i = 0; i < NumThreads; ++i) {
+			Threads[i].join();
+		}
+		State.PauseTiming();
+
+		std::vector<s64> AllLatencies;
+		AllLatencies.reserve((size_t) NumThreads * Count);
+		for (auto& ThreadLatencies : Latencies) {
+			AllLatencies.insert(AllLatencies.end(), ThreadLatencies.begin(), ThreadLatencies.end());
+		}
+		std::sort(AllLatencies.begin(), AllLatencies.end());
+		auto Percentile = [&](double Fraction) {
+			return (double) AllLatencies[std::min(AllLatencies.size() - 1, (size_t) (Fraction * AllLatencies.size()))];
+		};
+		State.SetCounter("p50 ns", Percentile(0.5));
+		State.SetCounter("p99 ns", Percentile(0.99));
+		State.SetCounter("p99.9 ns", Percentile(0.999));
+		State.SetCounter("max ns", (double) AllLatencies.back());
+		State.ResumeTiming();
+	});
+	std::cout << "GROWTH INSERT " << Name << " CHECK " << (Test.GetSize() == (size_t) NumThreads * Count) << std::endl;
+}
+
+template <typename map_type>
+void Contest(const char* Name, int NumThreads, int Count, bool SameKeys) {
 	using key_type = int;
 	using value_type = int;
-	
+	std::cout << "CONTEST " << Name << std::endl;
+
 	std::vector<int> Seeds;
 	std::vector<std::pair<int, int>> KeyRanges;
 	Seeds.reserve(NumThreads);
@@ -143,146 +177,144 @@ int main() {
 		}
 	}
 	std::unordered_map<key_type, value_type> SequentialIdeal;
-	DaniilPavlenko::ConcurrentMap<key_type, value_type> SequentialTest;
-	DaniilPavlenko::ConcurrentMap<key_type, value_type> MultithreadingTest;
-	
-	timer SequentialInsertIdealTimer;
-	timer SequentialInsertTestTimer;
-	timer MultithreadingInsertTestTimer;
-
-	SequentialInsertIdealTimer.Start();
-	for (int i = 0; i < NumThreads; ++i) {
-		IdealThreadInsertions<key_type, value_type>(
-			&SequentialIdeal, Seeds[i], Count, KeyRanges[i].first, KeyRanges[i].second);
-	}
-	SequentialInsertIdealTimer.Stop();
+	map_type SequentialTest;
+	map_type MultithreadingTest;
+	// every phase continues from the maps the previous one left, so each is timed once
+	const bench::config OneShot{
+		.Samples = 1, .WarmupSamples = 0, .Iterations = 1, .ItemsPerIteration = (u64) NumThreads * Count};
+
+	bench::Run(std::string{Name} + " sequential insert std::unordered_map", OneShot, [&](bench::state&) {
+		for (int i = 0; i < NumThreads; ++i) {
+			IdealThreadInsertions<key_type, value_type>(
+				&SequentialIdeal, Seeds[i], Count, KeyRanges[i].first, KeyRanges[i].second);
+		}
+	});
 
-	SequentialInsertTestTimer.Start();
-	for (int i = 0; i < NumThreads; ++i) {
-		TestThreadInsertions<key_type, value_type>(
-			&SequentialTest, Seeds[i], Count, KeyRanges[i].first, KeyRanges[i].second);
-	}
-	SequentialInsertTestTimer.Stop();
+	bench::Run(std::string{Name} + " sequential insert", OneShot, [&](bench::state&) {
+		for (int i = 0; i < NumThreads; ++i) {
+			TestThreadInsertions<key_type, value_type, map_type>(
+				&SequentialTest, Seeds[i], Count, KeyRanges[i].first, KeyRanges[i].second);
+		}
+	});
 
 	bool SequentialInsertResult = Compare(SequentialIdeal, SequentialTest);
 
-	std::cout << "SEQUENTIAL INSERT IDEAL TIME: " << SequentialInsertIdealTimer.Result() << " ms" << std::endl;
-	std::cout << "SEQUENTIAL INSERT TEST  TIME: " << SequentialInsertTestTimer.Result() << " ms" << std::endl;
 	std::cout << "SEQUENTIAL INSERT CHECK " << SequentialInsertResult << std::endl;
 
-	MultithreadingInsertTestTimer.Start();
-	std::vector<std::thread> Threads{};
-	for (int i = 0; i < NumThreads; ++i) {
-		Threads.push_back(std::thread{
-			TestThreadInsertions<key_type, value_type>,
-			&MultithreadingTest,
-			Seeds[i],
-			Count,
-			KeyRanges[i].first,
-			KeyRanges[i].second});
-	}
-	for (int i = 0; i < NumThreads; ++i) {
-		Threads[i].join();
-	}
-	MultithreadingInsertTestTimer.Stop();
+	bench::Run(std::string{Name} + " multithreaded insert", OneShot, [&](bench::state&) {
+		std::vector<std::thread> Threads{};
+		for (int i = 0; i < NumThreads; ++i) {
+			Threads.push_back(std::thread{
+				TestThreadInsertions<key_type, value_type, map_type>,
+				&MultithreadingTest,
+				Seeds[i],
+				Count,
+				KeyRanges[i].first,
+				KeyRanges[i].second});
+		}
+		for (int i = 0; i < NumThreads; ++i) {
+			Threads[i].join();
+		}
+	});
 
 	bool MultithreadingInsertResult = Compare(SequentialIdeal, MultithreadingTest);
 
-	std::cout << "MLTITHREAD INSERT TEST  TIME: " << MultithreadingInsertTestTimer.Result() << " ms" << std::endl;
 	std::cout << "MLTITHREAD INSERT CHECK " << MultithreadingInsertResult << std::endl;
 
 	// ---------------------------------------------------------------------------
 
-	timer SequentialMixIdealTimer;
-	timer SequentialMixTestTimer;
-	timer MultithreadingMixTestTimer;
-
-	SequentialMixIdealTimer.Start();
-	for (int i = 0; i < NumThreads; ++i) {
-		IdealThreadMix<key_type, value_type>(
-			&SequentialIdeal, Seeds[i], Count, KeyRanges[i].first, KeyRanges[i].second);
-	}
-	SequentialMixIdealTimer.Stop();
+	bench::Run(std::string{Name} + " sequential mix std::unordered_map", OneShot, [&](bench::state&) {
+		for (int i = 0; i < NumThreads; ++i) {
+			IdealThreadMix<key_type, value_type>(
+				&SequentialIdeal, Seeds[i], Count, KeyRanges[i].first, KeyRanges[i].second);
+		}
+	});
 
-	SequentialMixTestTimer.Start();
-	for (int i = 0; i < NumThreads; ++i) {
-		TestThreadMix<key_type, value_type>(&SequentialTest, Seeds[i], Count, KeyRanges[i].first, KeyRanges[i].second);
-	}
-	SequentialMixTestTimer.Stop();
+	bench::Run(std::string{Name} + " sequential mix", OneShot, [&](bench::state&) {
+		for (int i = 0; i < NumThreads; ++i) {
+			TestThreadMix<key_type, value_type, map_type>(
+				&SequentialTest, Seeds[i], Count, KeyRanges[i].first, KeyRanges[i].second);
+		}
+	});
 
 	bool SequentialMixResult = Compare(SequentialIdeal, SequentialTest);
 
-	std::cout << "SEQUENTIAL MIX IDEAL TIME: " << SequentialMixIdealTimer.Result() << " ms" << std::endl;
-	std::cout << "SEQUENTIAL MIX TEST  TIME: " << SequentialMixTestTimer.Result() << " ms" << std::endl;
 	std::cout << "SEQUENTIAL MIX CHECK " << SequentialMixResult << std::endl;
 
-	MultithreadingMixTestTimer.Start();
-	std::vector<std::thread> Threads3{};
-	for (int i = 0; i < NumThreads; ++i) {
-		Threads3.push_back(std::thread{
-			TestThreadMix<key_type, value_type>,
-			&MultithreadingTest,
-			Seeds[i],
-			Count,
-			KeyRanges[i].first,
-			KeyRanges[i].second});
-	}
-	for (int i = 0; i < NumThreads; ++i) {
-		Threads3[i].join();
-	}
-	MultithreadingMixTestTimer.Stop();
+	bench::Run(std::string{Name} + " multithreaded mix", OneShot, [&](bench::state&) {
+		std::vector<std::thread> Threads3{};
+		for (int i = 0; i < NumThreads; ++i) {
+			Threads3.push_back(std::thread{
+				TestThreadMix<key_type, value_type, map_type>,
+				&MultithreadingTest,
+				Seeds[i],
+				Count,
+				KeyRanges[i].first,
+				KeyRanges[i].second});
+		}
+		for (int i = 0; i < NumThreads; ++i) {
+			Threads3[i].join();
+		}
+	});
 
 	bool MultithreadingMixResult = Compare(SequentialIdeal, MultithreadingTest);
 
-	std::cout << "MLTITHREAD MIX TEST  TIME: " << MultithreadingMixTestTimer.Result() << " ms" << std::endl;
 	std::cout << "MLTITHREAD MIX CHECK " << MultithreadingMixResult << std::endl;
 
 	// ---------------------------------------------------------------------------
 
-	timer SequentialDeleteIdealTimer;
-	timer SequentialDeleteTestTimer;
-	timer MultithreadingDeleteTestTimer;
-
-	SequentialDeleteIdealTimer.Start();
-	for (int i = 0; i < NumThreads; ++i) {
-		IdealThreadDeletions<key_type, value_type>(
-			&SequentialIdeal, Seeds[i], Count, KeyRanges[i].first, KeyRanges[i].second);
-	}
-	SequentialDeleteIdealTimer.Stop();
+	bench::Run(std::string{Name} + " sequential delete std::unordered_map", OneShot, [&](bench::state&) {
+		for (int i = 0; i < NumThreads; ++i) {
+			IdealThreadDeletions<key_type, value_type>(
+				&SequentialIdeal, Seeds[i], Count, KeyRanges[i].first, KeyRanges[i].second);
+		}
+	});
 
-	SequentialDeleteTestTimer.Start();
-	for (int i = 0; i < NumThreads; ++i) {
-		TestThreadDeletions<key_type, value_type>(
-			&SequentialTest, Seeds[i], Count, KeyRanges[i].first, KeyRanges[i].second);
-	}
-	SequentialDeleteTestTimer.Stop();
+	bench::Run(std::string{Name} + " sequential delete", OneShot, [&](bench::state&) {
+		for (int i = 0; i < NumThreads; ++i) {
+			TestThreadDeletions<key_type, value_type, map_type>(
+				&SequentialTest, Seeds[i], Count, KeyRanges[i].first, KeyRanges[i].second);
+		}
+	});
 
 	bool SequentialDeleteResult = Compare(SequentialIdeal, SequentialTest);
 
-	std::cout << "SEQUENTIAL DELETE IDEAL TIME: " << SequentialDeleteIdealTimer.Result() << " ms" << std::endl;
-	std::cout << "SEQUENTIAL DELETE TEST  TIME: " << SequentialDeleteTestTimer.Result() << " ms" << std::endl;
 	std::cout << "SEQUENTIAL DELETE CHECK " << SequentialDeleteResult << std::endl;
 
-	MultithreadingDeleteTestTimer.Start();
-	std::vector<std::thread> Threads2{};
-	for (int i = 0; i < NumThreads; ++i) {
-		Threads2.push_back(std::thread{
-			TestThreadDeletions<key_type, value_type>,
-			&MultithreadingTest,
-			Seeds[i],
-			Count,
-			KeyRanges[i].first,
-			KeyRanges[i].second});
-	}
-	for (int i = 0; i < NumThreads; ++i) {
-		Threads2[i].join();
-	}
-	MultithreadingDeleteTestTimer.Stop();
+	bench::Run(std::string{Name} + " multithreaded delete", OneShot, [&](bench::state&) {
+		std::vector<std::thread> Threads2{};
+		for (int i = 0; i < NumThreads; ++i) {
+			Threads2.push_back(std::thread{
+				TestThreadDeletions<key_type, value_type, map_type>,
+				&MultithreadingTest,
+				Seeds[i],
+				Count,
+				KeyRanges[i].first,
+				KeyRanges[i].second});
+		}
+		for (int i = 0; i < NumThreads; ++i) {
+			Threads2[i].join();
+		}
+	});
 
 	bool MultithreadingDeleteResult = Compare(SequentialIdeal, MultithreadingTest);
 
-	std::cout << "MLTITHREAD DELETE TEST  TIME: " << MultithreadingDeleteTestTimer.Result() << " ms" << std::endl;
 	std::cout << "MLTITHREAD DELETE CHECK " << MultithreadingDeleteResult << std::endl;
+}
+
+int main() {
+	int NumThreads = 32;
+	int Count = 100000;
+	bool SameKeys = false;
+
+	Contest<DaniilPavlenko::ConcurrentMap<int, int>>("CONCURRENT MAP", NumThreads, Count, SameKeys);
+	Contest<DaniilPavlenko::CompactConcurrentMap<int, int>>("COMPACT CONCURRENT MAP", NumThreads, Count, SameKeys);
+
+	// ---------------------------------------------------------------------------
+
+	GrowthLatencyTest<DaniilPavlenko::ConcurrentMap<int, int>>("CONCURRENT MAP", NumThreads, Count);
+	GrowthLatencyTest<DaniilPavlenko::CompactConcurrentMap<int, int>>("COMPACT CONCURRENT MAP", NumThreads, Count);
+	GrowthLatencyTest<concurrent_hash_table<int, int>>("CONCURRENT HASH TABLE", NumThreads, Count);
 
 	return 0;
 }
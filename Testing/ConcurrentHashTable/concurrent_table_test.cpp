@@ -1,6 +1,8 @@
 ﻿#include "Concurrency/concurrent_hash_table.h"
+#include "Concurrency/ConcurrentMap.h"
 #include "../testing_shared.h"
 
+#include <atomic>
 #include <thread>
 #include <syncstream>
 #include <unordered_map>
@@ -121,31 +123,20 @@ static bool SanityCheck(int Count, int NumThreads, bool SameKeys) {
 	concurrent_hash_table<key_type, value_type> SequentialTest;
 	concurrent_hash_table<key_type, value_type> MultithreadingTest;
 
-	timer SequentialInsertIdealTimer;
-	timer SequentialInsertTestTimer;
-	timer MultithreadingInsertTestTimer;
-
-	SequentialInsertIdealTimer.Start();
 	for (int i = 0; i < NumThreads; ++i) {
 		IdealThreadInsertions<key_type, value_type>(
 			&SequentialIdeal, Seeds[i], Count, KeyRanges[i].first, KeyRanges[i].second);
 	}
-	SequentialInsertIdealTimer.Stop();
 
-	SequentialInsertTestTimer.Start();
 	for (int i = 0; i < NumThreads; ++i) {
 		TestThreadInsertions<key_type, value_type>(
 			&SequentialTest, Seeds[i], Count, KeyRanges[i].first, KeyRanges[i].second);
 	}
-	SequentialInsertTestTimer.Stop();
 
 	bool SequentialInsertResult = Compare(SequentialIdeal, SequentialTest);
 
-	std::cout << "SEQUENTIAL INSERT IDEAL TIME: " << SequentialInsertIdealTimer.Result() << " ms" << std::endl;
-	std::cout << "SEQUENTIAL INSERT TEST  TIME: " << SequentialInsertTestTimer.Result() << " ms" << std::endl;
 	std::cout << "SEQUENTIAL INSERT CHECK " << SequentialInsertResult << std::endl;
 
-	MultithreadingInsertTestTimer.Start();
 	std::vector<std::thread> Threads{};
 	for (int i = 0; i < NumThreads; ++i) {
 		Threads.push_back(std::thread{
@@ -159,40 +150,27 @@ static bool SanityCheck(int Count, int NumThreads, bool SameKeys) {
 	for (int i = 0; i < NumThreads; ++i) {
 		Threads[i].join();
 	}
-	MultithreadingInsertTestTimer.Stop();
 
 	bool MultithreadingInsertResult = Compare(SequentialIdeal, MultithreadingTest);
 
-	std::cout << "MLTITHREAD INSERT TEST  TIME: " << MultithreadingInsertTestTimer.Result() << " ms" << std::endl;
 	std::cout << "MLTITHREAD INSERT CHECK " << MultithreadingInsertResult << std::endl;
 	CHECK(MultithreadingInsertResult);
 
 	// ---------------------------------------------------------------------------
 
-	timer SequentialMixIdealTimer;
-	timer SequentialMixTestTimer;
-	timer MultithreadingMixTestTimer;
-
-	SequentialMixIdealTimer.Start();
 	for (int i = 0; i < NumThreads; ++i) {
 		IdealThreadMix<key_type, value_type>(
 			&SequentialIdeal, Seeds[i], Count, KeyRanges[i].first, KeyRanges[i].second);
 	}
-	SequentialMixIdealTimer.Stop();
 
-	SequentialMixTestTimer.Start();
 	for (int i = 0; i < NumThreads; ++i) {
 		TestThreadMix<key_type, value_type>(&SequentialTest, Seeds[i], Count, KeyRanges[i].first, KeyRanges[i].second);
 	}
-	SequentialMixTestTimer.Stop();
 
 	bool SequentialMixResult = Compare(SequentialIdeal, SequentialTest);
 
-	std::cout << "SEQUENTIAL MIX IDEAL TIME: " << SequentialMixIdealTimer.Result() << " ms" << std::endl;
-	std::cout << "SEQUENTIAL MIX TEST  TIME: " << SequentialMixTestTimer.Result() << " ms" << std::endl;
 	std::cout << "SEQUENTIAL MIX CHECK " << SequentialMixResult << std::endl;
 
-	MultithreadingMixTestTimer.Start();
 	std::vector<std::thread> Threads3{};
 	for (int i = 0; i < NumThreads; ++i) {
 		Threads3.push_back(std::thread{
@@ -206,41 +184,28 @@ static bool SanityCheck(int Count, int NumThreads, bool SameKeys) {
 	for (int i = 0; i < NumThreads; ++i) {
 		Threads3[i].join();
 	}
-	MultithreadingMixTestTimer.Stop();
 
 	bool MultithreadingMixResult = Compare(SequentialIdeal, MultithreadingTest);
 
-	std::cout << "MLTITHREAD MIX TEST  TIME: " << MultithreadingMixTestTimer.Result() << " ms" << std::endl;
 	std::cout << "MLTITHREAD MIX CHECK " << MultithreadingMixResult << std::endl;
 	CHECK(MultithreadingMixResult);
 
 	// ---------------------------------------------------------------------------
 
-	timer SequentialDeleteIdealTimer;
-	timer SequentialDeleteTestTimer;
-	timer MultithreadingDeleteTestTimer;
-
-	SequentialDeleteIdealTimer.Start();
 	for (int i = 0; i < NumThreads; ++i) {
 		IdealThreadDeletions<key_type, value_type>(
 			&SequentialIdeal, Seeds[i], Count, KeyRanges[i].first, KeyRanges[i].second);
 	}
-	SequentialDeleteIdealTimer.Stop();
 
-	SequentialDeleteTestTimer.Start();
 	for (int i = 0; i < NumThreads; ++i) {
 		TestThreadDeletions<key_type, value_type>(
 			&SequentialTest, Seeds[i], Count, KeyRanges[i].first, KeyRanges[i].second);
 	}
-	SequentialDeleteTestTimer.Stop();
 
 	bool SequentialDeleteResult = Compare(SequentialIdeal, SequentialTest);
 
-	std::cout << "SEQUENTIAL DELETE IDEAL TIME: " << SequentialDeleteIdealTimer.Result() << " ms" << std::endl;
-	std::cout << "SEQUENTIAL DELETE TEST  TIME: " << SequentialDeleteTestTimer.Result() << " ms" << std::endl;
 	std::cout << "SEQUENTIAL DELETE CHECK " << SequentialDeleteResult << std::endl;
 
-	MultithreadingDeleteTestTimer.Start();
 	std::vector<std::thread> Threads2{};
 	for (int i = 0; i < NumThreads; ++i) {
 		Threads2.push_back(std::thread{
@@ -254,26 +219,270 @@ static bool SanityCheck(int Count, int NumThreads, bool SameKeys) {
 	for (int i = 0; i < NumThreads; ++i) {
 		Threads2[i].join();
 	}
-	MultithreadingDeleteTestTimer.Stop();
 
 	bool MultithreadingDeleteResult = Compare(SequentialIdeal, MultithreadingTest);
 
-	std::cout << "MLTITHREAD DELETE TEST  TIME: " << MultithreadingDeleteTestTimer.Result() << " ms" << std::endl;
 	std::cout << "MLTITHREAD DELETE CHECK " << MultithreadingDeleteResult << std::endl;
 	CHECK(MultithreadingDeleteResult);
 
 	return true;
 }
 
+// Present keys have to stay visible to lock-free readers while writers grow the table and move them between
+// generations, a reader that loads current generation before a key is moved out of its source must not miss it
+static bool GrowthVisibilityCheck(s64 NumKeys, s64 NumGrowthKeys, index NumReaders, index NumWriters) {
+	std::cout << "------------------------------------------" << std::endl;
+	concurrent_hash_table<s64, s64> Table;
+	for (s64 Key = 0; Key < NumKeys; ++Key) {
+		Table[Key] = Key;
+	}
+	std::atomic<bool> Growing{true};
+	std::atomic<s64> Misses{0};
+	std::vector<std::thread> Threads;
+	for (index Reader = 0; Reader < NumReaders; ++Reader) {
+		Threads.emplace_back([&, Reader]() {
+			s64 Key = (s64) Reader;
+			while (Growing.load(std::memory_order_relaxed)) {
+				s64 Value = -1;
+				if (!Table.ContainsKey(Key) || !Table.Find(Key, Value) || Value != Key) {
+					Misses.fetch_add(1, std::memory_order_relaxed);
+				}
+				Key = (Key + 1) % NumKeys;
+			}
+		});
+	}
+	std::vector<std::thread> Writers;
+	for (index Writer = 0; Writer < NumWriters; ++Writer) {
+		Writers.emplace_back([&, Writer]() {
+			for (s64 Key = NumKeys + Writer; Key < NumKeys + NumGrowthKeys; Key += NumWriters) {
+				Table[Key] = Key;
+			}
+		});
+	}
+	for (std::thread& Writer : Writers) {
+		Writer.join();
+	}
+	Growing.store(false);
+	for (std::thread& Thread : Threads) {
+		Thread.join();
+	}
+	TEST_CHECK(Misses.load() == 0, "keys stay visible during growth");
+	TEST_CHECK(Table.GetSize() == NumKeys + NumGrowthKeys, "size after growth");
+	return true;
+}
+
+// read-modify-write of few hot keys from many threads, no increment may be lost
+static bool UpdateCheck(s64 NumKeys, s64 UpdatesPerThread, index NumThreads) {
+	std::cout << "------------------------------------------" << std::endl;
+	concurrent_hash_table<s64, s64> Table;
+	std::vector<std::thread> Threads;
+	for (index Thread = 0; Thread < NumThreads; ++Thread) {
+		Threads.emplace_back([&, Thread]() {
+			for (s64 Update = 0; Update < UpdatesPerThread; ++Update) {
+				Table.Update((Update + Thread) % NumKeys, [](s64& Value) { Value += 1; });
+			}
+		});
+	}
+	for (std::thread& Thread : Threads) {
+		Thread.join();
+	}
+	s64 Total = 0;
+	for (s64 Key = 0; Key < NumKeys; ++Key) {
+		s64 Value = 0;
+		Table.Find(Key, Value);
+		Total += Value;
+	}
+	TEST_CHECK(Total == UpdatesPerThread * NumThreads, "no lost updates");
+	return true;
+}
+
 s32 concurrent_table_test::Test(const std::span<char*>& Args) {
 	TEST_PRINT_LINE();
 	bool Passed = true;
 	Passed = Passed && SanityCheck<s64, bytes_struct<2048>>(50000, 16, false);
+	Passed = Passed && GrowthVisibilityCheck(1000, 1000000, 4, 4);
+	Passed = Passed && UpdateCheck(64, 200000, 8);
 	return Passed ? 0 : 1;
 }
 
+struct read_write_op {
+	s64 Key;
+	bool Write;
+};
+
+static void ReadWriteOp(concurrent_hash_table<s64, s64>& Table, const read_write_op& Op, s64& Checksum) {
+	if (Op.Write) {
+		Table.Remove(Op.Key);
+		Table[Op.Key] = Op.Key;
+	} else {
+		s64 Value;
+		if (Table.Find(Op.Key, Value)) {
+			Checksum += Value;
+		}
+	}
+}
+
+// ConcurrentMap and CompactConcurrentMap, reads lock slots while probing
+template <typename map_type>
+static void ReadWriteOp(map_type& Map, const read_write_op& Op, s64& Checksum) {
+	if (Op.Write) {
+		Map.Remove(Op.Key);
+		Map.AtLock(Op.Key) = Op.Key;
+		Map.Unlock(Op.Key);
+	} else {
+		Checksum += Map.AtLock(Op.Key);
+		Map.Unlock(Op.Key);
+	}
+}
+
+template <typename map_type>
+static void ReadWriteThread(map_type* Map, const std::vector<read_write_op>* Ops, s64* Checksum) {
+	s64 LocalChecksum = 0;
+	for (const read_write_op& Op : *Ops) {
+		ReadWriteOp(*Map, Op, LocalChecksum);
+	}
+	*Checksum = LocalChecksum;
+}
+
+template <typename map_type>
+static void ReadHeavyRun(std::string_view MapName, const std::vector<std::vector<read_write_op>>& Ops, index NumKeys) {
+	const std::string Name = std::string{MapName} + " " + std::to_string(Ops.size()) + " threads";
+	const bench::config Config{
+		.Samples = 5, .WarmupSamples = 0, .Iterations = 1, .ItemsPerIteration = Ops.size() * Ops[0].size()};
+	bench::Run(Name, Config, [&](bench::state& State) {
+		State.PauseTiming();
+		s64 Checksum = 0;
+		auto Map = std::make_unique<map_type>();
+		for (index Key = 0; Key < NumKeys; ++Key) {
+			read_write_op Op{(s64) Key, true};
+			ReadWriteOp(*Map, Op, Checksum);
+		}
+		std::vector<s64> Checksums(Ops.size());
+		std::vector<std::thread> Threads;
+		State.ResumeTiming();
+		for (index Thread = 0; Thread < Ops.size(); ++Thread) {
+			Threads.push_back(std::thread{ReadWriteThread<map_type>, Map.get(), &Ops[Thread], &Checksums[Thread]});
+		}
+		for (std::thread& Thread : Threads) {
+			Thread.join();
+		}
+		State.PauseTiming();
+		for (s64 ThreadChecksum : Checksums) {
+			Checksum += ThreadChecksum;
+		}
+		bench::DoNotOptimize(Checksum);
+		Map.reset();
+		State.ResumeTiming();
+	});
+}
+
+// Random reads of present keys mixed with remove + insert of the same key, every thread does the same amount of ops
+static std::vector<std::vector<read_write_op>> MakeReadWriteOps(
+	index NumThreads, index OpsPerThread, index NumKeys, u32 WritePercent) {
+	std::vector<std::vector<read_write_op>> Ops(NumThreads);
+	for (index Thread = 0; Thread < NumThreads; ++Thread) {
+		std::mt19937 Generator((u32) Thread);
+		std::uniform_int_distribution<s64> KeyDistribution(0, (s64) NumKeys - 1);
+		std::uniform_int_distribution<u32> WriteDistribution(0, 99);
+		Ops[Thread].reserve(OpsPerThread);
+		for (index Op = 0; Op < OpsPerThread; ++Op) {
+			Ops[Thread].push_back({KeyDistribution(Generator), WriteDistribution(Generator) < WritePercent});
+		}
+	}
+	return Ops;
+}
+
+static void ReadHeavyPerformanceTests(index OpsPerThread, index NumKeys, u32 WritePercent) {
+	std::cout << "------------------------------------------" << std::endl;
+	std::cout << "Testing " << 100 - WritePercent << "/" << WritePercent << " read/write with " << NumKeys << " keys, "
+			  << OpsPerThread << " ops per thread" << std::endl;
+	const std::string Mix = " " + std::to_string(100 - WritePercent) + "/" + std::to_string(WritePercent);
+	for (index NumThreads = 1; NumThreads <= 64; NumThreads *= 2) {
+		const auto Ops = MakeReadWriteOps(NumThreads, OpsPerThread, NumKeys, WritePercent);
+		ReadHeavyRun<DaniilPavlenko::ConcurrentMap<s64, s64>>("locked reads" + Mix, Ops, NumKeys);
+		ReadHeavyRun<concurrent_hash_table<s64, s64>>("seqlock reads" + Mix, Ops, NumKeys);
+	}
+}
+
+// Every thread inserts its own range of keys into an empty table, so most of the inserts run while it grows
+static void InsertPerformanceTests(int Count, int NumThreads) {
+	const u64 TotalKeys = (u64) Count * NumThreads;
+	const bench::config SequentialConfig{.Samples = 5, .ItemsPerIteration = TotalKeys};
+	bench::Run("std::unordered_map sequential insert", SequentialConfig, [&](bench::state& State) {
+		for (u64 Iter = 0; Iter < State.Iterations; ++Iter) {
+			std::unordered_map<s64, s64> Ideal;
+			for (int i = 0; i < NumThreads; ++i) {
+				IdealThreadInsertions<s64, s64>(&Ideal, i, Count, i * Count, (i + 1) * Count - 1);
+			}
+			State.PauseTiming();
+			Ideal = {};
+			State.ResumeTiming();
+		}
+	});
+	bench::Run("concurrent_hash_table sequential insert", SequentialConfig, [&](bench::state& State) {
+		for (u64 Iter = 0; Iter < State.Iterations; ++Iter) {
+			auto Test = std::make_unique<concurrent_hash_table<s64, s64>>();
+			for (int i = 0; i < NumThreads; ++i) {
+				TestThreadInsertions<s64, s64>(Test.get(), i, Count, i * Count, (i + 1) * Count - 1);
+			}
+			State.PauseTiming();
+			Test.reset();
+			State.ResumeTiming();
+		}
+	});
+	const std::string Name = "concurrent_hash_table insert " + std::to_string(NumThreads) + " threads";
+	const bench::config Config{.Samples = 5, .WarmupSamples = 0, .Iterations = 1, .ItemsPerIteration = TotalKeys};
+	bench::Run(Name, Config, [&](bench::state& State) {
+		State.PauseTiming();
+		auto Test = std::make_unique<concurrent_hash_table<s64, s64>>();
+		std::vector<std::thread> Threads{};
+		State.ResumeTiming();
+		for (int i = 0; i < NumThreads; ++i) {
+			Threads.push_back(std::thread{
+				TestThreadInsertions<s64, s64>, Test.get(), i, Count, i * Count, (i + 1) * Count - 1});
+		}
+		for (std::thread& Thread : Threads) {
+			Thread.join();
+		}
+		State.PauseTiming();
+		Test.reset();
+		State.ResumeTiming();
+	});
+}
+
+template <typename map_type>
+static float BytesPerEntry(index NumKeys) {
+	map_type Map;
+	for (index Key = 0; Key < NumKeys; ++Key) {
+		Map.AtLock((s32) Key) = (s32) Key;
+		Map.Unlock((s32) Key);
+	}
+	return (float) Map.GetAllocatedSize() / (float) Map.GetSize();
+}
+
+// 64 byte slots with own locks against densely packed slots guarded by lock stripes
+static void CompactLayoutPerformanceTests(index OpsPerThread, index NumKeys) {
+	std::cout << "------------------------------------------" << std::endl;
+	std::cout << "Testing map layouts with " << NumKeys << " keys, " << OpsPerThread << " ops per thread" << std::endl;
+	std::cout << "Memory per s32 -> s32 entry:\n\tConcurrentMap "
+			  << BytesPerEntry<DaniilPavlenko::ConcurrentMap<s32, s32>>(NumKeys) << " bytes"
+			  << "\n\tCompactConcurrentMap " << BytesPerEntry<DaniilPavlenko::CompactConcurrentMap<s32, s32>>(NumKeys)
+			  << " bytes" << std::endl;
+	for (index NumThreads = 1; NumThreads <= 64; NumThreads *= 4) {
+		const auto Ops = MakeReadWriteOps(NumThreads, OpsPerThread, NumKeys, 5);
+		ReadHeavyRun<DaniilPavlenko::ConcurrentMap<s64, s64>>("ConcurrentMap 95/5", Ops, NumKeys);
+		ReadHeavyRun<DaniilPavlenko::CompactConcurrentMap<s64, s64>>("CompactConcurrentMap 95/5", Ops, NumKeys);
+		ReadHeavyRun<DaniilPavlenko::CompactConcurrentMap<s64, s64, 16>>(
+			"CompactConcurrentMap 16 stripes 95/5", Ops, NumKeys);
+	}
+}
+
 void concurrent_table_test::Benchmark(const std::span<char*>& Args) {
 	TEST_PRINT_LINE();
+	InsertPerformanceTests(200000, 8);
+	CompactLayoutPerformanceTests(100000, 1000000);
+	ReadHeavyPerformanceTests(100000, 100000, 5);
+	ReadHeavyPerformanceTests(100000, 100000, 1);
 }
 
 TEST_ENTRY(concurrent_table_test);
@@ -0,0 +1,357 @@
+﻿#include "../testing_shared.h"
+#include "Concurrency/epoch.h"
+#include "Concurrency/rw_lock.h"
+
+#include <atomic>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+struct epoch_test {
+	s32 Test(const std::span<char*>& Args);
+	void Benchmark(const std::span<char*>& Args);
+};
+
+constexpr u64 AliveMagic = 0xa11ca11ca11ca11cull;
+constexpr u64 DeadMagic = 0xdeaddeaddeaddeadull;
+
+// Nodes come from a preallocated array and are only marked dead by the deleter,
+// so a reader that got a node after it was "freed" reads DeadMagic instead of invoking UB
+struct node {
+	std::atomic<u64> Magic{AliveMagic};
+	u64 Value{0};
+};
+
+static std::atomic<index> NumFreed{0};
+
+static void KillNode(void* Object) {
+	static_cast<node*>(Object)->Magic.store(DeadMagic, std::memory_order_relaxed);
+	NumFreed.fetch_add(1, std::memory_order_relaxed);
+}
+
+static bool SingleThreadCheck() {
+	std::cout << "------------------------------------------" << std::endl;
+	std::vector<node> Nodes(1000);
+	NumFreed.store(0);
+	epoch::Synchronize();
+	const index PendingBefore = epoch::GetPendingCount();
+	{
+		epoch::guard Outer;
+		epoch::guard Inner;
+		for (node& Node : Nodes) {
+			epoch::Retire(&Node, &KillNode);
+		}
+		TEST_CHECK(Nodes.back().Magic.load() == AliveMagic, "nothing retired while pinned is freed");
+	}
+	epoch::Synchronize();
+	TEST_CHECK(NumFreed.load() == Nodes.size() && epoch::GetPendingCount() == PendingBefore, "all freed");
+	bool AllDead = true;
+	for (node& Node : Nodes) {
+		AllDead = AllDead && Node.Magic.load() == DeadMagic;
+	}
+	TEST_CHECK(AllDead, "every deleter called");
+
+	const u64 Epoch = epoch::GetEpoch();
+	epoch::Collect();
+	TEST_CHECK(epoch::GetEpoch() == Epoch + 1, "epoch advances with nobody pinned");
+	return true;
+}
+
+// object retired while other thread is pinned must survive any number of collections until it unpins
+static bool PinnedReaderCheck() {
+	std::cout << "------------------------------------------" << std::endl;
+	node Node;
+	NumFreed.store(0);
+	std::atomic<bool> Pinned{false};
+	std::atomic<bool> Release{false};
+	std::thread Reader([&]() {
+		epoch::guard Guard;
+		Pinned.store(true);
+		while (!Release.load()) {
+			std::this_thread::yield();
+		}
+	});
+	while (!Pinned.load()) {
+		std::this_thread::yield();
+	}
+	epoch::Retire(&Node, &KillNode);
+	for (index Attempt = 0; Attempt < 1000; ++Attempt) {
+		epoch::Collect();
+	}
+	TEST_CHECK(Node.Magic.load() == AliveMagic && NumFreed.load() == 0, "pinned reader keeps object alive");
+	Release.store(true);
+	Reader.join();
+	epoch::Synchronize();
+	TEST_CHECK(Node.Magic.load() == DeadMagic && NumFreed.load() == 1, "freed after reader unpinned");
+	return true;
+}
+
+// leftovers of exited threads go to the orphan list and are freed by whoever collects next
+static bool ThreadExitCheck(u32 NumThreads) {
+	std::cout << "------------------------------------------" << std::endl;
+	std::vector<node> Nodes(NumThreads * 10);
+	NumFreed.store(0);
+	std::vector<std::thread> Threads;
+	for (u32 Thread = 0; Thread < NumThreads; ++Thread) {
+		Threads.emplace_back([&, Thread]() {
+			for (index Node = 0; Node < 10; ++Node) {
+				epoch::Retire(&Nodes[Thread * 10 + Node], &KillNode);
+			}
+		});
+	}
+	for (std::thread& Thread : Threads) {
+		Thread.join();
+	}
+	epoch::Synchronize();
+	TEST_CHECK(NumFreed.load() == Nodes.size(), "objects of exited threads are freed");
+	return true;
+}
+
+// Thread that retired early but exits late puts an older object behind a newer one in the orphan list,
+// the older one has to be freed as soon as it expires anyway
+static bool OrphanOrderCheck() {
+	std::cout << "------------------------------------------" << std::endl;
+	node Older;
+	node Newer;
+	NumFreed.store(0);
+	epoch::Synchronize();
+	std::atomic<bool> Pinned{false};
+	std::atomic<bool> Unpin{false};
+	std::atomic<bool> ReaderExit{false};
+	std::atomic<bool> Retired{false};
+	std::atomic<bool> LateExit{false};
+	// holds the epoch back so exiting threads can't free what they retired, stays alive after unpinning so that
+	// collection in its exit doesn't get ahead of the check
+	std::thread Reader([&]() {
+		{
+			epoch::guard Guard;
+			Pinned.store(true);
+			while (!Unpin.load()) {
+				std::this_thread::yield();
+			}
+		}
+		Pinned.store(false);
+		while (!ReaderExit.load()) {
+			std::this_thread::yield();
+		}
+	});
+	while (!Pinned.load()) {
+		std::this_thread::yield();
+	}
+	std::thread Late([&]() {
+		epoch::Retire(&Older, &KillNode);
+		Retired.store(true);
+		while (!LateExit.load()) {
+			std::this_thread::yield();
+		}
+	});
+	while (!Retired.load()) {
+		std::this_thread::yield();
+	}
+	// last advance the pinned reader allows
+	epoch::Collect();
+	std::thread Early([&]() { epoch::Retire(&Newer, &KillNode); });
+	Early.join();
+	LateExit.store(true);
+	Late.join();
+	Unpin.store(true);
+	while (Pinned.load()) {
+		std::this_thread::yield();
+	}
+	epoch::Collect();
+	TEST_CHECK(Older.Magic.load() == DeadMagic && Newer.Magic.load() == AliveMagic, "expired orphan freed first");
+	ReaderExit.store(true);
+	Reader.join();
+	epoch::Synchronize();
+	TEST_CHECK(Newer.Magic.load() == DeadMagic && NumFreed.load() == 2, "every orphan freed");
+	return true;
+}
+
+// Writers keep replacing shared node and retiring old one, readers must never see a dead node
+static bool StressCheck(u32 NumReaders, u32 NumWriters, index ReplacesPerWriter) {
+	std::cout << "------------------------------------------" << std::endl;
+	std::cout << "Testing " << NumReaders << " readers, " << NumWriters << " writers" << std::endl;
+	std::vector<node> Nodes(NumWriters * ReplacesPerWriter + 1);
+	NumFreed.store(0);
+	std::atomic<node*> Shared{&Nodes[0]};
+	std::atomic<u32> WritersLeft{NumWriters};
+	std::atomic<index> Violations{0};
+	std::atomic<index> Reads{0};
+	std::vector<std::thread> Threads;
+	for (u32 Reader = 0; Reader < NumReaders; ++Reader) {
+		Threads.emplace_back([&]() {
+			index LocalReads = 0;
+			index LocalViolations = 0;
+			while (WritersLeft.load(std::memory_order_relaxed) > 0) {
+				epoch::guard Guard;
+				node* Node = Shared.load(std::memory_order_acquire);
+				for (index Spin = 0; Spin < 16; ++Spin) {
+					LocalViolations += Node->Magic.load(std::memory_order_relaxed) != AliveMagic;
+				}
+				++LocalReads;
+			}
+			Violations += LocalViolations;
+			Reads += LocalReads;
+		});
+	}
+	for (u32 Writer = 0; Writer < NumWriters; ++Writer) {
+		Threads.emplace_back([&, Writer]() {
+			for (index Replace = 0; Replace < ReplacesPerWriter; ++Replace) {
+				node* Fresh = &Nodes[1 + Writer * ReplacesPerWriter + Replace];
+				Fresh->Value = Replace;
+				epoch::Retire(Shared.exchange(Fresh, std::memory_order_acq_rel), &KillNode);
+			}
+			WritersLeft.fetch_sub(1);
+		});
+	}
+	for (std::thread& Thread : Threads) {
+		Thread.join();
+	}
+	epoch::Synchronize();
+	std::cout << "\t" << Reads.load() << " reads, " << NumFreed.load() << " objects freed" << std::endl;
+	TEST_CHECK(Violations.load() == 0, "no reader touched freed object");
+	TEST_CHECK(NumFreed.load() == Nodes.size() - 1, "every retired object freed");
+	return true;
+}
+
+s32 epoch_test::Test(const std::span<char*>& Args) {
+	TEST_PRINT_LINE();
+	bool Passed = true;
+	Passed = Passed && SingleThreadCheck();
+	Passed = Passed && PinnedReaderCheck();
+	Passed = Passed && ThreadExitCheck(8);
+	Passed = Passed && OrphanOrderCheck();
+	Passed = Passed && StressCheck(2, 1, 100000);
+	Passed = Passed && StressCheck(math::Max(4u, std::thread::hardware_concurrency()), 4, 50000);
+	return Passed ? 0 : 1;
+}
+
+static void GuardOverheadTest() {
+	std::atomic<node*> Shared{new node{}};
+	bench::Run("unprotected read", {}, [&](bench::state& State) {
+		u64 Sum = 0;
+		for (u64 Read = 0; Read < State.Iterations; ++Read) {
+			Sum += Shared.load(std::memory_order_acquire)->Value + Read;
+		}
+		bench::DoNotOptimize(Sum);
+	});
+	bench::Run("guarded read", {}, [&](bench::state& State) {
+		u64 Sum = 0;
+		for (u64 Read = 0; Read < State.Iterations; ++Read) {
+			epoch::guard Guard;
+			Sum += Shared.load(std::memory_order_acquire)->Value + Read;
+		}
+		bench::DoNotOptimize(Sum);
+	});
+	{
+		epoch::guard Outer;
+		bench::Run("nested guarded read", {}, [&](bench::state& State) {
+			u64 Sum = 0;
+			for (u64 Read = 0; Read < State.Iterations; ++Read) {
+				epoch::guard Guard;
+				Sum += Shared.load(std::memory_order_acquire)->Value + Read;
+			}
+			bench::DoNotOptimize(Sum);
+		});
+	}
+	delete Shared.load();
+}
+
+// readers pin epoch guard instead of taking any lock
+struct epoch_reader {};
+
+// adapts repo lock to std naming used in ReadRun
+struct shared_rw_lock {
+	rw_lock Lock;
+
+	FORCEINLINE void lock() {
+		Lock.Lock();
+	}
+	FORCEINLINE void unlock() {
+		Lock.Unlock();
+	}
+	FORCEINLINE void lock_shared() {
+		Lock.LockShared();
+	}
+	FORCEINLINE void unlock_shared() {
+		Lock.UnlockShared();
+	}
+};
+
+// Read side of a shared pointer that one writer replaces all the time, epoch guard vs reader-writer locks
+template <typename lock_type>
+static void ReadRun(const char* Name, u32 NumReaders, index ReadsPerThread) {
+	const std::string BenchName = std::string{Name} + " " + std::to_string(NumReaders) + " readers";
+	const bench::config Config{
+		.Samples = 5, .WarmupSamples = 0, .Iterations = 1, .ItemsPerIteration = (u64) ReadsPerThread * NumReaders};
+	bench::Run(BenchName, Config, [&](bench::state& State) {
+		State.PauseTiming();
+		std::atomic<node*> Shared{new node{}};
+		lock_type Lock;
+		std::atomic<bool> Start{false};
+		std::atomic<u32> ReadersLeft{NumReaders};
+		std::vector<std::thread> Threads;
+		for (u32 Reader = 0; Reader < NumReaders; ++Reader) {
+			Threads.emplace_back([&]() {
+				while (!Start.load(std::memory_order_acquire)) {
+					std::this_thread::yield();
+				}
+				u64 Sum = 0;
+				for (index Read = 0; Read < ReadsPerThread; ++Read) {
+					if constexpr (std::is_same_v<lock_type, epoch_reader>) {
+						epoch::guard Guard;
+						Sum += Shared.load(std::memory_order_acquire)->Value;
+					} else {
+						Lock.lock_shared();
+						Sum += Shared.load(std::memory_order_relaxed)->Value;
+						Lock.unlock_shared();
+					}
+				}
+				ReadersLeft.fetch_sub(1, std::memory_order_relaxed);
+				CHECK(Sum != 1)
+			});
+		}
+		Threads.emplace_back([&]() {
+			u64 Value = 0;
+			while (ReadersLeft.load(std::memory_order_relaxed) > 0) {
+				node* Fresh = new node{};
+				Fresh->Value = Value++;
+				if constexpr (std::is_same_v<lock_type, epoch_reader>) {
+					epoch::Retire(Shared.exchange(Fresh, std::memory_order_acq_rel));
+				} else {
+					Lock.lock();
+					node* Old = Shared.exchange(Fresh, std::memory_order_relaxed);
+					Lock.unlock();
+					delete Old;
+				}
+				std::this_thread::yield();
+			}
+		});
+		State.ResumeTiming();
+		Start.store(true, std::memory_order_release);
+		for (std::thread& Thread : Threads) {
+			Thread.join();
+		}
+		State.PauseTiming();
+		epoch::Synchronize();
+		delete Shared.load();
+		State.ResumeTiming();
+	});
+}
+
+static void ReadScalingTest(index ReadsPerThread) {
+	const u32 NumCores = math::Max(1u, std::thread::hardware_concurrency());
+	for (u32 NumReaders = 1; NumReaders <= NumCores * 2; NumReaders *= 2) {
+		ReadRun<epoch_reader>("epoch guard", NumReaders, ReadsPerThread);
+		ReadRun<shared_rw_lock>("rw_lock", NumReaders, ReadsPerThread);
+		ReadRun<std::shared_mutex>("std::shared_mutex", NumReaders, ReadsPerThread);
+	}
+}
+
+void epoch_test::Benchmark(const std::span<char*>& Args) {
+	TEST_PRINT_LINE();
+	GuardOverheadTest();
+	ReadScalingTest(10000000);
+}
+
+TEST_ENTRY(epoch_test);
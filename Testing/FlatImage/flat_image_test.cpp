@@ -0,0 +1,234 @@
+﻿#include "../testing_shared.h"
+#include "Containers/flat_image.h"
+
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <vector>
+
+#include "Application/Platform/filesystem.h"
+
+struct flat_image_test {
+	s32 Test(const std::span<char*>& Args);
+	void Benchmark(const std::span<char*>& Args);
+};
+
+struct vertex {
+	static constexpr bool PositionIndependent = true;
+
+	float Position[3];
+	u32 Color;
+
+	bool operator==(const vertex& Other) const {
+		return memcmp(this, &Other, sizeof(vertex)) == 0;
+	}
+};
+
+static bool ArrayCheck(index Count) {
+	std::cout << "------------------------------------------" << std::endl;
+	dyn_array<vertex> Array;
+	for (index i = 0; i < Count; ++i) {
+		Array.Add(vertex{{(float) i, 1.f, 2.f}, i * 3});
+	}
+	const dyn_array<u8> Image = flat_image::Write(Array);
+	span<vertex> View;
+	TEST_CHECK(flat_image::OpenArray(span<u8>{Image}, View), "open array");
+	bool Valid = View.GetSize() == Count;
+	for (index i = 0; i < Count && Valid; ++i) {
+		Valid = View[i] == Array[i];
+	}
+	TEST_CHECK(Valid, "array contents");
+	return true;
+}
+
+static bool TableCheck(index Count) {
+	std::cout << "------------------------------------------" << std::endl;
+	hash_table<u64, vertex> Table;
+	for (index i = 0; i < Count; ++i) {
+		Table[i * 7] = vertex{{(float) i, 0.f, 0.f}, i};
+	}
+	// deleted slots have to be preserved for probing to work
+	for (index i = 0; i < Count; i += 3) {
+		Table.Remove(i * 7);
+	}
+	const dyn_array<u8> Image = flat_image::Write(Table);
+	flat_image::table_view<hash_table<u64, vertex>> View;
+	TEST_CHECK(flat_image::OpenTable(span<u8>{Image}, View), "open table");
+	bool Valid = View.GetSize() == Table.GetSize();
+	for (index i = 0; i < Count * 2; ++i) {
+		const vertex* Expected = Table.Find(i * 7);
+		const vertex* Found = View.Find(i * 7);
+		Valid = Valid && (Expected ? Found && *Found == *Expected : !Found);
+	}
+	TEST_CHECK(Valid, "table lookups");
+	TEST_CHECK(Image == flat_image::Write(Table), "image is deterministic");
+
+	// image copied to another place in memory stays valid, there are no pointers inside
+	dyn_array<u8> Moved;
+	Moved.AppendUninitialized(64);
+	Moved.AppendInplace(Image);
+	const span<u8> MovedImage{Moved.GetData() + 64, Image.GetSize()};
+	TEST_CHECK(
+		flat_image::OpenTable(MovedImage, View) && View.Contains(7) == Table.Contains(7), "position independent");
+	return true;
+}
+
+static_assert(!position_independent<str_view>, "views point outside of image");
+static_assert(!flat_image::flat_table<hash_table<u64, str_view>>);
+
+// same hashing as default_hasher for integers, but no seed
+struct seedless_hasher {
+	template <hashable hashable_type>
+	[[nodiscard]] FORCEINLINE static hash::hash_type Hash(const hashable_type& Key) {
+		return hash::Hash(Key);
+	}
+};
+
+// different hashes for same keys
+struct other_hasher {
+	static constexpr hash::hash_type Seed = hash::DefaultSeed;
+
+	[[nodiscard]] FORCEINLINE static hash::hash_type Hash(u64 Key) {
+		return hash::Hash(Key + 1);
+	}
+};
+
+static bool ValidationCheck() {
+	std::cout << "------------------------------------------" << std::endl;
+	dyn_array<u32> Array{1, 2, 3};
+	dyn_array<u8> Image = flat_image::Write(Array);
+	span<u32> U32View;
+	span<u64> U64View;
+	TEST_CHECK(!flat_image::OpenArray(span<u8>{Image}, U64View), "reject element size mismatch");
+	flat_image::table_view<hash_table<u32, u32>> TableView;
+	TEST_CHECK(!flat_image::OpenTable(span<u8>{Image}, TableView), "reject container kind mismatch");
+	TEST_CHECK(!flat_image::OpenArray(span<u8>{Image.GetData(), 20}, U32View), "reject truncated image");
+
+	hash_table<u64, u64> Table;
+	Table[1] = 2;
+	const dyn_array<u8> TableImage = flat_image::Write(Table);
+	flat_image::table_view<hash_table<u64, u64, seedless_hasher>> SeedlessView;
+	TEST_CHECK(!flat_image::OpenTable(span<u8>{TableImage}, SeedlessView), "reject hasher seed mismatch");
+	flat_image::table_view<hash_table<u64, u64, other_hasher>> OtherView;
+	TEST_CHECK(!flat_image::OpenTable(span<u8>{TableImage}, OtherView), "reject hasher mismatch");
+
+	Image[4] = 0xff;
+	TEST_CHECK(!flat_image::OpenArray(span<u8>{Image}, U32View), "reject layout version mismatch");
+	return true;
+}
+
+s32 flat_image_test::Test(const std::span<char*>& Args) {
+	TEST_PRINT_LINE();
+	bool Passed = true;
+	Passed = Passed && ArrayCheck(0);
+	Passed = Passed && ArrayCheck(10000);
+	Passed = Passed && TableCheck(0);
+	Passed = Passed && TableCheck(10000);
+	Passed = Passed && ValidationCheck();
+	return Passed ? 0 : 1;
+}
+
+static dyn_array<u8> LoadFile(const char* Path) {
+	dyn_array<u8> Result;
+	std::ifstream File{Path, std::ios::binary};
+	File.seekg(0, std::ios::end);
+	const std::streamsize Size = File.tellg();
+	File.seekg(0, std::ios::beg);
+	File.read((char*) Result.AppendUninitialized((index) Size).GetData(), Size);
+	return Result;
+}
+
+static void SaveFile(const char* Path, const dyn_array<u8>& Data) {
+	std::ofstream File{Path, std::ios::binary};
+	File.write((const char*) Data.GetData(), Data.GetSize());
+}
+
+// Rebuilding table from source data every startup against loading prebuilt image.
+// File is in OS page cache after first iteration, so file load measures copy from page cache,
+// memory mapped image would skip even that and fault pages in lazily.
+static void PerformanceTests(index Count) {
+	const std::string Entries = " " + std::to_string(Count) + " entries";
+	const char* Path = "flat_image_benchmark.bin";
+
+	std::vector<u64> Keys(Count);
+	std::mt19937_64 Generator(0);
+	for (index i = 0; i < Count; ++i) {
+		Keys[i] = Generator();
+	}
+	hash_table<u64, u64> Table;
+	for (index i = 0; i < Count; ++i) {
+		Table[Keys[i]] = i;
+	}
+	SaveFile(Path, flat_image::Write(Table));
+
+	bench::Run("rebuild hash_table" + Entries, {.ItemsPerIteration = Count}, [&](bench::state& State) {
+		for (u64 Iter = 0; Iter < State.Iterations; ++Iter) {
+			hash_table<u64, u64> Rebuilt;
+			Rebuilt.EnsureCapacity(Count);
+			for (index i = 0; i < Count; ++i) {
+				Rebuilt[Keys[i]] = i;
+			}
+			bench::DoNotOptimize(Rebuilt);
+			State.PauseTiming();
+			Rebuilt.Clear();
+			State.ResumeTiming();
+		}
+	});
+	bench::Run("read image file" + Entries, {}, [&](bench::state& State) {
+		for (u64 Iter = 0; Iter < State.Iterations; ++Iter) {
+			dyn_array<u8> Image = LoadFile(Path);
+			bench::DoNotOptimize(Image);
+			State.PauseTiming();
+			Image.Clear();
+			State.ResumeTiming();
+		}
+	});
+	const dyn_array<u8> Image = LoadFile(Path);
+	flat_image::table_view<hash_table<u64, u64>> View;
+	bench::Run("open image in place" + Entries, {}, [&](bench::state& State) {
+		for (u64 Iter = 0; Iter < State.Iterations; ++Iter) {
+			flat_image::OpenTable(span<u8>{Image}, View);
+			bench::DoNotOptimize(View);
+		}
+	});
+	bench::Run("map image file" + Entries, {}, [&](bench::state& State) {
+		for (u64 Iter = 0; Iter < State.Iterations; ++Iter) {
+			mapped_file Mapped = filesystem::MapFile(Path);
+			flat_image::table_view<hash_table<u64, u64>> MappedView;
+			flat_image::OpenTable(Mapped.GetView(), MappedView);
+			bench::DoNotOptimize(*MappedView.Find(Keys[0]));
+			State.PauseTiming();
+			filesystem::UnmapFile(Mapped);
+			State.ResumeTiming();
+		}
+	});
+	std::remove(Path);
+
+	flat_image::OpenTable(span<u8>{Image}, View);
+	bench::Run("hash_table Find" + Entries, {.ItemsPerIteration = Count}, [&](bench::state& State) {
+		for (u64 Iter = 0; Iter < State.Iterations; ++Iter) {
+			u64 Checksum = 0;
+			for (index i = 0; i < Count; ++i) {
+				Checksum += *Table.Find(Keys[i]);
+			}
+			bench::DoNotOptimize(Checksum);
+		}
+	});
+	bench::Run("table_view Find" + Entries, {.ItemsPerIteration = Count}, [&](bench::state& State) {
+		for (u64 Iter = 0; Iter < State.Iterations; ++Iter) {
+			u64 Checksum = 0;
+			for (index i = 0; i < Count; ++i) {
+				Checksum += *View.Find(Keys[i]);
+			}
+			bench::DoNotOptimize(Checksum);
+		}
+	});
+}
+
+void flat_image_test::Benchmark(const std::span<char*>& Args) {
+	TEST_PRINT_LINE();
+	PerformanceTests(100000);
+	PerformanceTests(1000000);
+}
+
+TEST_ENTRY(flat_image_test);
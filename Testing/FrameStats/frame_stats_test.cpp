@@ -0,0 +1,156 @@
+﻿#include "../testing_shared.h"
+#include "Profiler/frame_stats.h"
+#include "Time/cycle_clock.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <vector>
+
+struct frame_stats_test {
+	s32 Test(const std::span<char*>& Args);
+	void Benchmark(const std::span<char*>& Args);
+};
+
+static bool IsClose(s64 Value, s64 Expected) {
+	return std::abs((double) (Value - Expected)) <= (double) Expected / 128.0 + 1.0;
+}
+
+// percentiles of random samples over several magnitudes against exact ones from sorted samples
+static bool HistogramAccuracyCheck(index Count) {
+	std::cout << "------------------------------------------" << std::endl;
+	std::mt19937_64 Random{42};
+	std::lognormal_distribution<double> Distribution{14.0, 1.5};
+	std::vector<s64> Samples;
+	auto* Histogram = new histogram{};
+	s64 Sum = 0;
+	for (index Sample = 0; Sample < Count; ++Sample) {
+		const s64 Value = (s64) Distribution(Random);
+		Samples.push_back(Value);
+		Histogram->Record(Value);
+		Sum += Value;
+	}
+	std::sort(Samples.begin(), Samples.end());
+	const auto GetExact = [&](double Percentile) {
+		return Samples[(size_t) std::max(std::ceil(Percentile / 100.0 * (double) Count), 1.0) - 1];
+	};
+	const histogram_summary Summary = Histogram->GetSummary();
+	std::cout << "\tp50 " << Summary.P50 << " (" << GetExact(50.0) << "), p99 " << Summary.P99 << " ("
+			  << GetExact(99.0) << ")" << std::endl;
+	TEST_CHECK(Summary.Count == Count, "count");
+	TEST_CHECK(Summary.Min == Samples.front() && Summary.Max == Samples.back(), "min and max are exact");
+	TEST_CHECK(Summary.Mean == Sum / (s64) Count, "mean is exact");
+	bool Close = true;
+	for (const double Percentile : {1.0, 10.0, 50.0, 90.0, 95.0, 99.0, 99.9}) {
+		Close = Close && IsClose(Histogram->GetPercentile(Percentile), GetExact(Percentile));
+	}
+	TEST_CHECK(Close, "percentiles within bucket precision");
+	s64 SlowSum = 0;
+	for (index Sample = Count - Count / 100; Sample < Count; ++Sample) {
+		SlowSum += Samples[Sample];
+	}
+	TEST_CHECK(IsClose(Summary.Low1, SlowSum / (s64) (Count / 100)), "1% low");
+	Histogram->Reset();
+	TEST_CHECK(Histogram->GetCount() == 0 && Histogram->GetPercentile(50.0) == 0, "reset");
+	Histogram->Record(5);
+	TEST_CHECK(Histogram->GetPercentile(99.0) == 5 && Histogram->GetMin() == 5, "small values are exact");
+	delete Histogram;
+	return true;
+}
+
+static bool HistogramThreadsCheck(u32 NumThreads, index SamplesPerThread) {
+	std::cout << "------------------------------------------" << std::endl;
+	auto* Histogram = new histogram{};
+	std::vector<std::thread> Threads;
+	for (u32 Thread = 0; Thread < NumThreads; ++Thread) {
+		Threads.emplace_back([&, Thread]() {
+			for (index Sample = 0; Sample < SamplesPerThread; ++Sample) {
+				Histogram->Record((s64) (Sample * NumThreads + Thread));
+			}
+		});
+	}
+	for (std::thread& Thread : Threads) {
+		Thread.join();
+	}
+	const u64 Total = (u64) NumThreads * SamplesPerThread;
+	TEST_CHECK(Histogram->GetCount() == Total, "no sample lost");
+	TEST_CHECK(Histogram->GetMin() == 0 && Histogram->GetMax() == (s64) Total - 1, "min and max");
+	TEST_CHECK(Histogram->GetMean() == (s64) ((Total - 1) / 2), "mean");
+	TEST_CHECK(IsClose(Histogram->GetPercentile(50.0), (s64) Total / 2), "median");
+	delete Histogram;
+	return true;
+}
+
+// window keeps last frames only, stage times of a frame are summed
+static bool FrameStatsCheck() {
+	std::cout << "------------------------------------------" << std::endl;
+	const char* StageNames[] = {"First", "Second"};
+	frame_stats Stats{span<const char*>{StageNames, 2}, 100};
+	TEST_CHECK(Stats.GetStageCount() == 2 && str_view{Stats.GetStageName(1)} == "Second", "stages");
+	TEST_CHECK(Stats.GetWindowSummary().Count == 0, "empty window");
+	for (s64 Frame = 1; Frame <= 250; ++Frame) {
+		Stats.PendingStageNs[0] += Frame;
+		Stats.PendingStageNs[0] += Frame;
+		Stats.PendingStageNs[1] += 1000;
+		Stats.EndFrame(Frame * 1000);
+	}
+	const s64 BeginNs = cycle_clock::GetNs();
+	const s64 EndNs = Stats.EndStage(1, BeginNs);
+	TEST_CHECK(EndNs >= BeginNs && Stats.PendingStageNs[1] == EndNs - BeginNs, "stage time added");
+	const histogram_summary Window = Stats.GetWindowSummary();
+	TEST_CHECK(Window.Count == 100 && Window.Min == 151000 && Window.Max == 250000, "window holds last frames");
+	TEST_CHECK(Window.Mean == 200500 && Window.P50 == 200000 && Window.P99 == 249000, "window percentiles");
+	TEST_CHECK(Window.Low1 == 250000, "window 1% low");
+	const histogram_summary Frames = Stats.GetFrameSummary();
+	TEST_CHECK(Frames.Count == 250 && Frames.Min == 1000 && Frames.Max == 250000, "frames since start");
+	const histogram_summary First = Stats.GetStageSummary(0);
+	TEST_CHECK(First.Count == 250 && First.Max == 500 && First.Mean == 251, "stage summed per frame");
+	TEST_CHECK(Stats.GetStageSummary(1).P50 == 1000, "constant stage");
+	Stats.LogReport();
+	Stats.Reset();
+	TEST_CHECK(Stats.GetFrameSummary().Count == 0 && Stats.GetWindowSummary().Count == 0, "reset");
+	return true;
+}
+
+s32 frame_stats_test::Test(const std::span<char*>& Args) {
+	TEST_PRINT_LINE();
+	bool Passed = true;
+	Passed = Passed && HistogramAccuracyCheck(1000000);
+	Passed = Passed && HistogramThreadsCheck(4, 1000000);
+	Passed = Passed && FrameStatsCheck();
+	return Passed ? 0 : 1;
+}
+
+// Cost of one sample from one thread and from several threads into the same histogram
+static void RecordCostTest(u32 NumThreads, index Count) {
+	const std::string Name = "histogram Record " + std::to_string(NumThreads) + " threads";
+	const bench::config Config{.Samples = 5, .WarmupSamples = 0, .Iterations = 1, .ItemsPerIteration = Count};
+	bench::Run(Name, Config, [&](bench::state& State) {
+		State.PauseTiming();
+		auto Histogram = std::make_unique<histogram>();
+		State.ResumeTiming();
+		std::vector<std::thread> Threads;
+		for (u32 Thread = 0; Thread < NumThreads; ++Thread) {
+			Threads.emplace_back([&]() {
+				for (index Sample = 0; Sample < Count; ++Sample) {
+					Histogram->Record((s64) (Sample & 0xFFFFF) * 64);
+				}
+			});
+		}
+		for (std::thread& Thread : Threads) {
+			Thread.join();
+		}
+		State.PauseTiming();
+		Histogram.reset();
+		State.ResumeTiming();
+	});
+}
+
+void frame_stats_test::Benchmark(const std::span<char*>& Args) {
+	TEST_PRINT_LINE();
+	RecordCostTest(1, 10000000);
+	RecordCostTest(4, 10000000);
+}
+
+TEST_ENTRY(frame_stats_test);
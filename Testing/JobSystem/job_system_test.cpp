@@ -0,0 +1,235 @@
+﻿#include "../testing_shared.h"
+#include "Concurrency/job_system.h"
+
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+struct job_system_test {
+	s32 Test(const std::span<char*>& Args);
+	void Benchmark(const std::span<char*>& Args);
+};
+
+static u64 SerialFib(u32 N) {
+	return N < 2 ? N : SerialFib(N - 1) + SerialFib(N - 2);
+}
+
+// one job per call above Cutoff, smaller calls are computed inline
+static u64 JobFib(job_system& Jobs, u32 N, u32 Cutoff) {
+	if (N < Cutoff || N < 2) {
+		return SerialFib(N);
+	}
+	u64 Left = 0;
+	job_counter Counter;
+	Jobs.Run([&Jobs, &Left, N, Cutoff]() { Left = JobFib(Jobs, N - 1, Cutoff); }, Counter);
+	const u64 Right = JobFib(Jobs, N - 2, Cutoff);
+	Jobs.Wait(Counter);
+	return Left + Right;
+}
+
+// Halves range until it is not bigger than Grain, upper halves become jobs for thieves.
+// All jobs share the counter, nested jobs are counted before their parent finishes so it can't reach zero early.
+template <typename functor_type>
+static void SplitFor(
+	job_system& Jobs, index Begin, index End, index Grain, const functor_type& Functor, job_counter& Counter) {
+	while (End - Begin > Grain) {
+		const index Middle = Begin + (End - Begin) / 2;
+		Jobs.Run([&Jobs, Middle, End, Grain, &Functor, &Counter]() {
+			SplitFor(Jobs, Middle, End, Grain, Functor, Counter);
+		}, Counter);
+		End = Middle;
+	}
+	Functor(Begin, End);
+}
+
+template <typename functor_type>
+static void ParallelFor(job_system& Jobs, index Count, index Grain, const functor_type& Functor) {
+	job_counter Counter;
+	SplitFor(Jobs, 0, Count, Grain, Functor, Counter);
+	Jobs.Wait(Counter);
+}
+
+static bool FibCheck(u32 NumThreads) {
+	std::cout << "------------------------------------------" << std::endl;
+	std::cout << "Testing with " << NumThreads << " background threads" << std::endl;
+	job_system Jobs{NumThreads};
+	TEST_CHECK(Jobs.GetNumWorkers() == NumThreads + 1 && job_system::GetCurrentWorkerIndex() == 0, "workers");
+	TEST_CHECK(JobFib(Jobs, 25, 0) == SerialFib(25), "fib with job per call");
+	TEST_CHECK(JobFib(Jobs, 30, 15) == SerialFib(30), "fib with cutoff");
+	return true;
+}
+
+static bool ParallelForCheck(u32 NumThreads) {
+	std::cout << "------------------------------------------" << std::endl;
+	std::cout << "Testing with " << NumThreads << " background threads" << std::endl;
+	job_system Jobs{NumThreads};
+	std::vector<u32> Visits(100000);
+	std::vector<std::atomic<u32>> UsedWorkers(Jobs.GetNumWorkers());
+	for (index Grain : {1u, 7u, 1000u, 1000000u}) {
+		ParallelFor(Jobs, (index) Visits.size(), Grain, [&](index Begin, index End) {
+			UsedWorkers[job_system::GetCurrentWorkerIndex()].fetch_add(1, std::memory_order_relaxed);
+			for (index Element = Begin; Element < End; ++Element) {
+				++Visits[Element];
+			}
+		});
+	}
+	bool Valid = true;
+	for (u32 Visit : Visits) {
+		Valid = Valid && Visit == 4;
+	}
+	TEST_CHECK(Valid, "every element visited once per loop");
+	u32 NumUsedWorkers = 0;
+	for (std::atomic<u32>& Used : UsedWorkers) {
+		NumUsedWorkers += Used > 0;
+	}
+	std::cout << NumUsedWorkers << " of " << Jobs.GetNumWorkers() << " workers executed jobs" << std::endl;
+	return true;
+}
+
+// many independent counters and jobs that are waited on from other jobs
+static bool NestedWaitCheck(u32 NumThreads) {
+	std::cout << "------------------------------------------" << std::endl;
+	job_system Jobs{NumThreads};
+	std::atomic<u64> Sum{0};
+	job_counter Outer;
+	for (u64 Group = 0; Group < 64; ++Group) {
+		Jobs.Run([&Jobs, &Sum, Group]() {
+			job_counter Inner;
+			u64 Values[16]{};
+			for (u64 Item = 0; Item < 16; ++Item) {
+				u64* Value = &Values[Item];
+				Jobs.Run([Value, Group, Item]() { *Value = Group * 16 + Item; }, Inner);
+			}
+			Jobs.Wait(Inner);
+			u64 GroupSum = 0;
+			for (u64 Value : Values) {
+				GroupSum += Value;
+			}
+			Sum.fetch_add(GroupSum);
+		}, Outer);
+	}
+	Jobs.Wait(Outer);
+	TEST_CHECK(Outer.IsDone() && Sum == 1024 * 1023 / 2, "nested waits");
+
+	// reusing counter after it reached zero
+	std::atomic<u32> Executed{0};
+	for (u32 Round = 0; Round < 100; ++Round) {
+		for (u32 Job = 0; Job < 100; ++Job) {
+			Jobs.Run([&Executed]() { Executed.fetch_add(1, std::memory_order_relaxed); }, Outer);
+		}
+		Jobs.Wait(Outer);
+	}
+	TEST_CHECK(Executed == 10000, "counter reuse");
+	return true;
+}
+
+// starting and stopping system with parked workers must not hang
+static bool LifetimeCheck(u32 NumThreads) {
+	std::cout << "------------------------------------------" << std::endl;
+	for (u32 Iteration = 0; Iteration < 20; ++Iteration) {
+		job_system Jobs{NumThreads};
+		if (Iteration % 2) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		}
+		job_counter Counter;
+		Jobs.Run([]() {}, Counter);
+		Jobs.Wait(Counter);
+	}
+	TEST_CHECK(job_system::GetCurrentWorkerIndex() == InvalidIndex, "creating thread is released");
+	return true;
+}
+
+s32 job_system_test::Test(const std::span<char*>& Args) {
+	TEST_PRINT_LINE();
+	bool Passed = true;
+	const u32 NumThreads = math::Max(4u, std::thread::hardware_concurrency());
+	for (u32 Threads : {0u, 1u, NumThreads}) {
+		Passed = Passed && FibCheck(Threads);
+		Passed = Passed && ParallelForCheck(Threads);
+		Passed = Passed && NestedWaitCheck(Threads);
+		Passed = Passed && LifetimeCheck(Threads);
+	}
+	return Passed ? 0 : 1;
+}
+
+static void FibPerformanceTests(job_system& Jobs, u32 N) {
+	const std::string Name = "fib(" + std::to_string(N) + ")";
+	const std::string Workers = " on " + std::to_string(Jobs.GetNumWorkers()) + " workers";
+	const u64 Expected = SerialFib(N);
+	bool Correct = true;
+	bench::Run(Name + " serial", {.Samples = 5}, [&](bench::state& State) {
+		for (u64 Iter = 0; Iter < State.Iterations; ++Iter) {
+			bench::DoNotOptimize(SerialFib(N));
+		}
+	});
+	for (u32 Cutoff : {2u, 10u, 20u}) {
+		// number of JobFib calls above cutoff, each one runs a job
+		const u64 NumJobs = Cutoff <= 2 ? SerialFib(N + 1) - 1 : SerialFib(N - Cutoff + 3) - 1;
+		const std::string JobsName = Name + " jobs with cutoff " + std::to_string(Cutoff) + Workers;
+		bench::Run(JobsName, {.Samples = 5}, [&](bench::state& State) {
+			for (u64 Iter = 0; Iter < State.Iterations; ++Iter) {
+				Correct = Correct && JobFib(Jobs, N, Cutoff) == Expected;
+			}
+			State.SetCounter("jobs", (double) NumJobs);
+		});
+	}
+	if (!Correct) {
+		std::cout << "WRONG fib result" << std::endl;
+	}
+}
+
+static void ParallelForPerformanceTests(job_system& Jobs, index Count) {
+	const std::string Name = "parallel for over " + std::to_string(Count) + " elements";
+	std::vector<float> Values(Count, 2.f);
+	const auto Kernel = [&](index Begin, index End) {
+		for (index Element = Begin; Element < End; ++Element) {
+			Values[Element] = std::sqrt(Values[Element] * Values[Element] + 1.f);
+		}
+	};
+	bench::Run(Name + " serial", {.ItemsPerIteration = Count}, [&](bench::state& State) {
+		for (u64 Iter = 0; Iter < State.Iterations; ++Iter) {
+			Kernel(0, Count);
+		}
+	});
+	for (index Grain : {256u, 4096u, 65536u}) {
+		const std::string GrainName = Name + " grain " + std::to_string(Grain) + " on " +
+									  std::to_string(Jobs.GetNumWorkers()) + " workers";
+		bench::Run(GrainName, {.ItemsPerIteration = Count}, [&](bench::state& State) {
+			for (u64 Iter = 0; Iter < State.Iterations; ++Iter) {
+				ParallelFor(Jobs, Count, Grain, Kernel);
+			}
+		});
+	}
+	bench::DoNotOptimize(Values[Count / 2]);
+}
+
+// cost of Run + execution of empty job, jobs pushed by one thread and stolen by others
+static void OverheadPerformanceTests(u32 NumThreads, index NumJobs) {
+	job_system Jobs{NumThreads};
+	std::atomic<u32> Executed{0};
+	const std::string Name = "scheduling overhead on " + std::to_string(Jobs.GetNumWorkers()) + " workers";
+	bench::Run(Name, {.ItemsPerIteration = NumJobs}, [&](bench::state& State) {
+		for (u64 Iter = 0; Iter < State.Iterations; ++Iter) {
+			job_counter Counter;
+			for (index Job = 0; Job < NumJobs; ++Job) {
+				Jobs.Run([&Executed]() { Executed.fetch_add(1, std::memory_order_relaxed); }, Counter);
+			}
+			Jobs.Wait(Counter);
+		}
+	});
+}
+
+void job_system_test::Benchmark(const std::span<char*>& Args) {
+	TEST_PRINT_LINE();
+	{
+		job_system Jobs;
+		FibPerformanceTests(Jobs, 32);
+		ParallelForPerformanceTests(Jobs, 1 << 24);
+	}
+	OverheadPerformanceTests(0, 1000000);
+	OverheadPerformanceTests(math::Max(1u, std::thread::hardware_concurrency()) - 1, 1000000);
+	OverheadPerformanceTests(math::Max(1u, std::thread::hardware_concurrency()) * 2, 1000000);
+}
+
+TEST_ENTRY(job_system_test);
@@ -0,0 +1,234 @@
+﻿#include "../testing_shared.h"
+#include "Concurrency/spinlock.h"
+#include "Concurrency/mutex.h"
+#include "Concurrency/rw_lock.h"
+
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+struct locks_test {
+	s32 Test(const std::span<char*>& Args);
+	void Benchmark(const std::span<char*>& Args);
+};
+
+// previous spinlock, spins with constant pause and never yields
+struct pause_spinlock {
+	std::atomic<bool> Flag{false};
+
+	void Lock() {
+		while (Flag.exchange(true, std::memory_order_acquire)) {
+			CPU_PAUSE();
+		}
+	}
+
+	void Unlock() {
+		Flag.store(false, std::memory_order_release);
+	}
+};
+
+template <typename lock_type>
+static void LockExclusive(lock_type& Lock) {
+	Lock.Lock();
+}
+
+template <typename lock_type>
+static void UnlockExclusive(lock_type& Lock) {
+	Lock.Unlock();
+}
+
+static void LockExclusive(std::mutex& Lock) {
+	Lock.lock();
+}
+
+static void UnlockExclusive(std::mutex& Lock) {
+	Lock.unlock();
+}
+
+static void LockExclusive(std::shared_mutex& Lock) {
+	Lock.lock();
+}
+
+static void UnlockExclusive(std::shared_mutex& Lock) {
+	Lock.unlock();
+}
+
+static void LockShared(rw_lock& Lock) {
+	Lock.LockShared();
+}
+
+static void UnlockShared(rw_lock& Lock) {
+	Lock.UnlockShared();
+}
+
+static void LockShared(std::shared_mutex& Lock) {
+	Lock.lock_shared();
+}
+
+static void UnlockShared(std::shared_mutex& Lock) {
+	Lock.unlock_shared();
+}
+
+// non-atomic counter only adds up if lock excludes all other threads
+template <typename lock_type>
+static bool MutualExclusionCheck(const char* Name, u32 NumThreads, u64 Iterations) {
+	lock_type Lock;
+	u64 Counter = 0;
+	std::vector<std::thread> Threads;
+	for (u32 Thread = 0; Thread < NumThreads; ++Thread) {
+		Threads.emplace_back([&]() {
+			for (u64 Iteration = 0; Iteration < Iterations; ++Iteration) {
+				LockExclusive(Lock);
+				++Counter;
+				UnlockExclusive(Lock);
+			}
+		});
+	}
+	for (std::thread& Thread : Threads) {
+		Thread.join();
+	}
+	TEST_CHECK(Counter == NumThreads * Iterations, Name);
+	return true;
+}
+
+// writers keep two counters equal, readers must never see them differ
+static bool ReaderWriterCheck(u32 NumReaders, u32 NumWriters, u64 Iterations) {
+	rw_lock Lock;
+	u64 First = 0;
+	u64 Second = 0;
+	std::atomic<bool> Valid{true};
+	std::atomic<u32> WritersDone{0};
+	std::vector<std::thread> Threads;
+	for (u32 Writer = 0; Writer < NumWriters; ++Writer) {
+		Threads.emplace_back([&]() {
+			for (u64 Iteration = 0; Iteration < Iterations; ++Iteration) {
+				Lock.Lock();
+				++First;
+				++Second;
+				Lock.Unlock();
+			}
+			WritersDone.fetch_add(1);
+		});
+	}
+	for (u32 Reader = 0; Reader < NumReaders; ++Reader) {
+		Threads.emplace_back([&]() {
+			while (WritersDone.load() < NumWriters) {
+				Lock.LockShared();
+				if (First != Second) {
+					Valid = false;
+				}
+				Lock.UnlockShared();
+			}
+		});
+	}
+	for (std::thread& Thread : Threads) {
+		Thread.join();
+	}
+	TEST_CHECK(Valid && First == NumWriters * Iterations && Second == First, "rw_lock readers see consistent state");
+	return true;
+}
+
+static bool TryLockCheck() {
+	mutex Mutex;
+	TEST_CHECK(Mutex.TryLock() && !Mutex.TryLock(), "mutex try lock");
+	Mutex.Unlock();
+	rw_lock Lock;
+	TEST_CHECK(Lock.TryLockShared() && Lock.TryLockShared() && !Lock.TryLock(), "rw_lock readers share");
+	Lock.UnlockShared();
+	Lock.UnlockShared();
+	TEST_CHECK(Lock.TryLock() && !Lock.TryLockShared() && !Lock.TryLock(), "rw_lock writer excludes");
+	Lock.Unlock();
+	spinlock Spinlock;
+	TEST_CHECK(Spinlock.TryLock() && !Spinlock.TryLock(), "spinlock try lock");
+	Spinlock.Unlock();
+	return true;
+}
+
+s32 locks_test::Test(const std::span<char*>& Args) {
+	TEST_PRINT_LINE();
+	bool Passed = true;
+	Passed = Passed && TryLockCheck();
+	// more threads than cores on most machines, owners get preempted inside critical sections
+	const u32 NumThreads = math::Max(2u, std::thread::hardware_concurrency()) * 4;
+	Passed = Passed && MutualExclusionCheck<spinlock>("spinlock", NumThreads, 20000);
+	Passed = Passed && MutualExclusionCheck<mutex>("mutex", NumThreads, 20000);
+	Passed = Passed && MutualExclusionCheck<rw_lock>("rw_lock", NumThreads, 20000);
+	Passed = Passed && ReaderWriterCheck(4, 2, 50000);
+	Passed = Passed && ReaderWriterCheck(NumThreads, NumThreads, 5000);
+	return Passed ? 0 : 1;
+}
+
+// Critical section touches a few shared cache lines, work outside of it keeps lock from being always contended
+template <typename lock_type>
+static void RunContended(const char* LockName, u32 NumThreads, u64 OpsPerThread, u32 SharedPercent) {
+	const std::string Name = std::string{LockName} + " " + std::to_string(SharedPercent) + "% shared " +
+							 std::to_string(NumThreads) + " threads";
+	const bench::config Config{
+		.Samples = 5, .WarmupSamples = 0, .Iterations = 1, .ItemsPerIteration = OpsPerThread * NumThreads};
+	bench::Run(Name, Config, [&](bench::state& State) {
+		State.PauseTiming();
+		lock_type Lock;
+		u64 Shared[32]{};
+		std::atomic<bool> Start{false};
+		std::vector<std::thread> Threads;
+		for (u32 Thread = 0; Thread < NumThreads; ++Thread) {
+			Threads.emplace_back([&, Thread]() {
+				u64 Local = Thread;
+				while (!Start.load(std::memory_order_acquire)) {
+					std::this_thread::yield();
+				}
+				for (u64 Op = 0; Op < OpsPerThread; ++Op) {
+					Local = Local * 6364136223846793005ull + 1442695040888963407ull;
+					if constexpr (requires { LockShared(Lock); }) {
+						if ((Local >> 33) % 100 < SharedPercent) {
+							LockShared(Lock);
+							Local += Shared[Local % 32];
+							UnlockShared(Lock);
+							continue;
+						}
+					}
+					LockExclusive(Lock);
+					for (u64& Value : Shared) {
+						Value += Local;
+					}
+					UnlockExclusive(Lock);
+					for (u32 Work = 0; Work < 64; ++Work) {
+						Local = Local * 6364136223846793005ull + 1;
+					}
+				}
+				// keeps Local alive, Shared is only touched under lock
+				LockExclusive(Lock);
+				Shared[0] += Local == 0;
+				UnlockExclusive(Lock);
+			});
+		}
+		State.ResumeTiming();
+		Start.store(true, std::memory_order_release);
+		for (std::thread& Thread : Threads) {
+			Thread.join();
+		}
+	});
+}
+
+static void OversubscriptionTests(u64 TotalOps) {
+	const u32 NumCores = math::Max(1u, std::thread::hardware_concurrency());
+	for (u32 NumThreads : {1u, NumCores, NumCores * 2, NumCores * 4, NumCores * 8}) {
+		const u64 OpsPerThread = TotalOps / NumThreads;
+		RunContended<pause_spinlock>("pause spinlock", NumThreads, OpsPerThread, 0);
+		RunContended<spinlock>("spinlock", NumThreads, OpsPerThread, 0);
+		RunContended<mutex>("mutex", NumThreads, OpsPerThread, 0);
+		RunContended<std::mutex>("std::mutex", NumThreads, OpsPerThread, 0);
+		RunContended<rw_lock>("rw_lock", NumThreads, OpsPerThread, 95);
+		RunContended<std::shared_mutex>("std::shared_mutex", NumThreads, OpsPerThread, 95);
+		RunContended<mutex>("mutex", NumThreads, OpsPerThread, 95);
+	}
+}
+
+void locks_test::Benchmark(const std::span<char*>& Args) {
+	TEST_PRINT_LINE();
+	OversubscriptionTests(2000000);
+}
+
+TEST_ENTRY(locks_test);
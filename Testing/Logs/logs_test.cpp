@@ -0,0 +1,735 @@
+﻿#include "../testing_shared.h"
+#include "Logs/logs.h"
+#include "Logs/log_ring.h"
+#include "Logs/log_throttle.h"
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct logs_test {
+	s32 Test(const std::span<char*>& Args);
+	void Benchmark(const std::span<char*>& Args);
+};
+
+// redirects std::cout (where logs are written) for its lifetime
+struct output_capture {
+	std::ostringstream Stream;
+	std::streambuf* Previous{nullptr};
+
+	output_capture() : Previous{std::cout.rdbuf(Stream.rdbuf())} {
+	}
+
+	~output_capture() {
+		std::cout.rdbuf(Previous);
+	}
+
+	// log lines without timestamps, which differ between runs
+	std::vector<std::string> GetLines() {
+		logs::Flush();
+		std::vector<std::string> Lines;
+		std::istringstream Input(Stream.str());
+		std::string Line;
+		while (std::getline(Input, Line)) {
+			const size_t Separator = Line.find(" | ");
+			Lines.push_back(Separator == std::string::npos ? Line : Line.substr(Separator + 3));
+		}
+		return Lines;
+	}
+};
+
+static std::string GetLogPath(const char* Name) {
+	return (std::filesystem::temp_directory_path() / Name).string();
+}
+
+static void RemoveLogFiles(const std::string& Path) {
+	for (u32 FileIndex = 0; FileIndex < 10; ++FileIndex) {
+		std::filesystem::remove(FileIndex == 0 ? Path : Path + "." + std::to_string(FileIndex));
+	}
+}
+
+static std::string ReadFile(const std::string& Path) {
+	std::ifstream File(Path, std::ios::binary);
+	std::ostringstream Contents;
+	Contents << File.rdbuf();
+	return Contents.str();
+}
+
+struct null_buffer : std::streambuf {
+	int overflow(int Char) override {
+		return Char;
+	}
+
+	std::streamsize xsputn(const char*, std::streamsize Count) override {
+		return Count;
+	}
+};
+
+static bool RingCheck() {
+	std::cout << "------------------------------------------" << std::endl;
+	log_ring Ring{256};
+	index Size = 0;
+	TEST_CHECK(Ring.TryPeek(Size) == nullptr, "new ring is empty");
+	// sizes that don't divide capacity, so records keep hitting the end and get padded
+	u64 Written = 0;
+	u64 Read = 0;
+	bool Ordered = true;
+	for (index Round = 0; Round < 1000; ++Round) {
+		const index RecordSize = log_ring::GetAlignedSize(8 + (Round * 13) % 100);
+		u8* Memory = Ring.TryReserve(RecordSize);
+		while (!Memory) {
+			const u8* Oldest = Ring.TryPeek(Size);
+			Ordered = Ordered && Oldest && *(const u64*) Oldest == Read++;
+			Ring.Pop();
+			Memory = Ring.TryReserve(RecordSize);
+		}
+		*(u64*) Memory = Written++;
+		Ring.Commit();
+	}
+	while (const u8* Memory = Ring.TryPeek(Size)) {
+		Ordered = Ordered && *(const u64*) Memory == Read++;
+		Ring.Pop();
+	}
+	TEST_CHECK(Ordered, "records come out in order");
+	TEST_CHECK(Read == Written && Ring.IsEmpty(), "everything read");
+	TEST_CHECK(Ring.TryReserve(Ring.GetMaxRecordSize() + 8) == nullptr, "oversized record never fits");
+
+	// one producer and one consumer thread, payload checksum has to survive wrapping
+	log_ring SharedRing{1024};
+	constexpr u64 NumRecords = 200000;
+	std::thread Producer([&]() {
+		for (u64 Record = 0; Record < NumRecords; ++Record) {
+			const index Words = 1 + Record % 17;
+			u8* Memory;
+			while (!(Memory = SharedRing.TryReserve(Words * 8))) {
+				std::this_thread::yield();
+			}
+			for (index Word = 0; Word < Words; ++Word) {
+				((u64*) Memory)[Word] = Record * 31 + Word;
+			}
+			SharedRing.Commit();
+		}
+	});
+	bool Valid = true;
+	for (u64 Record = 0; Record < NumRecords;) {
+		const u8* Memory = SharedRing.TryPeek(Size);
+		if (!Memory) {
+			std::this_thread::yield();
+			continue;
+		}
+		Valid = Valid && Size == (1 + Record % 17) * 8;
+		for (index Word = 0; Word < Size / 8; ++Word) {
+			Valid = Valid && ((const u64*) Memory)[Word] == Record * 31 + Word;
+		}
+		SharedRing.Pop();
+		++Record;
+	}
+	Producer.join();
+	TEST_CHECK(Valid && SharedRing.IsEmpty(), "concurrent records intact");
+	return true;
+}
+
+static void LogSample(index Round) {
+	// arguments are temporaries, async path has to copy them
+	const str Name{"temporary string"};
+	logs::Info("round {} name {} flag {} ratio {}", Round, Name, Round % 2 == 0, 0.5f);
+	logs::Warning(atom{"Test Category"}, "warning {}", str{"with category"});
+	logs::Error("error without arguments");
+	logs::Debug(str{"format string {} that is a temporary"}, -(s64) Round);
+}
+
+// deferred formatting has to produce exactly the same lines
+static bool AsyncMatchCheck() {
+	std::cout << "------------------------------------------" << std::endl;
+	std::vector<std::string> SyncLines;
+	std::vector<std::string> AsyncLines;
+	{
+		output_capture Capture;
+		for (index Round = 0; Round < 100; ++Round) {
+			LogSample(Round);
+		}
+		SyncLines = Capture.GetLines();
+	}
+	bool WasAsync = false;
+	{
+		output_capture Capture;
+		logs::StartAsync();
+		WasAsync = logs::IsAsync();
+		for (index Round = 0; Round < 100; ++Round) {
+			LogSample(Round);
+		}
+		AsyncLines = Capture.GetLines();
+		logs::StopAsync();
+	}
+	TEST_CHECK(WasAsync && !logs::IsAsync(), "async started and stopped");
+	TEST_CHECK(SyncLines.size() == 400 && SyncLines == AsyncLines, "async output matches sync output");
+	return true;
+}
+
+// every line is written once, lines of one thread keep their order, rings of exited threads are drained
+static bool ThreadsCheck(u32 NumThreads, index MessagesPerThread) {
+	std::cout << "------------------------------------------" << std::endl;
+	std::vector<std::string> Lines;
+	{
+		output_capture Capture;
+		logs::StartAsync({.Overflow = logs::overflow_policy::block});
+		std::vector<std::thread> Threads;
+		for (u32 Thread = 0; Thread < NumThreads; ++Thread) {
+			Threads.emplace_back([Thread, MessagesPerThread]() {
+				for (index Message = 0; Message < MessagesPerThread; ++Message) {
+					logs::Info("thread {} message {}", Thread, Message);
+				}
+			});
+		}
+		for (std::thread& Thread : Threads) {
+			Thread.join();
+		}
+		Lines = Capture.GetLines();
+		logs::StopAsync();
+	}
+	std::vector<index> NextMessage(NumThreads, 0);
+	bool Ordered = true;
+	for (const std::string& Line : Lines) {
+		u32 Thread = 0;
+		index Message = 0;
+		if (std::sscanf(Line.c_str(), "INFO    | Global Category | thread %u message %u", &Thread, &Message) == 2) {
+			Ordered = Ordered && Thread < NumThreads && NextMessage[Thread]++ == Message;
+		}
+	}
+	TEST_CHECK(Ordered, "lines of every thread are in order");
+	TEST_CHECK(
+		std::all_of(NextMessage.begin(), NextMessage.end(), [&](index Count) { return Count == MessagesPerThread; }),
+		"all lines written");
+	return true;
+}
+
+// Threads keep logging while async logging is stopped under them, records committed by threads that saw it
+// still running must be written by StopAsync, later messages are written synchronously
+static bool StopRaceCheck(u32 NumThreads, index Rounds) {
+	std::cout << "------------------------------------------" << std::endl;
+	bool Valid = true;
+	for (index Round = 0; Round < Rounds && Valid; ++Round) {
+		std::vector<std::string> Lines;
+		std::vector<index> Logged(NumThreads, 0);
+		{
+			output_capture Capture;
+			logs::StartAsync({.Overflow = logs::overflow_policy::block});
+			std::atomic<bool> Logging{true};
+			std::vector<std::thread> Threads;
+			for (u32 Thread = 0; Thread < NumThreads; ++Thread) {
+				Threads.emplace_back([&, Thread]() {
+					while (Logging.load(std::memory_order_relaxed)) {
+						logs::Info("thread {} message {}", Thread, Logged[Thread]++);
+					}
+				});
+			}
+			std::this_thread::sleep_for(std::chrono::microseconds(200));
+			logs::StopAsync();
+			Logging.store(false);
+			for (std::thread& Thread : Threads) {
+				Thread.join();
+			}
+			Lines = Capture.GetLines();
+		}
+		// synchronous lines may overtake records still waiting in rings, only presence is checked
+		std::vector<std::vector<index>> Messages(NumThreads);
+		for (const std::string& Line : Lines) {
+			u32 Thread = 0;
+			index Message = 0;
+			if (std::sscanf(Line.c_str(), "INFO    | Global Category | thread %u message %u", &Thread, &Message) == 2) {
+				Valid = Valid && Thread < NumThreads;
+				if (Valid) {
+					Messages[Thread].push_back(Message);
+				}
+			}
+		}
+		for (u32 Thread = 0; Thread < NumThreads && Valid; ++Thread) {
+			std::sort(Messages[Thread].begin(), Messages[Thread].end());
+			Valid = Messages[Thread].size() == Logged[Thread];
+			for (index Message = 0; Message < Messages[Thread].size() && Valid; ++Message) {
+				Valid = Messages[Thread][Message] == Message;
+			}
+		}
+	}
+	TEST_CHECK(Valid, "every message written once when stopping");
+	return true;
+}
+
+// Tiny ring and background thread that rarely wakes up on its own. Dropped debug messages are reported,
+// warnings are never dropped
+static bool OverflowCheck() {
+	std::cout << "------------------------------------------" << std::endl;
+	constexpr index NumMessages = 20000;
+	const u64 DroppedBefore = logs::GetDroppedCount();
+	std::vector<std::string> Lines;
+	{
+		output_capture Capture;
+		logs::StartAsync({.RingSize = 1024, .Overflow = logs::overflow_policy::drop, .FlushIntervalMs = 1000});
+		// fresh thread gets a ring of the configured size
+		std::thread Thread([]() {
+			for (index Message = 0; Message < NumMessages; ++Message) {
+				logs::Debug("debug {}", Message);
+				logs::Warning("warning {}", Message);
+			}
+		});
+		Thread.join();
+		Lines = Capture.GetLines();
+		logs::StopAsync();
+	}
+	const u64 Dropped = logs::GetDroppedCount() - DroppedBefore;
+	index NumDebug = 0;
+	index NumWarning = 0;
+	u64 Reported = 0;
+	for (const std::string& Line : Lines) {
+		NumDebug += Line.starts_with("DEBUG");
+		unsigned long long Count = 0;
+		if (std::sscanf(Line.c_str(), "WARNING | Global Category | %llu messages dropped", &Count) == 1) {
+			Reported += Count;
+		} else {
+			NumWarning += Line.starts_with("WARNING");
+		}
+	}
+	std::cout << "\t" << Dropped << " of " << NumMessages << " debug messages dropped" << std::endl;
+	TEST_CHECK(NumWarning == NumMessages, "warnings are never dropped");
+	TEST_CHECK(NumDebug + Dropped == NumMessages && Reported == Dropped, "dropped messages are counted and reported");
+
+	// message bigger than the ring falls back to synchronous output
+	std::vector<std::string> BigLines;
+	{
+		output_capture Capture;
+		logs::StartAsync({.RingSize = 64});
+		std::thread Thread([]() {
+			const str Big{std::string(1000, 'x').c_str()};
+			logs::Info("big {}", Big);
+		});
+		Thread.join();
+		BigLines = Capture.GetLines();
+		logs::StopAsync();
+	}
+	TEST_CHECK(BigLines.size() == 1 && BigLines[0].size() > 1000, "oversized message is written synchronously");
+	return true;
+}
+
+// Rotated files keep the most recent lines in order, each file stays under the size limit
+static bool FileSinkCheck(bool Async) {
+	std::cout << "------------------------------------------" << std::endl;
+	std::cout << "Testing " << (Async ? "async" : "sync") << " file sink" << std::endl;
+	constexpr index NumMessages = 2000;
+	const std::string Path = GetLogPath("scratch_logs_test.log");
+	RemoveLogFiles(Path);
+	logs::file_sink_config Config;
+	Config.BufferSize = 8 * 1024;
+	Config.MaxFileSize = 16 * 1024;
+	Config.MaxFiles = 3;
+	u64 NumWrites = 0;
+	{
+		logs::file_sink Sink{str_view{Path.c_str()}, Config};
+		TEST_CHECK(Sink.IsOpen(), "file opened");
+		logs::RemoveSink(logs::GetConsoleSink());
+		logs::AddSink(Sink);
+		if (Async) {
+			logs::StartAsync({.Overflow = logs::overflow_policy::block});
+		}
+		for (index Message = 0; Message < NumMessages; ++Message) {
+			logs::Info("file message {}", Message);
+		}
+		logs::StopAsync();
+		logs::RemoveSink(Sink);
+		logs::AddSink(logs::GetConsoleSink());
+		NumWrites = Sink.GetNumWrites();
+	}
+	bool SizesValid = true;
+	std::string Contents;
+	for (u32 FileIndex = 3; FileIndex-- > 0;) {
+		const std::string FilePath = FileIndex == 0 ? Path : Path + "." + std::to_string(FileIndex);
+		SizesValid = SizesValid && std::filesystem::exists(FilePath);
+		SizesValid = SizesValid && std::filesystem::file_size(FilePath) <= Config.MaxFileSize;
+		Contents += ReadFile(FilePath);
+	}
+	TEST_CHECK(SizesValid && !std::filesystem::exists(Path + ".3"), "files rotated within size limit");
+	std::istringstream Lines(Contents);
+	std::string Line;
+	index Expected = ~0u;
+	bool Consecutive = true;
+	while (std::getline(Lines, Line)) {
+		index Message = 0;
+		const char* Text = Line.c_str() + Line.find(" | ") + 3;
+		Consecutive = Consecutive && std::sscanf(Text, "INFO    | Global Category | file message %u", &Message) == 1;
+		Consecutive = Consecutive && (Expected == ~0u || Message == Expected);
+		Expected = Message + 1;
+	}
+	std::cout << "\t" << NumWrites << " writes for " << NumMessages << " lines" << std::endl;
+	TEST_CHECK(Consecutive && Expected == NumMessages, "most recent lines kept in order");
+	TEST_CHECK(Async ? NumWrites < NumMessages / 10 : NumWrites == NumMessages, "writes are batched when async");
+	RemoveLogFiles(Path);
+	return true;
+}
+
+static bool MemorySinkCheck() {
+	std::cout << "------------------------------------------" << std::endl;
+	logs::memory_sink Sink{256};
+	logs::RemoveSink(logs::GetConsoleSink());
+	logs::AddSink(Sink);
+	for (index Message = 0; Message < 100; ++Message) {
+		logs::Info("memory message {}", Message);
+	}
+	logs::RemoveSink(Sink);
+	logs::AddSink(logs::GetConsoleSink());
+	logs::line_buffer Text;
+	Sink.GetText(Text);
+	const std::string Kept{Text.GetData(), Text.GetSize()};
+	TEST_CHECK(Kept.size() <= 256 && Kept.ends_with("memory message 99\n"), "last lines kept");
+	const bool WholeLines = Kept.find(" | ") < Kept.find('\n') && Kept.find("memory message 98\n") != std::string::npos;
+	TEST_CHECK(WholeLines, "only whole lines kept");
+	TEST_CHECK(Kept.find("\033") == std::string::npos, "lines without colors");
+	return true;
+}
+
+// lines sitting in ring and in sink buffer have to reach the file
+static bool CrashFlushCheck() {
+	std::cout << "------------------------------------------" << std::endl;
+	const std::string Path = GetLogPath("scratch_logs_crash.log");
+	RemoveLogFiles(Path);
+	logs::file_sink Sink{str_view{Path.c_str()}, {.BufferSize = 1024 * 1024}};
+	logs::AddSink(Sink);
+	logs::RemoveSink(logs::GetConsoleSink());
+	logs::StartAsync({.FlushIntervalMs = 100000});
+	for (index Message = 0; Message < 100; ++Message) {
+		logs::Error("crash message {}", Message);
+	}
+	logs::FlushOnCrash();
+	const std::string Contents = ReadFile(Path);
+	logs::StopAsync();
+	logs::RemoveSink(Sink);
+	logs::AddSink(logs::GetConsoleSink());
+	TEST_CHECK(std::count(Contents.begin(), Contents.end(), '\n') == 100, "pending lines written by crash flush");
+	RemoveLogFiles(Path);
+	return true;
+}
+
+static logs::category TestCategory{atom{"Test Category"}};
+
+// runtime levels per category, also for categories created after the level was set
+static bool VerbosityCheck() {
+	std::cout << "------------------------------------------" << std::endl;
+	logs::memory_sink Sink{4096};
+	logs::RemoveSink(logs::GetConsoleSink());
+	logs::AddSink(Sink);
+	logs::SetVerbosity(TestCategory.Name, logs::verbosity::warning);
+	logs::SetVerbosity(atom{"Late Category"}, logs::verbosity::error);
+	logs::category LateCategory{atom{"Late Category"}};
+	logs::Debug(TestCategory, "hidden debug");
+	logs::Info(atom{"Test Category"}, "hidden info");
+	logs::Warning(TestCategory, "shown warning");
+	logs::Warning(LateCategory, "hidden warning");
+	logs::Error(LateCategory, "shown error");
+	logs::SetDefaultVerbosity(logs::verbosity::info);
+	logs::Debug("hidden global debug");
+	logs::Info("shown global info");
+	logs::SetDefaultVerbosity(logs::EnabledVerbosity);
+	logs::SetVerbosity(TestCategory.Name, logs::verbosity::debug);
+	logs::Debug(TestCategory, "shown debug");
+	logs::RemoveSink(Sink);
+	logs::AddSink(logs::GetConsoleSink());
+	logs::line_buffer Text;
+	Sink.GetText(Text);
+	const std::string Kept{Text.GetData(), Text.GetSize()};
+	TEST_CHECK(Kept.find("hidden") == std::string::npos, "disabled messages skipped");
+	const bool Shown = Kept.find("shown warning") != std::string::npos &&
+					   Kept.find("shown error") != std::string::npos &&
+					   Kept.find("shown global info") != std::string::npos &&
+					   Kept.find("shown debug") != std::string::npos;
+	TEST_CHECK(Shown, "enabled messages written");
+	TEST_CHECK(logs::GetVerbosity(atom{"Late Category"}) == logs::verbosity::error, "verbosity by name");
+	TEST_CHECK(&logs::GetCategory(atom{"Test Category"}) == &TestCategory, "category found by name");
+	return true;
+}
+
+static void LogOnce(index Value) {
+	LOG_ONCE(debug, TestCategory, "once {}", Value);
+}
+
+static void LogEveryN(index Value) {
+	LOG_EVERY_N(info, TestCategory, 10, "sampled {}", Value);
+}
+
+static void LogRateLimited(index Value) {
+	LOG_RATE_LIMITED(warning, TestCategory, 5, "limited {}", Value);
+}
+
+static index CountOccurrences(const std::string& Text, const std::string& Part) {
+	index Count = 0;
+	for (size_t Position = Text.find(Part); Position != std::string::npos; Position = Text.find(Part, Position + 1)) {
+		++Count;
+	}
+	return Count;
+}
+
+// per call site limits, skipped lines are counted on the next line that gets through
+static bool ThrottleCheck() {
+	std::cout << "------------------------------------------" << std::endl;
+	logs::memory_sink Sink{16 * 1024};
+	logs::RemoveSink(logs::GetConsoleSink());
+	logs::AddSink(Sink);
+	// disabled calls don't use up the single line
+	logs::SetVerbosity(TestCategory.Name, logs::verbosity::info);
+	LogOnce(0);
+	logs::SetVerbosity(TestCategory.Name, logs::verbosity::debug);
+	for (index Call = 1; Call <= 100; ++Call) {
+		LogOnce(Call);
+		LogEveryN(Call);
+		LogRateLimited(Call);
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+	LogRateLimited(101);
+	logs::RemoveSink(Sink);
+	logs::AddSink(logs::GetConsoleSink());
+	logs::line_buffer Text;
+	Sink.GetText(Text);
+	const std::string Kept{Text.GetData(), Text.GetSize()};
+	TEST_CHECK(CountOccurrences(Kept, "once ") == 1 && Kept.find("once 1\n") != std::string::npos, "logged once");
+	const bool Sampled = CountOccurrences(Kept, "sampled ") == 10 && Kept.find("sampled 1\n") != std::string::npos &&
+						 Kept.find("sampled 11 (9 similar messages suppressed)\n") != std::string::npos;
+	TEST_CHECK(Sampled, "every 10th line with suppressed count");
+	const bool Limited = CountOccurrences(Kept, "limited ") == 6 && Kept.find("limited 5\n") != std::string::npos &&
+						 Kept.find("limited 101 (95 similar messages suppressed)\n") != std::string::npos;
+	TEST_CHECK(Limited, "5 lines per second with suppressed count");
+	return true;
+}
+
+s32 logs_test::Test(const std::span<char*>& Args) {
+	TEST_PRINT_LINE();
+	bool Passed = true;
+	Passed = Passed && RingCheck();
+	Passed = Passed && AsyncMatchCheck();
+	Passed = Passed && ThreadsCheck(8, 10000);
+	Passed = Passed && StopRaceCheck(4, 50);
+	Passed = Passed && OverflowCheck();
+	Passed = Passed && FileSinkCheck(false);
+	Passed = Passed && FileSinkCheck(true);
+	Passed = Passed && MemorySinkCheck();
+	Passed = Passed && CrashFlushCheck();
+	Passed = Passed && VerbosityCheck();
+	Passed = Passed && ThrottleCheck();
+	return Passed ? 0 : 1;
+}
+
+// Console output of a benchmark body goes nowhere, restored before the harness prints results
+struct null_console {
+	null_buffer Null;
+	std::streambuf* Previous{std::cout.rdbuf(&Null)};
+
+	~null_console() {
+		logs::Flush();
+		std::cout.rdbuf(Previous);
+	}
+};
+
+// Per call latency seen by logging thread, output goes nowhere so only formatting and handoff are measured.
+// Time per item is wall time over calls of one thread, so it stays the mean call latency when threads run in
+// parallel, percentiles come from timing every call separately in a second pass (includes clock overhead).
+static void MeasureLatency(u32 NumThreads, index CallsPerThread, bool Async) {
+	const std::string BenchName = std::string{"logs::Info "} + (Async ? "async " : "sync ") +
+								  std::to_string(NumThreads) + " threads";
+	const bench::config Config{
+		.Samples = 5, .WarmupSamples = 0, .Iterations = 1, .ItemsPerIteration = (u64) CallsPerThread};
+	bench::Run(BenchName, Config, [&](bench::state& State) {
+		State.PauseTiming();
+		std::optional<null_console> Console{std::in_place};
+		if (Async) {
+			logs::StartAsync({.RingSize = 1024 * 1024, .Overflow = logs::overflow_policy::block});
+		}
+		std::vector<std::vector<s64>> Samples(NumThreads);
+		std::atomic<bool> Start{false};
+		std::vector<std::thread> Threads;
+		for (u32 Thread = 0; Thread < NumThreads; ++Thread) {
+			Threads.emplace_back([&]() {
+				const str Name{"player"};
+				while (!Start.load(std::memory_order_acquire)) {
+					std::this_thread::yield();
+				}
+				for (index Call = 0; Call < CallsPerThread; ++Call) {
+					logs::Info("frame {} entity {} position {}", Call, Name, (float) Call * 0.25f);
+				}
+			});
+		}
+		State.ResumeTiming();
+		Start.store(true, std::memory_order_release);
+		for (std::thread& Thread : Threads) {
+			Thread.join();
+		}
+		State.PauseTiming();
+
+		Threads.clear();
+		for (u32 Thread = 0; Thread < NumThreads; ++Thread) {
+			Threads.emplace_back([&, Thread]() {
+				std::vector<s64>& ThreadSamples = Samples[Thread];
+				ThreadSamples.reserve(CallsPerThread);
+				const str Name{"player"};
+				for (index Call = 0; Call < CallsPerThread; ++Call) {
+					const s64 CallStart = cycle_clock::GetNs();
+					logs::Info("frame {} entity {} position {}", Call, Name, (float) Call * 0.25f);
+					ThreadSamples.push_back(cycle_clock::GetNs() - CallStart);
+				}
+			});
+		}
+		for (std::thread& Thread : Threads) {
+			Thread.join();
+		}
+		logs::StopAsync();
+		Console.reset();
+		std::vector<s64> All;
+		for (const std::vector<s64>& ThreadSamples : Samples) {
+			All.insert(All.end(), ThreadSamples.begin(), ThreadSamples.end());
+		}
+		std::sort(All.begin(), All.end());
+		State.SetCounter("p50 ns", (double) All[All.size() / 2]);
+		State.SetCounter("p99 ns", (double) All[All.size() * 99 / 100]);
+		State.SetCounter("p99.9 ns", (double) All[All.size() * 999 / 1000]);
+		State.ResumeTiming();
+	});
+}
+
+static void LatencyTest(index CallsPerThread) {
+	const u32 NumCores = math::Max(1u, std::thread::hardware_concurrency());
+	for (u32 NumThreads = 1; NumThreads <= math::Max(4u, NumCores); NumThreads *= 4) {
+		MeasureLatency(NumThreads, CallsPerThread, false);
+		MeasureLatency(NumThreads, CallsPerThread, true);
+	}
+}
+
+// Lines until everything is in the sinks, console goes to null buffer
+static void ThroughputTest(index LinesPerThread) {
+	const std::string Path = GetLogPath("scratch_logs_bench.log");
+	struct run {
+		const char* Name;
+		bool File;
+		bool Memory;
+		bool Async;
+		u32 NumThreads;
+	};
+	const run Runs[]{
+		{"console sync", false, false, false, 1},
+		{"console async", false, false, true, 1},
+		{"file sync", true, false, false, 1},
+		{"file async", true, false, true, 1},
+		{"file async 4 threads", true, false, true, 4},
+		{"file + memory + console async 4 threads", true, true, true, 4},
+	};
+	for (const run& Run : Runs) {
+		const u64 Lines = (u64) LinesPerThread * Run.NumThreads;
+		const bench::config Config{.Samples = 3, .WarmupSamples = 0, .Iterations = 1, .ItemsPerIteration = Lines};
+		bench::Run(std::string{"logs::Debug "} + Run.Name, Config, [&](bench::state& State) {
+			State.PauseTiming();
+			std::optional<null_console> Console{std::in_place};
+			RemoveLogFiles(Path);
+			logs::file_sink File{str_view{Path.c_str()}};
+			logs::memory_sink Memory;
+			if (Run.File) {
+				logs::RemoveSink(logs::GetConsoleSink());
+				logs::AddSink(File);
+				if (Run.Memory) {
+					logs::AddSink(Memory);
+					logs::AddSink(logs::GetConsoleSink());
+				}
+			}
+			if (Run.Async) {
+				logs::StartAsync({.RingSize = 1024 * 1024, .Overflow = logs::overflow_policy::block});
+			}
+			State.ResumeTiming();
+			std::vector<std::thread> Threads;
+			for (u32 Thread = 0; Thread < Run.NumThreads; ++Thread) {
+				Threads.emplace_back([LinesPerThread]() {
+					const str Name{"player"};
+					for (index Line = 0; Line < LinesPerThread; ++Line) {
+						logs::Debug("frame {} entity {} position {}", Line, Name, (float) Line * 0.25f);
+					}
+				});
+			}
+			for (std::thread& Thread : Threads) {
+				Thread.join();
+			}
+			logs::StopAsync();
+			logs::Flush();
+			State.PauseTiming();
+			if (Run.File) {
+				State.SetCounter("writes", (double) File.GetNumWrites());
+			}
+			logs::RemoveSink(File);
+			logs::RemoveSink(Memory);
+			logs::RemoveSink(logs::GetConsoleSink());
+			logs::AddSink(logs::GetConsoleSink());
+			Console.reset();
+			State.ResumeTiming();
+		});
+	}
+	RemoveLogFiles(Path);
+}
+
+// Cost of a call that is disabled at runtime, against the same loop without the call
+static void DisabledCallTest() {
+	logs::SetVerbosity(TestCategory.Name, logs::verbosity::info);
+	const atom CategoryName = TestCategory.Name;
+	volatile u64 Sink = 0;
+	bench::Run("empty loop", {}, [&](bench::state& State) {
+		for (u64 Iteration = 0; Iteration < State.Iterations; ++Iteration) {
+			Sink = Sink + Iteration;
+		}
+	});
+	bench::Run("disabled call, category object", {}, [&](bench::state& State) {
+		for (u64 Iteration = 0; Iteration < State.Iterations; ++Iteration) {
+			Sink = Sink + Iteration;
+			logs::Debug(TestCategory, "disabled {} {} {}", Iteration, 1.5f, "text");
+		}
+	});
+	// lookup takes a lock
+	bench::Run("disabled call, category by name", {}, [&](bench::state& State) {
+		for (u64 Iteration = 0; Iteration < State.Iterations; ++Iteration) {
+			Sink = Sink + Iteration;
+			logs::Debug(CategoryName, "disabled {} {} {}", Iteration, 1.5f, "text");
+		}
+	});
+	logs::SetVerbosity(TestCategory.Name, logs::verbosity::debug);
+}
+
+// Cost of a call skipped by its limit, against the empty loop of DisabledCallTest
+static void ThrottledCallTest() {
+	volatile u64 Sink = 0;
+	bench::Run("LOG_ONCE", {}, [&](bench::state& State) {
+		const null_console Console;
+		for (u64 Iteration = 0; Iteration < State.Iterations; ++Iteration) {
+			Sink = Sink + Iteration;
+			LOG_ONCE(debug, TestCategory, "once {} {}", Iteration, 1.5f);
+		}
+	});
+	bench::Run("LOG_EVERY_N", {}, [&](bench::state& State) {
+		const null_console Console;
+		for (u64 Iteration = 0; Iteration < State.Iterations; ++Iteration) {
+			Sink = Sink + Iteration;
+			LOG_EVERY_N(debug, TestCategory, 1000000, "sampled {} {}", Iteration, 1.5f);
+		}
+	});
+	bench::Run("LOG_RATE_LIMITED", {}, [&](bench::state& State) {
+		const null_console Console;
+		for (u64 Iteration = 0; Iteration < State.Iterations; ++Iteration) {
+			Sink = Sink + Iteration;
+			LOG_RATE_LIMITED(debug, TestCategory, 10, "limited {} {}", Iteration, 1.5f);
+		}
+	});
+}
+
+void logs_test::Benchmark(const std::span<char*>& Args) {
+	TEST_PRINT_LINE();
+	LatencyTest(200000);
+	ThroughputTest(500000);
+	DisabledCallTest();
+	ThrottledCallTest();
+}
+
+TEST_ENTRY(logs_test);
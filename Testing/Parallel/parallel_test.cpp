@@ -0,0 +1,276 @@
+﻿#include "../testing_shared.h"
+#include "Concurrency/parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <vector>
+
+struct parallel_test {
+	s32 Test(const std::span<char*>& Args);
+	void Benchmark(const std::span<char*>& Args);
+};
+
+static bool ForCheck(job_system& Jobs, index Count, index Grain) {
+	std::vector<u32> Visits(Count);
+	parallel::For(Jobs, Count, Grain, [&](index Begin, index End) {
+		for (index Index = Begin; Index < End; ++Index) {
+			++Visits[Index];
+		}
+	});
+	parallel::ForEach(Jobs, mutable_span<u32>{Visits.data(), Count}, [](u32& Visit, index) { ++Visit; }, Grain);
+	const bool Valid = std::all_of(Visits.begin(), Visits.end(), [](u32 Visit) { return Visit == 2; });
+	TEST_CHECK(Valid, "for visits every index");
+	return true;
+}
+
+// ranges close to the index limit, chunk arithmetic must not wrap
+static bool LargeCountCheck(job_system& Jobs) {
+	const index Count = ~0u;
+	const index Grain = 1u << 28;
+	TEST_CHECK(parallel::GetNumChunks(Count, Grain) == 16, "chunk count of largest range");
+	std::atomic<u64> Covered{0};
+	std::atomic<index> Last{0};
+	parallel::For(Jobs, Count, Grain, [&](index Begin, index End) {
+		Covered.fetch_add(End - Begin);
+		if (End == Count) {
+			Last.store(Begin);
+		}
+	});
+	TEST_CHECK(Covered.load() == Count && Last.load() == 15 * Grain, "for covers largest range");
+	return true;
+}
+
+static bool ReduceCheck(job_system& Jobs, index Count, index Grain) {
+	std::vector<u64> Values(Count);
+	std::iota(Values.begin(), Values.end(), 1);
+	const span<u64> Elements{Values.data(), Count};
+	const u64 Sum = parallel::Reduce(Jobs, Elements, (u64) 0, [](u64 Left, u64 Right) { return Left + Right; }, Grain);
+	TEST_CHECK(Sum == (u64) Count * (Count + 1) / 2, "reduce sum");
+
+	// count of odd elements, accumulate and combine take different types
+	const u32 Odd = parallel::Reduce(
+		Jobs,
+		Elements,
+		0u,
+		[](u32 Result, u64 Value) { return Result + (Value & 1); },
+		[](u32 Left, u32 Right) { return Left + Right; },
+		Grain);
+	TEST_CHECK(Odd == (Count + 1) / 2, "reduce with accumulate and combine");
+
+	// string concatenation is not commutative, chunk results must be combined in order
+	std::vector<char> Letters(Count);
+	for (index Index = 0; Index < Count; ++Index) {
+		Letters[Index] = (char) ('a' + Index % 26);
+	}
+	const std::string Joined = parallel::Reduce(
+		Jobs,
+		span<char>{Letters.data(), Count},
+		std::string{},
+		[](std::string Result, char Letter) { return Result + Letter; },
+		[](std::string Left, const std::string& Right) { return Left + Right; },
+		Grain);
+	TEST_CHECK(Joined == std::string(Letters.begin(), Letters.end()), "reduce keeps order");
+	return true;
+}
+
+// float sum has to be identical no matter how many workers took part
+static bool DeterminismCheck(index Count) {
+	std::vector<float> Values(Count);
+	std::mt19937 Generator(0);
+	std::uniform_real_distribution<float> Distribution(-1000.f, 1000.f);
+	for (float& Value : Values) {
+		Value = Distribution(Generator);
+	}
+	const auto Add = [](float Left, float Right) { return Left + Right; };
+	float Reference = 0.f;
+	bool Valid = true;
+	for (u32 NumThreads : {0u, 1u, 3u, 8u}) {
+		job_system Jobs{NumThreads};
+		for (u32 Repeat = 0; Repeat < 5; ++Repeat) {
+			const float Sum = parallel::Reduce(Jobs, span<float>{Values.data(), Count}, 0.f, Add, 1000);
+			if (NumThreads == 0 && Repeat == 0) {
+				Reference = Sum;
+			}
+			Valid = Valid && std::memcmp(&Sum, &Reference, sizeof(float)) == 0;
+		}
+	}
+	TEST_CHECK(Valid, "float reduce is deterministic");
+	return true;
+}
+
+static bool ScanCheck(job_system& Jobs, index Count, index Grain) {
+	std::vector<u64> Values(Count);
+	std::mt19937 Generator(Count);
+	for (u64& Value : Values) {
+		Value = Generator() % 100;
+	}
+	std::vector<u64> Expected(Count);
+	std::inclusive_scan(Values.begin(), Values.end(), Expected.begin());
+	std::vector<u64> Result(Count);
+	const auto Add = [](u64 Left, u64 Right) { return Left + Right; };
+	parallel::Scan(Jobs, span<u64>{Values.data(), Count}, mutable_span<u64>{Result.data(), Count}, (u64) 0, Add, Grain);
+	TEST_CHECK(Result == Expected, "scan");
+	parallel::Scan(Jobs, span<u64>{Values.data(), Count}, mutable_span<u64>{Values.data(), Count}, (u64) 0, Add, Grain);
+	TEST_CHECK(Values == Expected, "scan in place");
+	return true;
+}
+
+static bool SortCheck(job_system& Jobs, index Count, index Grain) {
+	std::vector<u32> Values(Count);
+	std::mt19937 Generator(Count);
+	for (u32& Value : Values) {
+		Value = Generator() % (Count / 4 + 1);
+	}
+	std::vector<u32> Expected = Values;
+	std::sort(Expected.begin(), Expected.end());
+	parallel::Sort(Jobs, mutable_span<u32>{Values.data(), Count}, default_less_op{}, Grain);
+	TEST_CHECK(Values == Expected, "sort random with duplicates");
+	parallel::Sort(Jobs, mutable_span<u32>{Values.data(), Count}, default_less_op{}, Grain);
+	TEST_CHECK(Values == Expected, "sort sorted");
+	const auto Greater = [](u32 Left, u32 Right) { return Left > Right; };
+	parallel::Sort(Jobs, mutable_span<u32>{Values.data(), Count}, Greater, Grain);
+	TEST_CHECK(std::equal(Values.begin(), Values.end(), Expected.rbegin()), "sort with predicate");
+
+	// swaps are memcopies for relocatable types, so concurrent sorting doesn't touch instance counter
+	std::vector<complex_type_realloc> Complex;
+	for (index Index = 0; Index < Count; ++Index) {
+		Complex.push_back(MakeValue<complex_type_realloc>(Generator() % 256));
+	}
+	std::vector<complex_type_realloc> ExpectedComplex = Complex;
+	std::sort(ExpectedComplex.begin(), ExpectedComplex.end());
+	parallel::Sort(Jobs, mutable_span<complex_type_realloc>{Complex.data(), Count}, default_less_op{}, Grain);
+	const bool Valid = Complex == ExpectedComplex;
+	TEST_CHECK(Valid, "sort complex type");
+	return true;
+}
+
+s32 parallel_test::Test(const std::span<char*>& Args) {
+	TEST_PRINT_LINE();
+	bool Passed = true;
+	for (u32 NumThreads : {0u, 3u}) {
+		job_system Jobs{NumThreads};
+		for (index Count : {0u, 1u, 1000u, 100000u}) {
+			std::cout << "------------------------------------------" << std::endl;
+			std::cout << "Testing " << Count << " elements on " << Jobs.GetNumWorkers() << " workers" << std::endl;
+			for (index Grain : {1u, 64u, 4096u}) {
+				if (Count / Grain > 10000) {
+					continue;
+				}
+				Passed = Passed && ForCheck(Jobs, Count, Grain);
+				Passed = Passed && ReduceCheck(Jobs, Count, Grain);
+				Passed = Passed && ScanCheck(Jobs, Count, Grain);
+				Passed = Passed && SortCheck(Jobs, Count, Grain);
+			}
+		}
+		Passed = Passed && LargeCountCheck(Jobs);
+	}
+	Passed = Passed && DeterminismCheck(100000);
+	return Passed ? 0 : 1;
+}
+
+// Same work on job systems with growing number of workers, speedup is relative to serial loop
+static void ScalingPerformanceTests(index Count) {
+	const std::string Elements = " " + std::to_string(Count) + " elements";
+	std::vector<float> Source(Count);
+	std::mt19937 Generator(0);
+	for (float& Value : Source) {
+		Value = (float) (Generator() % 1000000);
+	}
+	std::vector<float> Values(Count);
+	std::vector<u32> Keys(Count);
+
+	const auto Transform = [&](index Begin, index End) {
+		for (index Index = Begin; Index < End; ++Index) {
+			Values[Index] = std::sqrt(Source[Index]) * std::sin(Source[Index]);
+		}
+	};
+	const auto Add = [](float Left, float Right) { return Left + Right; };
+	const auto ResetKeys = [&]() {
+		std::transform(Source.begin(), Source.end(), Keys.begin(), [](float Value) { return (u32) Value; });
+	};
+	const bench::config Config{.Samples = 5, .ItemsPerIteration = Count};
+
+	bench::Run("serial for" + Elements, Config, [&](bench::state& State) {
+		for (u64 Iter = 0; Iter < State.Iterations; ++Iter) {
+			Transform(0, Count);
+		}
+	});
+	bench::Run("serial reduce" + Elements, Config, [&](bench::state& State) {
+		for (u64 Iter = 0; Iter < State.Iterations; ++Iter) {
+			bench::DoNotOptimize(std::accumulate(Values.begin(), Values.end(), 0.f));
+		}
+	});
+	bench::Run("serial scan" + Elements, Config, [&](bench::state& State) {
+		for (u64 Iter = 0; Iter < State.Iterations; ++Iter) {
+			std::inclusive_scan(Values.begin(), Values.end(), Values.begin());
+		}
+	});
+	bench::Run("serial sort" + Elements, Config, [&](bench::state& State) {
+		for (u64 Iter = 0; Iter < State.Iterations; ++Iter) {
+			State.PauseTiming();
+			ResetKeys();
+			State.ResumeTiming();
+			algo::Quicksort(Keys.data(), Keys.data() + Count, default_less_op{});
+		}
+	});
+
+	const u32 NumCores = math::Max(1u, std::thread::hardware_concurrency());
+	for (u32 NumWorkers = 1; NumWorkers <= NumCores * 2; NumWorkers *= 2) {
+		job_system Jobs{NumWorkers - 1};
+		const std::string Workers = Elements + " " + std::to_string(NumWorkers) + " workers";
+		bench::Run("parallel::For" + Workers, Config, [&](bench::state& State) {
+			for (u64 Iter = 0; Iter < State.Iterations; ++Iter) {
+				parallel::For(Jobs, Count, parallel::DefaultGrain, Transform);
+			}
+		});
+		bench::Run("parallel::Reduce" + Workers, Config, [&](bench::state& State) {
+			for (u64 Iter = 0; Iter < State.Iterations; ++Iter) {
+				bench::DoNotOptimize(parallel::Reduce(Jobs, span<float>{Values.data(), Count}, 0.f, Add));
+			}
+		});
+		bench::Run("parallel::Scan" + Workers, Config, [&](bench::state& State) {
+			for (u64 Iter = 0; Iter < State.Iterations; ++Iter) {
+				parallel::Scan(
+					Jobs, span<float>{Values.data(), Count}, mutable_span<float>{Values.data(), Count}, 0.f, Add);
+			}
+		});
+		bench::Run("parallel::Sort" + Workers, Config, [&](bench::state& State) {
+			for (u64 Iter = 0; Iter < State.Iterations; ++Iter) {
+				State.PauseTiming();
+				ResetKeys();
+				State.ResumeTiming();
+				parallel::Sort(Jobs, mutable_span<u32>{Keys.data(), Count});
+			}
+		});
+	}
+	bench::DoNotOptimize(Values[Count / 2]);
+}
+
+// fixed work split into more and more chunks shows where per-chunk overhead starts to dominate
+static void GrainPerformanceTests(index Count) {
+	job_system Jobs;
+	std::vector<float> Values(Count, 1.f);
+	const auto Add = [](float Left, float Right) { return Left + Right; };
+	const std::string Elements = "parallel::Reduce " + std::to_string(Count) + " elements";
+	const bench::config Config{.Samples = 5, .ItemsPerIteration = Count};
+	for (index Grain : {64u, 256u, 1024u, 4096u, 16384u, 65536u}) {
+		bench::Run(Elements + " grain " + std::to_string(Grain), Config, [&](bench::state& State) {
+			for (u64 Iter = 0; Iter < State.Iterations; ++Iter) {
+				bench::DoNotOptimize(parallel::Reduce(Jobs, span<float>{Values.data(), Count}, 0.f, Add, Grain));
+			}
+		});
+	}
+}
+
+void parallel_test::Benchmark(const std::span<char*>& Args) {
+	TEST_PRINT_LINE();
+	ScalingPerformanceTests(1 << 20);
+	ScalingPerformanceTests(1 << 24);
+	GrainPerformanceTests(1 << 24);
+}
+
+TEST_ENTRY(parallel_test);
@@ -0,0 +1,241 @@
+﻿#include "../testing_shared.h"
+#include "Profiler/perf_counters.h"
+#include "Profiler/profiler.h"
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct profiler_test {
+	s32 Test(const std::span<char*>& Args);
+	void Benchmark(const std::span<char*>& Args);
+};
+
+struct collected_zone {
+	u32 ThreadId;
+	profiler::zone_event Zone;
+};
+
+static std::vector<collected_zone> GetZones() {
+	std::vector<collected_zone> Zones;
+	profiler::GetZones(
+		[](void* Context, u32 ThreadId, const profiler::zone_event& Zone) {
+			((std::vector<collected_zone>*) Context)->push_back({ThreadId, Zone});
+		},
+		&Zones);
+	return Zones;
+}
+
+static const collected_zone* FindZone(const std::vector<collected_zone>& Zones, const char* Name) {
+	for (const collected_zone& Zone : Zones) {
+		if (std::string_view(Zone.Zone.Name) == Name) {
+			return &Zone;
+		}
+	}
+	return nullptr;
+}
+
+static void Inner() {
+	PROFILE_SCOPE("Inner");
+	std::this_thread::sleep_for(std::chrono::microseconds(100));
+}
+
+// nested zones get depth and lie inside their parent, nothing is recorded outside of capture
+static bool NestingCheck() {
+	std::cout << "------------------------------------------" << std::endl;
+	{
+		PROFILE_SCOPE("BeforeCapture");
+	}
+	profiler::StartCapture();
+	{
+		PROFILE_SCOPE("Outer");
+		Inner();
+		Inner();
+	}
+	profiler::StopCapture();
+	{
+		PROFILE_SCOPE("AfterCapture");
+	}
+	const std::vector<collected_zone> Zones = GetZones();
+	TEST_CHECK(Zones.size() == 3, "only zones of the capture");
+	const collected_zone* Outer = FindZone(Zones, "Outer");
+	bool Nested = Outer && Outer->Zone.Depth == 0;
+	for (const collected_zone& Zone : Zones) {
+		if (Outer && &Zone != Outer) {
+			Nested = Nested && Zone.Zone.Depth == 1 && Zone.ThreadId == Outer->ThreadId &&
+					 Zone.Zone.BeginNs >= Outer->Zone.BeginNs && Zone.Zone.EndNs <= Outer->Zone.EndNs &&
+					 Zone.Zone.EndNs - Zone.Zone.BeginNs >= 100000;
+		}
+	}
+	TEST_CHECK(Nested, "inner zones nested in outer");
+	return true;
+}
+
+// zones of every thread are collected by frame marks and full rings, count matches unless something was dropped
+static bool ThreadsCheck(u32 NumThreads, index ZonesPerThread) {
+	std::cout << "------------------------------------------" << std::endl;
+	profiler::StartCapture({.RingSize = 1024});
+	std::atomic<u32> Finished{0};
+	std::vector<std::thread> Threads;
+	for (u32 Thread = 0; Thread < NumThreads; ++Thread) {
+		Threads.emplace_back([&, Thread]() {
+			const std::string Name = "Test thread " + std::to_string(Thread);
+			profiler::SetThreadName(str_view{Name.data(), (index) Name.size()});
+			for (index Zone = 0; Zone < ZonesPerThread / 2; ++Zone) {
+				PROFILE_SCOPE("Parent");
+				PROFILE_SCOPE("Child");
+			}
+			Finished.fetch_add(1);
+		});
+	}
+	while (Finished.load() < NumThreads) {
+		profiler::MarkFrame();
+		std::this_thread::sleep_for(std::chrono::microseconds(500));
+	}
+	for (std::thread& Thread : Threads) {
+		Thread.join();
+	}
+	profiler::StopCapture();
+	const std::vector<collected_zone> Zones = GetZones();
+	const u64 Dropped = profiler::GetDroppedCount();
+	std::cout << "\t" << Zones.size() << " zones collected, " << Dropped << " dropped" << std::endl;
+	TEST_CHECK(Zones.size() + Dropped == (u64) NumThreads * (ZonesPerThread / 2) * 2, "every zone accounted for");
+	bool Ordered = true;
+	for (size_t ZoneIndex = 1; ZoneIndex < Zones.size(); ++ZoneIndex) {
+		const collected_zone& Previous = Zones[ZoneIndex - 1];
+		const collected_zone& Current = Zones[ZoneIndex];
+		Ordered = Ordered && (Previous.ThreadId != Current.ThreadId || Previous.Zone.EndNs <= Current.Zone.EndNs);
+	}
+	TEST_CHECK(Ordered, "zones of a thread ordered by end");
+	return true;
+}
+
+static std::string ReadFile(const std::string& Path) {
+	std::ifstream File(Path, std::ios::binary);
+	std::ostringstream Contents;
+	Contents << File.rdbuf();
+	return Contents.str();
+}
+
+static bool ChromeTraceCheck() {
+	std::cout << "------------------------------------------" << std::endl;
+	const std::string Path = (std::filesystem::temp_directory_path() / "scratch_profiler_test.json").string();
+	profiler::SetThreadName("Main \"test\" thread");
+	profiler::StartCapture();
+	for (u32 Frame = 0; Frame < 3; ++Frame) {
+		profiler::MarkFrame();
+		PROFILE_SCOPE("Frame work");
+		Inner();
+	}
+	profiler::MarkFrame();
+	profiler::StopCapture();
+	TEST_CHECK(profiler::WriteChromeTrace(str_view{Path.data(), (index) Path.size()}), "trace written");
+	const std::string Trace = ReadFile(Path);
+	std::filesystem::remove(Path);
+	TEST_CHECK(Trace.starts_with("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[") && Trace.ends_with("]}\n"), "format");
+	index Frames = 0;
+	index Work = 0;
+	for (size_t Position = Trace.find("\"name\":\"Frame\""); Position != std::string::npos;
+		 Position = Trace.find("\"name\":\"Frame\"", Position + 1)) {
+		++Frames;
+	}
+	for (size_t Position = Trace.find("\"name\":\"Frame work\""); Position != std::string::npos;
+		 Position = Trace.find("\"name\":\"Frame work\"", Position + 1)) {
+		++Work;
+	}
+	TEST_CHECK(Frames == 3 && Work == 3, "frames and zones exported");
+	TEST_CHECK(Trace.find("\"args\":{\"name\":\"Main \\\"test\\\" thread\"}") != std::string::npos, "thread name");
+	TEST_CHECK(Trace.find("\"ph\":\"X\",\"pid\":1,\"tid\":") != std::string::npos, "complete events");
+	return true;
+}
+
+// counts grow with the work done between Start() and Stop(), everything stays zero without counters
+static bool PerfCountersCheck(index Count) {
+	std::cout << "------------------------------------------" << std::endl;
+	volatile u64 Sink = 0;
+	perf_counters Short;
+	perf_counters Long;
+	{
+		const perf_counters::scope Scope{Short};
+		for (index Iteration = 0; Iteration < Count; ++Iteration) {
+			Sink = Sink + Iteration;
+		}
+	}
+	{
+		const perf_counters::scope Scope{Long};
+		for (index Iteration = 0; Iteration < Count * 10; ++Iteration) {
+			Sink = Sink + Iteration;
+		}
+	}
+	if (!perf_counters::IsAvailable()) {
+		std::cout << "\tno hardware counters" << std::endl;
+		bool Zero = true;
+		for (index Event = 0; Event < PerfEventCount; ++Event) {
+			Zero = Zero && Short.Values[Event] == 0 && Long.Values[Event] == 0;
+		}
+		TEST_CHECK(Zero && Long.GetIpc() == 0.0, "unavailable counters read zero");
+		return true;
+	}
+	for (index Event = 0; Event < PerfEventCount; ++Event) {
+		std::cout << "\t" << perf_counters::GetName((perf_event) Event) << " " << Long.Values[Event] << std::endl;
+	}
+	if (perf_counters::IsAvailable(perf_event::instructions)) {
+		const u64 Instructions = Long.Get(perf_event::instructions);
+		TEST_CHECK(Instructions >= (u64) Count * 10, "instructions of the loop counted");
+		TEST_CHECK(Instructions > Short.Get(perf_event::instructions) * 5, "counts follow amount of work");
+	}
+	Long.Offset(Short);
+	Long.Clear();
+	TEST_CHECK(Long.Get(perf_event::cycles) == 0, "clear");
+	return true;
+}
+
+s32 profiler_test::Test(const std::span<char*>& Args) {
+	TEST_PRINT_LINE();
+	bool Passed = true;
+	Passed = Passed && NestingCheck();
+	Passed = Passed && ThreadsCheck(4, 200000);
+	Passed = Passed && ChromeTraceCheck();
+	Passed = Passed && PerfCountersCheck(1000000);
+	return Passed ? 0 : 1;
+}
+
+// Cost of a zone with and without running capture, against the same loop without the zone
+static void ZoneCostTest() {
+	volatile u64 Sink = 0;
+	bench::Run("empty loop", {}, [&](bench::state& State) {
+		for (u64 Iteration = 0; Iteration < State.Iterations; ++Iteration) {
+			Sink = Sink + Iteration;
+		}
+	});
+	bench::Run("zone without capture", {}, [&](bench::state& State) {
+		for (u64 Iteration = 0; Iteration < State.Iterations; ++Iteration) {
+			PROFILE_SCOPE("Idle");
+			Sink = Sink + Iteration;
+		}
+	});
+	profiler::StartCapture({.RingSize = 1024 * 1024});
+	bench::Run("zone with capture", {}, [&](bench::state& State) {
+		for (u64 Iteration = 0; Iteration < State.Iterations; ++Iteration) {
+			PROFILE_SCOPE("Captured");
+			Sink = Sink + Iteration;
+			// what a frame does, collection is part of the cost
+			if (Iteration % 1000 == 0) {
+				profiler::MarkFrame();
+			}
+		}
+		State.SetCounter("dropped", (double) profiler::GetDroppedCount());
+	});
+	profiler::StopCapture();
+}
+
+void profiler_test::Benchmark(const std::span<char*>& Args) {
+	TEST_PRINT_LINE();
+	ZoneCostTest();
+}
+
+TEST_ENTRY(profiler_test);
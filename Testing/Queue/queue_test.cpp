@@ -0,0 +1,287 @@
+﻿#include "../testing_shared.h"
+#include "Concurrency/spsc_queue.h"
+#include "Concurrency/mpmc_queue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+struct queue_test {
+	s32 Test(const std::span<char*>& Args);
+	void Benchmark(const std::span<char*>& Args);
+};
+
+template <typename queue_type>
+static bool SingleThreadCheck(index Capacity) {
+	queue_type Queue{Capacity};
+	index Pushed = 0;
+	while (Queue.TryPush(MakeValue<typename queue_type::value_type>(Pushed % 256))) {
+		++Pushed;
+	}
+	TEST_CHECK(Pushed == Queue.GetCapacity(), "push until full");
+
+	bool Valid = true;
+	typename queue_type::value_type Value{};
+	for (index Index = 0; Index < Pushed; ++Index) {
+		Valid = Valid && Queue.TryPop(Value) && Value == MakeValue<typename queue_type::value_type>(Index % 256);
+	}
+	TEST_CHECK(Valid && !Queue.TryPop(Value), "pop in order until empty");
+
+	std::vector<typename queue_type::value_type> Source;
+	for (index Index = 0; Index < 2 * Capacity; ++Index) {
+		Source.push_back(MakeValue<typename queue_type::value_type>(Index % 256));
+	}
+	const index BatchPushed = Queue.TryPushBatch(span{Source.data(), (index) Source.size()});
+	TEST_CHECK(BatchPushed == Queue.GetCapacity(), "batch push is limited by capacity");
+
+	const index QueueCapacity = Queue.GetCapacity();
+	std::vector<typename queue_type::value_type> Destination(QueueCapacity);
+	index BatchPopped = Queue.TryPopBatch(mutable_span{Destination.data(), QueueCapacity / 2});
+	BatchPopped += Queue.TryPopBatch(mutable_span{Destination.data() + BatchPopped, QueueCapacity - BatchPopped});
+	TEST_CHECK(BatchPopped == BatchPushed, "batch pop");
+	for (index Index = 0; Index < BatchPopped; ++Index) {
+		Valid = Valid && Destination[Index] == Source[Index];
+	}
+	TEST_CHECK(Valid, "batch pop in order");
+	return true;
+}
+
+static bool SpscThreadsCheck(u64 Count, bool Batched) {
+	spsc_queue<u64> Queue{1024};
+	std::atomic<bool> Valid{true};
+	std::thread Consumer{[&]() {
+		u64 Expected = 0;
+		u64 Buffer[64];
+		while (Expected < Count) {
+			if (Batched) {
+				const index Popped = Queue.TryPopBatch(mutable_span{Buffer, 64});
+				if (Popped == 0) {
+					std::this_thread::yield();
+				}
+				for (index Index = 0; Index < Popped; ++Index) {
+					Valid = Valid && Buffer[Index] == Expected++;
+				}
+			} else {
+				u64 Value;
+				if (Queue.TryPop(Value)) {
+					Valid = Valid && Value == Expected++;
+				} else {
+					std::this_thread::yield();
+				}
+			}
+		}
+	}};
+	u64 Buffer[64];
+	for (u64 Next = 0; Next < Count;) {
+		if (Batched) {
+			const index BatchSize = (index) std::min<u64>(64, Count - Next);
+			for (index Index = 0; Index < BatchSize; ++Index) {
+				Buffer[Index] = Next + Index;
+			}
+			const index Pushed = Queue.TryPushBatch(span{Buffer, BatchSize});
+			if (Pushed == 0) {
+				std::this_thread::yield();
+			}
+			Next += Pushed;
+		} else if (Queue.TryPush(Next)) {
+			++Next;
+		} else {
+			std::this_thread::yield();
+		}
+	}
+	Consumer.join();
+	TEST_CHECK(Valid, Batched ? "spsc threaded batch FIFO" : "spsc threaded FIFO");
+	return true;
+}
+
+static bool MpmcThreadsCheck(u32 NumProducers, u32 NumConsumers, u64 CountPerProducer, bool Batched) {
+	mpmc_queue<u64> Queue{1024};
+	std::vector<std::atomic<u8>> Seen(NumProducers * CountPerProducer);
+	std::atomic<u64> TotalPopped{0};
+	std::atomic<bool> Valid{true};
+	const u64 Total = NumProducers * CountPerProducer;
+
+	std::vector<std::thread> Threads;
+	for (u32 Producer = 0; Producer < NumProducers; ++Producer) {
+		Threads.emplace_back([&, Producer]() {
+			u64 Buffer[32];
+			const u64 Begin = Producer * CountPerProducer;
+			for (u64 Next = Begin; Next < Begin + CountPerProducer;) {
+				if (Batched) {
+					const index BatchSize = (index) std::min<u64>(32, Begin + CountPerProducer - Next);
+					for (index Index = 0; Index < BatchSize; ++Index) {
+						Buffer[Index] = Next + Index;
+					}
+					const index Pushed = Queue.TryPushBatch(span{Buffer, BatchSize});
+					if (Pushed == 0) {
+						std::this_thread::yield();
+					}
+					Next += Pushed;
+				} else if (Queue.TryPush(Next)) {
+					++Next;
+				} else {
+					std::this_thread::yield();
+				}
+			}
+		});
+	}
+	for (u32 Consumer = 0; Consumer < NumConsumers; ++Consumer) {
+		Threads.emplace_back([&]() {
+			u64 Buffer[32];
+			while (TotalPopped.load(std::memory_order_relaxed) < Total) {
+				const index Popped = Batched ? Queue.TryPopBatch(mutable_span{Buffer, 32})
+											 : (index) Queue.TryPop(Buffer[0]);
+				if (Popped == 0) {
+					std::this_thread::yield();
+				}
+				for (index Index = 0; Index < Popped; ++Index) {
+					if (Buffer[Index] >= Total || Seen[Buffer[Index]].fetch_add(1) != 0) {
+						Valid = false;
+					}
+				}
+				TotalPopped.fetch_add(Popped, std::memory_order_relaxed);
+			}
+		});
+	}
+	for (std::thread& Thread : Threads) {
+		Thread.join();
+	}
+	TEST_CHECK(Valid && TotalPopped == Total, Batched ? "mpmc threaded batch" : "mpmc threaded");
+	return true;
+}
+
+template <typename queue_type>
+static bool DestructionCheck() {
+	complex_type::NumInstances = 0;
+	{
+		queue_type Queue{16};
+		for (u8 Index = 0; Index < 10; ++Index) {
+			Queue.TryPush(complex_type{Index});
+		}
+		complex_type Value;
+		Queue.TryPop(Value);
+	}
+	TEST_CHECK(complex_type::NumInstances == 0, "object construction/destruction");
+	return true;
+}
+
+s32 queue_test::Test(const std::span<char*>& Args) {
+	TEST_PRINT_LINE();
+	bool Passed = true;
+	Passed = Passed && SingleThreadCheck<spsc_queue<s32>>(100);
+	Passed = Passed && SingleThreadCheck<spsc_queue<complex_type>>(64);
+	Passed = Passed && SingleThreadCheck<mpmc_queue<s32>>(100);
+	Passed = Passed && SingleThreadCheck<mpmc_queue<complex_type>>(64);
+	Passed = Passed && DestructionCheck<spsc_queue<complex_type>>();
+	Passed = Passed && DestructionCheck<mpmc_queue<complex_type>>();
+	Passed = Passed && SpscThreadsCheck(1000000, false);
+	Passed = Passed && SpscThreadsCheck(1000000, true);
+	Passed = Passed && MpmcThreadsCheck(4, 4, 200000, false);
+	Passed = Passed && MpmcThreadsCheck(4, 4, 200000, true);
+	Passed = Passed && MpmcThreadsCheck(1, 6, 200000, true);
+	Passed = Passed && MpmcThreadsCheck(6, 1, 200000, false);
+	return Passed ? 0 : 1;
+}
+
+static u64 NowNanoseconds() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			   std::chrono::steady_clock::now().time_since_epoch())
+		.count();
+}
+
+// Every element is a timestamp of the moment it was pushed, so consumers measure push-to-pop latency
+template <typename queue_type>
+static void RunScaling(const char* Name, u32 NumProducers, u32 NumConsumers, u64 CountPerProducer, index BatchSize) {
+	const u64 Total = NumProducers * CountPerProducer;
+	const std::string BenchName = std::string{Name} + " producers " + std::to_string(NumProducers) + " consumers " +
+								  std::to_string(NumConsumers) + " batch " + std::to_string(BatchSize);
+	const bench::config Config{.Samples = 5, .WarmupSamples = 0, .Iterations = 1, .ItemsPerIteration = Total};
+	bench::Run(BenchName, Config, [&](bench::state& State) {
+		State.PauseTiming();
+		queue_type Queue{4096};
+		std::atomic<u64> TotalPopped{0};
+		std::atomic<bool> Start{false};
+		std::vector<std::vector<u64>> Latencies(NumConsumers);
+
+		std::vector<std::thread> Threads;
+		for (u32 Producer = 0; Producer < NumProducers; ++Producer) {
+			Threads.emplace_back([&]() {
+				std::vector<u64> Buffer(BatchSize);
+				while (!Start.load(std::memory_order_acquire)) {
+					std::this_thread::yield();
+				}
+				for (u64 Pushed = 0; Pushed < CountPerProducer;) {
+					const index Count = (index) std::min<u64>(BatchSize, CountPerProducer - Pushed);
+					const u64 Now = NowNanoseconds();
+					for (index Index = 0; Index < Count; ++Index) {
+						Buffer[Index] = Now;
+					}
+					const index NewPushed =
+						BatchSize > 1 ? Queue.TryPushBatch(span{Buffer.data(), Count}) : (index) Queue.TryPush(Now);
+					if (NewPushed == 0) {
+						std::this_thread::yield();
+					}
+					Pushed += NewPushed;
+				}
+			});
+		}
+		for (u32 Consumer = 0; Consumer < NumConsumers; ++Consumer) {
+			Threads.emplace_back([&, Consumer]() {
+				std::vector<u64> Buffer(BatchSize);
+				std::vector<u64>& ConsumerLatencies = Latencies[Consumer];
+				ConsumerLatencies.reserve(Total / NumConsumers + 1);
+				while (!Start.load(std::memory_order_acquire)) {
+					std::this_thread::yield();
+				}
+				while (TotalPopped.load(std::memory_order_relaxed) < Total) {
+					const index Popped = BatchSize > 1 ? Queue.TryPopBatch(mutable_span{Buffer.data(), BatchSize})
+													   : (index) Queue.TryPop(Buffer[0]);
+					if (Popped == 0) {
+						std::this_thread::yield();
+						continue;
+					}
+					const u64 Now = NowNanoseconds();
+					// sampling every element would make the benchmark measure the vector
+					ConsumerLatencies.push_back(Now - Buffer[0]);
+					TotalPopped.fetch_add(Popped, std::memory_order_relaxed);
+				}
+			});
+		}
+
+		State.ResumeTiming();
+		Start.store(true, std::memory_order_release);
+		for (std::thread& Thread : Threads) {
+			Thread.join();
+		}
+		State.PauseTiming();
+
+		std::vector<u64> AllLatencies;
+		for (const auto& ConsumerLatencies : Latencies) {
+			AllLatencies.insert(AllLatencies.end(), ConsumerLatencies.begin(), ConsumerLatencies.end());
+		}
+		std::sort(AllLatencies.begin(), AllLatencies.end());
+		State.SetCounter("latency p50 ns", AllLatencies.empty() ? 0.0 : (double) AllLatencies[AllLatencies.size() / 2]);
+		State.SetCounter(
+			"latency p99 ns", AllLatencies.empty() ? 0.0 : (double) AllLatencies[AllLatencies.size() * 99 / 100]);
+		State.ResumeTiming();
+	});
+}
+
+void queue_test::Benchmark(const std::span<char*>& Args) {
+	TEST_PRINT_LINE();
+	constexpr u64 Count = 2000000;
+	for (index BatchSize : {1, 16}) {
+		RunScaling<spsc_queue<u64>>("spsc_queue", 1, 1, Count, BatchSize);
+	}
+	const u32 MaxThreads = math::Max(2u, std::thread::hardware_concurrency());
+	for (index BatchSize : {1, 16}) {
+		for (u32 Producers = 1; Producers <= MaxThreads / 2; Producers *= 2) {
+			for (u32 Consumers = 1; Consumers <= MaxThreads / 2; Consumers *= 2) {
+				RunScaling<mpmc_queue<u64>>("mpmc_queue", Producers, Consumers, Count / Producers, BatchSize);
+			}
+		}
+	}
+}
+
+TEST_ENTRY(queue_test);
@@ -0,0 +1,206 @@
+﻿#include "../testing_shared.h"
+#include "Containers/sparse_set.h"
+#include "Containers/hash_table.h"
+
+#include <unordered_map>
+#include <vector>
+
+struct sparse_set_test {
+	s32 Test(const std::span<char*>& Args);
+	void Benchmark(const std::span<char*>& Args);
+};
+
+template <typename test_type>
+static bool Compare(const std::unordered_map<index, test_type>& Ideal, const sparse_set<test_type>& Set) {
+	if (Ideal.size() != Set.GetSize()) {
+		return false;
+	}
+	for (const auto& [Key, Value] : Ideal) {
+		const test_type* Found = Set.Find(Key);
+		if (!Found || !(*Found == Value)) {
+			return false;
+		}
+	}
+	// dense keys and elements have to stay in sync after swap removal
+	index DenseIndex = 0;
+	for (const test_type& Value : Set) {
+		if (!(Ideal.at(Set.GetKeys()[DenseIndex++]) == Value)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+template <typename test_type>
+static bool SanityCheck(index Count) {
+	std::cout << "------------------------------------------" << std::endl;
+	const std::string InfoString = std::string("Testing with ") + typeid(test_type).name() + ", " +
+								   std::to_string(sizeof(test_type)) + " bytes";
+	std::cout << InfoString << std::endl;
+
+	if constexpr (requires { test_type::NumInstances; }) {
+		test_type::NumInstances = 0;
+	}
+	{
+		sparse_set<test_type> Set;
+		std::unordered_map<index, test_type> Ideal;
+		srand(0);
+		for (index Iteration = 0; Iteration < Count; ++Iteration) {
+			const index Key = rand() % Count;
+			Set.Add(Key, MakeValue<test_type>(Iteration % 256));
+			Ideal.insert_or_assign(Key, MakeValue<test_type>(Iteration % 256));
+		}
+		TEST_CHECK(Compare(Ideal, Set), "add");
+
+		for (index Iteration = 0; Iteration < Count; ++Iteration) {
+			const index Key = rand() % Count;
+			if (rand() % 2) {
+				Set.Remove(Key);
+				Ideal.erase(Key);
+			} else {
+				Set.Emplace(Key, MakeValue<test_type>(Key % 256));
+				Ideal.insert_or_assign(Key, MakeValue<test_type>(Key % 256));
+			}
+		}
+		TEST_CHECK(Compare(Ideal, Set), "churn");
+
+		bool Valid = true;
+		for (index Key = 0; Key < Count; ++Key) {
+			Valid = Valid && Set.Contains(Key) == Ideal.contains(Key);
+		}
+		Valid = Valid && !Set.Contains(Count * 2) && !Set.Find(Count * 2) && !Set.Remove(Count * 2);
+		TEST_CHECK(Valid, "contains");
+
+		while (!Set.IsEmpty()) {
+			Set.Remove(Set.GetKeys()[0]);
+		}
+		TEST_CHECK(Set.GetSize() == 0 && !Set.Contains(0), "remove all");
+	}
+	if constexpr (requires { test_type::NumInstances; }) {
+		TEST_CHECK(test_type::NumInstances == 0, "object construction/destruction");
+	}
+	return true;
+}
+
+static bool JoinCheck() {
+	std::cout << "------------------------------------------" << std::endl;
+	sparse_set<s32> Positions;
+	sparse_set<s32> Velocities;
+	sparse_set<s32> Tags;
+	for (index Key = 0; Key < 1000; ++Key) {
+		Positions.Add(Key, (s32) Key);
+		if (Key % 3 == 0) {
+			Velocities.Add(Key, 1);
+		}
+		if (Key % 10 == 0) {
+			Tags.Add(Key, 0);
+		}
+	}
+	index Visited = 0;
+	bool Valid = true;
+	ForEachJoined(
+		[&](index Key, s32& Position, s32& Velocity, s32& Tag) {
+			Valid = Valid && Key % 30 == 0 && Position == (s32) Key;
+			Position += Velocity;
+			++Visited;
+		},
+		Positions,
+		Velocities,
+		Tags);
+	TEST_CHECK(Valid && Visited == 34, "join visits intersection");
+	TEST_CHECK(Positions[30] == 31 && Positions[31] == 31, "join modifies elements");
+	return true;
+}
+
+s32 sparse_set_test::Test(const std::span<char*>& Args) {
+	TEST_PRINT_LINE();
+	bool Passed = true;
+	Passed = Passed && SanityCheck<s32>(10000);
+	Passed = Passed && SanityCheck<complex_type>(10000);
+	Passed = Passed && SanityCheck<complex_type_realloc>(10000);
+	Passed = Passed && JoinCheck();
+	return Passed ? 0 : 1;
+}
+
+struct transform_component {
+	float Position[3];
+	float Velocity[3];
+};
+
+static void PerformanceTests(index NumEntities, index Iters) {
+	const std::string Entities = " " + std::to_string(NumEntities) + " entities";
+
+	sparse_set<transform_component> Transforms;
+	sparse_set<u32> Tags;
+	hash_table<index, transform_component> TransformsTable;
+	srand(0);
+	for (index Entity = 0; Entity < NumEntities; ++Entity) {
+		const transform_component Transform{{(float) Entity, 0.f, 0.f}, {1.f, 1.f, 1.f}};
+		Transforms.Add(Entity, Transform);
+		TransformsTable[Entity] = Transform;
+		if (rand() % 16 == 0) {
+			Tags.Add(Entity, Entity);
+		}
+	}
+
+	// every pass starts with cold caches, so one pass per sample
+	const bench::config Config{
+		.Samples = (u32) Iters,
+		.WarmupSamples = 0,
+		.Iterations = 1,
+		.ItemsPerIteration = NumEntities,
+		.ColdCache = true};
+	float Checksum = 0;
+
+	bench::Run("sparse_set iterate" + Entities, Config, [&](bench::state&) {
+		for (transform_component& Transform : Transforms) {
+			for (index Axis = 0; Axis < 3; ++Axis) {
+				Transform.Position[Axis] += Transform.Velocity[Axis];
+			}
+		}
+	});
+	bench::Run("hash_table iterate" + Entities, Config, [&](bench::state&) {
+		for (auto& [Entity, Transform] : TransformsTable) {
+			for (index Axis = 0; Axis < 3; ++Axis) {
+				Transform.Position[Axis] += Transform.Velocity[Axis];
+			}
+		}
+	});
+	bench::Run("sparse_set join with 1/16 tagged" + Entities, Config, [&](bench::state&) {
+		ForEachJoined(
+			[&](index Entity, transform_component& Transform, u32& Tag) { Checksum += Transform.Position[0]; },
+			Transforms,
+			Tags);
+	});
+
+	// remove and re-add 10% of entities, both containers see the same entities
+	bench::config ChurnConfig = Config;
+	ChurnConfig.ItemsPerIteration = NumEntities / 10;
+	u32 SetSeed = 0;
+	bench::Run("sparse_set remove + add" + Entities, ChurnConfig, [&](bench::state&) {
+		srand(SetSeed++);
+		for (index Churn = 0; Churn < NumEntities / 10; ++Churn) {
+			const index Entity = rand() % NumEntities;
+			Transforms.Remove(Entity);
+			Transforms.Add(Entity, transform_component{});
+		}
+	});
+	u32 TableSeed = 0;
+	bench::Run("hash_table remove + add" + Entities, ChurnConfig, [&](bench::state&) {
+		srand(TableSeed++);
+		for (index Churn = 0; Churn < NumEntities / 10; ++Churn) {
+			const index Entity = rand() % NumEntities;
+			TransformsTable.Remove(Entity);
+			TransformsTable[Entity] = transform_component{};
+		}
+	});
+	bench::DoNotOptimize(Checksum);
+}
+
+void sparse_set_test::Benchmark(const std::span<char*>& Args) {
+	TEST_PRINT_LINE();
+	PerformanceTests(10000, 100);
+	PerformanceTests(1000000, 10);
+}
+
+TEST_ENTRY(sparse_set_test);
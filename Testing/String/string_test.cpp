@@ -1,8 +1,14 @@
 ﻿#include "../testing_shared.h"
 #include "String/str_conversions.h"
+#include "String/str_format.h"
 #include "Logs/logs.h"
 #include "Time/timestamp.h"
 
+#include <version>
+#if defined(__cpp_lib_format)
+#include <format>
+#endif
+
 struct set_test {
 	s32 Test(const std::span<char*>& Args);
 	void Benchmark(const std::span<char*>& Args);
@@ -161,16 +167,108 @@ static bool SanityCheck(s64 Count) {
 	return true;
 }
 
+static_assert(strings::GetFormatLengthCompiled("a{}b{}", 123, "xy") == 7);
+static_assert(strings::GetFormatLengthCompiled("no placeholders") == 15);
+
+// compiled format strings have to produce exactly what Format() does
+static bool FormatCompiledCheck() {
+	std::cout << "------------------------------------------" << std::endl;
+	bool Valid = true;
+	const auto Compare = [&](const str& Expected, const str& Result) {
+		Valid = Valid && Expected == Result;
+		if (Expected != Result) {
+			std::cout << "\t" << Expected.GetData() << " != " << Result.GetData() << std::endl;
+		}
+	};
+	Compare(strings::Format("plain text"), strings::FormatCompiled("plain text"));
+	Compare(strings::Format("{}", ""), strings::FormatCompiled("{}", ""));
+	Compare(strings::Format("{}{}", "a", "b"), strings::FormatCompiled("{}{}", "a", "b"));
+	srand(0);
+	for (s32 Index = 0; Index < 1000; ++Index) {
+		const s32 Integer = rand() - RAND_MAX / 2;
+		const u64 Unsigned = (u64) rand() * (u64) rand();
+		const float Float = (float) rand() / (float) (rand() + 1) * (rand() % 2 ? 1.f : -1.f);
+		// default_float_format only handles significands that fit into s32
+		const double Double = (double) (rand() % 100000) / 8.0;
+		const str String = strings::ToString(Integer);
+		Compare(
+			strings::Format("int {}, u64 {}, float {}, double {}!", Integer, Unsigned, Float, Double),
+			strings::FormatCompiled("int {}, u64 {}, float {}, double {}!", Integer, Unsigned, Float, Double));
+		Compare(
+			strings::Format("{:ignored} {} {} [{}]", String, Index % 2 == 0, (s8) Index, (u16) Index),
+			strings::FormatCompiled("{:ignored} {} {} [{}]", String, Index % 2 == 0, (s8) Index, (u16) Index));
+		Compare(
+			strings::Format("{} {} {}", &Valid, (void*) &Index, str_view{"view"}),
+			strings::FormatCompiled("{} {} {}", &Valid, (void*) &Index, str_view{"view"}));
+	}
+	TEST_CHECK(Valid, "same output as Format");
+
+	char Buffer[64];
+	const index Length = strings::WriteFormatCompiled(mutable_str_view{Buffer, 64}, "{} + {} = {}", 2, 2.5f, 4.5);
+	TEST_CHECK(str_view(Buffer, Length) == str_view{"2 + 2.5e0 = 4.5e0"}, "write into buffer");
+	TEST_CHECK(Length == strings::GetFormatLengthCompiled("{} + {} = {}", 2, 2.5f, 4.5), "length");
+	// strings::FormatCompiled("{} {}", 1) doesn't compile
+	return true;
+}
+
 s32 set_test::Test(const std::span<char*>& Args) {
 	TEST_PRINT_LINE();
 	bool Passed = true;
 	Passed = Passed && SanityCheck(10000);
+	Passed = Passed && FormatCompiledCheck();
 	return Passed ? 0 : 1;
 }
 
 void set_test::Benchmark(const std::span<char*>& Args) {
 	TEST_PRINT_LINE();
-	std::cout << "no benchmarking for string" << std::endl;
+	std::cout << "------------------------------------------" << std::endl;
+	// allocation of result is included, every formatter gets the same arguments
+	bench::Run("Format", {}, [](bench::state& State) {
+		for (u64 Iteration = 0; Iteration < State.Iterations; ++Iteration) {
+			str Result = strings::Format("Entity {} moved to {}, {} in {} ms", Iteration, 1.5f, -2.25f, 16.6);
+			bench::DoNotOptimize(Result);
+		}
+	});
+	bench::Run("FormatCompiled", {}, [](bench::state& State) {
+		for (u64 Iteration = 0; Iteration < State.Iterations; ++Iteration) {
+			str Result = strings::FormatCompiled("Entity {} moved to {}, {} in {} ms", Iteration, 1.5f, -2.25f, 16.6);
+			bench::DoNotOptimize(Result);
+		}
+	});
+#if defined(__cpp_lib_format)
+	bench::Run("std::format", {}, [](bench::state& State) {
+		for (u64 Iteration = 0; Iteration < State.Iterations; ++Iteration) {
+			std::string Result = std::format("Entity {} moved to {}, {} in {} ms", Iteration, 1.5f, -2.25f, 16.6);
+			bench::DoNotOptimize(Result);
+		}
+	});
+#endif
+
+	// formatting alone, into a buffer, integers and strings only
+	char Buffer[256];
+	const str_view Name{"player_controller"};
+	bench::Run("WriteFormat", {}, [&](bench::state& State) {
+		for (u64 Iteration = 0; Iteration < State.Iterations; ++Iteration) {
+			strings::WriteFormat(mutable_str_view{Buffer, 256}, "[{}] {}: {} of {} done", Iteration, Name, 7, 100);
+			bench::DoNotOptimize(Buffer);
+		}
+	});
+	bench::Run("WriteFormatCompiled", {}, [&](bench::state& State) {
+		for (u64 Iteration = 0; Iteration < State.Iterations; ++Iteration) {
+			strings::WriteFormatCompiled(
+				mutable_str_view{Buffer, 256}, "[{}] {}: {} of {} done", Iteration, Name, 7, 100);
+			bench::DoNotOptimize(Buffer);
+		}
+	});
+#if defined(__cpp_lib_format)
+	const std::string_view StdName{Name.GetData(), Name.GetSize()};
+	bench::Run("std::format_to_n", {}, [&](bench::state& State) {
+		for (u64 Iteration = 0; Iteration < State.Iterations; ++Iteration) {
+			std::format_to_n(Buffer, 256, "[{}] {}: {} of {} done", Iteration, StdName, 7, 100);
+			bench::DoNotOptimize(Buffer);
+		}
+	});
+#endif
 }
 
 TEST_ENTRY(set_test)
\ No newline at end of file
@@ -0,0 +1,219 @@
+﻿#include "../testing_shared.h"
+#include "Application/Platform/platform.h"
+#include "String/str_conversions.h"
+#include "Time/cycle_clock.h"
+#include "Time/timestamp.h"
+#include "Time/wall_clock.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+struct time_test {
+	s32 Test(const std::span<char*>& Args);
+	void Benchmark(const std::span<char*>& Args);
+};
+
+// cached formatter has to match default one on every step, including second, day and year boundaries
+static bool CachedFormatCheck() {
+	std::cout << "------------------------------------------" << std::endl;
+	strings::cached_timestamp_format Cached;
+	timestamp Time{timestamp::DateTimeToTicks(2023, 12, 31) + 23 * timestamp::TicksPerHour};
+	bool Matches = true;
+	for (index Step = 0; Step < 100000; ++Step) {
+		char Expected[23];
+		char Actual[23];
+		strings::default_timestamp_format::Write(mutable_str_view{Expected, 23}, Time);
+		Cached.Write(mutable_str_view{Actual, 23}, Time);
+		Matches = Matches && std::memcmp(Expected, Actual, 23) == 0;
+		// mostly small steps within a second, sometimes big jumps
+		Time.Ticks += Step % 97 == 0 ? (s64) (Step % 5) * timestamp::TicksPerHour : (s64) (Step % 13) * 3217 * 100;
+	}
+	TEST_CHECK(Matches, "cached format matches default format");
+	return true;
+}
+
+static s64 GetDifferenceMicroseconds(timestamp Left, timestamp Right) {
+	const s64 Difference = Left.Ticks - Right.Ticks;
+	return (Difference < 0 ? -Difference : Difference) / timestamp::TicksPerMicrosecond;
+}
+
+// extrapolated time stays close to platform time over several resyncs, also while many threads read it
+static bool WallClockCheck(u32 NumThreads) {
+	std::cout << "------------------------------------------" << std::endl;
+	std::atomic<s64> MaxDifference{0};
+	std::atomic<bool> Stop{false};
+	std::vector<std::thread> Threads;
+	for (u32 Thread = 0; Thread < NumThreads; ++Thread) {
+		Threads.emplace_back([&]() {
+			s64 LocalMax = 0;
+			while (!Stop.load(std::memory_order_relaxed)) {
+				const timestamp Before = timestamp::GetCurrentUTC();
+				const timestamp Clock = wall_clock::GetUTC();
+				const timestamp After = timestamp::GetCurrentUTC();
+				// preemption between the reads is not an error of the clock
+				if (GetDifferenceMicroseconds(After, Before) < 100) {
+					LocalMax = math::Max(LocalMax, GetDifferenceMicroseconds(Clock, Before));
+				}
+				std::this_thread::sleep_for(std::chrono::microseconds(200));
+			}
+			s64 Current = MaxDifference.load();
+			while (LocalMax > Current && !MaxDifference.compare_exchange_weak(Current, LocalMax)) {
+			}
+		});
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(2500));
+	Stop.store(true);
+	for (std::thread& Thread : Threads) {
+		Thread.join();
+	}
+	std::cout << "\tmax difference from platform time " << MaxDifference.load() << " us" << std::endl;
+	TEST_CHECK(MaxDifference.load() < 2000, "wall clock follows platform time");
+	TEST_CHECK(wall_clock::GetTimezone().TickDiff == platform::GetTimezone().TickDiff, "timezone cached");
+	const timezone Cached = wall_clock::GetTimezone();
+	const timestamp UTC = wall_clock::GetUTC();
+	TEST_CHECK(Cached.Apply(UTC).Ticks == UTC.Ticks - Cached.TickDiff, "cached timezone applies to UTC");
+	return true;
+}
+
+static s64 GetSteadyNs() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+		.count();
+}
+
+// monotonic on every thread and follows steady_clock over longer intervals
+static bool CycleClockCheck(u32 NumThreads) {
+	std::cout << "------------------------------------------" << std::endl;
+	const cycle_clock::source Source = cycle_clock::GetSource();
+	std::cout << "\tsource " << (Source == cycle_clock::source::counter ? "counter" : "steady_clock") << ", "
+			  << cycle_clock::GetFrequency() << " cycles per second" << std::endl;
+	std::atomic<bool> Monotonic{true};
+	std::vector<std::thread> Threads;
+	for (u32 Thread = 0; Thread < NumThreads; ++Thread) {
+		Threads.emplace_back([&]() {
+			s64 Previous = cycle_clock::GetNs();
+			for (u32 Read = 0; Read < 1000000; ++Read) {
+				const s64 Current = cycle_clock::GetNs();
+				if (Current < Previous) {
+					Monotonic.store(false);
+				}
+				Previous = Current;
+			}
+		});
+	}
+	for (std::thread& Thread : Threads) {
+		Thread.join();
+	}
+	TEST_CHECK(Monotonic.load(), "clock is monotonic");
+	const s64 SteadyBegin = GetSteadyNs();
+	const s64 ClockBegin = cycle_clock::GetNs();
+	std::this_thread::sleep_for(std::chrono::milliseconds(500));
+	const s64 Steady = GetSteadyNs() - SteadyBegin;
+	const s64 Clock = cycle_clock::GetNs() - ClockBegin;
+	const double ErrorPpm = (double) (Clock - Steady) * 1e6 / (double) Steady;
+	std::cout << "\t" << ErrorPpm << " ppm from steady_clock over " << Steady / 1000000 << " ms" << std::endl;
+	TEST_CHECK(ErrorPpm > -1000.0 && ErrorPpm < 1000.0, "clock follows steady_clock");
+	const s64 Cycles = (s64) cycle_clock::GetFrequency();
+	TEST_CHECK(std::abs(cycle_clock::CyclesToNs(Cycles) - 1000000000) < 1000, "cycles convert to nanoseconds");
+	return true;
+}
+
+s32 time_test::Test(const std::span<char*>& Args) {
+	TEST_PRINT_LINE();
+	bool Passed = true;
+	Passed = Passed && CachedFormatCheck();
+	Passed = Passed && WallClockCheck(1);
+	Passed = Passed && WallClockCheck(math::Max(4u, std::thread::hardware_concurrency()));
+	Passed = Passed && CycleClockCheck(math::Max(4u, std::thread::hardware_concurrency()));
+	return Passed ? 0 : 1;
+}
+
+template <typename functor_type>
+static void MeasureCall(std::string_view Name, const functor_type& Functor) {
+	bench::Run(Name, {}, [&](bench::state& State) {
+		for (u64 Iteration = 0; Iteration < State.Iterations; ++Iteration) {
+			Functor((index) Iteration);
+		}
+	});
+}
+
+// What timestamp of one log line costs: reading time, applying timezone and formatting it
+static void TimestampCostTest() {
+	char Buffer[23];
+	u64 Checksum = 0;
+	strings::cached_timestamp_format Cached;
+	MeasureCall("platform UTC", [&](index) { Checksum += timestamp::GetCurrentUTC().Ticks; });
+	MeasureCall("wall_clock UTC", [&](index) { Checksum += wall_clock::GetUTC().Ticks; });
+	MeasureCall("platform timezone", [&](index) { Checksum += platform::GetTimezone().TickDiff; });
+	MeasureCall("wall_clock timezone", [&](index) { Checksum += wall_clock::GetTimezone().TickDiff; });
+	const timestamp Now = timestamp::GetCurrentUTC();
+	// 1 line per 10 microseconds
+	MeasureCall("default timestamp format", [&](index Iteration) {
+		strings::default_timestamp_format::Write(mutable_str_view{Buffer, 23}, timestamp{Now.Ticks + Iteration * 100});
+		Checksum += Buffer[22];
+	});
+	MeasureCall("cached timestamp format", [&](index Iteration) {
+		Cached.Write(mutable_str_view{Buffer, 23}, timestamp{Now.Ticks + Iteration * 100});
+		Checksum += Buffer[22];
+	});
+	MeasureCall("log line timestamp before", [&](index) {
+		const timestamp Local = platform::GetTimezone().Apply(timestamp::GetCurrentUTC());
+		strings::default_timestamp_format::Write(mutable_str_view{Buffer, 23}, Local);
+		Checksum += Buffer[22];
+	});
+	MeasureCall("log line timestamp after", [&](index) {
+		Cached.Write(mutable_str_view{Buffer, 23}, wall_clock::GetLocal());
+		Checksum += Buffer[22];
+	});
+	std::cout << "(checksum " << Checksum << ")" << std::endl;
+}
+
+// Read cost of every clock, and how far cycle_clock drifts from steady_clock over longer intervals
+static void ClockReadTest() {
+	u64 Checksum = 0;
+	MeasureCall("rdtsc", [&](index) { Checksum += cycle_clock::ReadCycles(); });
+	MeasureCall("rdtscp", [&](index) { Checksum += cycle_clock::ReadCyclesOrdered(); });
+	MeasureCall("cycle_clock::GetNs", [&](index) { Checksum += cycle_clock::GetNs(); });
+	MeasureCall("steady_clock", [&](index) { Checksum += GetSteadyNs(); });
+	MeasureCall("high_resolution_clock", [&](index) {
+		Checksum += std::chrono::high_resolution_clock::now().time_since_epoch().count();
+	});
+	// smallest step either clock can show
+	s64 ClockStep = INT64_MAX;
+	s64 SteadyStep = INT64_MAX;
+	for (index Read = 0; Read < 100000; ++Read) {
+		const s64 ClockBegin = cycle_clock::GetNs();
+		s64 ClockEnd = cycle_clock::GetNs();
+		while (ClockEnd == ClockBegin) {
+			ClockEnd = cycle_clock::GetNs();
+		}
+		ClockStep = math::Min(ClockStep, ClockEnd - ClockBegin);
+		const s64 SteadyBegin = GetSteadyNs();
+		s64 SteadyEnd = GetSteadyNs();
+		while (SteadyEnd == SteadyBegin) {
+			SteadyEnd = GetSteadyNs();
+		}
+		SteadyStep = math::Min(SteadyStep, SteadyEnd - SteadyBegin);
+	}
+	std::cout << "Smallest step:\n\tcycle_clock " << ClockStep << " ns\n\tsteady_clock " << SteadyStep << " ns"
+			  << std::endl;
+	std::cout << "Accuracy against steady_clock:" << std::endl;
+	for (const u32 Milliseconds : {10u, 100u, 1000u, 3000u}) {
+		const s64 SteadyBegin = GetSteadyNs();
+		const s64 ClockBegin = cycle_clock::GetNs();
+		std::this_thread::sleep_for(std::chrono::milliseconds(Milliseconds));
+		const s64 Clock = cycle_clock::GetNs() - ClockBegin;
+		const s64 Steady = GetSteadyNs() - SteadyBegin;
+		std::cout << "\t" << Milliseconds << " ms: " << Clock - Steady << " ns, "
+				  << (double) (Clock - Steady) * 1e6 / (double) Steady << " ppm" << std::endl;
+	}
+	std::cout << "(checksum " << Checksum << ")" << std::endl;
+}
+
+void time_test::Benchmark(const std::span<char*>& Args) {
+	TEST_PRINT_LINE();
+	TimestampCostTest();
+	ClockReadTest();
+}
+
+TEST_ENTRY(time_test);
@@ -9,75 +9,85 @@ struct tree_test {
 };
 
 template <typename test_type>
-static void PerformanceTests(s64 Count, s64 Iters) {
-	std::cout << "------------------------------------------" << std::endl;
-	const std::string InfoString = std::string("Testing with ") + typeid(test_type).name() + ", " +
-								   std::to_string(sizeof(test_type)) + " bytes.";
-	std::cout << InfoString << std::endl;
+static void AddValue(rb_set<test_type>& Set, const test_type& Value) {
+	Set.AddUnique(Value);
+}
 
-	timer stdSetInsert;
-	timer rbSetInsert;
-	timer stdSetRemove;
-	timer rbSetRemove;
+template <typename test_type>
+static void AddValue(std::set<test_type>& Set, const test_type& Value) {
+	Set.insert(Value);
+}
 
-	for (s32 iter = 0; iter < Iters; ++iter) {
-		rb_set<test_type> container;
-		std::set<test_type> ideal;
-		
-		std::vector<test_type> Values;
+template <typename test_type>
+static void RemoveValue(rb_set<test_type>& Set, const test_type& Value) {
+	Set.Remove(Value);
+}
 
-		srand(0);
-		for (size_t i = 0; i < Count; i++) {
-			const int32_t value = rand();
-			Values.push_back(value);
-		}
+template <typename test_type>
+static void RemoveValue(std::set<test_type>& Set, const test_type& Value) {
+	Set.erase(Value);
+}
 
-		ClearCache();
-		srand(0);
-		rbSetInsert.Start();
-		for (size_t i = 0; i < Count; i++) {
-			const int32_t value = rand();
-			container.AddUnique(value);
-		}
-		rbSetInsert.Stop();
+template <typename test_type>
+static void ClearValues(rb_set<test_type>& Set) {
+	Set.Clear();
+}
 
-		ClearCache();
-		srand(0);
-		stdSetInsert.Start();
-		for (size_t i = 0; i < Count; i++) {
-			const int32_t value = rand();
-			ideal.insert(value);
-		}
-		stdSetInsert.Stop();
+template <typename test_type>
+static void ClearValues(std::set<test_type>& Set) {
+	Set.clear();
+}
 
-		uint32_t countToRemove = Count / 2;
-		ClearCache();
-		srand(0);
-		stdSetRemove.Start();
-		for (size_t i = 0; i < countToRemove; i++) {
-			const size_t pos = rand() % Values.size();
-			const auto valueToRemove = Values[pos];
-			ideal.erase(valueToRemove);
+template <typename test_type, typename set_type>
+static void PerformanceTests(const std::string& Name) {
+	bench::Sweep(Name + " insert", {1000, 10000, 100000}, {}, [](bench::state& State, s64 Count) {
+		State.ItemsPerIteration = Count;
+		for (u64 Iteration = 0; Iteration < State.Iterations; ++Iteration) {
+			set_type Set;
+			srand(0);
+			for (s64 i = 0; i < Count; i++) {
+				AddValue(Set, test_type(rand()));
+			}
+			bench::DoNotOptimize(Set);
+			State.PauseTiming();
+			ClearValues(Set);
+			State.ResumeTiming();
 		}
-		stdSetRemove.Stop();
-
-		ClearCache();
+	});
+	bench::Sweep(Name + " remove", {1000, 10000, 100000}, {}, [](bench::state& State, s64 Count) {
+		std::vector<test_type> Values;
 		srand(0);
-		rbSetRemove.Start();
-		for (size_t i = 0; i < countToRemove; i++) {
-			const size_t pos = rand() % Values.size();
-			const auto valueToRemove = Values[pos];
-			container.Remove(valueToRemove);
+		for (s64 i = 0; i < Count; i++) {
+			Values.push_back(test_type(rand()));
 		}
-		rbSetRemove.Stop();
-	}
-
-	std::cout << std::endl;
+		State.ItemsPerIteration = Count / 2;
+		for (u64 Iteration = 0; Iteration < State.Iterations; ++Iteration) {
+			State.PauseTiming();
+			set_type Set;
+			for (const test_type& Value : Values) {
+				AddValue(Set, Value);
+			}
+			srand(0);
+			State.ResumeTiming();
+			for (s64 i = 0; i < Count / 2; i++) {
+				RemoveValue(Set, Values[rand() % Values.size()]);
+			}
+			bench::DoNotOptimize(Set);
+			State.PauseTiming();
+			ClearValues(Set);
+			State.ResumeTiming();
+		}
+	});
+}
 
-	std::cout << "Performance test insert:\n\tstd::set " << stdSetInsert.Result() << " ms"
-			  << "\n\trb_set " << rbSetInsert.Result() << " ms" << std::endl;
-	std::cout << "Performance test remove:\n\tstd::set " << stdSetRemove.Result() << " ms"
-			  << "\n\trb_set " << rbSetRemove.Result() << " ms" << std::endl;
+template <typename test_type>
+static void PerformanceTests() {
+	std::cout << "------------------------------------------" << std::endl;
+	const std::string TypeName = std::string(typeid(test_type).name()) + ", " + std::to_string(sizeof(test_type)) +
+								 " bytes";
+	std::cout << "Testing with " << TypeName << "." << std::endl;
+	PerformanceTests<test_type, std::set<test_type>>("std::set<" + TypeName + ">");
+	PerformanceTests<test_type, rb_set<test_type>>("rb_set<" + TypeName + ">");
 }
 
 template <typename test_type>
@@ -157,9 +167,9 @@ s32 tree_test::Test(const std::span<char*>& Args) {
 
 void tree_test::Benchmark(const std::span<char*>& Args) {
 	TEST_PRINT_LINE();
-	PerformanceTests<s32>(10000, 1000);
-	PerformanceTests<bytes_struct<128>>(10000, 1000);
-	PerformanceTests<complex_type>(10000, 1000);
+	PerformanceTests<s32>();
+	PerformanceTests<bytes_struct<128>>();
+	PerformanceTests<complex_type>();
 }
 
 TEST_ENTRY(tree_test);
@@ -0,0 +1,622 @@
+#pragma once
+
+#include "basic.h"
+#include "Math/math.h"
+#include "Profiler/perf_counters.h"
+#include "Time/cycle_clock.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Micro-benchmark harness of the Testing executables. A body runs State.Iterations iterations per sample, the count
+// is calibrated so a sample takes at least MinSampleNs. Samples are repeated and summarized by median and median
+// absolute deviation, which ignore the odd sample hit by an interrupt or a page fault, and reported per item with
+// hardware counters where they are available. TEST_ENTRY takes the options:
+//
+//	--benchmark [--json=results.json] [--filter=name part] [--samples=N]
+//	--compare base.json new.json		returns 1 when something got significantly slower
+//
+//	bench::Run("dyn_array Add", {.ItemsPerIteration = Count}, [&](bench::state& State) {
+//		for (u64 Iteration = 0; Iteration < State.Iterations; ++Iteration) {
+//			dyn_array<s32> Array;
+//			for (index Item = 0; Item < Count; ++Item) {
+//				Array.Add(Item);
+//			}
+//			bench::DoNotOptimize(Array);
+//			State.PauseTiming();
+//			Array.Clear();
+//			State.ResumeTiming();
+//		}
+//	});
+namespace bench {
+namespace internal {
+inline const volatile char* volatile Sink{nullptr};
+}	 // namespace internal
+
+// Value is treated as read and written by something the compiler can't see, so computations producing it are kept
+template <typename value_type>
+FORCEINLINE void DoNotOptimize(const value_type& Value) {
+#if defined(_MSC_VER)
+	internal::Sink = &reinterpret_cast<const volatile char&>(Value);
+	_ReadWriteBarrier();
+#else
+	asm volatile("" : : "r,m"(Value) : "memory");
+#endif
+}
+
+template <typename value_type>
+FORCEINLINE void DoNotOptimize(value_type& Value) {
+#if defined(_MSC_VER)
+	internal::Sink = &reinterpret_cast<const volatile char&>(Value);
+	_ReadWriteBarrier();
+#else
+	asm volatile("" : "+m"(Value) : : "memory");
+#endif
+}
+
+// pending writes to memory have to happen before this point
+FORCEINLINE void ClobberMemory() {
+#if defined(_MSC_VER)
+	_ReadWriteBarrier();
+#else
+	asm volatile("" : : : "memory");
+#endif
+}
+
+// larger than last level cache of desktop CPUs
+constexpr index FlushBytes = 64 * 1024 * 1024;
+
+// Evicts everything the benchmark touched from every cache level by writing a buffer larger than last level cache
+inline void FlushCache() {
+	static u8* Buffer = new u8[FlushBytes]{};
+	for (index Offset = 0; Offset < FlushBytes; Offset += CacheLineSize) {
+		Buffer[Offset] += 1;
+	}
+	ClobberMemory();
+}
+
+// Evicts only the given range, much cheaper than FlushCache() when the data is known, falls back to it without clflush
+inline void FlushRange(const void* Data, size_t Size) {
+#if CYCLE_CLOCK_HAS_TSC
+	const uintptr_t End = (uintptr_t) Data + Size;
+	for (uintptr_t Line = (uintptr_t) Data & ~(uintptr_t) (CacheLineSize - 1); Line < End; Line += CacheLineSize) {
+		_mm_clflush((const void*) Line);
+	}
+	_mm_mfence();
+#else
+	FlushCache();
+#endif
+}
+
+struct config {
+	// timed samples, median and deviation are taken over them
+	u32 Samples{11};
+	// untimed samples after calibration
+	u32 WarmupSamples{1};
+	// iterations per sample grow until a sample takes this long
+	s64 MinSampleNs{10'000'000};
+	// fixed iterations per sample, skips calibration
+	u64 Iterations{0};
+	// things done by one iteration, results are per item
+	u64 ItemsPerIteration{1};
+	// caches are flushed before every sample, calibration and warm-up included
+	bool ColdCache{false};
+};
+
+struct state {
+	u64 Iterations{1};
+	// can be changed by the body, for example when it depends on a swept parameter
+	u64 ItemsPerIteration{1};
+
+	s64 ElapsedNs{0};
+	s64 ResumeNs{0};
+	perf_counters Counters{};
+	// extra numbers reported with results, values of the last sample are kept
+	std::vector<std::pair<std::string, double>> UserCounters{};
+
+	// excludes setup and teardown of an iteration from the sample, costs two counter reads
+	FORCEINLINE void PauseTiming() {
+		const s64 NowNs = cycle_clock::GetNs();
+		Counters.Stop();
+		ElapsedNs += NowNs - ResumeNs;
+	}
+
+	FORCEINLINE void ResumeTiming() {
+		Counters.Start();
+		ResumeNs = cycle_clock::GetNs();
+	}
+
+	void SetCounter(std::string_view Name, double Value) {
+		for (auto& [CounterName, CounterValue] : UserCounters) {
+			if (CounterName == Name) {
+				CounterValue = Value;
+				return;
+			}
+		}
+		UserCounters.emplace_back(std::string{Name}, Value);
+	}
+};
+
+struct result {
+	std::string Name{};
+	u64 Iterations{0};
+	u64 ItemsPerIteration{1};
+	// nanoseconds per item of every sample
+	std::vector<double> SamplesNs{};
+	double MedianNs{0};
+	// median absolute deviation from the median
+	double MadNs{0};
+	double MinNs{0};
+	double MeanNs{0};
+	// per item, zero where unavailable
+	double Counters[PerfEventCount]{};
+	std::vector<std::pair<std::string, double>> UserCounters{};
+};
+
+struct session {
+	// results stay in place while more are added
+	std::deque<result> Results{};
+	std::string JsonPath{};
+	// only benchmarks with this in their name run
+	std::string Filter{};
+	// overrides sample count of every benchmark
+	u32 Samples{0};
+};
+
+inline session& GetSession() {
+	static session Session;
+	return Session;
+}
+
+inline double GetMedian(std::vector<double> Values) {
+	if (Values.empty()) {
+		return 0.0;
+	}
+	const size_t Middle = Values.size() / 2;
+	std::nth_element(Values.begin(), Values.begin() + Middle, Values.end());
+	const double Upper = Values[Middle];
+	if (Values.size() % 2 == 1) {
+		return Upper;
+	}
+	return (*std::max_element(Values.begin(), Values.begin() + Middle) + Upper) / 2.0;
+}
+
+inline double GetMedianAbsoluteDeviation(const std::vector<double>& Values, double Median) {
+	std::vector<double> Deviations;
+	Deviations.reserve(Values.size());
+	for (const double Value : Values) {
+		Deviations.push_back(std::abs(Value - Median));
+	}
+	return GetMedian(std::move(Deviations));
+}
+
+// Two-sided Mann-Whitney U test with normal approximation: probability of seeing this much difference in ranks
+// when both sample sets come from the same distribution. Doesn't assume normal samples, timings never are.
+inline double GetPValue(const std::vector<double>& Lhs, const std::vector<double>& Rhs) {
+	const double LhsCount = (double) Lhs.size();
+	const double RhsCount = (double) Rhs.size();
+	if (Lhs.empty() || Rhs.empty()) {
+		return 1.0;
+	}
+	std::vector<std::pair<double, bool>> Combined;
+	for (const double Value : Lhs) {
+		Combined.emplace_back(Value, true);
+	}
+	for (const double Value : Rhs) {
+		Combined.emplace_back(Value, false);
+	}
+	std::sort(Combined.begin(), Combined.end());
+	const double Count = LhsCount + RhsCount;
+	double LhsRankSum = 0.0;
+	double TieCorrection = 0.0;
+	for (size_t Begin = 0; Begin < Combined.size();) {
+		size_t End = Begin + 1;
+		while (End < Combined.size() && Combined[End].first == Combined[Begin].first) {
+			++End;
+		}
+		// tied values share the average of their ranks, ranks start at 1
+		const double Rank = (double) (Begin + End + 1) / 2.0;
+		const double Ties = (double) (End - Begin);
+		TieCorrection += Ties * Ties * Ties - Ties;
+		for (size_t Position = Begin; Position < End; ++Position) {
+			LhsRankSum += Combined[Position].second ? Rank : 0.0;
+		}
+		Begin = End;
+	}
+	const double U = LhsRankSum - LhsCount * (LhsCount + 1.0) / 2.0;
+	const double Mean = LhsCount * RhsCount / 2.0;
+	const double Variance =
+		LhsCount * RhsCount / 12.0 * ((Count + 1.0) - TieCorrection / (Count * (Count - 1.0)));
+	if (Variance <= 0.0) {
+		return 1.0;
+	}
+	const double Z = math::Max(std::abs(U - Mean) - 0.5, 0.0) / std::sqrt(Variance);
+	return std::erfc(Z / std::sqrt(2.0));
+}
+
+inline void PrintResult(const result& Result) {
+	std::cout << "Performance test " << Result.Name << ":\n\t" << Result.MedianNs << " ns, MAD " << Result.MadNs
+			  << " ns, min " << Result.MinNs << " ns, " << Result.SamplesNs.size() << " samples of "
+			  << Result.Iterations << " x " << Result.ItemsPerIteration;
+	if (perf_counters::IsAvailable(perf_event::cycles) && perf_counters::IsAvailable(perf_event::instructions) &&
+		Result.Counters[(index) perf_event::cycles] > 0.0) {
+		std::cout << ", IPC "
+				  << Result.Counters[(index) perf_event::instructions] / Result.Counters[(index) perf_event::cycles];
+	}
+	for (const perf_event Event :
+		 {perf_event::l1d_misses, perf_event::llc_misses, perf_event::branch_misses, perf_event::dtlb_misses}) {
+		if (perf_counters::IsAvailable(Event)) {
+			std::cout << ", " << perf_counters::GetName(Event) << " " << Result.Counters[(index) Event];
+		}
+	}
+	for (const auto& [Name, Value] : Result.UserCounters) {
+		std::cout << ", " << Name << " " << Value;
+	}
+	std::cout << std::endl;
+}
+
+// Calibrates, warms up and samples Body, returns nullptr when the name is filtered out. Result stays valid.
+template <typename body_type>
+const result* Run(std::string_view Name, const config& Config, body_type&& Body) {
+	session& Session = GetSession();
+	if (!Session.Filter.empty() && Name.find(Session.Filter) == std::string_view::npos) {
+		return nullptr;
+	}
+	state State;
+	State.ItemsPerIteration = Config.ItemsPerIteration;
+	const auto RunSample = [&](u64 Iterations) {
+		if (Config.ColdCache) {
+			FlushCache();
+		}
+		State.Iterations = Iterations;
+		State.ElapsedNs = 0;
+		State.Counters.Clear();
+		State.ResumeTiming();
+		Body(State);
+		State.PauseTiming();
+		return State.ElapsedNs;
+	};
+
+	// first samples double as warm-up
+	u64 Iterations = Config.Iterations;
+	if (Iterations == 0) {
+		constexpr u64 MaxIterations = 1'000'000'000;
+		Iterations = 1;
+		for (;;) {
+			const s64 SampleNs = RunSample(Iterations);
+			if (SampleNs >= Config.MinSampleNs || Iterations >= MaxIterations) {
+				break;
+			}
+			// aims a bit over the minimum, so the next sample most likely is the last one
+			const double Scale = SampleNs > 0 ? 1.2 * (double) Config.MinSampleNs / (double) SampleNs : 10.0;
+			Iterations = math::Min((u64) ((double) Iterations * std::clamp(Scale, 1.5, 10.0)) + 1, MaxIterations);
+		}
+	}
+	for (u32 Sample = 0; Sample < Config.WarmupSamples; ++Sample) {
+		RunSample(Iterations);
+	}
+
+	result Result;
+	Result.Name = std::string{Name};
+	Result.Iterations = Iterations;
+	const u32 Samples = math::Max(Session.Samples > 0 ? Session.Samples : Config.Samples, 1u);
+	u64 TotalItems = 0;
+	for (u32 Sample = 0; Sample < Samples; ++Sample) {
+		const s64 SampleNs = RunSample(Iterations);
+		const u64 Items = math::Max(Iterations * State.ItemsPerIteration, (u64) 1);
+		Result.SamplesNs.push_back((double) SampleNs / (double) Items);
+		for (index Event = 0; Event < PerfEventCount; ++Event) {
+			Result.Counters[Event] += (double) State.Counters.Values[Event];
+		}
+		TotalItems += Items;
+	}
+	for (double& Counter : Result.Counters) {
+		Counter /= (double) TotalItems;
+	}
+	Result.ItemsPerIteration = State.ItemsPerIteration;
+	Result.MedianNs = GetMedian(Result.SamplesNs);
+	Result.MadNs = GetMedianAbsoluteDeviation(Result.SamplesNs, Result.MedianNs);
+	Result.MinNs = *std::min_element(Result.SamplesNs.begin(), Result.SamplesNs.end());
+	double Sum = 0.0;
+	for (const double SampleNs : Result.SamplesNs) {
+		Sum += SampleNs;
+	}
+	Result.MeanNs = Sum / (double) Result.SamplesNs.size();
+	Result.UserCounters = std::move(State.UserCounters);
+	Session.Results.push_back(std::move(Result));
+	PrintResult(Session.Results.back());
+	return &Session.Results.back();
+}
+
+// Runs Body(State, Parameter) for every parameter, named "Name/Parameter"
+template <typename parameter_type, typename body_type>
+void Sweep(std::string_view Name, std::initializer_list<parameter_type> Parameters, const config& Config,
+		   body_type&& Body) {
+	for (const parameter_type& Parameter : Parameters) {
+		std::ostringstream FullName;
+		FullName << Name << "/" << Parameter;
+		Run(FullName.str(), Config, [&](state& State) { Body(State, Parameter); });
+	}
+}
+
+inline void WriteEscaped(std::ostream& Stream, std::string_view Text) {
+	for (const char Char : Text) {
+		if (Char == '"' || Char == '\\') {
+			Stream << '\\';
+		}
+		Stream << (Char >= ' ' ? Char : ' ');
+	}
+}
+
+inline void WriteJson(std::ostream& Stream, const std::deque<result>& Results) {
+	Stream << std::setprecision(17) << "{\"benchmarks\": [";
+	for (size_t ResultIndex = 0; ResultIndex < Results.size(); ++ResultIndex) {
+		const result& Result = Results[ResultIndex];
+		Stream << (ResultIndex > 0 ? ",\n" : "\n") << "\t{\"name\": \"";
+		WriteEscaped(Stream, Result.Name);
+		Stream << "\", \"iterations\": " << Result.Iterations
+			   << ", \"items_per_iteration\": " << Result.ItemsPerIteration << ", \"median_ns\": " << Result.MedianNs
+			   << ", \"mad_ns\": " << Result.MadNs << ", \"min_ns\": " << Result.MinNs
+			   << ", \"mean_ns\": " << Result.MeanNs << ", \"samples_ns\": [";
+		for (size_t Sample = 0; Sample < Result.SamplesNs.size(); ++Sample) {
+			Stream << (Sample > 0 ? ", " : "") << Result.SamplesNs[Sample];
+		}
+		Stream << "], \"counters\": {";
+		bool First = true;
+		for (index Event = 0; Event < PerfEventCount; ++Event) {
+			if (perf_counters::IsAvailable((perf_event) Event)) {
+				Stream << (First ? "\"" : ", \"") << perf_counters::GetName((perf_event) Event)
+					   << "\": " << Result.Counters[Event];
+				First = false;
+			}
+		}
+		for (const auto& [Name, Value] : Result.UserCounters) {
+			Stream << (First ? "\"" : ", \"");
+			WriteEscaped(Stream, Name);
+			Stream << "\": " << Value;
+			First = false;
+		}
+		Stream << "}}";
+	}
+	Stream << "\n]}\n";
+}
+
+namespace internal {
+// just enough JSON to read back what WriteJson() writes
+struct json_value {
+	enum class kind : u8 { null, boolean, number, string, array, object };
+
+	kind Kind{kind::null};
+	double Number{0.0};
+	std::string String{};
+	std::vector<json_value> Items{};
+	// object members, keys and values at the same positions
+	std::vector<std::string> Keys{};
+
+	[[nodiscard]] const json_value* Find(std::string_view Key) const {
+		for (size_t Member = 0; Member < Keys.size(); ++Member) {
+			if (Keys[Member] == Key) {
+				return &Items[Member];
+			}
+		}
+		return nullptr;
+	}
+};
+
+struct json_parser {
+	std::string_view Text;
+	size_t Position{0};
+
+	void SkipSpace() {
+		while (Position < Text.size() && std::isspace((unsigned char) Text[Position])) {
+			++Position;
+		}
+	}
+
+	bool Consume(char Char) {
+		SkipSpace();
+		if (Position < Text.size() && Text[Position] == Char) {
+			++Position;
+			return true;
+		}
+		return false;
+	}
+
+	bool ParseString(std::string& Out) {
+		if (!Consume('"')) {
+			return false;
+		}
+		while (Position < Text.size() && Text[Position] != '"') {
+			if (Text[Position] == '\\' && Position + 1 < Text.size()) {
+				++Position;
+			}
+			Out += Text[Position++];
+		}
+		return Consume('"');
+	}
+
+	bool Parse(json_value& Out) {
+		SkipSpace();
+		if (Position >= Text.size()) {
+			return false;
+		}
+		const char Char = Text[Position];
+		if (Char == '{') {
+			Out.Kind = json_value::kind::object;
+			++Position;
+			if (Consume('}')) {
+				return true;
+			}
+			do {
+				Out.Keys.emplace_back();
+				Out.Items.emplace_back();
+				if (!ParseString(Out.Keys.back()) || !Consume(':') || !Parse(Out.Items.back())) {
+					return false;
+				}
+			} while (Consume(','));
+			return Consume('}');
+		}
+		if (Char == '[') {
+			Out.Kind = json_value::kind::array;
+			++Position;
+			if (Consume(']')) {
+				return true;
+			}
+			do {
+				Out.Items.emplace_back();
+				if (!Parse(Out.Items.back())) {
+					return false;
+				}
+			} while (Consume(','));
+			return Consume(']');
+		}
+		if (Char == '"') {
+			Out.Kind = json_value::kind::string;
+			return ParseString(Out.String);
+		}
+		for (const std::string_view Literal : {"true", "false", "null"}) {
+			if (Text.substr(Position, Literal.size()) == Literal) {
+				Out.Kind = Literal == "null" ? json_value::kind::null : json_value::kind::boolean;
+				Out.Number = Literal == "true" ? 1.0 : 0.0;
+				Position += Literal.size();
+				return true;
+			}
+		}
+		const char* Begin = Text.data() + Position;
+		char* End = nullptr;
+		Out.Kind = json_value::kind::number;
+		Out.Number = std::strtod(Begin, &End);
+		Position += (size_t) (End - Begin);
+		return End != Begin;
+	}
+};
+}	 // namespace internal
+
+// names and samples of results written by WriteJson(), false when the file can't be read or parsed
+inline bool ReadJson(std::string_view Path, std::vector<result>& OutResults) {
+	std::ifstream File{std::string{Path}, std::ios::binary};
+	if (!File) {
+		return false;
+	}
+	std::ostringstream Contents;
+	Contents << File.rdbuf();
+	const std::string Text = Contents.str();
+	internal::json_parser Parser{Text};
+	internal::json_value Root;
+	if (!Parser.Parse(Root)) {
+		return false;
+	}
+	const internal::json_value* Benchmarks = Root.Find("benchmarks");
+	if (!Benchmarks) {
+		return false;
+	}
+	for (const internal::json_value& Benchmark : Benchmarks->Items) {
+		const internal::json_value* Name = Benchmark.Find("name");
+		const internal::json_value* Samples = Benchmark.Find("samples_ns");
+		if (!Name || !Samples) {
+			return false;
+		}
+		result& Result = OutResults.emplace_back();
+		Result.Name = Name->String;
+		for (const internal::json_value& Sample : Samples->Items) {
+			Result.SamplesNs.push_back(Sample.Number);
+		}
+		Result.MedianNs = GetMedian(Result.SamplesNs);
+		Result.MadNs = GetMedianAbsoluteDeviation(Result.SamplesNs, Result.MedianNs);
+	}
+	return true;
+}
+
+struct compare_config {
+	// chance to call noise a change
+	double Alpha{0.01};
+	// smaller changes of the median are not reported even when they are significant
+	double MinChange{0.02};
+};
+
+enum class verdict : u8 { same, faster, slower };
+
+inline verdict Compare(const result& Base, const result& New, const compare_config& Config, double& OutPValue) {
+	OutPValue = GetPValue(Base.SamplesNs, New.SamplesNs);
+	const double Change = Base.MedianNs > 0.0 ? New.MedianNs / Base.MedianNs - 1.0 : 0.0;
+	if (OutPValue >= Config.Alpha || std::abs(Change) < Config.MinChange) {
+		return verdict::same;
+	}
+	return Change > 0.0 ? verdict::slower : verdict::faster;
+}
+
+// prints every benchmark present in both files, 1 when any of them is significantly slower in the new one
+inline s32 CompareFiles(std::string_view BasePath, std::string_view NewPath, const compare_config& Config = {}) {
+	std::vector<result> BaseResults;
+	std::vector<result> NewResults;
+	if (!ReadJson(BasePath, BaseResults) || !ReadJson(NewPath, NewResults)) {
+		std::cout << "Can't read " << BasePath << " or " << NewPath << std::endl;
+		return 2;
+	}
+	u32 Regressions = 0;
+	for (const result& New : NewResults) {
+		const auto Base = std::find_if(
+			BaseResults.begin(), BaseResults.end(), [&](const result& Result) { return Result.Name == New.Name; });
+		if (Base == BaseResults.end()) {
+			continue;
+		}
+		double PValue;
+		const verdict Verdict = Compare(*Base, New, Config, PValue);
+		const char* VerdictName[] = {"same", "faster", "SLOWER"};
+		std::cout << VerdictName[(index) Verdict] << "\t" << New.Name << ":\n\t" << Base->MedianNs << " ns -> "
+				  << New.MedianNs << " ns (" << std::showpos << (New.MedianNs / Base->MedianNs - 1.0) * 100.0
+				  << std::noshowpos << "%), p " << PValue << std::endl;
+		Regressions += Verdict == verdict::slower;
+	}
+	std::cout << Regressions << " regressions" << std::endl;
+	return Regressions > 0 ? 1 : 0;
+}
+
+// harness options, tests skip them when parsing their own
+inline bool IsOption(std::string_view Argument) {
+	return Argument.starts_with("--json=") || Argument.starts_with("--filter=") || Argument.starts_with("--samples=");
+}
+
+inline void ParseOptions(std::span<char*> Args) {
+	session& Session = GetSession();
+	for (const char* Arg : Args) {
+		const std::string_view Argument{Arg};
+		const std::string_view Value = Argument.substr(math::Min(Argument.find('=') + 1, Argument.size()));
+		if (Argument.starts_with("--json=")) {
+			Session.JsonPath = Value;
+		} else if (Argument.starts_with("--filter=")) {
+			Session.Filter = Value;
+		} else if (Argument.starts_with("--samples=")) {
+			Session.Samples = (u32) std::strtoul(std::string{Value}.c_str(), nullptr, 10);
+		}
+	}
+}
+
+// writes results when asked to, exit code of the benchmark run
+inline s32 Finish() {
+	const session& Session = GetSession();
+	if (Session.JsonPath.empty()) {
+		return 0;
+	}
+	std::ofstream File{Session.JsonPath, std::ios::binary};
+	WriteJson(File, Session.Results);
+	File.close();
+	if (!File) {
+		std::cout << "Can't write " << Session.JsonPath << std::endl;
+		return 1;
+	}
+	std::cout << "Results written to " << Session.JsonPath << std::endl;
+	return 0;
+}
+}	 // namespace bench
@@ -2,6 +2,7 @@
 
 #include "core.h"
 #include "Core/Hash/hash.h"
+#include "benchmark.h"
 
 #include <chrono>
 #include <iostream>
@@ -26,45 +27,6 @@ size_t GetTotalUsedVirtualMemory() {
 }
 #endif
 
-// NOTE: commented out since not used and increases GCC ocmpilation times by a lot
-//constexpr u64 GarbageLength = 20 * 1024 * 1024;
-//static u64 GarbageBytes[GarbageLength]{0xff};
-
-FORCEINLINE void ClearCache() {
-//	for (int i = 0; i < 2000; i++) {
-//		GarbageBytes[rand() % GarbageLength] = GarbageBytes[rand() % GarbageLength];
-//	}
-}
-
-struct timer {
-	using time_point = std::chrono::time_point<std::chrono::high_resolution_clock>;
-	time_point mStart{};
-	float mAccumulator{0};
-
-	void Start() {
-		mStart = std::chrono::high_resolution_clock::now();
-	}
-
-	void Stop() {
-		time_point End = std::chrono::high_resolution_clock::now();
-		s64 Time = std::chrono::duration_cast<std::chrono::microseconds>(End - mStart).count();
-		mAccumulator += Time / 1000.f;
-	}
-
-	[[nodiscard]] float Result() const {
-		return mAccumulator;
-	}
-
-	void Offset(const timer& OffsetTimer) {
-		mAccumulator -= OffsetTimer.mAccumulator;
-	}
-
-	void Clear() {
-		mStart = {};
-		mAccumulator = 0;
-	}
-};
-
 template <bool Relocatable = false>
 struct complex_type_template {
 	static inline s64 NumInstances = 0;
@@ -192,14 +154,17 @@ FORCEINLINE static value_type MakeValue(s64 value) {
 		std::cout << "CHECK PASSED: " << (TestName) << std::endl;                     \
 	}
 
-#define TEST_ENTRY(TestClass)                                                \
-	int main(int Argc, char** Argv) {                                        \
-		TestClass Test;                                                      \
-		auto Args = std::span(Argv, size_t(Argc));                           \
-		if (Args.size() > 1 && std::string_view(Args[1]) == "--benchmark") { \
-			Test.Benchmark(Args);                                            \
-			return 0;                                                        \
-		} else {                                                             \
-			return Test.Test(Args);                                          \
-		}                                                                    \
+#define TEST_ENTRY(TestClass)                                                     \
+	int main(int Argc, char** Argv) {                                             \
+		TestClass Test;                                                           \
+		auto Args = std::span(Argv, size_t(Argc));                                \
+		if (Args.size() > 1 && std::string_view(Args[1]) == "--benchmark") {      \
+			bench::ParseOptions(Args.subspan(2));                                 \
+			Test.Benchmark(Args);                                                 \
+			return bench::Finish();                                               \
+		} else if (Args.size() > 3 && std::string_view(Args[1]) == "--compare") { \
+			return bench::CompareFiles(Args[2], Args[3]);                         \
+		} else {                                                                  \
+			return Test.Test(Args);                                               \
+		}                                                                         \
 	}